@@ -0,0 +1,106 @@
+#pragma once
+
+// for size_t and std::swap
+#include <stddef.h>
+#include <utility>
+
+#ifdef _MSC_VER
+#include <malloc.h>     // _aligned_malloc(...) and _aligned_free(...)
+#else
+#include <stdlib.h>     // posix_memalign(...) and free(...)
+#endif
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A heap-allocated array whose first element starts on an "alignment"-byte boundary.  SIMD
+    load/store instructions want 16-byte (SSE) or 32-byte (AVX) aligned addresses, and a stack
+    array both cannot make that promise and will overflow long before a 16k x 16k texture fits
+    in it.
+
+    Note: The elements are NOT constructed or destructed.  This is only meant for plain data
+    (texels, vertices, indices) that will be written before it is read.
+    Also Note: Move-only.  Copying megabytes of texels by accident is exactly the kind of
+    thing this is supposed to prevent.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+template<typename T, size_t alignment = 32>
+class AlignedBuffer
+{
+public:
+    AlignedBuffer() :
+        _data(0),
+        _count(0)
+    {
+    }
+
+    explicit AlignedBuffer(size_t count) :
+        _data(0),
+        _count(0)
+    {
+        Resize(count);
+    }
+
+    AlignedBuffer(AlignedBuffer &&other) noexcept :
+        _data(other._data),
+        _count(other._count)
+    {
+        other._data = 0;
+        other._count = 0;
+    }
+
+    AlignedBuffer &operator=(AlignedBuffer &&other) noexcept
+    {
+        std::swap(_data, other._data);
+        std::swap(_count, other._count);
+        return *this;
+    }
+
+    ~AlignedBuffer()
+    {
+        Free();
+    }
+
+    // throws away any existing contents
+    void Resize(size_t count)
+    {
+        Free();
+        if (count == 0)
+        {
+            return;
+        }
+
+#ifdef _MSC_VER
+        _data = static_cast<T *>(_aligned_malloc(count * sizeof(T), alignment));
+#else
+        void *mem = 0;
+        _data = (posix_memalign(&mem, alignment, count * sizeof(T)) == 0) ?
+            static_cast<T *>(mem) : 0;
+#endif
+        _count = (_data != 0) ? count : 0;
+    }
+
+    T *Data() { return _data; }
+    const T *Data() const { return _data; }
+    size_t Count() const { return _count; }
+    size_t SizeBytes() const { return _count * sizeof(T); }
+    T &operator[](size_t index) { return _data[index]; }
+    const T &operator[](size_t index) const { return _data[index]; }
+
+private:
+    AlignedBuffer(const AlignedBuffer &);
+    AlignedBuffer &operator=(const AlignedBuffer &);
+
+    void Free()
+    {
+#ifdef _MSC_VER
+        _aligned_free(_data);
+#else
+        free(_data);
+#endif
+        _data = 0;
+        _count = 0;
+    }
+
+    T *_data;
+    size_t _count;
+};
@@ -0,0 +1,2235 @@
+// the OpenGL version include has to come before anything else that might touch OpenGL
+#include "glload/include/glload/gl_4_4.h"
+
+#include "Benchmark.h"
+#include "TextureGenerator.h"
+#include "TexelFormatConverter.h"
+#include "MipChainBuilder.h"
+#include "TextureUpload.h"
+#include "BlockCompressor.h"
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
+#include "SpriteBatcher.h"
+#include "MultiDrawRenderer.h"
+#include "GpuCuller.h"
+#include "GpuBufferArena.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshFile.h"
+#include "DynamicVertexBuffer.h"
+#include "GlStateCache.h"
+#include "RenderQueue.h"
+
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <random>
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+
+// for printf(...)
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Runs something a few times and keeps the fastest run.  The slower runs are usually the
+    ones that got interrupted or that were paging in fresh memory, and that's noise.
+Parameters:
+    numRuns     How many times to run it.
+    func        The thing to time.
+Returns:
+    The fastest run, in seconds.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static double BestTimeSeconds(int numRuns, const std::function<void()> &func)
+{
+    double bestSeconds = 0.0;
+    for (int runCount = 0; runCount < numRuns; runCount++)
+    {
+        std::chrono::high_resolution_clock::time_point start =
+            std::chrono::high_resolution_clock::now();
+        func();
+        std::chrono::duration<double> elapsed =
+            std::chrono::high_resolution_clock::now() - start;
+        if ((runCount == 0) || (elapsed.count() < bestSeconds))
+        {
+            bestSeconds = elapsed.count();
+        }
+    }
+
+    return bestSeconds;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The texel loop that CreateTexture() used to have, kept here (except for writing into a
+    heap buffer instead of a stack array) so that there's something to compare against.
+Parameters:
+    texels          Where to write.  Must hold texelsPerRow * numRows texels.
+    texelsPerRow    How many texels wide.
+    numRows         How many texels tall.
+Returns:    None
+Exception:  Safe
+Creator:    John Cox (2-24-2016)
+-----------------------------------------------------------------------------------------------*/
+static void OriginalTexelLoop(texel *texels, unsigned int texelsPerRow, unsigned int numRows)
+{
+    for (size_t rowCounter = 0; rowCounter < numRows; rowCounter++)
+    {
+        for (size_t colCounter = 0; colCounter < texelsPerRow; colCounter++)
+        {
+            texel t = { 0.0f, 0.0f, 0.0f, 0.0f };
+            if (rowCounter < (numRows / 3))
+            {
+                t = { 1.0f, 0.0f, 0.0f, 1.0f };
+            }
+            else if (rowCounter < ((2 * numRows) / 3))
+            {
+                t = { 0.0f, 1.0f, 0.0f, 1.0f };
+            }
+            else
+            {
+                t = { 0.0f, 0.0f, 1.0f, 1.0f };
+            }
+
+            texels[(rowCounter * texelsPerRow) + colCounter] = t;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Compares the original one-texel-at-a-time loop against the banded SIMD fill, both on one
+    thread and on the shared thread pool, and prints megatexels per second for each.
+
+    Note: The fill is limited by memory bandwidth long before it is limited by instructions,
+    so the multithreaded number will flatten out at however many threads it takes to saturate
+    the memory bus.
+Parameters:
+    texelsPerRow    How many texels wide.
+    numRows         How many texels tall.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BenchmarkTextureGeneration(unsigned int texelsPerRow, unsigned int numRows)
+{
+    const int NUM_RUNS = 5;
+    double megatexels = ((double)texelsPerRow * numRows) / 1000000.0;
+    printf("texture generation: %ux%u (%.1f MB), %s stores, %u worker threads + main\n",
+        texelsPerRow, numRows, (megatexels * sizeof(texel)), TexelFillInstructionSet(),
+        ThreadPool::Shared().NumWorkers());
+
+    // Note: Both versions write into memory that has already been touched once, so that the
+    // page faults from a fresh allocation don't get charged to whichever one runs first.
+    TexelBuffer original((size_t)texelsPerRow * numRows);
+    TexelBuffer generated((size_t)texelsPerRow * numRows);
+    if ((original.Data() == 0) || (generated.Data() == 0))
+    {
+        printf("could not allocate %ux%u texels\n", texelsPerRow, numRows);
+        return;
+    }
+
+    OriginalTexelLoop(original.Data(), texelsPerRow, numRows);
+    FillTricolorTextureSingleThreaded(generated.Data(), texelsPerRow, numRows);
+
+    double originalSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        OriginalTexelLoop(original.Data(), texelsPerRow, numRows);
+    });
+    double singleThreadSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        FillTricolorTextureSingleThreaded(generated.Data(), texelsPerRow, numRows);
+    });
+    double multiThreadSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        FillTricolorTexture(generated.Data(), texelsPerRow, numRows);
+    });
+
+    // make sure that the new way makes the same thing as the old way
+    size_t mismatchCount = 0;
+    for (size_t texelCount = 0; texelCount < generated.Count(); texelCount++)
+    {
+        const texel &a = original[texelCount];
+        const texel &b = generated[texelCount];
+        if ((a.r != b.r) || (a.g != b.g) || (a.b != b.b) || (a.a != b.a))
+        {
+            mismatchCount++;
+        }
+    }
+
+    printf("    original loop:          %10.1f Mtexels/s\n", megatexels / originalSeconds);
+    printf("    SIMD, 1 thread:         %10.1f Mtexels/s\n", megatexels / singleThreadSeconds);
+    printf("    SIMD, thread pool:      %10.1f Mtexels/s\n", megatexels / multiThreadSeconds);
+    printf("    speedup:                %10.2fx\n", originalSeconds / multiThreadSeconds);
+    printf("    mismatched texels:      %10u\n", (unsigned int)mismatchCount);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    For every packed texel format, checks that the SIMD conversion produces exactly the same
+    bytes as the scalar reference and then prints how fast each one goes.
+
+    The check doesn't use the demo's texture because red/green/blue at exactly 0.0 and 1.0
+    would never exercise the rounding.  It uses random values across a wide range plus the
+    nasty ones (NaN, infinities, negatives, denormals, values that round up past the format's
+    largest finite value).
+Parameters:
+    texelsPerRow    How many texels wide the timed texture is.
+    numRows         How many texels tall the timed texture is.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BenchmarkTexelConversion(unsigned int texelsPerRow, unsigned int numRows)
+{
+    const int NUM_RUNS = 5;
+    size_t numTexels = (size_t)texelsPerRow * numRows;
+    double megatexels = (double)numTexels / 1000000.0;
+    printf("texel conversion: %ux%u, %u worker threads + main\n", texelsPerRow, numRows,
+        ThreadPool::Shared().NumWorkers());
+
+    // the tricky values come first and then random floats fill in the rest
+    const size_t NUM_CHECK_TEXELS = 64 * 1024;
+    TexelBuffer checkTexels(NUM_CHECK_TEXELS);
+    TexelBuffer timedTexels = GenerateTricolorTexture(texelsPerRow, numRows);
+    if ((checkTexels.Data() == 0) || (timedTexels.Data() == 0))
+    {
+        printf("could not allocate texels\n");
+        return;
+    }
+
+    const unsigned int SPECIAL_BITS[] =
+    {
+        0x00000000, 0x80000000, 0x7F800000, 0xFF800000, 0x7FC00000, 0xFFC00001, 0x7F800001,
+        0x00000001, 0x807FFFFF, 0x33800000, 0x387FC000, 0x38800000, 0x477FE000, 0x477FF000,
+        0x477FFFFF, 0x47800000, 0x3F800000, 0x3F7FFFFF, 0x3B808081, 0x3F000000, 0xBF800000,
+    };
+    float *checkFloats = (float *)checkTexels.Data();
+    const size_t NUM_SPECIAL = sizeof(SPECIAL_BITS) / sizeof(SPECIAL_BITS[0]);
+    std::mt19937 randomEngine(12345);
+    std::uniform_real_distribution<float> randomExponent(-30.0f, 20.0f);
+    std::uniform_real_distribution<float> randomSign(-0.25f, 1.0f);
+    for (size_t floatCount = 0; floatCount < NUM_CHECK_TEXELS * 4; floatCount++)
+    {
+        if (floatCount < NUM_SPECIAL)
+        {
+            memcpy(&checkFloats[floatCount], &SPECIAL_BITS[floatCount], sizeof(float));
+        }
+        else
+        {
+            // mostly positive, spread across many exponents
+            float sign = (randomSign(randomEngine) < 0.0f) ? -1.0f : 1.0f;
+            checkFloats[floatCount] = sign * powf(2.0f, randomExponent(randomEngine));
+        }
+    }
+
+    for (int formatIndex = 0; formatIndex < TEXEL_FORMAT_COUNT; formatIndex++)
+    {
+        TexelFormat format = (TexelFormat)formatIndex;
+        const TexelFormatDescription &description = GetTexelFormatDescription(format);
+
+        // bit-exact check
+        PackedTexelBuffer scalarBytes(NUM_CHECK_TEXELS * description.bytesPerTexel);
+        PackedTexelBuffer simdBytes(NUM_CHECK_TEXELS * description.bytesPerTexel);
+        ConvertTexelsScalar(checkTexels.Data(), NUM_CHECK_TEXELS, format, scalarBytes.Data());
+        ConvertTexelsSimd(checkTexels.Data(), NUM_CHECK_TEXELS, format, simdBytes.Data());
+        size_t mismatchCount = 0;
+        for (size_t byteCount = 0; byteCount < scalarBytes.Count(); byteCount++)
+        {
+            if (scalarBytes[byteCount] != simdBytes[byteCount])
+            {
+                mismatchCount++;
+            }
+        }
+
+        // throughput, scalar on one thread versus SIMD on the thread pool
+        PackedTexelBuffer timedBytes(numTexels * description.bytesPerTexel);
+        ConvertTexelsScalar(timedTexels.Data(), numTexels, format, timedBytes.Data());
+        double scalarSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+        {
+            ConvertTexelsScalar(timedTexels.Data(), numTexels, format, timedBytes.Data());
+        });
+        double simdSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+        {
+            ConvertTexels(timedTexels.Data(), numTexels, format, timedBytes.Data());
+        });
+
+        printf("    %-11s %2u bytes/texel  scalar %9.1f Mtexels/s  %-8s %9.1f Mtexels/s  "
+            "(%.1fx upload size reduction)  %s\n",
+            description.name, description.bytesPerTexel, megatexels / scalarSeconds,
+            TexelConversionInstructionSet(format), megatexels / simdSeconds,
+            (double)sizeof(texel) / description.bytesPerTexel,
+            (mismatchCount == 0) ? "bit-exact" : "MISMATCH");
+        if (mismatchCount != 0)
+        {
+            printf("        %u of %u bytes differ from the scalar reference\n",
+                (unsigned int)mismatchCount, (unsigned int)scalarBytes.Count());
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Times the block compressor for each format and measures how much quality it loses.
+
+    Note: The tricolor texture is three solid colors, which every format compresses perfectly,
+    so the quality is measured on a made-up "photo-like" image instead: a smooth color ramp,
+    a checkerboard of hard edges, a little noise, and an alpha ramp.  The CPU decoder turns
+    the blocks back into texels for the comparison, so this doesn't need a GPU.
+Parameters:
+    texelsPerRow    Image width.
+    numRows         Image height.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BenchmarkBlockCompression(unsigned int texelsPerRow, unsigned int numRows)
+{
+    const int NUM_RUNS = 3;
+    size_t numTexels = (size_t)texelsPerRow * numRows;
+    double megatexels = (double)numTexels / 1000000.0;
+    printf("block compression: %ux%u, %u worker threads + main\n", texelsPerRow, numRows,
+        ThreadPool::Shared().NumWorkers());
+
+    PackedTexelBuffer original(numTexels * 4);
+    PackedTexelBuffer decoded(numTexels * 4);
+    if ((original.Data() == 0) || (decoded.Data() == 0))
+    {
+        printf("could not allocate texels\n");
+        return;
+    }
+
+    std::mt19937 randomEngine(12345);
+    std::uniform_int_distribution<int> randomNoise(-6, 6);
+    for (unsigned int row = 0; row < numRows; row++)
+    {
+        for (unsigned int col = 0; col < texelsPerRow; col++)
+        {
+            float x = (float)col / texelsPerRow;
+            float y = (float)row / numRows;
+            float values[4] =
+            {
+                127.5f + (127.5f * sinf(x * 12.0f)),
+                255.0f * y,
+                (((col / 32) + (row / 32)) % 2 == 0) ? 40.0f : 200.0f,
+                255.0f * (1.0f - (0.5f * x) - (0.5f * y)),
+            };
+            unsigned char *dest = original.Data() + ((((size_t)row * texelsPerRow) + col) * 4);
+            for (int channel = 0; channel < 4; channel++)
+            {
+                float value = values[channel] + (float)randomNoise(randomEngine);
+                dest[channel] = (unsigned char)std::min(std::max(value, 0.0f), 255.0f);
+            }
+        }
+    }
+
+    for (int formatIndex = BLOCK_FORMAT_NONE + 1; formatIndex < BLOCK_FORMAT_COUNT; formatIndex++)
+    {
+        BlockFormat format = (BlockFormat)formatIndex;
+        const BlockFormatDescription &description = GetBlockFormatDescription(format);
+        PackedTexelBuffer blocks(CompressedSizeBytes(texelsPerRow, numRows, format));
+        if (blocks.Data() == 0)
+        {
+            printf("could not allocate blocks\n");
+            return;
+        }
+
+        double encodeSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+        {
+            CompressTexels(original.Data(), texelsPerRow, numRows, format, blocks.Data());
+        });
+        double decodeSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+        {
+            DecompressBlocks(blocks.Data(), texelsPerRow, numRows, format, decoded.Data());
+        });
+        double psnr = ComputePsnr(original.Data(), decoded.Data(), numTexels,
+            description.hasAlpha);
+
+        printf("    %-4s %4.1f bits/texel  encode %8.2f Mtexels/s  decode %8.1f Mtexels/s  "
+            "PSNR %5.2f dB (%s)\n", description.name,
+            (double)blocks.SizeBytes() * 8.0 / numTexels, megatexels / encodeSeconds,
+            megatexels / decodeSeconds, psnr, description.hasAlpha ? "RGBA" : "RGB");
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Compares building the mip chain on the CPU (and uploading every level) against uploading
+    level 0 and letting the driver make the rest with glGenerateMipmap(...).  Both include
+    the upload, and both end with glFinish() so that the driver can't hide work by deferring
+    it.
+
+    Note: On a software renderer like Mesa's llvmpipe, glGenerateMipmap(...) runs on the same
+    CPU cores as everything else, so this is a straight comparison of the two CPU
+    implementations.  On real hardware, the driver's version runs on the GPU and the
+    interesting number is how long the CPU side blocks.
+Parameters:
+    texelsPerRow    How many texels wide.
+    numRows         How many texels tall.
+    texelFormat     The format that both versions store the texture in.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BenchmarkMipmapGeneration(unsigned int texelsPerRow, unsigned int numRows, 
+    TexelFormat texelFormat)
+{
+    const int NUM_RUNS = 5;
+    printf("mipmap generation: %ux%u, %u levels, %s, %s filter, renderer '%s'\n", 
+        texelsPerRow, numRows, NumMipLevels(texelsPerRow, numRows), 
+        GetTexelFormatDescription(texelFormat).name, MipFilterInstructionSet(),
+        (const char *)glGetString(GL_RENDERER));
+
+    TexelBuffer level0 = GenerateTricolorTexture(texelsPerRow, numRows);
+    if (level0.Data() == 0)
+    {
+        printf("could not allocate texels\n");
+        return;
+    }
+
+    // CPU only, no upload
+    double buildSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        BuildMipChain(level0.Data(), texelsPerRow, numRows);
+    });
+
+    // every run gets a fresh texture so that nothing is reused between runs
+    GlStateCache &stateCache = GlStateCache::Shared();
+    double cpuChainSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        GLuint textureId = 0;
+        glGenTextures(1, &textureId);
+        stateCache.BindTexture(0, GL_TEXTURE_2D, textureId);
+        std::vector<MipLevel> mipLevels = BuildMipChain(level0.Data(), texelsPerRow, numRows);
+        UploadMipChain(level0.Data(), texelsPerRow, numRows, mipLevels, texelFormat);
+        glFinish();
+        glDeleteTextures(1, &textureId);
+        stateCache.ForgetTexture(textureId);
+    });
+
+    double driverSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        GLuint textureId = 0;
+        glGenTextures(1, &textureId);
+        stateCache.BindTexture(0, GL_TEXTURE_2D, textureId);
+        glTexStorage2D(GL_TEXTURE_2D, NumMipLevels(texelsPerRow, numRows),
+            GetTexelFormatDescription(texelFormat).internalFormat, texelsPerRow, numRows);
+        UploadTexelsToLevel(0, texelsPerRow, numRows, level0.Data(), texelFormat);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glFinish();
+        glDeleteTextures(1, &textureId);
+        stateCache.ForgetTexture(textureId);
+    });
+
+    printf("    CPU chain build only:               %9.2f ms\n", buildSeconds * 1000.0);
+    printf("    CPU chain + upload all levels:      %9.2f ms\n", cpuChainSeconds * 1000.0);
+    printf("    upload level 0 + glGenerateMipmap:  %9.2f ms\n", driverSeconds * 1000.0);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Compares updating a texture every frame the old way (make the texels and then
+    glTexSubImage2D(...) from client memory, all on the OpenGL thread) against the
+    TextureStreamer (producers on the thread pool write into mapped buffers, and the OpenGL
+    thread only queues up uploads from them).
+
+    The number that matters is how long the OpenGL thread is busy per image, since that's
+    time taken away from drawing.  Both runs end with glFinish() so that the streaming run
+    can't leave its uploads unfinished.
+Parameters:
+    texelsPerRow    How many texels wide.
+    numRows         How many texels tall.
+    texelFormat     What the texels are packed into.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BenchmarkTextureStreaming(unsigned int texelsPerRow, unsigned int numRows,
+    TexelFormat texelFormat)
+{
+    const unsigned int NUM_FRAMES = 300;
+    const TexelFormatDescription &description = GetTexelFormatDescription(texelFormat);
+    size_t bytesPerImage = (size_t)texelsPerRow * numRows * description.bytesPerTexel;
+    printf("texture streaming: %ux%u %s (%.1f KB/image), %u frames, renderer '%s'\n",
+        texelsPerRow, numRows, description.name, bytesPerImage / 1024.0, NUM_FRAMES,
+        (const char *)glGetString(GL_RENDERER));
+    TextureProducer producer = MakeScrollingTricolorProducer(texelsPerRow, numRows,
+        texelFormat);
+
+    // the old way
+    PackedTexelBuffer clientTexels(bytesPerImage);
+    if (clientTexels.Data() == 0)
+    {
+        printf("could not allocate texels\n");
+        return;
+    }
+    GlStateCache &stateCache = GlStateCache::Shared();
+    GLuint textureId;
+    glGenTextures(1, &textureId);
+    stateCache.BindTexture(0, GL_TEXTURE_2D, textureId);
+    glTexStorage2D(GL_TEXTURE_2D, 1, description.internalFormat, texelsPerRow, numRows);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, (description.bytesPerTexel >= 4) ? 4 :
+        description.bytesPerTexel);
+    glFinish();
+    std::chrono::high_resolution_clock::time_point start =
+        std::chrono::high_resolution_clock::now();
+    for (unsigned int frameCount = 0; frameCount < NUM_FRAMES; frameCount++)
+    {
+        producer(frameCount, clientTexels.Data());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texelsPerRow, numRows, description.format,
+            description.type, clientTexels.Data());
+    }
+    std::chrono::duration<double> syncGlThreadSeconds =
+        std::chrono::high_resolution_clock::now() - start;
+    glFinish();
+    std::chrono::duration<double> syncTotalSeconds =
+        std::chrono::high_resolution_clock::now() - start;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glDeleteTextures(1, &textureId);
+    stateCache.ForgetTexture(textureId);
+
+    // the streamer
+    // Note: A real frame would be drawing between Update() calls.  Here, the loop just gives
+    // up the CPU so that it doesn't starve the producers while it waits for the next image.
+    TextureStreamer streamer;
+    if (!streamer.Init(texelsPerRow, numRows, texelFormat, 3, producer))
+    {
+        return;
+    }
+    glFinish();
+    start = std::chrono::high_resolution_clock::now();
+    while (streamer.Stats().numUploads < NUM_FRAMES)
+    {
+        streamer.Update();
+        std::this_thread::yield();
+    }
+    glFinish();
+    std::chrono::duration<double> streamTotalSeconds =
+        std::chrono::high_resolution_clock::now() - start;
+    TextureStreamerStats stats = streamer.Stats();
+    streamer.Shutdown();
+
+    printf("    client memory  %8.3f ms/image on the GL thread  %8.1f images/s\n",
+        syncGlThreadSeconds.count() * 1000.0 / NUM_FRAMES,
+        NUM_FRAMES / syncTotalSeconds.count());
+    printf("    PBO ring       %8.3f ms/image on the GL thread  %8.1f images/s  "
+        "(%.3f ms/image fence polling, %.1f KB/update, %llu of %llu updates without new "
+        "texels)\n",
+        stats.updateSeconds * 1000.0 / stats.numUploads,
+        stats.numUploads / streamTotalSeconds.count(),
+        stats.fenceWaitSeconds * 1000.0 / stats.numUploads,
+        (double)stats.bytesUploaded / stats.numFrames / 1024.0, stats.framesWithoutNewTexels,
+        stats.numFrames);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Times drawing lots of sprites with SpriteBatcher's instanced draws against drawing them
+    with one draw call per sprite, and prints sprites/s for each.
+
+    The sprites are spread over 4 (1x1) textures, so the batched runs show both the best case
+    (sorted by texture: 4 draw calls) and the worst (in random texture order: a texture change
+    and a draw call for nearly every sprite).  The sorted case is run twice, once writing the
+    instances into an orphaned buffer and once into a persistently mapped DynamicVertexBuffer.
+    Each run is several frames back to back (queue the sprites, draw them) with one
+    glFinish() at the end, so that a frame that has to wait on an earlier one shows up.
+
+    Note: The sprites are only a pixel or two across, so that filling them in (which is the
+    same work however they are drawn) doesn't hide the cost of submitting them.
+Parameters:
+    numSprites  How many sprites per frame.
+    batcher     Already Init()ed and with its program set.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BenchmarkSpriteBatching(unsigned int numSprites, SpriteBatcher &batcher)
+{
+    const int NUM_RUNS = 3;
+    const unsigned int NUM_FRAMES = 5;
+    const unsigned int NUM_TEXTURES = 4;
+    printf("sprite batching: %u sprites, %u textures, renderer '%s'\n", numSprites,
+        NUM_TEXTURES, (const char *)glGetString(GL_RENDERER));
+    if (!batcher.IsReady())
+    {
+        printf("the sprite batcher isn't ready\n");
+        return;
+    }
+
+    GlStateCache &stateCache = GlStateCache::Shared();
+    GLuint textureIds[NUM_TEXTURES];
+    glGenTextures(NUM_TEXTURES, textureIds);
+    for (unsigned int textureCount = 0; textureCount < NUM_TEXTURES; textureCount++)
+    {
+        GLubyte color[4] = { 255, 255, 255, 255 };
+        color[textureCount % 3] = 64;
+        stateCache.BindTexture(0, GL_TEXTURE_2D, textureIds[textureCount]);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, color);
+    }
+
+    // the same sprites every run
+    std::mt19937 randomNumbers(17);
+    std::uniform_real_distribution<float> position(-1.0f, +1.0f);
+    std::uniform_real_distribution<float> scale(0.002f, 0.004f);
+    std::uniform_int_distribution<unsigned int> texture(0, NUM_TEXTURES - 1);
+    std::vector<SpriteInstance> sprites(numSprites);
+    std::vector<GLuint> spriteTextureIds(numSprites);
+    for (unsigned int spriteCount = 0; spriteCount < numSprites; spriteCount++)
+    {
+        SpriteInstance &sprite = sprites[spriteCount];
+        sprite.position[0] = position(randomNumbers);
+        sprite.position[1] = position(randomNumbers);
+        sprite.scale[0] = scale(randomNumbers);
+        sprite.scale[1] = sprite.scale[0];
+        sprite.uvRect[0] = 0.0f;
+        sprite.uvRect[1] = 0.0f;
+        sprite.uvRect[2] = 1.0f;
+        sprite.uvRect[3] = 1.0f;
+        memset(sprite.tint, 255, sizeof(sprite.tint));
+        spriteTextureIds[spriteCount] = textureIds[texture(randomNumbers)];
+    }
+
+    // 3 frames of instances in flight, like the windowed and headless frames use
+    DynamicVertexBuffer dynamicBuffer;
+    if (!dynamicBuffer.Init(numSprites * sizeof(SpriteInstance), 3))
+    {
+        printf("the persistently mapped case will fall back to orphaning\n");
+    }
+
+    SpriteBatcherStats stats;
+    auto timeFrames = [&](bool sortByTexture, bool batched, bool persistent)
+    {
+        batcher.SetDynamicBuffer(persistent ? &dynamicBuffer : 0);
+        double seconds = BestTimeSeconds(NUM_RUNS, [&]()
+        {
+            for (unsigned int frameCount = 0; frameCount < NUM_FRAMES; frameCount++)
+            {
+                dynamicBuffer.BeginFrame();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                batcher.Begin(sortByTexture);
+                for (unsigned int spriteCount = 0; spriteCount < numSprites; spriteCount++)
+                {
+                    batcher.Add(spriteTextureIds[spriteCount], sprites[spriteCount]);
+                }
+                if (batched)
+                {
+                    batcher.Flush();
+                }
+                else
+                {
+                    batcher.FlushOneDrawPerSprite();
+                }
+                dynamicBuffer.EndFrame();
+            }
+            glFinish();
+            stats = batcher.Stats();
+        });
+        batcher.SetDynamicBuffer(0);
+        return seconds / NUM_FRAMES;
+    };
+
+    const char *names[] =
+    {
+        "instanced, sorted, orphaned buffer",
+        "instanced, sorted, persistent ring",
+        "instanced, in random texture order",
+        "one draw per sprite, sorted",
+    };
+    bool sortByTexture[] = { true, true, false, true };
+    bool batched[] = { true, true, true, false };
+    bool persistent[] = { false, true, false, false };
+    for (int caseCount = 0; caseCount < 4; caseCount++)
+    {
+        double seconds = timeFrames(sortByTexture[caseCount], batched[caseCount],
+            persistent[caseCount]);
+        printf("    %-36s %8.2f ms/frame  %12.0f sprites/s  (%u draw calls)\n",
+            names[caseCount], seconds * 1000.0, numSprites / seconds, stats.numDrawCalls);
+    }
+
+    const DynamicVertexBufferStats &dynamicStats = dynamicBuffer.Stats();
+    printf("    persistent ring: %llu frames, %llu stalls, %.3f ms/frame waiting on fences\n",
+        dynamicStats.numFrames, dynamicStats.numStalls,
+        (dynamicStats.numFrames > 0) ?
+        dynamicStats.waitSeconds * 1000.0 / dynamicStats.numFrames : 0.0);
+    dynamicBuffer.Shutdown();
+
+    glDeleteTextures(NUM_TEXTURES, textureIds);
+    for (unsigned int textureCount = 0; textureCount < NUM_TEXTURES; textureCount++)
+    {
+        stateCache.ForgetTexture(textureIds[textureCount]);
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Times drawing lots of different meshes with MultiDrawRenderer's one
+    glMultiDrawElementsIndirect(...) against drawing them with one draw call per mesh, at a
+    few mesh counts up to maxMeshes, and prints how long each took on the CPU (the Submit...()
+    alone) and per frame (including the GPU).  The point is the CPU column: the multi-draw
+    one should barely move as the count goes up.
+
+    Each run is several frames back to back with one glFinish() at the end, like
+    BenchmarkSpriteBatching(...), and every frame's commands and instances go through a
+    persistently mapped DynamicVertexBuffer for both.
+
+    Note: The meshes are tiny, for the same reason as the sprites.
+Parameters:
+    maxMeshes   The most meshes per frame.  Also how many different meshes are made.
+    renderer    Already Init()ed, with its program set, and with no meshes yet.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BenchmarkMultiDraw(unsigned int maxMeshes, MultiDrawRenderer &renderer)
+{
+    const int NUM_RUNS = 3;
+    const unsigned int NUM_FRAMES = 5;
+    printf("multi-draw: up to %u different meshes, renderer '%s'\n", maxMeshes,
+        (const char *)glGetString(GL_RENDERER));
+
+    // 3 frames of draws in flight, like the windowed and headless frames use
+    DynamicVertexBuffer dynamicBuffer;
+    if (!dynamicBuffer.Init((maxMeshes * MultiDrawRenderer::BYTES_PER_DRAW) + 1024, 3))
+    {
+        printf("multi-draw needs a persistently mapped buffer\n");
+        return;
+    }
+    renderer.SetDynamicBuffer(&dynamicBuffer);
+    if (!renderer.IsReady())
+    {
+        printf("the multi-draw renderer isn't ready\n");
+        renderer.SetDynamicBuffer(0);
+        dynamicBuffer.Shutdown();
+        return;
+    }
+
+    // the same meshes and places every run
+    std::mt19937 randomNumbers(17);
+    std::uniform_real_distribution<float> position(-1.0f, +1.0f);
+    std::uniform_real_distribution<float> scale(0.004f, 0.008f);
+    std::vector<MeshInstance> instances(maxMeshes);
+    unsigned int firstMeshIndex = renderer.NumMeshes();
+    for (unsigned int meshCount = 0; meshCount < maxMeshes; meshCount++)
+    {
+        renderer.AddMesh(MakeAssortedMesh(meshCount));
+        MeshInstance &instance = instances[meshCount];
+        instance.position[0] = position(randomNumbers);
+        instance.position[1] = position(randomNumbers);
+        instance.position[2] = 0.0f;
+        instance.scale = scale(randomNumbers);
+        memset(instance.tint, 255, sizeof(instance.tint));
+    }
+
+    // a white texture, since the renderer needs one
+    GlStateCache &stateCache = GlStateCache::Shared();
+    GLuint textureId = 0;
+    GLubyte white[4] = { 255, 255, 255, 255 };
+    glGenTextures(1, &textureId);
+    stateCache.BindTexture(0, GL_TEXTURE_2D, textureId);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, white);
+
+    MultiDrawStats stats;
+    double cpuSeconds = 0.0;
+    auto timeFrames = [&](unsigned int numMeshes, bool multiDraw)
+    {
+        double seconds = BestTimeSeconds(NUM_RUNS, [&]()
+        {
+            cpuSeconds = 0.0;
+            for (unsigned int frameCount = 0; frameCount < NUM_FRAMES; frameCount++)
+            {
+                dynamicBuffer.BeginFrame();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                renderer.Begin();
+                for (unsigned int meshCount = 0; meshCount < numMeshes; meshCount++)
+                {
+                    renderer.Draw(firstMeshIndex + meshCount, instances[meshCount]);
+                }
+                if (multiDraw)
+                {
+                    renderer.Submit(textureId);
+                }
+                else
+                {
+                    renderer.SubmitOneDrawPerMesh(textureId);
+                }
+                cpuSeconds += renderer.Stats().cpuSeconds;
+                dynamicBuffer.EndFrame();
+            }
+            glFinish();
+            stats = renderer.Stats();
+        });
+        return seconds / NUM_FRAMES;
+    };
+
+    // Note: The first run also points the VAO at the arenas and uploads where the meshes are
+    // in them, so that is done first, out of the timing.
+    renderer.Begin();
+    renderer.Draw(firstMeshIndex, instances[0]);
+    dynamicBuffer.BeginFrame();
+    renderer.Submit(textureId);
+    dynamicBuffer.EndFrame();
+    glFinish();
+
+    unsigned int meshCounts[] = { maxMeshes / 16, maxMeshes / 4, maxMeshes };
+    for (int countCount = 0; countCount < 3; countCount++)
+    {
+        unsigned int numMeshes = (meshCounts[countCount] > 0) ? meshCounts[countCount] : 1;
+        double multiDrawSeconds = timeFrames(numMeshes, true);
+        double multiDrawCpuSeconds = cpuSeconds / NUM_FRAMES;
+        unsigned int numMultiDrawCalls = stats.numDrawCalls;
+        double oneDrawSeconds = timeFrames(numMeshes, false);
+        double oneDrawCpuSeconds = cpuSeconds / NUM_FRAMES;
+        printf("    %6u meshes (%7u triangles)  multi-draw: %7.3f ms CPU %8.2f ms/frame "
+            "(%u draw call)   one draw per mesh: %7.3f ms CPU %8.2f ms/frame (%u draw calls)\n",
+            numMeshes, stats.numTriangles, multiDrawCpuSeconds * 1000.0,
+            multiDrawSeconds * 1000.0, numMultiDrawCalls, oneDrawCpuSeconds * 1000.0,
+            oneDrawSeconds * 1000.0, stats.numDrawCalls);
+    }
+
+    const DynamicVertexBufferStats &dynamicStats = dynamicBuffer.Stats();
+    printf("    persistent ring: %llu frames, %llu stalls, %llu failed allocations\n",
+        dynamicStats.numFrames, dynamicStats.numStalls, dynamicStats.failedAllocations);
+    renderer.SetDynamicBuffer(0);
+    dynamicBuffer.Shutdown();
+
+    glDeleteTextures(1, &textureId);
+    stateCache.ForgetTexture(textureId);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Times deciding which of numMeshes meshes are in view on the CPU (a bounding sphere test
+    per mesh, and only the ones in view go to MultiDrawRenderer::Submit(...)) against having
+    GpuCuller do it (every mesh goes to SubmitCulled(...)), and prints the CPU time and the
+    frame time of each.
+
+    The view is the middle half of the screen on each axis, so about a quarter of the meshes,
+    which are spread over the whole screen, are in view.  The two had better agree on how
+    many that is, and the GPU's count (read back after the timing) is printed next to the
+    CPU's to show that they do.
+
+    Note: The meshes are tiny, for the same reason as the sprites.
+Parameters:
+    numMeshes   How many meshes per frame.  Also how many different meshes are made.
+    renderer    Already Init()ed, with its program set, and with no meshes yet.
+    culler      Already Init()ed and with its program set.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BenchmarkGpuCulling(unsigned int numMeshes, MultiDrawRenderer &renderer, GpuCuller &culler)
+{
+    const int NUM_RUNS = 3;
+    const unsigned int NUM_FRAMES = 5;
+    const float VIEW_SIZE = 0.5f;
+    printf("GPU culling: %u different meshes, renderer '%s'\n", numMeshes,
+        (const char *)glGetString(GL_RENDERER));
+
+    // 3 frames of draws in flight, like the windowed and headless frames use
+    DynamicVertexBuffer dynamicBuffer;
+    if (!dynamicBuffer.Init((numMeshes * MultiDrawRenderer::BYTES_PER_DRAW) + 1024, 3))
+    {
+        printf("multi-draw needs a persistently mapped buffer\n");
+        return;
+    }
+    renderer.SetDynamicBuffer(&dynamicBuffer);
+    if (!renderer.IsReady() || !culler.IsReady())
+    {
+        printf("the multi-draw renderer or the culler isn't ready\n");
+        renderer.SetDynamicBuffer(0);
+        dynamicBuffer.Shutdown();
+        return;
+    }
+
+    // the view: a box, -VIEW_SIZE - +VIEW_SIZE on X and Y (the same planes for both)
+    float viewPlanes[] =
+    {
+        +1.0f, 0.0f, 0.0f, VIEW_SIZE,
+        -1.0f, 0.0f, 0.0f, VIEW_SIZE,
+        0.0f, +1.0f, 0.0f, VIEW_SIZE,
+        0.0f, -1.0f, 0.0f, VIEW_SIZE,
+    };
+    const unsigned int NUM_VIEW_PLANES = 4;
+    culler.SetViewPlanes(viewPlanes, NUM_VIEW_PLANES);
+
+    // the same meshes and places every run
+    std::mt19937 randomNumbers(17);
+    std::uniform_real_distribution<float> position(-1.0f, +1.0f);
+    std::uniform_real_distribution<float> scale(0.004f, 0.008f);
+    std::vector<MeshInstance> instances(numMeshes);
+    unsigned int firstMeshIndex = renderer.NumMeshes();
+    for (unsigned int meshCount = 0; meshCount < numMeshes; meshCount++)
+    {
+        renderer.AddMesh(MakeAssortedMesh(meshCount));
+        MeshInstance &instance = instances[meshCount];
+        instance.position[0] = position(randomNumbers);
+        instance.position[1] = position(randomNumbers);
+        instance.position[2] = 0.0f;
+        instance.scale = scale(randomNumbers);
+        memset(instance.tint, 255, sizeof(instance.tint));
+    }
+
+    // a white texture, since the renderer needs one
+    GlStateCache &stateCache = GlStateCache::Shared();
+    GLuint textureId = 0;
+    GLubyte white[4] = { 255, 255, 255, 255 };
+    glGenTextures(1, &textureId);
+    stateCache.BindTexture(0, GL_TEXTURE_2D, textureId);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, white);
+
+    // the CPU's culling: the same test as cull.comp, on the same spheres (each meshlet's,
+    // moved and scaled by the instance), and counted by meshlet like the GPU's count is
+    // Note: A mesh goes to Draw(...) if any of its meshlets are in view.
+    unsigned int numCpuVisible = 0;
+    auto cullOnCpu = [&]()
+    {
+        numCpuVisible = 0;
+        for (unsigned int meshCount = 0; meshCount < numMeshes; meshCount++)
+        {
+            unsigned int meshIndex = firstMeshIndex + meshCount;
+            const MeshInstance &instance = instances[meshCount];
+            unsigned int numMeshlets = renderer.NumMeshlets(meshIndex);
+            bool anyInView = false;
+            for (unsigned int meshletCount = 0; meshletCount < numMeshlets; meshletCount++)
+            {
+                float center[3];
+                float radius = 0.0f;
+                renderer.MeshletBounds(meshIndex, meshletCount, center, &radius);
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    center[axis] = instance.position[axis] + (center[axis] * instance.scale);
+                }
+                radius *= instance.scale;
+
+                bool inView = true;
+                for (unsigned int planeCount = 0; inView && (planeCount < NUM_VIEW_PLANES);
+                    planeCount++)
+                {
+                    const float *plane = &viewPlanes[planeCount * 4];
+                    float distance = (plane[0] * center[0]) + (plane[1] * center[1]) +
+                        (plane[2] * center[2]) + plane[3];
+                    inView = (distance >= -radius);
+                }
+                if (inView)
+                {
+                    anyInView = true;
+                    numCpuVisible++;
+                }
+            }
+            if (anyInView)
+            {
+                renderer.Draw(meshIndex, instance);
+            }
+        }
+        renderer.Submit(textureId);
+    };
+    auto cullOnGpu = [&]()
+    {
+        for (unsigned int meshCount = 0; meshCount < numMeshes; meshCount++)
+        {
+            renderer.Draw(firstMeshIndex + meshCount, instances[meshCount]);
+        }
+        renderer.SubmitCulled(textureId, culler);
+    };
+
+    double cpuSeconds = 0.0;
+    auto timeFrames = [&](const std::function<void()> &cullAndSubmit)
+    {
+        double seconds = BestTimeSeconds(NUM_RUNS, [&]()
+        {
+            cpuSeconds = 0.0;
+            for (unsigned int frameCount = 0; frameCount < NUM_FRAMES; frameCount++)
+            {
+                dynamicBuffer.BeginFrame();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                std::chrono::high_resolution_clock::time_point start =
+                    std::chrono::high_resolution_clock::now();
+                renderer.Begin();
+                cullAndSubmit();
+                std::chrono::duration<double> elapsed =
+                    std::chrono::high_resolution_clock::now() - start;
+                cpuSeconds += elapsed.count();
+                dynamicBuffer.EndFrame();
+            }
+            glFinish();
+        });
+        return seconds / NUM_FRAMES;
+    };
+
+    // Note: The first frame also points the VAO at the arenas and uploads where the meshes are
+    // in them, so that is done first, out of the timing.
+    dynamicBuffer.BeginFrame();
+    renderer.Begin();
+    cullOnGpu();
+    dynamicBuffer.EndFrame();
+    glFinish();
+
+    double cpuCullSeconds = timeFrames(cullOnCpu);
+    double cpuCullCpuSeconds = cpuSeconds / NUM_FRAMES;
+    double gpuCullSeconds = timeFrames(cullOnGpu);
+    double gpuCullCpuSeconds = cpuSeconds / NUM_FRAMES;
+    printf("    culled on the CPU  %8.3f ms CPU  %8.2f ms/frame  (%u in view)\n",
+        cpuCullCpuSeconds * 1000.0, cpuCullSeconds * 1000.0, numCpuVisible);
+    printf("    culled on the GPU  %8.3f ms CPU  %8.2f ms/frame  (%u in view, %s)\n",
+        gpuCullCpuSeconds * 1000.0, gpuCullSeconds * 1000.0, culler.VisibleCount(),
+        culler.HasDrawCount() ? "GPU draw count" : "0-instance commands past the count");
+
+    renderer.SetDynamicBuffer(0);
+    dynamicBuffer.Shutdown();
+    glDeleteTextures(1, &textureId);
+    stateCache.ForgetTexture(textureId);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Times putting numMeshes different meshes on the GPU with a vertex buffer and an index
+    buffer each (glGenBuffers(...) and glBufferData(...) per mesh, the old way) against
+    suballocating them from one GpuBufferArena for vertices and one for indices, and then
+    churns the arenas to see how they hold up.
+
+    The churn frees a random half of the meshes, which leaves the free space in scattered
+    pieces of different sizes (printed as the biggest free range against all the free space),
+    and puts them back in a different order, which has to repack.  Then it frees a different
+    half and has Defragment() put the free space back together, and prints its time and how
+    many bytes it copied.
+
+    Note: Both end with glFinish() so that the driver can't hide work by deferring it.
+Parameters:
+    numMeshes   How many meshes.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BenchmarkBufferArena(unsigned int numMeshes)
+{
+    const int NUM_RUNS = 3;
+    printf("buffer arena: %u different meshes, renderer '%s'\n", numMeshes,
+        (const char *)glGetString(GL_RENDERER));
+
+    std::vector<MeshData> meshes(numMeshes);
+    unsigned int numVertices = 0;
+    unsigned int numIndices = 0;
+    for (unsigned int meshCount = 0; meshCount < numMeshes; meshCount++)
+    {
+        meshes[meshCount] = MakeAssortedMesh(meshCount);
+        numVertices += (unsigned int)meshes[meshCount].vertices.size();
+        numIndices += (unsigned int)meshes[meshCount].indices.size();
+    }
+
+    // the old way: 2 buffer objects per mesh
+    GlStateCache &stateCache = GlStateCache::Shared();
+    std::vector<GLuint> bufferIds(numMeshes * 2);
+    double perMeshSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        glGenBuffers((GLsizei)bufferIds.size(), bufferIds.data());
+        for (unsigned int meshCount = 0; meshCount < numMeshes; meshCount++)
+        {
+            const MeshData &mesh = meshes[meshCount];
+            stateCache.BindBuffer(GL_COPY_WRITE_BUFFER, bufferIds[meshCount * 2]);
+            glBufferData(GL_COPY_WRITE_BUFFER, mesh.vertices.size() * sizeof(MeshVertex),
+                mesh.vertices.data(), GL_STATIC_DRAW);
+            stateCache.BindBuffer(GL_COPY_WRITE_BUFFER, bufferIds[(meshCount * 2) + 1]);
+            glBufferData(GL_COPY_WRITE_BUFFER, mesh.indices.size() * sizeof(GLuint),
+                mesh.indices.data(), GL_STATIC_DRAW);
+        }
+        glFinish();
+
+        // out of the timing would be better, but the next run needs them gone
+        for (unsigned int bufferCount = 0; bufferCount < bufferIds.size(); bufferCount++)
+        {
+            stateCache.ForgetBuffer(bufferIds[bufferCount]);
+        }
+        glDeleteBuffers((GLsizei)bufferIds.size(), bufferIds.data());
+    });
+
+    // the new way: a range of 2 arenas per mesh, with room for all of them from the start
+    GpuBufferArena vertexArena;
+    GpuBufferArena indexArena;
+    std::vector<unsigned int> vertexHandles(numMeshes);
+    std::vector<unsigned int> indexHandles(numMeshes);
+    auto addMesh = [&](unsigned int meshIndex)
+    {
+        const MeshData &mesh = meshes[meshIndex];
+        vertexHandles[meshIndex] = vertexArena.Allocate((unsigned int)mesh.vertices.size());
+        indexHandles[meshIndex] = indexArena.Allocate((unsigned int)mesh.indices.size());
+        vertexArena.Upload(vertexHandles[meshIndex], mesh.vertices.data());
+        indexArena.Upload(indexHandles[meshIndex], mesh.indices.data());
+    };
+    double arenaSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        vertexArena.Init(sizeof(MeshVertex), numVertices);
+        indexArena.Init(sizeof(GLuint), numIndices);
+        for (unsigned int meshCount = 0; meshCount < numMeshes; meshCount++)
+        {
+            addMesh(meshCount);
+        }
+        glFinish();
+    });
+    printf("    buffer objects per mesh:  %9.2f ms  (%u buffers)\n", perMeshSeconds * 1000.0,
+        numMeshes * 2);
+    printf("    arena suballocation:      %9.2f ms  (2 buffers)\n", arenaSeconds * 1000.0);
+
+    // churn: free a random half, which leaves the free space in scattered pieces
+    std::mt19937 randomNumbers(18);
+    std::vector<unsigned int> meshOrder(numMeshes);
+    for (unsigned int meshCount = 0; meshCount < numMeshes; meshCount++)
+    {
+        meshOrder[meshCount] = meshCount;
+    }
+    std::shuffle(meshOrder.begin(), meshOrder.end(), randomNumbers);
+    unsigned int numFreed = numMeshes / 2;
+    auto freeHalf = [&]()
+    {
+        for (unsigned int freeCount = 0; freeCount < numFreed; freeCount++)
+        {
+            vertexArena.Free(vertexHandles[meshOrder[freeCount]]);
+            indexArena.Free(indexHandles[meshOrder[freeCount]]);
+        }
+    };
+    freeHalf();
+    GpuBufferArenaStats stats = vertexArena.Stats();
+    printf("    half freed:          %u of %u vertices free, biggest free range %u\n",
+        stats.capacity - stats.used, stats.capacity, stats.largestFreeRange);
+
+    // put them back in a different order, so they don't fit where they were and the arenas
+    // have to repack to make room
+    unsigned int numRepacksBefore = stats.numRepacks + indexArena.Stats().numRepacks;
+    std::shuffle(meshOrder.begin(), meshOrder.begin() + numFreed, randomNumbers);
+    double churnSeconds = BestTimeSeconds(1, [&]()
+    {
+        for (unsigned int freeCount = 0; freeCount < numFreed; freeCount++)
+        {
+            addMesh(meshOrder[freeCount]);
+        }
+        glFinish();
+    });
+    printf("    re-added in a different order: %9.2f ms, %u repack(s)\n", churnSeconds * 1000.0,
+        vertexArena.Stats().numRepacks + indexArena.Stats().numRepacks - numRepacksBefore);
+
+    // scatter it again, and this time put it back together before anything needs the room
+    std::shuffle(meshOrder.begin(), meshOrder.end(), randomNumbers);
+    freeHalf();
+    unsigned long long bytesMovedBefore =
+        vertexArena.Stats().bytesMoved + indexArena.Stats().bytesMoved;
+    double defragmentSeconds = BestTimeSeconds(1, [&]()
+    {
+        vertexArena.Defragment();
+        indexArena.Defragment();
+        glFinish();
+    });
+    stats = vertexArena.Stats();
+    unsigned long long bytesMovedAfter = stats.bytesMoved + indexArena.Stats().bytesMoved;
+    printf("    Defragment():        %u of %u vertices free, biggest free range %u "
+        "(%.2f ms, %.1f KB copied on the GPU)\n", stats.capacity - stats.used, stats.capacity,
+        stats.largestFreeRange, defragmentSeconds * 1000.0,
+        (bytesMovedAfter - bytesMovedBefore) / 1024.0);
+
+    vertexArena.Shutdown();
+    indexArena.Shutdown();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Turns a half float back into a float, for measuring how much the texture coordinates lost.
+    Only finite values come out of the quantizer for texture coordinates that are in range,
+    so infinities and NaNs are just big numbers here.
+Parameters:
+    bits    The half float.
+Returns:
+    The float.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static float HalfToFloat(unsigned short bits)
+{
+    float sign = (bits & 0x8000) ? -1.0f : 1.0f;
+    int exponent = (bits >> 10) & 0x1F;
+    int mantissa = bits & 0x3FF;
+    if (exponent == 0)
+    {
+        // denormal
+        return sign * ldexpf((float)mantissa, -24);
+    }
+    return sign * ldexpf((float)(mantissa | 0x400), exponent - 25);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Measures one vertex format (see VertexQuantizer.h) with numMeshes of the assorted meshes:
+    how many bytes their vertices take, how fast they're packed (the scalar reference on one
+    thread against the SIMD version on the thread pool, checked to be bit-exact), the worst
+    position and texture coordinate error after unpacking them the way the GPU does, and the
+    time per frame to draw all of them.  Run it once per format for the comparison.
+
+    The meshes are drawn tiny, like in BenchmarkMultiDraw(...), so that the GPU spends its
+    time fetching and transforming vertices instead of filling pixels, which is the part the
+    packed formats are meant to speed up.
+
+    Note: The bit-exact check also packs vertices with texture coordinates outside of 0 - 1
+    and positions nowhere near the fit, since the meshes never have those.
+Parameters:
+    numMeshes   How many meshes.
+    renderer    Already Init()ed with the format to measure, with its program set, and with
+                no meshes yet.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BenchmarkVertexFormat(unsigned int numMeshes, MultiDrawRenderer &renderer)
+{
+    const int NUM_RUNS = 3;
+    const unsigned int NUM_FRAMES = 5;
+    VertexFormat format = renderer.Format();
+    const VertexFormatDescription &description = GetVertexFormatDescription(format);
+
+    // every mesh's vertices back to back for the encoding throughput
+    std::vector<MeshData> meshes(numMeshes);
+    std::vector<MeshVertex> allVertices;
+    for (unsigned int meshCount = 0; meshCount < numMeshes; meshCount++)
+    {
+        meshes[meshCount] = MakeAssortedMesh(meshCount);
+        allVertices.insert(allVertices.end(), meshes[meshCount].vertices.begin(),
+            meshes[meshCount].vertices.end());
+    }
+    size_t numVertices = allVertices.size();
+    double megavertices = (double)numVertices / 1000000.0;
+
+    // bit-exact check
+    const size_t NUM_CHECK_VERTICES = 64 * 1024;
+    std::vector<MeshVertex> checkVertices(NUM_CHECK_VERTICES);
+    std::mt19937 randomEngine(12345);
+    std::uniform_real_distribution<float> randomPosition(-4.0f, 4.0f);
+    std::uniform_real_distribution<float> randomUv(-2.0f, 3.0f);
+    for (size_t vertexCount = 0; vertexCount < NUM_CHECK_VERTICES; vertexCount++)
+    {
+        MeshVertex &vertex = checkVertices[vertexCount];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            vertex.pos[axis] = randomPosition(randomEngine);
+        }
+        vertex.uv[0] = randomUv(randomEngine);
+        vertex.uv[1] = randomUv(randomEngine);
+    }
+    PositionQuantization checkQuantization = { 2.5f, { 0.5f, -0.25f, 1.0f } };
+    std::vector<unsigned char> scalarBytes(NUM_CHECK_VERTICES * description.bytesPerVertex);
+    std::vector<unsigned char> simdBytes(NUM_CHECK_VERTICES * description.bytesPerVertex);
+    QuantizeVerticesScalar(checkVertices.data(), NUM_CHECK_VERTICES, format, checkQuantization,
+        scalarBytes.data());
+    QuantizeVerticesSimd(checkVertices.data(), NUM_CHECK_VERTICES, format, checkQuantization,
+        simdBytes.data());
+    size_t mismatchCount = 0;
+    for (size_t byteCount = 0; byteCount < scalarBytes.size(); byteCount++)
+    {
+        if (scalarBytes[byteCount] != simdBytes[byteCount])
+        {
+            mismatchCount++;
+        }
+    }
+
+    // throughput, scalar on one thread versus SIMD on the thread pool
+    PositionQuantization quantization = FitPositionQuantization(allVertices.data(), numVertices);
+    std::vector<unsigned char> packedBytes(numVertices * description.bytesPerVertex);
+    QuantizeVerticesScalar(allVertices.data(), numVertices, format, quantization,
+        packedBytes.data());
+    double scalarSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        QuantizeVerticesScalar(allVertices.data(), numVertices, format, quantization,
+            packedBytes.data());
+    });
+    double simdSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        QuantizeVertices(allVertices.data(), numVertices, format, quantization,
+            packedBytes.data());
+    });
+
+    // the worst error, each mesh packed with its own fit the way AddMesh(...) does it
+    float maxPositionError = 0.0f;
+    float maxUvError = 0.0f;
+    for (unsigned int meshCount = 0; (meshCount < numMeshes) && (format != VERTEX_FORMAT_FLOAT);
+        meshCount++)
+    {
+        const std::vector<MeshVertex> &vertices = meshes[meshCount].vertices;
+        PositionQuantization meshQuantization =
+            FitPositionQuantization(vertices.data(), vertices.size());
+        // Note: Both packed formats have the texture coordinates' bits in the same place.
+        std::vector<PackedMeshVertex> packed(vertices.size());
+        QuantizeVertices(vertices.data(), vertices.size(), format, meshQuantization,
+            packed.data());
+        for (size_t vertexCount = 0; vertexCount < vertices.size(); vertexCount++)
+        {
+            // the same as OpenGL's normalized integers (and half floats) in the shader
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float unpacked = (packed[vertexCount].pos[axis] / 32767.0f) *
+                    meshQuantization.scale + meshQuantization.bias[axis];
+                float error = fabsf(unpacked - vertices[vertexCount].pos[axis]);
+                maxPositionError = (error > maxPositionError) ? error : maxPositionError;
+            }
+            for (int component = 0; component < 2; component++)
+            {
+                unsigned short bits = packed[vertexCount].uv[component];
+                float unpacked = (format == VERTEX_FORMAT_SNORM16_HALF) ?
+                    HalfToFloat(bits) : (bits / 65535.0f);
+                float error = fabsf(unpacked - vertices[vertexCount].uv[component]);
+                maxUvError = (error > maxUvError) ? error : maxUvError;
+            }
+        }
+    }
+
+    // draw time, with the same tiny meshes in the same random places every run
+    DynamicVertexBuffer dynamicBuffer;
+    if (!dynamicBuffer.Init((numMeshes * MultiDrawRenderer::BYTES_PER_DRAW) + 1024, 3))
+    {
+        printf("the vertex format benchmark needs a persistently mapped buffer\n");
+        return;
+    }
+    renderer.SetDynamicBuffer(&dynamicBuffer);
+    if (!renderer.IsReady())
+    {
+        printf("the multi-draw renderer isn't ready\n");
+        renderer.SetDynamicBuffer(0);
+        dynamicBuffer.Shutdown();
+        return;
+    }
+    std::mt19937 randomNumbers(17);
+    std::uniform_real_distribution<float> position(-1.0f, +1.0f);
+    std::uniform_real_distribution<float> scale(0.004f, 0.008f);
+    std::vector<MeshInstance> instances(numMeshes);
+    unsigned int firstMeshIndex = renderer.NumMeshes();
+    for (unsigned int meshCount = 0; meshCount < numMeshes; meshCount++)
+    {
+        renderer.AddMesh(meshes[meshCount]);
+        MeshInstance &instance = instances[meshCount];
+        instance.position[0] = position(randomNumbers);
+        instance.position[1] = position(randomNumbers);
+        instance.position[2] = 0.0f;
+        instance.scale = scale(randomNumbers);
+        memset(instance.tint, 255, sizeof(instance.tint));
+    }
+
+    // a white texture, since the renderer needs one
+    GlStateCache &stateCache = GlStateCache::Shared();
+    GLuint textureId = 0;
+    GLubyte white[4] = { 255, 255, 255, 255 };
+    glGenTextures(1, &textureId);
+    stateCache.BindTexture(0, GL_TEXTURE_2D, textureId);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, white);
+
+    // Note: The first frame also uploads where the meshes are, so it's out of the timing.
+    auto drawFrames = [&](unsigned int numFrames)
+    {
+        for (unsigned int frameCount = 0; frameCount < numFrames; frameCount++)
+        {
+            dynamicBuffer.BeginFrame();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            renderer.Begin();
+            for (unsigned int meshCount = 0; meshCount < numMeshes; meshCount++)
+            {
+                renderer.Draw(firstMeshIndex + meshCount, instances[meshCount]);
+            }
+            renderer.Submit(textureId);
+            dynamicBuffer.EndFrame();
+        }
+        glFinish();
+    };
+    drawFrames(1);
+    double drawSeconds = BestTimeSeconds(NUM_RUNS, [&]() { drawFrames(NUM_FRAMES); });
+    drawSeconds /= NUM_FRAMES;
+
+    printf("    %-16s %2u bytes/vertex %7.2f MB  scalar %7.1f Mverts/s  %-8s %7.1f Mverts/s  "
+        "max error: position %.6f uv %.6f  draw %7.2f ms/frame  %s\n",
+        description.name, description.bytesPerVertex,
+        (double)numVertices * description.bytesPerVertex / (1024.0 * 1024.0),
+        megavertices / scalarSeconds, VertexQuantizationInstructionSet(format),
+        megavertices / simdSeconds, maxPositionError, maxUvError, drawSeconds * 1000.0,
+        (mismatchCount == 0) ? "bit-exact" : "MISMATCH");
+    if (mismatchCount != 0)
+    {
+        printf("        %u of %u bytes differ from the scalar reference\n",
+            (unsigned int)mismatchCount, (unsigned int)scalarBytes.size());
+    }
+
+    renderer.SetDynamicBuffer(0);
+    dynamicBuffer.Shutdown();
+    glDeleteTextures(1, &textureId);
+    stateCache.ForgetTexture(textureId);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Runs the mesh optimizer (see MeshOptimizer.h) over a few kinds of meshes and prints how
+    many vertex shader runs each needs per triangle (ACMR) and per vertex (ATVR) before and
+    after, on a simulated FIFO and LRU cache of OPTIMIZER_CACHE_SIZE vertices, plus how long
+    the optimizer took.
+
+    The procedural meshes are already in a fairly cache-friendly order (row by row), so each
+    big one is also measured with its triangles and vertices shuffled, which is closer to a
+    mesh out of a modeling program or a file.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BenchmarkMeshOptimizer()
+{
+    const int NUM_RUNS = 3;
+    const unsigned int NUM_ASSORTED_MESHES = 1000;
+    printf("mesh optimizer: %u-vertex cache\n", OPTIMIZER_CACHE_SIZE);
+
+    // the same mesh with its vertices renumbered and triangles in a random order
+    std::mt19937 randomEngine(12345);
+    auto shuffle = [&](MeshData mesh)
+    {
+        std::vector<unsigned int> newIndices(mesh.vertices.size());
+        for (size_t vertexCount = 0; vertexCount < newIndices.size(); vertexCount++)
+        {
+            newIndices[vertexCount] = (unsigned int)vertexCount;
+        }
+        std::shuffle(newIndices.begin(), newIndices.end(), randomEngine);
+        std::vector<MeshVertex> vertices(mesh.vertices.size());
+        for (size_t vertexCount = 0; vertexCount < newIndices.size(); vertexCount++)
+        {
+            vertices[newIndices[vertexCount]] = mesh.vertices[vertexCount];
+        }
+        std::vector<unsigned int> triangles(mesh.indices.size() / 3);
+        for (size_t triangleCount = 0; triangleCount < triangles.size(); triangleCount++)
+        {
+            triangles[triangleCount] = (unsigned int)triangleCount;
+        }
+        std::shuffle(triangles.begin(), triangles.end(), randomEngine);
+        std::vector<unsigned int> indices;
+        for (size_t triangleCount = 0; triangleCount < triangles.size(); triangleCount++)
+        {
+            for (int cornerCount = 0; cornerCount < 3; cornerCount++)
+            {
+                indices.push_back(newIndices[mesh.indices[(triangles[triangleCount] * 3) +
+                    cornerCount]]);
+            }
+        }
+        mesh.vertices.swap(vertices);
+        mesh.indices.swap(indices);
+        return mesh;
+    };
+
+    // Note: A set of meshes is measured as a whole, like one draw after another.
+    auto measure = [&](const char *name, const std::vector<MeshData> &meshes)
+    {
+        VertexCacheStats before[2] = {};
+        VertexCacheStats after[2] = {};
+        std::vector<MeshData> optimized;
+        double seconds = BestTimeSeconds(NUM_RUNS, [&]()
+        {
+            optimized = meshes;
+            for (size_t meshCount = 0; meshCount < optimized.size(); meshCount++)
+            {
+                OptimizeMesh(&optimized[meshCount]);
+            }
+        });
+        for (int typeCount = 0; typeCount < 2; typeCount++)
+        {
+            VertexCacheType type = (VertexCacheType)typeCount;
+            for (size_t meshCount = 0; meshCount < meshes.size(); meshCount++)
+            {
+                VertexCacheStats stats = SimulateVertexCache(meshes[meshCount].indices,
+                    meshes[meshCount].vertices.size(), OPTIMIZER_CACHE_SIZE, type);
+                before[type].numTriangles += stats.numTriangles;
+                before[type].numVertices += stats.numVertices;
+                before[type].numTransforms += stats.numTransforms;
+                stats = SimulateVertexCache(optimized[meshCount].indices,
+                    optimized[meshCount].vertices.size(), OPTIMIZER_CACHE_SIZE, type);
+                after[type].numTriangles += stats.numTriangles;
+                after[type].numVertices += stats.numVertices;
+                after[type].numTransforms += stats.numTransforms;
+            }
+        }
+
+        unsigned int numTriangles = before[0].numTriangles;
+        printf("    %-22s %7u triangles  FIFO ACMR %.3f -> %.3f  ATVR %.3f -> %.3f  "
+            "LRU ACMR %.3f -> %.3f  ATVR %.3f -> %.3f  %7.2f ms (%.1f Mtriangles/s)\n", name,
+            numTriangles,
+            (float)before[0].numTransforms / numTriangles,
+            (float)after[0].numTransforms / numTriangles,
+            (float)before[0].numTransforms / before[0].numVertices,
+            (float)after[0].numTransforms / after[0].numVertices,
+            (float)before[1].numTransforms / numTriangles,
+            (float)after[1].numTransforms / numTriangles,
+            (float)before[1].numTransforms / before[1].numVertices,
+            (float)after[1].numTransforms / after[1].numVertices,
+            seconds * 1000.0, numTriangles / seconds / 1000000.0);
+    };
+
+    std::vector<MeshData> assorted(NUM_ASSORTED_MESHES);
+    for (unsigned int meshCount = 0; meshCount < NUM_ASSORTED_MESHES; meshCount++)
+    {
+        assorted[meshCount] = MakeAssortedMesh(meshCount);
+    }
+    measure("1000 assorted meshes", assorted);
+
+    MeshData sphere = MakeSphereMesh(128, 256);
+    MeshData grid = MakeGridMesh(256, 256);
+    measure("sphere 128x256", std::vector<MeshData>(1, sphere));
+    measure("sphere, shuffled", std::vector<MeshData>(1, shuffle(sphere)));
+    measure("grid 256x256", std::vector<MeshData>(1, grid));
+    measure("grid, shuffled", std::vector<MeshData>(1, shuffle(grid)));
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Times loading a mesh of about numVertices vertices onto the GPU, from an OBJ file and
+    from a mesh file (see MeshFile.h), and prints each per million vertices.
+
+    The mesh is a grid (see MakeGridMesh(...)) that's written out as an OBJ first, with
+    every corner of every face its own vertex like an OBJ from a modeling program, and then
+    converted.  The OBJ's time is only reading it (parsing and finding the duplicate
+    vertices), not even uploading it.  The mesh file's is everything: mapping the file,
+    checking it, and uploading the vertices and indices straight from the mapping into a
+    GpuBufferArena, with a glFinish() at the end.  For comparison, it's also timed with an
+    extra copy of the vertices and indices out of the mapping first, like a loader that
+    read the file into memory of its own would do.
+
+    Note: The files were just written, so they're in the OS's file cache.  The first load
+    off a disk would be slower for both, but only by the time to read the bytes, and the
+    mesh file has less than half as many of them.
+Parameters:
+    numVertices About how many vertices.
+    format      What the mesh file's vertices are packed into.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BenchmarkMeshLoading(unsigned int numVertices, VertexFormat format)
+{
+    const int NUM_RUNS = 3;
+    const char *OBJ_FILE_PATH = "bench_mesh.obj";
+    const char *MESH_FILE_PATH = "bench_mesh.mesh";
+
+    unsigned int numSquaresPerSide = 1;
+    while ((numSquaresPerSide + 2) * (numSquaresPerSide + 2) <= numVertices)
+    {
+        numSquaresPerSide++;
+    }
+    MeshData grid = MakeGridMesh(numSquaresPerSide, numSquaresPerSide);
+    double megavertices = grid.vertices.size() / 1000000.0;
+    printf("mesh loading: %u vertices, %u triangles, '%s' vertices, renderer '%s'\n",
+        (unsigned int)grid.vertices.size(), (unsigned int)(grid.indices.size() / 3),
+        GetVertexFormatDescription(format).name, (const char *)glGetString(GL_RENDERER));
+
+    FILE *objFile = fopen(OBJ_FILE_PATH, "w");
+    if (objFile == 0)
+    {
+        printf("could not write '%s'\n", OBJ_FILE_PATH);
+        return;
+    }
+    for (size_t vertexCount = 0; vertexCount < grid.vertices.size(); vertexCount++)
+    {
+        const MeshVertex &vertex = grid.vertices[vertexCount];
+        fprintf(objFile, "v %f %f %f\nvt %f %f\n", vertex.pos[0], vertex.pos[1],
+            vertex.pos[2], vertex.uv[0], vertex.uv[1]);
+    }
+    for (size_t indexCount = 0; indexCount < grid.indices.size(); indexCount += 3)
+    {
+        unsigned int a = grid.indices[indexCount] + 1;
+        unsigned int b = grid.indices[indexCount + 1] + 1;
+        unsigned int c = grid.indices[indexCount + 2] + 1;
+        fprintf(objFile, "f %u/%u %u/%u %u/%u\n", a, a, b, b, c, c);
+    }
+    fclose(objFile);
+
+    MeshData objMesh;
+    double objSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        ReadObjFile(OBJ_FILE_PATH, &objMesh);
+    });
+    if (objMesh.vertices.size() != grid.vertices.size())
+    {
+        printf("    the OBJ came back with %u vertices instead of %u\n",
+            (unsigned int)objMesh.vertices.size(), (unsigned int)grid.vertices.size());
+    }
+    if (!WriteMeshFile(MESH_FILE_PATH, objMesh, format))
+    {
+        remove(OBJ_FILE_PATH);
+        return;
+    }
+
+    // the arenas have room for it from the start, so this is only the upload
+    // Note: The file's indices are as narrow as WriteMeshFile(...) could make them.
+    IndexWidth indexWidth = ChooseIndexWidth(grid.vertices.size());
+    GpuBufferArena vertexArena;
+    GpuBufferArena indexArena;
+    if (!vertexArena.Init(GetVertexFormatDescription(format).bytesPerVertex,
+        (unsigned int)grid.vertices.size()) ||
+        !indexArena.Init(BytesPerIndex(indexWidth), (unsigned int)grid.indices.size()))
+    {
+        remove(OBJ_FILE_PATH);
+        remove(MESH_FILE_PATH);
+        return;
+    }
+    auto upload = [&](const void *vertices, const void *indices)
+    {
+        unsigned int vertexHandle = vertexArena.Allocate((unsigned int)grid.vertices.size());
+        unsigned int indexHandle = indexArena.Allocate((unsigned int)grid.indices.size());
+        vertexArena.Upload(vertexHandle, vertices);
+        indexArena.Upload(indexHandle, indices);
+        glFinish();
+        vertexArena.Free(vertexHandle);
+        indexArena.Free(indexHandle);
+    };
+
+    MeshFile meshFile;
+    double openSeconds = 0.0;
+    double mappedSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        std::chrono::high_resolution_clock::time_point start =
+            std::chrono::high_resolution_clock::now();
+        meshFile.Open(MESH_FILE_PATH);
+        std::chrono::duration<double> elapsed =
+            std::chrono::high_resolution_clock::now() - start;
+        openSeconds = elapsed.count();
+        upload(meshFile.Mesh().vertices, meshFile.Mesh().indices);
+        meshFile.Close();
+    });
+    double copiedSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        meshFile.Open(MESH_FILE_PATH);
+        const PackedMesh &mesh = meshFile.Mesh();
+        const unsigned char *vertexBytes = (const unsigned char *)mesh.vertices;
+        std::vector<unsigned char> vertices(vertexBytes, vertexBytes +
+            (size_t)mesh.numVertices * GetVertexFormatDescription(format).bytesPerVertex);
+        const unsigned char *indexBytes = (const unsigned char *)mesh.indices;
+        std::vector<unsigned char> indices(indexBytes, indexBytes +
+            (size_t)mesh.numIndices * BytesPerIndex(mesh.indexWidth));
+        upload(vertices.data(), indices.data());
+        meshFile.Close();
+    });
+
+    printf("    OBJ, read only:              %9.2f ms  %8.2f ms per million vertices\n",
+        objSeconds * 1000.0, objSeconds * 1000.0 / megavertices);
+    printf("    mesh file, mapped to GPU:    %9.2f ms  %8.2f ms per million vertices  "
+        "(%.3f ms to map and check)\n", mappedSeconds * 1000.0,
+        mappedSeconds * 1000.0 / megavertices, openSeconds * 1000.0);
+    printf("    mesh file, copied first:     %9.2f ms  %8.2f ms per million vertices\n",
+        copiedSeconds * 1000.0, copiedSeconds * 1000.0 / megavertices);
+    printf("    speedup over OBJ:            %9.1fx\n", objSeconds / mappedSeconds);
+
+    // and Open(...) had better turn down files that were damaged (or made up) to point it
+    // outside the mapping or the vertices, instead of drawing garbage or crashing
+    // Note: The offsets near 2^64 are there to wrap around "offset + size <= file size".
+    const char *DAMAGED_FILE_PATH = "bench_mesh_damaged.mesh";
+    std::vector<unsigned char> fileBytes;
+    FILE *meshFileHandle = fopen(MESH_FILE_PATH, "rb");
+    if (meshFileHandle != 0)
+    {
+        fseek(meshFileHandle, 0, SEEK_END);
+        fileBytes.resize((size_t)ftell(meshFileHandle));
+        fseek(meshFileHandle, 0, SEEK_SET);
+        size_t numRead = fread(fileBytes.data(), 1, fileBytes.size(), meshFileHandle);
+        fileBytes.resize(numRead);
+        fclose(meshFileHandle);
+    }
+    const int NUM_DAMAGES = 4;
+    const char *damageNames[NUM_DAMAGES] =
+    {
+        "index offset near 2^64",
+        "vertex offset near 2^64",
+        "index past the last vertex",
+        "cut off halfway",
+    };
+    int numRejected = 0;
+    for (int damageCount = 0; (damageCount < NUM_DAMAGES) &&
+        (fileBytes.size() >= sizeof(MeshFileHeader)); damageCount++)
+    {
+        std::vector<unsigned char> damaged = fileBytes;
+        MeshFileHeader header;
+        memcpy(&header, damaged.data(), sizeof(header));
+        if (damageCount == 0)
+        {
+            header.indexOffset = 0 - (uint64_t)MeshFile::MESH_FILE_ALIGNMENT;
+            header.numIndices = 96;
+        }
+        else if (damageCount == 1)
+        {
+            header.vertexOffset = 0 - (uint64_t)MeshFile::MESH_FILE_ALIGNMENT;
+        }
+        else if (damageCount == 2)
+        {
+            // the first index, whatever its width, gets all of its bits set
+            memset(&damaged[(size_t)header.indexOffset], 0xFF, header.bytesPerIndex);
+            header.numVertices = 3;
+        }
+        else
+        {
+            damaged.resize(damaged.size() / 2);
+        }
+        memcpy(damaged.data(), &header, sizeof(header));
+
+        FILE *damagedFile = fopen(DAMAGED_FILE_PATH, "wb");
+        if (damagedFile == 0)
+        {
+            break;
+        }
+        fwrite(damaged.data(), 1, damaged.size(), damagedFile);
+        fclose(damagedFile);
+        if (meshFile.Open(DAMAGED_FILE_PATH))
+        {
+            printf("    a damaged mesh file (%s) was taken as good\n", damageNames[damageCount]);
+            meshFile.Close();
+        }
+        else
+        {
+            numRejected++;
+        }
+    }
+    printf("    damaged mesh files rejected: %d of %d\n", numRejected, NUM_DAMAGES);
+
+    vertexArena.Shutdown();
+    indexArena.Shutdown();
+    remove(OBJ_FILE_PATH);
+    remove(MESH_FILE_PATH);
+    remove(DAMAGED_FILE_PATH);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Compares drawing one big mesh whole against cutting it into meshlets (see
+    SplitIntoMeshlets(...)) of 65,536 vertices (16-bit indices) and of 256 (8-bit): how many
+    bytes its indices and vertices take, how long it takes to draw all of it, and how much of
+    it the GPU culler can throw out when only a corner of it is in view.
+
+    The mesh is a grid (see MakeGridMesh(...)) that's run through OptimizeMesh(...) first, so
+    that each meshlet is a compact patch of it.  The whole mesh needs 32-bit indices if it has
+    more than 65,536 vertices.  The meshlets repeat the vertices along their edges, which is
+    what they cost in vertex bytes.
+
+    Note: The renderer's meshlet size is left at the default when this is done.
+Parameters:
+    numVertices About how many vertices.
+    renderer    Already Init()ed with its program built.
+    culler      Same.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BenchmarkMeshlets(unsigned int numVertices, MultiDrawRenderer &renderer, GpuCuller &culler)
+{
+    const int NUM_RUNS = 3;
+    const unsigned int NUM_FRAMES = 5;
+    const unsigned int NUM_CASES = 3;
+    const unsigned int MAX_MESHLET_VERTICES[NUM_CASES] =
+    {
+        0, MAX_VERTICES_16_BIT_INDICES, MAX_VERTICES_8_BIT_INDICES
+    };
+
+    unsigned int numSquaresPerSide = 1;
+    while ((numSquaresPerSide + 2) * (numSquaresPerSide + 2) <= numVertices)
+    {
+        numSquaresPerSide++;
+    }
+    MeshData grid = MakeGridMesh(numSquaresPerSide, numSquaresPerSide);
+    OptimizeMesh(&grid);
+    unsigned int bytesPerVertex = GetVertexFormatDescription(renderer.Format()).bytesPerVertex;
+    printf("meshlets: %u vertices, %u triangles, '%s' vertices, renderer '%s'\n",
+        (unsigned int)grid.vertices.size(), (unsigned int)(grid.indices.size() / 3),
+        GetVertexFormatDescription(renderer.Format()).name,
+        (const char *)glGetString(GL_RENDERER));
+
+    // what each way takes in the arenas, worked out the same way that AddMesh(...) packs it
+    size_t numMeshlets[NUM_CASES];
+    size_t numVertexBytes[NUM_CASES];
+    size_t numIndexBytes[NUM_CASES];
+    unsigned int numPerWidth[NUM_CASES][INDEX_WIDTH_COUNT] = {};
+    size_t maxMeshlets = 1;
+    for (unsigned int caseCount = 0; caseCount < NUM_CASES; caseCount++)
+    {
+        std::vector<MeshData> meshlets;
+        if (MAX_MESHLET_VERTICES[caseCount] == 0)
+        {
+            meshlets.push_back(grid);
+        }
+        else
+        {
+            SplitIntoMeshlets(grid, MAX_MESHLET_VERTICES[caseCount], &meshlets);
+        }
+        numMeshlets[caseCount] = meshlets.size();
+        numVertexBytes[caseCount] = 0;
+        numIndexBytes[caseCount] = 0;
+        for (size_t meshletCount = 0; meshletCount < meshlets.size(); meshletCount++)
+        {
+            const MeshData &meshlet = meshlets[meshletCount];
+            IndexWidth width = ChooseIndexWidth(meshlet.vertices.size());
+            numVertexBytes[caseCount] += meshlet.vertices.size() * bytesPerVertex;
+            numIndexBytes[caseCount] += meshlet.indices.size() * BytesPerIndex(width);
+            numPerWidth[caseCount][width]++;
+        }
+        maxMeshlets = (meshlets.size() > maxMeshlets) ? meshlets.size() : maxMeshlets;
+    }
+
+    // each draw is a meshlet, and it's either drawn or culled
+    DynamicVertexBuffer dynamicBuffer;
+    if (!dynamicBuffer.Init((maxMeshlets * (MultiDrawRenderer::BYTES_PER_DRAW +
+        sizeof(CullDrawInput))) + 1024, 3))
+    {
+        printf("the meshlet benchmark needs a persistently mapped buffer\n");
+        return;
+    }
+    renderer.SetDynamicBuffer(&dynamicBuffer);
+    if (!renderer.IsReady() || !culler.IsReady())
+    {
+        printf("the multi-draw renderer or the culler isn't ready\n");
+        renderer.SetDynamicBuffer(0);
+        dynamicBuffer.Shutdown();
+        return;
+    }
+
+    // the view is all of the screen, and the culled draws are of a mesh that's mostly off of
+    // it: twice as big and moved so that only its bottom left quarter is in view
+    float viewPlanes[] =
+    {
+        +1.0f, 0.0f, 0.0f, 1.0f,
+        -1.0f, 0.0f, 0.0f, 1.0f,
+        0.0f, +1.0f, 0.0f, 1.0f,
+        0.0f, -1.0f, 0.0f, 1.0f,
+    };
+    culler.SetViewPlanes(viewPlanes, 4);
+    MeshInstance wholeInstance;
+    memset(&wholeInstance, 0, sizeof(wholeInstance));
+    wholeInstance.scale = 1.8f;
+    memset(wholeInstance.tint, 255, sizeof(wholeInstance.tint));
+    MeshInstance cornerInstance = wholeInstance;
+    cornerInstance.position[0] = 1.0f;
+    cornerInstance.position[1] = 1.0f;
+    cornerInstance.scale = 2.0f;
+
+    // a white texture, since the renderer needs one
+    GlStateCache &stateCache = GlStateCache::Shared();
+    GLuint textureId = 0;
+    GLubyte white[4] = { 255, 255, 255, 255 };
+    glGenTextures(1, &textureId);
+    stateCache.BindTexture(0, GL_TEXTURE_2D, textureId);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, white);
+
+    for (unsigned int caseCount = 0; caseCount < NUM_CASES; caseCount++)
+    {
+        renderer.SetMaxMeshletVertices(MAX_MESHLET_VERTICES[caseCount]);
+        unsigned int meshIndex = renderer.AddMesh(grid);
+        if (meshIndex == MultiDrawRenderer::NO_MESH)
+        {
+            printf("    could not add the mesh\n");
+            continue;
+        }
+
+        // Note: The first frame also uploads where the meshlets are, so it's out of the
+        // timing.
+        auto drawFrames = [&](unsigned int numFrames, bool cull)
+        {
+            for (unsigned int frameCount = 0; frameCount < numFrames; frameCount++)
+            {
+                dynamicBuffer.BeginFrame();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                renderer.Begin();
+                if (cull)
+                {
+                    renderer.Draw(meshIndex, cornerInstance);
+                    renderer.SubmitCulled(textureId, culler);
+                }
+                else
+                {
+                    renderer.Draw(meshIndex, wholeInstance);
+                    renderer.Submit(textureId);
+                }
+                dynamicBuffer.EndFrame();
+            }
+            glFinish();
+        };
+        drawFrames(1, false);
+        double drawSeconds = BestTimeSeconds(NUM_RUNS, [&]() { drawFrames(NUM_FRAMES, false); });
+        unsigned int numDrawCalls = renderer.Stats().numDrawCalls;
+        drawFrames(1, true);
+        double culledSeconds = BestTimeSeconds(NUM_RUNS, [&]() { drawFrames(NUM_FRAMES, true); });
+        unsigned int numVisible = culler.VisibleCount();
+
+        char name[32];
+        if (MAX_MESHLET_VERTICES[caseCount] == 0)
+        {
+            snprintf(name, sizeof(name), "whole mesh");
+        }
+        else
+        {
+            snprintf(name, sizeof(name), "%u-vertex meshlets", MAX_MESHLET_VERTICES[caseCount]);
+        }
+        printf("    %-22s %6u draw(s) (8/16/32-bit: %u/%u/%u) in %u call(s)  indices %7.2f MB  "
+            "vertices %7.2f MB (+%4.1f%%)  draw %7.2f ms  corner in view: %6u of %6u culled "
+            "draw %7.2f ms\n", name, (unsigned int)numMeshlets[caseCount],
+            numPerWidth[caseCount][INDEX_WIDTH_8], numPerWidth[caseCount][INDEX_WIDTH_16],
+            numPerWidth[caseCount][INDEX_WIDTH_32], numDrawCalls,
+            numIndexBytes[caseCount] / (1024.0 * 1024.0),
+            numVertexBytes[caseCount] / (1024.0 * 1024.0),
+            100.0 * ((double)numVertexBytes[caseCount] / numVertexBytes[0] - 1.0),
+            drawSeconds * 1000.0 / NUM_FRAMES, numVisible,
+            (unsigned int)numMeshlets[caseCount], culledSeconds * 1000.0 / NUM_FRAMES);
+        renderer.RemoveMesh(meshIndex);
+    }
+
+    renderer.SetMaxMeshletVertices(MAX_VERTICES_16_BIT_INDICES);
+    renderer.SetDynamicBuffer(0);
+    dynamicBuffer.Shutdown();
+    glDeleteTextures(1, &textureId);
+    stateCache.ForgetTexture(textureId);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Times the mesh simplifier (see MeshSimplifier.h) in triangles per second: first one big
+    mesh cut in half, and then a chain of levels of detail for each of a set of meshes, on
+    one thread and spread across the thread pool.  Then it prints what the chains came out
+    as: each level's triangles and error, and about how small (in pixels across) a mesh has
+    to be on the screen before that level is used, at 1 pixel of error.
+
+    The meshes are mostly spheres, which are curved all over and have UV seams, with a grid
+    every so often, which is flat and has borders.  They range from half to one and a half
+    times the average size, so that the threads don't all get the same amount of work.
+Parameters:
+    numTriangles    About how many triangles in all.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BenchmarkMeshSimplification(unsigned int numTriangles)
+{
+    const int NUM_RUNS = 3;
+    const unsigned int NUM_MESHES = 64;
+
+    // a sphere with N rings has about 4 * N^2 triangles, and an N by N grid has 2 * N^2
+    std::vector<MeshData> meshes(NUM_MESHES);
+    unsigned int numMeshTriangles = 0;
+    for (unsigned int meshCount = 0; meshCount < NUM_MESHES; meshCount++)
+    {
+        float size = 0.5f + ((float)meshCount / (NUM_MESHES - 1));
+        float meshTriangles = size * numTriangles / NUM_MESHES;
+        if (meshCount % 4 == 3)
+        {
+            unsigned int numSquaresPerSide = std::max(1u, (unsigned int)sqrtf(meshTriangles / 2));
+            meshes[meshCount] = MakeGridMesh(numSquaresPerSide, numSquaresPerSide);
+        }
+        else
+        {
+            unsigned int numRings = std::max(3u, (unsigned int)sqrtf(meshTriangles / 4));
+            meshes[meshCount] = MakeSphereMesh(numRings, numRings * 2);
+        }
+        numMeshTriangles += (unsigned int)(meshes[meshCount].indices.size() / 3);
+    }
+    printf("mesh simplification: %u meshes, %u triangles, %u worker threads + main\n",
+        NUM_MESHES, numMeshTriangles, ThreadPool::Shared().NumWorkers());
+
+    // one mesh with all of the triangles, down to half
+    unsigned int numBigRings = std::max(3u, (unsigned int)sqrtf(numMeshTriangles / 4.0f));
+    MeshData bigMesh = MakeSphereMesh(numBigRings, numBigRings * 2);
+    unsigned int numBigTriangles = (unsigned int)(bigMesh.indices.size() / 3);
+    MeshData simplified;
+    float error = 0.0f;
+    double bigSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        error = SimplifyMesh(bigMesh, numBigTriangles / 2, FLT_MAX, &simplified);
+    });
+    printf("    one sphere, to half          %8u -> %8u triangles (error %.5f)  %8.2f ms  "
+        "(%.2f Mtriangles/s)\n", numBigTriangles, (unsigned int)(simplified.indices.size() / 3),
+        error, bigSeconds * 1000.0, numBigTriangles / bigSeconds / 1000000.0);
+
+    // Note: The chains are built from scratch each run, the same as they would be at load time.
+    std::vector<std::vector<MeshLod>> singleThreadChains(NUM_MESHES);
+    std::vector<std::vector<MeshLod>> lodChains;
+    double singleThreadSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        for (unsigned int meshCount = 0; meshCount < NUM_MESHES; meshCount++)
+        {
+            BuildLodChain(meshes[meshCount], MAX_LODS, &singleThreadChains[meshCount]);
+        }
+    });
+    double multiThreadSeconds = BestTimeSeconds(NUM_RUNS, [&]()
+    {
+        BuildLodChains(meshes, MAX_LODS, &lodChains);
+    });
+    printf("    LOD chains, one thread       %8.2f ms  (%.2f Mtriangles/s)\n",
+        singleThreadSeconds * 1000.0, numMeshTriangles / singleThreadSeconds / 1000000.0);
+    printf("    LOD chains, thread pool      %8.2f ms  (%.2f Mtriangles/s, %.2fx)\n",
+        multiThreadSeconds * 1000.0, numMeshTriangles / multiThreadSeconds / 1000000.0,
+        singleThreadSeconds / multiThreadSeconds);
+
+    // make sure that the threads made the same thing (each mesh is simplified the same way on
+    // any thread)
+    size_t mismatchCount = 0;
+    for (unsigned int meshCount = 0; meshCount < NUM_MESHES; meshCount++)
+    {
+        const std::vector<MeshLod> &first = singleThreadChains[meshCount];
+        const std::vector<MeshLod> &second = lodChains[meshCount];
+        bool same = (first.size() == second.size());
+        for (size_t lodCount = 0; same && (lodCount < first.size()); lodCount++)
+        {
+            same = (first[lodCount].mesh.indices == second[lodCount].mesh.indices) &&
+                (first[lodCount].error == second[lodCount].error);
+        }
+        mismatchCount += same ? 0 : 1;
+    }
+    if (mismatchCount > 0)
+    {
+        printf("        %u of %u chains differ between one thread and the pool\n",
+            (unsigned int)mismatchCount, NUM_MESHES);
+    }
+
+    // the meshes are 1 unit across, so at 1 pixel of error, a level is good enough once the
+    // mesh is no more than 1 / error pixels across
+    for (unsigned int lodCount = 0; lodCount < MAX_LODS; lodCount++)
+    {
+        unsigned int numLodMeshes = 0;
+        unsigned int numLodTriangles = 0;
+        float errorSum = 0.0f;
+        for (unsigned int meshCount = 0; meshCount < NUM_MESHES; meshCount++)
+        {
+            if (lodCount < lodChains[meshCount].size())
+            {
+                const MeshLod &lod = lodChains[meshCount][lodCount];
+                numLodMeshes++;
+                numLodTriangles += (unsigned int)(lod.mesh.indices.size() / 3);
+                errorSum += lod.error;
+            }
+        }
+        if (numLodMeshes == 0)
+        {
+            break;
+        }
+
+        float averageError = errorSum / numLodMeshes;
+        // Note: The full-detail level is what's left for the biggest draws, so only the
+        // coarser levels have a size that they're used at or below.
+        char usedAt[64];
+        if (lodCount == 0)
+        {
+            snprintf(usedAt, sizeof(usedAt), "full detail");
+        }
+        else if (averageError > 0.0f)
+        {
+            snprintf(usedAt, sizeof(usedAt), "used at %.0f pixels across or smaller",
+                1.0f / averageError);
+        }
+        else
+        {
+            snprintf(usedAt, sizeof(usedAt), "used at any size");
+        }
+        printf("    level %u: %2u meshes %8u triangles (%5.1f%%)  average error %.5f  %s\n",
+            lodCount, numLodMeshes, numLodTriangles,
+            100.0f * numLodTriangles / numMeshTriangles, averageError, usedAt);
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Times drawing numDraws small triangles, each with a randomly picked program, texture, and
+    VAO, through a RenderQueue in the order that they were added against sorted by their keys,
+    and prints the frame time, the CPU time, and how many state changes each order took.  It
+    also times std::sort(...) on the same keys, to compare against the queue's radix sort.
+
+    Every triangle is somewhere else in one shared vertex buffer (the draw's base vertex says
+    where), so the draws are all different, like a scene's would be.  The VAOs all describe
+    the same layout, since only the switching between them matters here.
+
+    Note: The triangles are tiny, so that the GPU's part of the frame doesn't hide the CPU's.
+Parameters:
+    numDraws    How many draws per frame.
+    programIds  The programs to switch between, all built from shader.vert and shader.frag.
+                These are deleted when it's done.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BenchmarkRenderQueue(unsigned int numDraws, const std::vector<unsigned int> &programIds)
+{
+    const int NUM_RUNS = 3;
+    const unsigned int NUM_FRAMES = 5;
+    const unsigned int NUM_TEXTURES = 16;
+    const unsigned int NUM_VAOS = 4;
+    const float TRIANGLE_SIZE = 0.01f;
+    printf("render queue: %u draws, %u programs, %u textures, %u VAOs, renderer '%s'\n",
+        numDraws, (unsigned int)programIds.size(), NUM_TEXTURES, NUM_VAOS,
+        (const char *)glGetString(GL_RENDERER));
+
+    GlStateCache &stateCache = GlStateCache::Shared();
+    if (programIds.empty() || (numDraws == 0))
+    {
+        printf("the render queue benchmark needs at least 1 program and 1 draw\n");
+        return;
+    }
+
+    // a 1x1 texture of a different color for each
+    GLuint textureIds[NUM_TEXTURES];
+    glGenTextures(NUM_TEXTURES, textureIds);
+    for (unsigned int textureCount = 0; textureCount < NUM_TEXTURES; textureCount++)
+    {
+        GLubyte color[4] = { 255, 255, 255, 255 };
+        color[textureCount % 3] = (GLubyte)(64 + (textureCount * 8));
+        stateCache.BindTexture(0, GL_TEXTURE_2D, textureIds[textureCount]);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, color);
+    }
+
+    // the same triangles and state every run
+    std::mt19937 randomNumbers(17);
+    std::uniform_real_distribution<float> position(-1.0f, +1.0f);
+    std::uniform_int_distribution<unsigned int> program(0, (unsigned int)programIds.size() - 1);
+    std::uniform_int_distribution<unsigned int> texture(0, NUM_TEXTURES - 1);
+    std::uniform_int_distribution<unsigned int> vao(0, NUM_VAOS - 1);
+    std::vector<MeshVertex> vertices(numDraws * 3);
+    std::vector<float> depths(numDraws);
+    for (unsigned int drawCount = 0; drawCount < numDraws; drawCount++)
+    {
+        float x = position(randomNumbers);
+        float y = position(randomNumbers);
+        float z = position(randomNumbers);
+        MeshVertex corners[] =
+        {
+            { { x - TRIANGLE_SIZE, y - TRIANGLE_SIZE, z }, { 0.0f, 0.0f } },
+            { { x + TRIANGLE_SIZE, y - TRIANGLE_SIZE, z }, { 1.0f, 0.0f } },
+            { { x, y + TRIANGLE_SIZE, z }, { 0.5f, 1.0f } },
+        };
+        memcpy(&vertices[drawCount * 3], corners, sizeof(corners));
+        depths[drawCount] = (z + 1.0f) * 0.5f;
+    }
+    GLuint indices[] = { 0, 1, 2 };
+
+    GLuint bufferIds[2] = { 0, 0 };
+    GLuint vaoIds[NUM_VAOS];
+    glGenBuffers(2, bufferIds);
+    glGenVertexArrays(NUM_VAOS, vaoIds);
+    stateCache.BindBuffer(GL_ARRAY_BUFFER, bufferIds[0]);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(MeshVertex), vertices.data(),
+        GL_STATIC_DRAW);
+    for (unsigned int vaoCount = 0; vaoCount < NUM_VAOS; vaoCount++)
+    {
+        stateCache.BindVertexArray(vaoIds[vaoCount]);
+        SetVertexLayout(MESH_VERTEX_LAYOUT, 0);
+    }
+    stateCache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferIds[1]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    stateCache.BindVertexArray(0);
+
+    std::vector<RenderQueueDraw> draws(numDraws);
+    for (unsigned int drawCount = 0; drawCount < numDraws; drawCount++)
+    {
+        RenderQueueDraw &draw = draws[drawCount];
+        draw.programId = programIds[program(randomNumbers)];
+        draw.vaoId = vaoIds[vao(randomNumbers)];
+        draw.textureId = textureIds[texture(randomNumbers)];
+        draw.vertexBufferId = bufferIds[0];
+        draw.vertexStride = sizeof(MeshVertex);
+        draw.indexBufferId = bufferIds[1];
+        draw.indexType = GL_UNSIGNED_INT;
+        draw.indexCount = 3;
+        draw.firstIndexBytes = 0;
+        draw.baseVertex = (int)(drawCount * 3);
+    }
+
+    RenderQueue queue;
+    RenderQueueStats stats;
+    double cpuSeconds = 0.0;
+    double sortSeconds = 0.0;
+    auto timeFrames = [&](bool sortDraws)
+    {
+        double seconds = BestTimeSeconds(NUM_RUNS, [&]()
+        {
+            cpuSeconds = 0.0;
+            sortSeconds = 0.0;
+            for (unsigned int frameCount = 0; frameCount < NUM_FRAMES; frameCount++)
+            {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                queue.Begin(sortDraws);
+                for (unsigned int drawCount = 0; drawCount < numDraws; drawCount++)
+                {
+                    queue.Add(0, depths[drawCount], draws[drawCount]);
+                }
+                queue.Submit();
+                cpuSeconds += queue.Stats().cpuSeconds;
+                sortSeconds += queue.Stats().sortSeconds;
+            }
+            glFinish();
+            stats = queue.Stats();
+        });
+        return seconds / NUM_FRAMES;
+    };
+
+    const char *names[] = { "in the order added", "sorted by key" };
+    for (int caseCount = 0; caseCount < 2; caseCount++)
+    {
+        double seconds = timeFrames(caseCount == 1);
+        printf("    %-20s %8.2f ms/frame %8.3f ms CPU (%.3f ms sorting)  changes: %6u program "
+            "%6u texture %6u VAO\n", names[caseCount], seconds * 1000.0,
+            cpuSeconds * 1000.0 / NUM_FRAMES, sortSeconds * 1000.0 / NUM_FRAMES,
+            stats.numProgramChanges, stats.numTextureChanges, stats.numVaoChanges);
+    }
+    printf("    sorting avoided %u state changes a frame\n", stats.numChangesAvoided);
+
+    // the same keys as the queue makes (the queue numbers the IDs in the order that it first
+    // sees them, and so does this), sorted by comparing
+    std::vector<std::pair<unsigned long long, unsigned int>> keys(numDraws);
+    std::unordered_map<unsigned int, unsigned int> sortIds[3];
+    for (unsigned int drawCount = 0; drawCount < numDraws; drawCount++)
+    {
+        const RenderQueueDraw &draw = draws[drawCount];
+        unsigned int glIds[3] = { draw.programId, draw.textureId, draw.vaoId };
+        unsigned int drawSortIds[3];
+        for (int kindCount = 0; kindCount < 3; kindCount++)
+        {
+            std::unordered_map<unsigned int, unsigned int>::iterator found =
+                sortIds[kindCount].find(glIds[kindCount]);
+            if (found == sortIds[kindCount].end())
+            {
+                unsigned int sortId = (unsigned int)sortIds[kindCount].size();
+                found = sortIds[kindCount].insert(std::make_pair(glIds[kindCount], sortId)).first;
+            }
+            drawSortIds[kindCount] = found->second;
+        }
+        keys[drawCount].first = RenderQueue::MakeKey(0, drawSortIds[0], drawSortIds[1],
+            drawSortIds[2], depths[drawCount]);
+        keys[drawCount].second = drawCount;
+    }
+    double bestStdSortSeconds = DBL_MAX;
+    for (int runCount = 0; runCount < NUM_RUNS; runCount++)
+    {
+        std::vector<std::pair<unsigned long long, unsigned int>> sortedKeys = keys;
+        std::chrono::high_resolution_clock::time_point start =
+            std::chrono::high_resolution_clock::now();
+        std::sort(sortedKeys.begin(), sortedKeys.end());
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+        bestStdSortSeconds = std::min(bestStdSortSeconds, elapsed.count());
+    }
+    printf("    std::sort of the same keys: %.3f ms (the radix sort: %.3f ms)\n",
+        bestStdSortSeconds * 1000.0, sortSeconds * 1000.0 / NUM_FRAMES);
+
+    for (unsigned int vaoCount = 0; vaoCount < NUM_VAOS; vaoCount++)
+    {
+        glDeleteVertexArrays(1, &vaoIds[vaoCount]);
+        stateCache.ForgetVertexArray(vaoIds[vaoCount]);
+    }
+    for (int bufferCount = 0; bufferCount < 2; bufferCount++)
+    {
+        glDeleteBuffers(1, &bufferIds[bufferCount]);
+        stateCache.ForgetBuffer(bufferIds[bufferCount]);
+    }
+    glDeleteTextures(NUM_TEXTURES, textureIds);
+    for (unsigned int textureCount = 0; textureCount < NUM_TEXTURES; textureCount++)
+    {
+        stateCache.ForgetTexture(textureIds[textureCount]);
+    }
+    for (size_t programCount = 0; programCount < programIds.size(); programCount++)
+    {
+        glDeleteProgram(programIds[programCount]);
+        stateCache.ForgetProgram(programIds[programCount]);
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "TexelFormatConverter.h"
+#include "VertexQuantizer.h"
+
+#include <vector>
+
+class SpriteBatcher;
+class MultiDrawRenderer;
+class GpuCuller;
+
+// CPU-only measurements; these don't need a window or an OpenGL context
+void BenchmarkTextureGeneration(unsigned int texelsPerRow, unsigned int numRows);
+void BenchmarkTexelConversion(unsigned int texelsPerRow, unsigned int numRows);
+void BenchmarkBlockCompression(unsigned int texelsPerRow, unsigned int numRows);
+void BenchmarkMeshOptimizer();
+void BenchmarkMeshSimplification(unsigned int numTriangles);
+
+// these need a current OpenGL context (that is, call them after init(...))
+void BenchmarkMipmapGeneration(unsigned int texelsPerRow, unsigned int numRows, 
+    TexelFormat texelFormat);
+void BenchmarkTextureStreaming(unsigned int texelsPerRow, unsigned int numRows,
+    TexelFormat texelFormat);
+void BenchmarkSpriteBatching(unsigned int numSprites, SpriteBatcher &batcher);
+void BenchmarkMultiDraw(unsigned int maxMeshes, MultiDrawRenderer &renderer);
+void BenchmarkGpuCulling(unsigned int numMeshes, MultiDrawRenderer &renderer, GpuCuller &culler);
+void BenchmarkBufferArena(unsigned int numMeshes);
+void BenchmarkVertexFormat(unsigned int numMeshes, MultiDrawRenderer &renderer);
+void BenchmarkMeshLoading(unsigned int numVertices, VertexFormat format);
+void BenchmarkMeshlets(unsigned int numVertices, MultiDrawRenderer &renderer, GpuCuller &culler);
+void BenchmarkRenderQueue(unsigned int numDraws, const std::vector<unsigned int> &programIds);
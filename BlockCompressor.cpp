@@ -0,0 +1,1250 @@
+// only for the GL_* enums that describe each format
+#include "glload/include/glload/gl_4_4.h"
+
+#include "BlockCompressor.h"
+#include "ThreadPool.h"
+#include "SimdSupport.h"
+
+#include <string.h>     // memcpy(...) and strcmp(...)
+#include <math.h>       // sqrtf(...), lrintf(...), and log10(...)
+#include <algorithm>
+
+// Note: GL_COMPRESSED_RGB_S3TC_DXT1_EXT is the BC1 variant without the 1-bit alpha.  The
+// encoder always uses the 4-color mode, so none of its texels are ever transparent anyway.
+static const BlockFormatDescription BLOCK_FORMAT_DESCRIPTIONS[BLOCK_FORMAT_COUNT] =
+{
+    { "none", 0, 0, false },
+    { "bc1", GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 8, false },
+    { "bc3", GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 16, true },
+    { "bc7", GL_COMPRESSED_RGBA_BPTC_UNORM_ARB, 16, true },
+};
+
+// BC7's 4bit index weights, out of 64
+static const int BC7_WEIGHTS_4BIT[16] =
+{
+    0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    One 4x4 block's texels, split up by channel ("structure of arrays") so that SIMD code can
+    work on 4 texels of one channel at a time.  Texel i is row (i / 4), column (i % 4).
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct BlockTexels
+{
+    alignas(16) float channels[4][16];
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Looks up the GL enum and block size for one of the formats.
+Parameters:
+    format  One of the BlockFormat values (not BLOCK_FORMAT_COUNT).
+Returns:
+    A reference to a description that lives for the whole program.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const BlockFormatDescription &GetBlockFormatDescription(BlockFormat format)
+{
+    return BLOCK_FORMAT_DESCRIPTIONS[format];
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Turns a command line string like "bc7" into the matching BlockFormat.
+Parameters:
+    name    The format's name as it appears in BLOCK_FORMAT_DESCRIPTIONS.
+    format  Gets the matching format if there is one.  Untouched otherwise.
+Returns:
+    True if the name matched one of the formats, otherwise false.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool ParseBlockFormat(const char *name, BlockFormat *format)
+{
+    for (int formatIndex = 0; formatIndex < BLOCK_FORMAT_COUNT; formatIndex++)
+    {
+        if (strcmp(name, BLOCK_FORMAT_DESCRIPTIONS[formatIndex].name) == 0)
+        {
+            *format = (BlockFormat)formatIndex;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How many bytes the compressed image takes.  Partial blocks on the right and top edges
+    still take a whole block, so a 1x1 mip level is as big as a 4x4 one.
+Parameters:
+    width   Image width in texels.
+    height  Image height in texels.
+    format  The block format.  Must not be BLOCK_FORMAT_NONE.
+Returns:
+    The size in bytes, which is also the "imageSize" for glCompressedTexImage2D(...).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+size_t CompressedSizeBytes(unsigned int width, unsigned int height, BlockFormat format)
+{
+    size_t blocksWide = (width + 3) / 4;
+    size_t blocksHigh = (height + 3) / 4;
+    return blocksWide * blocksHigh * BLOCK_FORMAT_DESCRIPTIONS[format].bytesPerBlock;
+}
+
+
+// ---------------------------------------------------------------------------------------------
+// shared encoder pieces
+// ---------------------------------------------------------------------------------------------
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Copies one 4x4 block out of the image.  Blocks that hang off the right or top edge repeat
+    the last column/row, which keeps those (never sampled) texels from dragging the endpoints
+    somewhere that the real texels don't need.
+Parameters:
+    rgba8Texels     The whole image.
+    width           Image width.
+    height          Image height.
+    blockX          Block column.
+    blockY          Block row.
+    block           Gets the block's texels as floats in [0, 255].
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void LoadBlock(const unsigned char *rgba8Texels, unsigned int width, unsigned int height,
+    unsigned int blockX, unsigned int blockY, BlockTexels *block)
+{
+    for (unsigned int row = 0; row < 4; row++)
+    {
+        unsigned int y = std::min((blockY * 4) + row, height - 1);
+        for (unsigned int col = 0; col < 4; col++)
+        {
+            unsigned int x = std::min((blockX * 4) + col, width - 1);
+            const unsigned char *source = rgba8Texels + ((((size_t)y * width) + x) * 4);
+            for (int channel = 0; channel < 4; channel++)
+            {
+                block->channels[channel][(row * 4) + col] = source[channel];
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The smallest and largest value of every channel in the block.
+Parameters:
+    block       The block's texels.
+    minValues   Gets the 4 channel minimums.
+    maxValues   Gets the 4 channel maximums.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void BlockBounds(const BlockTexels &block, float minValues[4], float maxValues[4])
+{
+    for (int channel = 0; channel < 4; channel++)
+    {
+        const float *values = block.channels[channel];
+#if defined(SIMD_SSE2)
+        __m128 low = _mm_min_ps(_mm_min_ps(_mm_load_ps(values), _mm_load_ps(values + 4)),
+            _mm_min_ps(_mm_load_ps(values + 8), _mm_load_ps(values + 12)));
+        __m128 high = _mm_max_ps(_mm_max_ps(_mm_load_ps(values), _mm_load_ps(values + 4)),
+            _mm_max_ps(_mm_load_ps(values + 8), _mm_load_ps(values + 12)));
+
+        // fold 4 lanes down to 1
+        low = _mm_min_ps(low, _mm_shuffle_ps(low, low, _MM_SHUFFLE(1, 0, 3, 2)));
+        low = _mm_min_ps(low, _mm_shuffle_ps(low, low, _MM_SHUFFLE(2, 3, 0, 1)));
+        high = _mm_max_ps(high, _mm_shuffle_ps(high, high, _MM_SHUFFLE(1, 0, 3, 2)));
+        high = _mm_max_ps(high, _mm_shuffle_ps(high, high, _MM_SHUFFLE(2, 3, 0, 1)));
+        minValues[channel] = _mm_cvtss_f32(low);
+        maxValues[channel] = _mm_cvtss_f32(high);
+#else
+        minValues[channel] = values[0];
+        maxValues[channel] = values[0];
+        for (int texelIndex = 1; texelIndex < 16; texelIndex++)
+        {
+            minValues[channel] = std::min(minValues[channel], values[texelIndex]);
+            maxValues[channel] = std::max(maxValues[channel], values[texelIndex]);
+        }
+#endif
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The heart of every encoder here: for each of the 16 texels, which palette entry is
+    closest (squared distance over the first numChannels channels), and how much error that
+    leaves in total.  The endpoint search calls this for every candidate pair of endpoints,
+    so it is where most of the encoding time goes.
+
+    Note: The SSE version does 4 texels at a time and keeps a running "best so far" distance
+    and index per lane.  It does the same float operations in the same order as the scalar
+    version, so both pick the same indices.
+Parameters:
+    block           The block's texels.
+    palette         The decoded colors that the indices can choose from, in [0, 255].
+    numColors       How many palette entries (4, 8, or 16).
+    numChannels     1 (alpha only, channel 3), 3 (RGB), or 4 (RGBA).
+    indices         Gets the chosen palette index for every texel.
+Returns:
+    The total squared error of the block with those indices.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static float FindNearestColors(const BlockTexels &block, const float palette[][4],
+    int numColors, int numChannels, unsigned char indices[16])
+{
+    // alpha-only blocks look at channel 3
+    int firstChannel = (numChannels == 1) ? 3 : 0;
+    int endChannel = firstChannel + numChannels;
+
+    float totalError = 0.0f;
+#if defined(SIMD_SSE2)
+    __m128 errorSum = _mm_setzero_ps();
+    for (int texelIndex = 0; texelIndex < 16; texelIndex += 4)
+    {
+        __m128 bestDistance = _mm_set1_ps(1e30f);
+        __m128i bestIndex = _mm_setzero_si128();
+        for (int colorIndex = 0; colorIndex < numColors; colorIndex++)
+        {
+            __m128 distance = _mm_setzero_ps();
+            for (int channel = firstChannel; channel < endChannel; channel++)
+            {
+                __m128 diff = _mm_sub_ps(_mm_load_ps(block.channels[channel] + texelIndex),
+                    _mm_set1_ps(palette[colorIndex][channel]));
+                distance = _mm_add_ps(distance, _mm_mul_ps(diff, diff));
+            }
+
+            // only a strictly smaller distance wins, so ties go to the lower index
+            __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, bestDistance));
+            bestDistance = _mm_min_ps(distance, bestDistance);
+            bestIndex = _mm_or_si128(_mm_andnot_si128(closer, bestIndex),
+                _mm_and_si128(closer, _mm_set1_epi32(colorIndex)));
+        }
+
+        alignas(16) int laneIndices[4];
+        _mm_store_si128((__m128i *)laneIndices, bestIndex);
+        for (int lane = 0; lane < 4; lane++)
+        {
+            indices[texelIndex + lane] = (unsigned char)laneIndices[lane];
+        }
+        errorSum = _mm_add_ps(errorSum, bestDistance);
+    }
+
+    alignas(16) float laneErrors[4];
+    _mm_store_ps(laneErrors, errorSum);
+    totalError = (laneErrors[0] + laneErrors[1]) + (laneErrors[2] + laneErrors[3]);
+#else
+    float laneErrors[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int texelIndex = 0; texelIndex < 16; texelIndex++)
+    {
+        float bestDistance = 1e30f;
+        int bestIndex = 0;
+        for (int colorIndex = 0; colorIndex < numColors; colorIndex++)
+        {
+            float distance = 0.0f;
+            for (int channel = firstChannel; channel < endChannel; channel++)
+            {
+                float diff = block.channels[channel][texelIndex] - palette[colorIndex][channel];
+                distance = distance + (diff * diff);
+            }
+
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                bestIndex = colorIndex;
+            }
+        }
+
+        indices[texelIndex] = (unsigned char)bestIndex;
+        laneErrors[texelIndex % 4] += bestDistance;
+    }
+    totalError = (laneErrors[0] + laneErrors[1]) + (laneErrors[2] + laneErrors[3]);
+#endif
+
+    return totalError;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Finds the line through color space that the block's texels are most spread out along
+    (the principal axis of their covariance, found by power iteration), and returns where the
+    texels start and end along it.  Those two points are the starting endpoints for BC1 and
+    BC7.
+Parameters:
+    block           The block's texels.
+    numChannels     3 (RGB) or 4 (RGBA).
+    endpoint0       Gets the low end of the line.
+    endpoint1       Gets the high end of the line.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void PrincipalAxisEndpoints(const BlockTexels &block, int numChannels,
+    float endpoint0[4], float endpoint1[4])
+{
+    float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        for (int texelIndex = 0; texelIndex < 16; texelIndex++)
+        {
+            mean[channel] += block.channels[channel][texelIndex];
+        }
+        mean[channel] /= 16.0f;
+    }
+
+    float covariance[4][4] = {};
+    for (int texelIndex = 0; texelIndex < 16; texelIndex++)
+    {
+        for (int row = 0; row < numChannels; row++)
+        {
+            float rowDiff = block.channels[row][texelIndex] - mean[row];
+            for (int col = row; col < numChannels; col++)
+            {
+                covariance[row][col] += rowDiff * (block.channels[col][texelIndex] - mean[col]);
+            }
+        }
+    }
+
+    // start from the bounding box's diagonal, which is usually close already
+    float minValues[4];
+    float maxValues[4];
+    BlockBounds(block, minValues, maxValues);
+    float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        axis[channel] = maxValues[channel] - minValues[channel];
+    }
+
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int row = 0; row < numChannels; row++)
+        {
+            for (int col = 0; col < numChannels; col++)
+            {
+                float value = (row <= col) ? covariance[row][col] : covariance[col][row];
+                next[row] += value * axis[col];
+            }
+        }
+
+        float length = 0.0f;
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            length += next[channel] * next[channel];
+        }
+        if (length < 1e-12f)
+        {
+            // all texels are (nearly) the same color or the start was perpendicular to them,
+            // so keep whatever axis there was
+            break;
+        }
+
+        length = 1.0f / sqrtf(length);
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            axis[channel] = next[channel] * length;
+        }
+    }
+
+    float minProjection = 0.0f;
+    float maxProjection = 0.0f;
+    for (int texelIndex = 0; texelIndex < 16; texelIndex++)
+    {
+        float projection = 0.0f;
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            projection += (block.channels[channel][texelIndex] - mean[channel]) * axis[channel];
+        }
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+
+    for (int channel = 0; channel < 4; channel++)
+    {
+        float end0 = mean[channel] + (minProjection * axis[channel]);
+        float end1 = mean[channel] + (maxProjection * axis[channel]);
+        endpoint0[channel] = std::min(std::max(end0, 0.0f), 255.0f);
+        endpoint1[channel] = std::min(std::max(end1, 0.0f), 255.0f);
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Given which palette entry every texel picked, solves for the two endpoints that would
+    have made those picks as accurate as possible (least squares).  Alternating this with
+    FindNearestColors(...) is the classic way to polish a pair of endpoints.
+Parameters:
+    block           The block's texels.
+    indices         The palette index that each texel picked.
+    weights         How far along from endpoint 0 to endpoint 1 each palette index is, [0, 1].
+    endpoint0       Gets the new endpoint 0.  Untouched if the texels all picked one weight.
+    endpoint1       Gets the new endpoint 1.  Untouched if the texels all picked one weight.
+Returns:
+    True if the endpoints were changed.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static bool RefineEndpoints(const BlockTexels &block, const unsigned char indices[16],
+    const float weights[], float endpoint0[4], float endpoint1[4])
+{
+    float alphaSquared = 0.0f;
+    float alphaBeta = 0.0f;
+    float betaSquared = 0.0f;
+    float alphaTexels[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float betaTexels[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int texelIndex = 0; texelIndex < 16; texelIndex++)
+    {
+        float beta = weights[indices[texelIndex]];
+        float alpha = 1.0f - beta;
+        alphaSquared += alpha * alpha;
+        alphaBeta += alpha * beta;
+        betaSquared += beta * beta;
+        for (int channel = 0; channel < 4; channel++)
+        {
+            alphaTexels[channel] += alpha * block.channels[channel][texelIndex];
+            betaTexels[channel] += beta * block.channels[channel][texelIndex];
+        }
+    }
+
+    float determinant = (alphaSquared * betaSquared) - (alphaBeta * alphaBeta);
+    if (fabsf(determinant) < 1e-6f)
+    {
+        return false;
+    }
+
+    float scale = 1.0f / determinant;
+    for (int channel = 0; channel < 4; channel++)
+    {
+        float end0 = ((betaSquared * alphaTexels[channel]) -
+            (alphaBeta * betaTexels[channel])) * scale;
+        float end1 = ((alphaSquared * betaTexels[channel]) -
+            (alphaBeta * alphaTexels[channel])) * scale;
+        endpoint0[channel] = std::min(std::max(end0, 0.0f), 255.0f);
+        endpoint1[channel] = std::min(std::max(end1, 0.0f), 255.0f);
+    }
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------------------------
+// BC1 and BC3
+// ---------------------------------------------------------------------------------------------
+
+static inline unsigned int PackRgb565(const float color[4])
+{
+    unsigned int r = (unsigned int)lrintf(color[0] * (31.0f / 255.0f));
+    unsigned int g = (unsigned int)lrintf(color[1] * (63.0f / 255.0f));
+    unsigned int b = (unsigned int)lrintf(color[2] * (31.0f / 255.0f));
+    return (r << 11) | (g << 5) | b;
+}
+
+static inline void UnpackRgb565(unsigned int packed, int rgb[3])
+{
+    unsigned int r = (packed >> 11) & 0x1F;
+    unsigned int g = (packed >> 5) & 0x3F;
+    unsigned int b = packed & 0x1F;
+    rgb[0] = (int)((r << 3) | (r >> 2));
+    rgb[1] = (int)((g << 2) | (g >> 4));
+    rgb[2] = (int)((b << 3) | (b >> 2));
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The 4 colors that a BC1 block with these endpoints decodes to in 4-color mode.  The two
+    in-between colors use the integer rounding that DecompressBlocks(...) uses.
+Parameters:
+    color0      Endpoint 0 as RGB565.
+    color1      Endpoint 1 as RGB565.
+    palette     Gets the 4 colors in [0, 255].  Alpha is left alone.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void Bc1Palette(unsigned int color0, unsigned int color1, float palette[4][4])
+{
+    int rgb0[3];
+    int rgb1[3];
+    UnpackRgb565(color0, rgb0);
+    UnpackRgb565(color1, rgb1);
+    for (int channel = 0; channel < 3; channel++)
+    {
+        palette[0][channel] = (float)rgb0[channel];
+        palette[1][channel] = (float)rgb1[channel];
+        palette[2][channel] = (float)(((2 * rgb0[channel]) + rgb1[channel]) / 3);
+        palette[3][channel] = (float)((rgb0[channel] + (2 * rgb1[channel])) / 3);
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Tries one pair of endpoints: rounds them to RGB565, picks the best index for every texel,
+    and keeps the result if it beats the best so far.
+Parameters:
+    block       The block's texels.
+    endpoint0   Candidate endpoint 0.
+    endpoint1   Candidate endpoint 1.
+    bestError   The best error so far.  Updated if this pair is better.
+    bestColor0  Updated with the packed endpoint 0 if this pair is better.
+    bestColor1  Updated with the packed endpoint 1 if this pair is better.
+    bestIndices Updated with the indices if this pair is better.
+Returns:
+    True if this pair was better.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static bool TryBc1Endpoints(const BlockTexels &block, const float endpoint0[4],
+    const float endpoint1[4], float *bestError, unsigned int *bestColor0,
+    unsigned int *bestColor1, unsigned char bestIndices[16])
+{
+    unsigned int color0 = PackRgb565(endpoint0);
+    unsigned int color1 = PackRgb565(endpoint1);
+    float palette[4][4] = {};
+    Bc1Palette(color0, color1, palette);
+
+    unsigned char indices[16];
+    float error = FindNearestColors(block, palette, 4, 3, indices);
+    if (error >= *bestError)
+    {
+        return false;
+    }
+
+    *bestError = error;
+    *bestColor0 = color0;
+    *bestColor1 = color1;
+    memcpy(bestIndices, indices, 16);
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Encodes the color half of a block (all of a BC1 block, the last 8 bytes of a BC3 block).
+
+    The endpoint search starts from two candidates, the ends of the principal axis and the
+    corners of the bounding box, and then polishes the better one with a couple of rounds of
+    least squares.  Every candidate is judged by its real error after RGB565 rounding, not by
+    how good it looked as floats.
+Parameters:
+    block   The block's texels.
+    dest    Gets the 8 bytes.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void EncodeBc1ColorBlock(const BlockTexels &block, unsigned char dest[8])
+{
+    static const float BC1_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    float endpoint0[4];
+    float endpoint1[4];
+    PrincipalAxisEndpoints(block, 3, endpoint0, endpoint1);
+
+    float bestError = 1e30f;
+    unsigned int color0 = 0;
+    unsigned int color1 = 0;
+    unsigned char indices[16] = {};
+    TryBc1Endpoints(block, endpoint0, endpoint1, &bestError, &color0, &color1, indices);
+
+    float boxMin[4];
+    float boxMax[4];
+    BlockBounds(block, boxMin, boxMax);
+    if (TryBc1Endpoints(block, boxMin, boxMax, &bestError, &color0, &color1, indices))
+    {
+        memcpy(endpoint0, boxMin, sizeof(endpoint0));
+        memcpy(endpoint1, boxMax, sizeof(endpoint1));
+    }
+
+    for (int iteration = 0; (iteration < 2) && (bestError > 0.0f); iteration++)
+    {
+        // Note: The palette's in-between colors are rounded, so the least squares answer isn't
+        // guaranteed to be better; TryBc1Endpoints(...) keeps it only if it is.
+        if (!RefineEndpoints(block, indices, BC1_WEIGHTS, endpoint0, endpoint1) ||
+            !TryBc1Endpoints(block, endpoint0, endpoint1, &bestError, &color0, &color1,
+            indices))
+        {
+            break;
+        }
+    }
+
+    // 4-color mode needs color0 > color1; swapping the endpoints means swapping indices
+    // 0 <-> 1 and 2 <-> 3
+    // Note: When they're equal, every index is set to 0, which decodes the same in either
+    // mode.
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+        for (int texelIndex = 0; texelIndex < 16; texelIndex++)
+        {
+            indices[texelIndex] ^= 1;
+        }
+    }
+    else if (color0 == color1)
+    {
+        memset(indices, 0, 16);
+    }
+
+    unsigned int indexBits = 0;
+    for (int texelIndex = 0; texelIndex < 16; texelIndex++)
+    {
+        indexBits |= (unsigned int)indices[texelIndex] << (texelIndex * 2);
+    }
+
+    dest[0] = (unsigned char)(color0 & 0xFF);
+    dest[1] = (unsigned char)(color0 >> 8);
+    dest[2] = (unsigned char)(color1 & 0xFF);
+    dest[3] = (unsigned char)(color1 >> 8);
+    dest[4] = (unsigned char)(indexBits & 0xFF);
+    dest[5] = (unsigned char)((indexBits >> 8) & 0xFF);
+    dest[6] = (unsigned char)((indexBits >> 16) & 0xFF);
+    dest[7] = (unsigned char)(indexBits >> 24);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The 8 alphas that a BC3 alpha block decodes to when alpha0 > alpha1.
+Parameters:
+    alpha0      Endpoint 0.
+    alpha1      Endpoint 1.
+    values      Gets the 8 alphas.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void Bc3AlphaPalette(int alpha0, int alpha1, int values[8])
+{
+    values[0] = alpha0;
+    values[1] = alpha1;
+    for (int step = 1; step < 7; step++)
+    {
+        values[step + 1] = (((7 - step) * alpha0) + (step * alpha1)) / 7;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Encodes the alpha half of a BC3 block.  The endpoints are just the block's smallest and
+    largest alpha, which already spreads the 8 steps over exactly the range in use.
+Parameters:
+    block   The block's texels.
+    dest    Gets the first 8 bytes of the block.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void EncodeBc3AlphaBlock(const BlockTexels &block, unsigned char dest[8])
+{
+    float minValues[4];
+    float maxValues[4];
+    BlockBounds(block, minValues, maxValues);
+    int alpha0 = (int)maxValues[3];
+    int alpha1 = (int)minValues[3];
+
+    unsigned char indices[16] = {};
+    if (alpha0 != alpha1)
+    {
+        int values[8];
+        Bc3AlphaPalette(alpha0, alpha1, values);
+        float palette[8][4] = {};
+        for (int valueIndex = 0; valueIndex < 8; valueIndex++)
+        {
+            palette[valueIndex][3] = (float)values[valueIndex];
+        }
+        FindNearestColors(block, palette, 8, 1, indices);
+    }
+
+    // 16 3bit indices make 48 bits
+    unsigned long long indexBits = 0;
+    for (int texelIndex = 0; texelIndex < 16; texelIndex++)
+    {
+        indexBits |= (unsigned long long)indices[texelIndex] << (texelIndex * 3);
+    }
+
+    dest[0] = (unsigned char)alpha0;
+    dest[1] = (unsigned char)alpha1;
+    for (int byteIndex = 0; byteIndex < 6; byteIndex++)
+    {
+        dest[2 + byteIndex] = (unsigned char)((indexBits >> (byteIndex * 8)) & 0xFF);
+    }
+}
+
+
+// ---------------------------------------------------------------------------------------------
+// BC7
+// Note: Only mode 6 is encoded: one subset, RGBA endpoints with 7 bits per channel plus a
+// shared low bit per endpoint, and 4bit indices.  It is the most general of BC7's 8 modes and
+// handles smooth color and alpha well.  The partitioned modes would do better on blocks with
+// sharp edges, at several times the search cost.
+// ---------------------------------------------------------------------------------------------
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Writes fields into a 128bit block starting at bit 0 of byte 0, in the order that BC7
+    stores them.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class BlockBitWriter
+{
+public:
+    BlockBitWriter(unsigned char *dest) :
+        _dest(dest),
+        _bitPosition(0)
+    {
+        memset(_dest, 0, 16);
+    }
+
+    void Write(unsigned int value, unsigned int numBits)
+    {
+        for (unsigned int bit = 0; bit < numBits; bit++, _bitPosition++)
+        {
+            if ((value >> bit) & 1)
+            {
+                _dest[_bitPosition / 8] |= (unsigned char)(1 << (_bitPosition % 8));
+            }
+        }
+    }
+
+private:
+    unsigned char *_dest;
+    unsigned int _bitPosition;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The reading half of BlockBitWriter.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class BlockBitReader
+{
+public:
+    BlockBitReader(const unsigned char *source) :
+        _source(source),
+        _bitPosition(0)
+    {
+    }
+
+    unsigned int Read(unsigned int numBits)
+    {
+        unsigned int value = 0;
+        for (unsigned int bit = 0; bit < numBits; bit++, _bitPosition++)
+        {
+            value |= (unsigned int)((_source[_bitPosition / 8] >> (_bitPosition % 8)) & 1) << bit;
+        }
+        return value;
+    }
+
+private:
+    const unsigned char *_source;
+    unsigned int _bitPosition;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The 16 colors that a mode 6 block with these (already expanded to 8 bits) endpoints
+    decodes to.
+Parameters:
+    endpoint0   Endpoint 0, RGBA, each ((7bit value << 1) | pBit).
+    endpoint1   Endpoint 1, the same.
+    palette     Gets the 16 colors.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void Bc7Mode6Palette(const int endpoint0[4], const int endpoint1[4], int palette[16][4])
+{
+    for (int index = 0; index < 16; index++)
+    {
+        int weight = BC7_WEIGHTS_4BIT[index];
+        for (int channel = 0; channel < 4; channel++)
+        {
+            palette[index][channel] = (((64 - weight) * endpoint0[channel]) +
+                (weight * endpoint1[channel]) + 32) >> 6;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Tries one pair of endpoints with all 4 combinations of p-bits (the shared lowest bit of
+    each endpoint) and keeps the best if it beats the best so far.
+Parameters:
+    block           The block's texels.
+    endpoint0       Candidate endpoint 0 as floats.
+    endpoint1       Candidate endpoint 1 as floats.
+    bestError       The best error so far.  Updated if this pair is better.
+    bestEndpoint0   Updated with the 7bit values and p-bit (as ((value << 1) | pBit)).
+    bestEndpoint1   The same for endpoint 1.
+    bestIndices     Updated with the indices if this pair is better.
+Returns:
+    True if this pair was better.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static bool TryBc7Endpoints(const BlockTexels &block, const float endpoint0[4],
+    const float endpoint1[4], float *bestError, int bestEndpoint0[4], int bestEndpoint1[4],
+    unsigned char bestIndices[16])
+{
+    bool improved = false;
+    for (int pBits = 0; pBits < 4; pBits++)
+    {
+        int pBit0 = pBits & 1;
+        int pBit1 = pBits >> 1;
+        int quantized0[4];
+        int quantized1[4];
+        for (int channel = 0; channel < 4; channel++)
+        {
+            int value0 = (int)lrintf((endpoint0[channel] - pBit0) * 0.5f);
+            int value1 = (int)lrintf((endpoint1[channel] - pBit1) * 0.5f);
+            quantized0[channel] = (std::min(std::max(value0, 0), 127) << 1) | pBit0;
+            quantized1[channel] = (std::min(std::max(value1, 0), 127) << 1) | pBit1;
+        }
+
+        int decoded[16][4];
+        Bc7Mode6Palette(quantized0, quantized1, decoded);
+        float palette[16][4];
+        for (int index = 0; index < 16; index++)
+        {
+            for (int channel = 0; channel < 4; channel++)
+            {
+                palette[index][channel] = (float)decoded[index][channel];
+            }
+        }
+
+        unsigned char indices[16];
+        float error = FindNearestColors(block, palette, 16, 4, indices);
+        if (error < *bestError)
+        {
+            *bestError = error;
+            memcpy(bestEndpoint0, quantized0, sizeof(quantized0));
+            memcpy(bestEndpoint1, quantized1, sizeof(quantized1));
+            memcpy(bestIndices, indices, 16);
+            improved = true;
+        }
+    }
+
+    return improved;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Encodes one BC7 block in mode 6.  The endpoint search is the same as BC1's (principal
+    axis, then least squares polishing), but in 4 dimensions so that alpha is part of the
+    same line.
+Parameters:
+    block   The block's texels.
+    dest    Gets the 16 bytes.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void EncodeBc7Block(const BlockTexels &block, unsigned char dest[16])
+{
+    // BC7_WEIGHTS_4BIT as fractions
+    static const float BC7_WEIGHTS[16] =
+    {
+        0.0f / 64, 4.0f / 64, 9.0f / 64, 13.0f / 64, 17.0f / 64, 21.0f / 64, 26.0f / 64,
+        30.0f / 64, 34.0f / 64, 38.0f / 64, 43.0f / 64, 47.0f / 64, 51.0f / 64, 55.0f / 64,
+        60.0f / 64, 64.0f / 64
+    };
+
+    float endpoint0[4];
+    float endpoint1[4];
+    PrincipalAxisEndpoints(block, 4, endpoint0, endpoint1);
+
+    float bestError = 1e30f;
+    int quantized0[4] = {};
+    int quantized1[4] = {};
+    unsigned char indices[16] = {};
+    TryBc7Endpoints(block, endpoint0, endpoint1, &bestError, quantized0, quantized1, indices);
+    for (int iteration = 0; (iteration < 2) && (bestError > 0.0f); iteration++)
+    {
+        if (!RefineEndpoints(block, indices, BC7_WEIGHTS, endpoint0, endpoint1) ||
+            !TryBc7Endpoints(block, endpoint0, endpoint1, &bestError, quantized0, quantized1,
+            indices))
+        {
+            break;
+        }
+    }
+
+    // the first texel's index only gets 3 bits, so its top bit must be 0; flipping the
+    // endpoints around flips every index (i -> 15 - i) without changing any decoded color
+    if (indices[0] & 8)
+    {
+        for (int channel = 0; channel < 4; channel++)
+        {
+            std::swap(quantized0[channel], quantized1[channel]);
+        }
+        for (int texelIndex = 0; texelIndex < 16; texelIndex++)
+        {
+            indices[texelIndex] = (unsigned char)(15 - indices[texelIndex]);
+        }
+    }
+
+    // mode 6 is "six 0 bits then a 1"
+    BlockBitWriter writer(dest);
+    writer.Write(1 << 6, 7);
+    for (int channel = 0; channel < 4; channel++)
+    {
+        writer.Write(quantized0[channel] >> 1, 7);
+        writer.Write(quantized1[channel] >> 1, 7);
+    }
+    writer.Write(quantized0[0] & 1, 1);
+    writer.Write(quantized1[0] & 1, 1);
+    writer.Write(indices[0], 3);
+    for (int texelIndex = 1; texelIndex < 16; texelIndex++)
+    {
+        writer.Write(indices[texelIndex], 4);
+    }
+}
+
+
+// ---------------------------------------------------------------------------------------------
+// the public encoder and decoder
+// ---------------------------------------------------------------------------------------------
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Compresses an RGBA8 image into blocks.  Every 4x4 block is independent of every other one,
+    so rows of blocks are split up across the thread pool with no locking at all.
+Parameters:
+    rgba8Texels     The image, 4 bytes per texel, rows from the bottom up.
+    width           Image width.
+    height          Image height.
+    format          Which block format to make.  Must not be BLOCK_FORMAT_NONE.
+    blocks          Gets CompressedSizeBytes(width, height, format) bytes.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void CompressTexels(const unsigned char *rgba8Texels, unsigned int width, unsigned int height,
+    BlockFormat format, unsigned char *blocks)
+{
+    unsigned int blocksWide = (width + 3) / 4;
+    unsigned int blocksHigh = (height + 3) / 4;
+    unsigned int bytesPerBlock = BLOCK_FORMAT_DESCRIPTIONS[format].bytesPerBlock;
+
+    ThreadPool::Shared().ParallelFor(blocksHigh, 1,
+        [=](size_t beginBlockRow, size_t endBlockRow)
+    {
+        BlockTexels block;
+        for (size_t blockY = beginBlockRow; blockY < endBlockRow; blockY++)
+        {
+            unsigned char *dest = blocks + (blockY * blocksWide * bytesPerBlock);
+            for (unsigned int blockX = 0; blockX < blocksWide; blockX++, dest += bytesPerBlock)
+            {
+                LoadBlock(rgba8Texels, width, height, blockX, (unsigned int)blockY, &block);
+                if (format == BLOCK_FORMAT_BC1)
+                {
+                    EncodeBc1ColorBlock(block, dest);
+                }
+                else if (format == BLOCK_FORMAT_BC3)
+                {
+                    EncodeBc3AlphaBlock(block, dest);
+                    EncodeBc1ColorBlock(block, dest + 8);
+                }
+                else if (format == BLOCK_FORMAT_BC7)
+                {
+                    EncodeBc7Block(block, dest);
+                }
+            }
+        }
+    });
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Compresses level 0 and every level of a mip chain.  Each level is packed down to RGBA8
+    first, since that's all the precision that any of the block formats can hold.
+Parameters:
+    level0      The full-size texels.
+    width       Level 0 width.
+    height      Level 0 height.
+    mipLevels   Levels 1 and on, as made by BuildMipChain(...).  May be empty.
+    format      Which block format to make.  Must not be BLOCK_FORMAT_NONE.
+Returns:
+    Level 0 and then every mip level, compressed.  Empty if an allocation failed.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+std::vector<CompressedMipLevel> CompressMipChain(const texel *level0, unsigned int width,
+    unsigned int height, const std::vector<MipLevel> &mipLevels, BlockFormat format)
+{
+    std::vector<CompressedMipLevel> compressedLevels(mipLevels.size() + 1);
+    for (size_t levelIndex = 0; levelIndex < compressedLevels.size(); levelIndex++)
+    {
+        const texel *texels = level0;
+        unsigned int levelWidth = width;
+        unsigned int levelHeight = height;
+        if (levelIndex > 0)
+        {
+            texels = mipLevels[levelIndex - 1].texels.Data();
+            levelWidth = mipLevels[levelIndex - 1].width;
+            levelHeight = mipLevels[levelIndex - 1].height;
+        }
+
+        CompressedMipLevel &compressed = compressedLevels[levelIndex];
+        compressed.width = levelWidth;
+        compressed.height = levelHeight;
+        compressed.blocks.Resize(CompressedSizeBytes(levelWidth, levelHeight, format));
+        PackedTexelBuffer rgba8Texels = ConvertTexels(texels, (size_t)levelWidth * levelHeight,
+            TEXEL_FORMAT_RGBA8);
+        if ((compressed.blocks.Data() == 0) || (rgba8Texels.Data() == 0))
+        {
+            compressedLevels.clear();
+            return compressedLevels;
+        }
+
+        CompressTexels(rgba8Texels.Data(), levelWidth, levelHeight, format,
+            compressed.blocks.Data());
+    }
+
+    return compressedLevels;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Decodes BC1 color bits into 16 RGBA texels.
+Parameters:
+    source          The 8 color bytes.
+    forceFourColor  BC3's color half always decodes in 4-color mode.
+    texels          Gets 16 texels, 4 bytes each.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void DecodeBc1ColorBlock(const unsigned char source[8], bool forceFourColor,
+    unsigned char texels[16][4])
+{
+    unsigned int color0 = source[0] | (source[1] << 8);
+    unsigned int color1 = source[2] | (source[3] << 8);
+    unsigned int indexBits = source[4] | (source[5] << 8) | (source[6] << 16) |
+        ((unsigned int)source[7] << 24);
+
+    int palette[4][4];
+    UnpackRgb565(color0, palette[0]);
+    UnpackRgb565(color1, palette[1]);
+    palette[0][3] = 255;
+    palette[1][3] = 255;
+    palette[2][3] = 255;
+    palette[3][3] = 255;
+    for (int channel = 0; channel < 3; channel++)
+    {
+        if (forceFourColor || (color0 > color1))
+        {
+            palette[2][channel] = ((2 * palette[0][channel]) + palette[1][channel]) / 3;
+            palette[3][channel] = (palette[0][channel] + (2 * palette[1][channel])) / 3;
+        }
+        else
+        {
+            // 3-color mode: a halfway color and transparent black
+            palette[2][channel] = (palette[0][channel] + palette[1][channel]) / 2;
+            palette[3][channel] = 0;
+            palette[3][3] = 0;
+        }
+    }
+
+    for (int texelIndex = 0; texelIndex < 16; texelIndex++)
+    {
+        unsigned int index = (indexBits >> (texelIndex * 2)) & 3;
+        for (int channel = 0; channel < 4; channel++)
+        {
+            texels[texelIndex][channel] = (unsigned char)palette[index][channel];
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Decodes one BC7 block.
+
+    Note: Only mode 6, the only mode that CompressTexels(...) makes, is decoded.  Blocks in any
+    other mode come out solid magenta so that they're easy to spot.
+Parameters:
+    source  The 16 bytes.
+    texels  Gets 16 texels, 4 bytes each.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void DecodeBc7Block(const unsigned char source[16], unsigned char texels[16][4])
+{
+    BlockBitReader reader(source);
+    if (reader.Read(7) != (1 << 6))
+    {
+        for (int texelIndex = 0; texelIndex < 16; texelIndex++)
+        {
+            texels[texelIndex][0] = 255;
+            texels[texelIndex][1] = 0;
+            texels[texelIndex][2] = 255;
+            texels[texelIndex][3] = 255;
+        }
+        return;
+    }
+
+    int endpoint0[4];
+    int endpoint1[4];
+    for (int channel = 0; channel < 4; channel++)
+    {
+        endpoint0[channel] = (int)reader.Read(7) << 1;
+        endpoint1[channel] = (int)reader.Read(7) << 1;
+    }
+    int pBit0 = (int)reader.Read(1);
+    int pBit1 = (int)reader.Read(1);
+    for (int channel = 0; channel < 4; channel++)
+    {
+        endpoint0[channel] |= pBit0;
+        endpoint1[channel] |= pBit1;
+    }
+
+    int palette[16][4];
+    Bc7Mode6Palette(endpoint0, endpoint1, palette);
+    for (int texelIndex = 0; texelIndex < 16; texelIndex++)
+    {
+        unsigned int index = reader.Read((texelIndex == 0) ? 3 : 4);
+        for (int channel = 0; channel < 4; channel++)
+        {
+            texels[texelIndex][channel] = (unsigned char)palette[index][channel];
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Decodes blocks back into RGBA8 on the CPU, the same way the GPU would.  This lets the
+    encoder's quality be measured (see ComputePsnr(...)) without a GPU or an OpenGL context.
+
+    Note: BC7 decoding is exact by spec.  BC1/BC3's in-between colors are allowed some slack,
+    so a driver may come out 1 away from this on those texels.
+Parameters:
+    blocks          CompressedSizeBytes(width, height, format) bytes of blocks.
+    width           Image width.
+    height          Image height.
+    format          Which block format they are.  Must not be BLOCK_FORMAT_NONE.
+    rgba8Texels     Gets width * height texels, 4 bytes each.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void DecompressBlocks(const unsigned char *blocks, unsigned int width, unsigned int height,
+    BlockFormat format, unsigned char *rgba8Texels)
+{
+    unsigned int blocksWide = (width + 3) / 4;
+    unsigned int blocksHigh = (height + 3) / 4;
+    unsigned int bytesPerBlock = BLOCK_FORMAT_DESCRIPTIONS[format].bytesPerBlock;
+
+    ThreadPool::Shared().ParallelFor(blocksHigh, 4,
+        [=](size_t beginBlockRow, size_t endBlockRow)
+    {
+        unsigned char texels[16][4];
+        for (size_t blockY = beginBlockRow; blockY < endBlockRow; blockY++)
+        {
+            const unsigned char *source = blocks + (blockY * blocksWide * bytesPerBlock);
+            for (unsigned int blockX = 0; blockX < blocksWide; blockX++, source += bytesPerBlock)
+            {
+                if (format == BLOCK_FORMAT_BC1)
+                {
+                    DecodeBc1ColorBlock(source, false, texels);
+                }
+                else if (format == BLOCK_FORMAT_BC3)
+                {
+                    DecodeBc1ColorBlock(source + 8, true, texels);
+
+                    int alphas[8];
+                    int alpha0 = source[0];
+                    int alpha1 = source[1];
+                    if (alpha0 > alpha1)
+                    {
+                        Bc3AlphaPalette(alpha0, alpha1, alphas);
+                    }
+                    else
+                    {
+                        // 6 steps plus fully transparent and fully opaque
+                        alphas[0] = alpha0;
+                        alphas[1] = alpha1;
+                        for (int step = 1; step < 5; step++)
+                        {
+                            alphas[step + 1] = (((5 - step) * alpha0) + (step * alpha1)) / 5;
+                        }
+                        alphas[6] = 0;
+                        alphas[7] = 255;
+                    }
+
+                    unsigned long long indexBits = 0;
+                    for (int byteIndex = 0; byteIndex < 6; byteIndex++)
+                    {
+                        indexBits |= (unsigned long long)source[2 + byteIndex] << (byteIndex * 8);
+                    }
+                    for (int texelIndex = 0; texelIndex < 16; texelIndex++)
+                    {
+                        unsigned int index = (unsigned int)(indexBits >> (texelIndex * 3)) & 7;
+                        texels[texelIndex][3] = (unsigned char)alphas[index];
+                    }
+                }
+                else if (format == BLOCK_FORMAT_BC7)
+                {
+                    DecodeBc7Block(source, texels);
+                }
+
+                // copy out whatever part of the block is inside the image
+                for (unsigned int row = 0; row < 4; row++)
+                {
+                    unsigned int y = ((unsigned int)blockY * 4) + row;
+                    for (unsigned int col = 0; col < 4; col++)
+                    {
+                        unsigned int x = (blockX * 4) + col;
+                        if ((x < width) && (y < height))
+                        {
+                            memcpy(rgba8Texels + ((((size_t)y * width) + x) * 4),
+                                texels[(row * 4) + col], 4);
+                        }
+                    }
+                }
+            }
+        }
+    });
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Peak signal-to-noise ratio between two RGBA8 images, in decibels.  Higher is better:
+    about 35dB and up is hard to tell apart from the original by eye, and identical images
+    are reported as 100dB rather than infinity.
+Parameters:
+    rgba8Original   The image before compression.
+    rgba8Decoded    The image after DecompressBlocks(...).
+    numTexels       How many texels are in each.
+    includeAlpha    False to compare only RGB (ex: for BC1, which has no alpha).
+Returns:
+    The PSNR in dB.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+double ComputePsnr(const unsigned char *rgba8Original, const unsigned char *rgba8Decoded,
+    size_t numTexels, bool includeAlpha)
+{
+    int numChannels = includeAlpha ? 4 : 3;
+    double squaredErrorSum = 0.0;
+    for (size_t texelIndex = 0; texelIndex < numTexels; texelIndex++)
+    {
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            double diff = (double)rgba8Original[(texelIndex * 4) + channel] -
+                (double)rgba8Decoded[(texelIndex * 4) + channel];
+            squaredErrorSum += diff * diff;
+        }
+    }
+
+    double meanSquaredError = squaredErrorSum / ((double)numTexels * numChannels);
+    if (meanSquaredError <= 0.0)
+    {
+        return 100.0;
+    }
+
+    return 10.0 * log10((255.0 * 255.0) / meanSquaredError);
+}
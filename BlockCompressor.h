@@ -0,0 +1,63 @@
+#pragma once
+
+#include "TexelFormatConverter.h"
+#include "MipChainBuilder.h"
+
+#include <stddef.h>
+#include <vector>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The block-compressed formats that the encoder can make.  Every one of them stores a 4x4
+    block of texels in a fixed number of bytes, and the GPU decodes them on the fly when it
+    samples, so they stay compressed in video memory.
+
+    BC1 (DXT1): 8 bytes per block, RGB (4 bits per texel, 8:1 against RGBA8).
+    BC3 (DXT5): 16 bytes per block, RGB + a separately compressed alpha.
+    BC7 (BPTC): 16 bytes per block, RGBA with much better quality than BC3.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+enum BlockFormat
+{
+    BLOCK_FORMAT_NONE = 0,
+    BLOCK_FORMAT_BC1,
+    BLOCK_FORMAT_BC3,
+    BLOCK_FORMAT_BC7,
+    BLOCK_FORMAT_COUNT,
+};
+
+struct BlockFormatDescription
+{
+    const char *name;
+    unsigned int internalFormat;    // ex: GL_COMPRESSED_RGBA_BPTC_UNORM_ARB
+    unsigned int bytesPerBlock;
+    bool hasAlpha;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    One compressed mip level.  Unlike MipLevel, this holds level 0 too.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct CompressedMipLevel
+{
+    unsigned int width;
+    unsigned int height;
+    PackedTexelBuffer blocks;
+};
+
+const BlockFormatDescription &GetBlockFormatDescription(BlockFormat format);
+bool ParseBlockFormat(const char *name, BlockFormat *format);
+size_t CompressedSizeBytes(unsigned int width, unsigned int height, BlockFormat format);
+
+// the source and destination texels are RGBA8, 4 bytes each, rows from the bottom up (the same
+// order as glTexImage2D(...))
+void CompressTexels(const unsigned char *rgba8Texels, unsigned int width, unsigned int height,
+    BlockFormat format, unsigned char *blocks);
+void DecompressBlocks(const unsigned char *blocks, unsigned int width, unsigned int height,
+    BlockFormat format, unsigned char *rgba8Texels);
+double ComputePsnr(const unsigned char *rgba8Original, const unsigned char *rgba8Decoded,
+    size_t numTexels, bool includeAlpha);
+
+std::vector<CompressedMipLevel> CompressMipChain(const texel *level0, unsigned int width,
+    unsigned int height, const std::vector<MipLevel> &mipLevels, BlockFormat format);
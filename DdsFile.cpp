@@ -0,0 +1,216 @@
+#include "DdsFile.h"
+
+#include <stdio.h>
+#include <string.h>     // memcmp(...) and memset(...)
+#include <algorithm>
+
+// the parts of the DirectDraw Surface header that matter here
+// Note: Everything in the file is little-endian 32bit words, the same as x86/x64 memory, so
+// the headers are read and written as plain structs.
+static const unsigned int DDSD_CAPS = 0x1;
+static const unsigned int DDSD_HEIGHT = 0x2;
+static const unsigned int DDSD_WIDTH = 0x4;
+static const unsigned int DDSD_PIXELFORMAT = 0x1000;
+static const unsigned int DDSD_MIPMAPCOUNT = 0x20000;
+static const unsigned int DDSD_LINEARSIZE = 0x80000;
+static const unsigned int DDPF_FOURCC = 0x4;
+static const unsigned int DDSCAPS_COMPLEX = 0x8;
+static const unsigned int DDSCAPS_TEXTURE = 0x1000;
+static const unsigned int DDSCAPS_MIPMAP = 0x400000;
+static const unsigned int DXGI_FORMAT_BC7_UNORM = 98;
+static const unsigned int D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+
+struct DdsPixelFormat
+{
+    unsigned int size;
+    unsigned int flags;
+    char fourCC[4];
+    unsigned int rgbBitCount;
+    unsigned int bitMasks[4];
+};
+
+struct DdsHeader
+{
+    unsigned int size;
+    unsigned int flags;
+    unsigned int height;
+    unsigned int width;
+    unsigned int pitchOrLinearSize;
+    unsigned int depth;
+    unsigned int mipMapCount;
+    unsigned int reserved1[11];
+    DdsPixelFormat pixelFormat;
+    unsigned int caps[4];
+    unsigned int reserved2;
+};
+
+// BC7 has no FourCC of its own, so it's "DX10" and then this
+struct DdsHeaderDx10
+{
+    unsigned int dxgiFormat;
+    unsigned int resourceDimension;
+    unsigned int miscFlag;
+    unsigned int arraySize;
+    unsigned int miscFlags2;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Saves compressed mip levels as a .dds file, so that the (slow, for BC7) compression can be
+    done once ahead of time and loading is just a read.
+Parameters:
+    filePath            Where to write it.  Overwritten if it exists.
+    format              The block format of the levels.
+    compressedLevels    Level 0 and then every mip level, as made by CompressMipChain(...).
+Returns:
+    True if the whole file was written.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool WriteDdsFile(const char *filePath, BlockFormat format,
+    const std::vector<CompressedMipLevel> &compressedLevels)
+{
+    if ((format == BLOCK_FORMAT_NONE) || compressedLevels.empty())
+    {
+        return false;
+    }
+
+    DdsHeader header;
+    memset(&header, 0, sizeof(header));
+    header.size = sizeof(DdsHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT |
+        DDSD_LINEARSIZE;
+    header.height = compressedLevels[0].height;
+    header.width = compressedLevels[0].width;
+    header.pitchOrLinearSize = (unsigned int)compressedLevels[0].blocks.SizeBytes();
+    header.mipMapCount = (unsigned int)compressedLevels.size();
+    header.pixelFormat.size = sizeof(DdsPixelFormat);
+    header.pixelFormat.flags = DDPF_FOURCC;
+    const char *fourCC = (format == BLOCK_FORMAT_BC1) ? "DXT1" :
+        ((format == BLOCK_FORMAT_BC3) ? "DXT5" : "DX10");
+    memcpy(header.pixelFormat.fourCC, fourCC, 4);
+    header.caps[0] = DDSCAPS_TEXTURE;
+    if (compressedLevels.size() > 1)
+    {
+        header.caps[0] |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+    }
+
+    FILE *file = fopen(filePath, "wb");
+    if (file == 0)
+    {
+        printf("could not open '%s' for writing\n", filePath);
+        return false;
+    }
+
+    bool good = (fwrite("DDS ", 4, 1, file) == 1) &&
+        (fwrite(&header, sizeof(header), 1, file) == 1);
+    if (good && (format == BLOCK_FORMAT_BC7))
+    {
+        DdsHeaderDx10 dx10Header = { DXGI_FORMAT_BC7_UNORM, D3D10_RESOURCE_DIMENSION_TEXTURE2D,
+            0, 1, 0 };
+        good = (fwrite(&dx10Header, sizeof(dx10Header), 1, file) == 1);
+    }
+    for (size_t levelIndex = 0; good && (levelIndex < compressedLevels.size()); levelIndex++)
+    {
+        const PackedTexelBuffer &blocks = compressedLevels[levelIndex].blocks;
+        good = (fwrite(blocks.Data(), blocks.SizeBytes(), 1, file) == 1);
+    }
+
+    if ((fclose(file) != 0) || !good)
+    {
+        printf("could not write all of '%s'\n", filePath);
+        return false;
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Loads a .dds file made by WriteDdsFile(...).  Other block formats, uncompressed .dds
+    files, cube maps, and arrays are turned away.
+Parameters:
+    filePath            The file to read.
+    format              Gets the file's block format.
+    compressedLevels    Gets level 0 and then every mip level that the file has.
+Returns:
+    True if the file was one of the supported kinds and all of it was there.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool ReadDdsFile(const char *filePath, BlockFormat *format,
+    std::vector<CompressedMipLevel> *compressedLevels)
+{
+    FILE *file = fopen(filePath, "rb");
+    if (file == 0)
+    {
+        printf("could not open '%s'\n", filePath);
+        return false;
+    }
+
+    char magic[4];
+    DdsHeader header;
+    memset(&header, 0, sizeof(header));
+    bool good = (fread(magic, 4, 1, file) == 1) && (memcmp(magic, "DDS ", 4) == 0) &&
+        (fread(&header, sizeof(header), 1, file) == 1) && (header.size == sizeof(DdsHeader)) &&
+        (header.pixelFormat.flags & DDPF_FOURCC) && (header.width > 0) && (header.height > 0);
+
+    BlockFormat fileFormat = BLOCK_FORMAT_NONE;
+    if (good)
+    {
+        if (memcmp(header.pixelFormat.fourCC, "DXT1", 4) == 0)
+        {
+            fileFormat = BLOCK_FORMAT_BC1;
+        }
+        else if (memcmp(header.pixelFormat.fourCC, "DXT5", 4) == 0)
+        {
+            fileFormat = BLOCK_FORMAT_BC3;
+        }
+        else if (memcmp(header.pixelFormat.fourCC, "DX10", 4) == 0)
+        {
+            DdsHeaderDx10 dx10Header;
+            if ((fread(&dx10Header, sizeof(dx10Header), 1, file) == 1) &&
+                (dx10Header.dxgiFormat == DXGI_FORMAT_BC7_UNORM) &&
+                (dx10Header.resourceDimension == D3D10_RESOURCE_DIMENSION_TEXTURE2D) &&
+                (dx10Header.arraySize <= 1))
+            {
+                fileFormat = BLOCK_FORMAT_BC7;
+            }
+        }
+        good = (fileFormat != BLOCK_FORMAT_NONE);
+    }
+
+    // a file without the mipmap count flag only has level 0
+    unsigned int numLevels = 1;
+    if (good && (header.flags & DDSD_MIPMAPCOUNT) && (header.mipMapCount > 1))
+    {
+        numLevels = std::min(header.mipMapCount, NumMipLevels(header.width, header.height));
+    }
+
+    std::vector<CompressedMipLevel> levels(good ? numLevels : 0);
+    unsigned int levelWidth = header.width;
+    unsigned int levelHeight = header.height;
+    for (size_t levelIndex = 0; good && (levelIndex < levels.size()); levelIndex++)
+    {
+        CompressedMipLevel &level = levels[levelIndex];
+        level.width = levelWidth;
+        level.height = levelHeight;
+        level.blocks.Resize(CompressedSizeBytes(levelWidth, levelHeight, fileFormat));
+        good = (level.blocks.Data() != 0) &&
+            (fread(level.blocks.Data(), level.blocks.SizeBytes(), 1, file) == 1);
+
+        levelWidth = std::max(levelWidth / 2, 1u);
+        levelHeight = std::max(levelHeight / 2, 1u);
+    }
+    fclose(file);
+
+    if (!good)
+    {
+        printf("'%s' is not a BC1, BC3, or BC7 .dds file, or it is cut short\n", filePath);
+        return false;
+    }
+
+    *format = fileFormat;
+    compressedLevels->swap(levels);
+    return true;
+}
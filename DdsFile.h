@@ -0,0 +1,12 @@
+#pragma once
+
+#include "BlockCompressor.h"
+
+#include <vector>
+
+// Note: The levels are written in OpenGL's bottom-up row order, so the file loads straight
+// back into glCompressedTexSubImage2D(...), but D3D-based viewers show it upside down.
+bool WriteDdsFile(const char *filePath, BlockFormat format,
+    const std::vector<CompressedMipLevel> &compressedLevels);
+bool ReadDdsFile(const char *filePath, BlockFormat *format,
+    std::vector<CompressedMipLevel> *compressedLevels);
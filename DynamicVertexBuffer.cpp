@@ -0,0 +1,333 @@
+#include "glload/include/glload/gl_4_4.h"
+#include "glload/include/glload/gl_load.hpp"
+
+#include "DynamicVertexBuffer.h"
+#include "GlStateCache.h"
+
+#include <stdio.h>
+#include <string.h>     // memset(...)
+#include <chrono>
+
+// Note: Each region starts on a boundary that is good for any vertex format (and for uniform
+// buffer offsets, which are the pickiest at 256 bytes on most hardware), and regions that
+// don't share cache lines don't have the CPU and GPU fighting over them.
+static const size_t REGION_ALIGNMENT = 256;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out empty.  Nothing happens until Init(...).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+DynamicVertexBuffer::DynamicVertexBuffer() :
+    _bufferId(0),
+    _mappedBytes(0),
+    _bytesPerFrame(0),
+    _numFrames(0),
+    _frameIndex(0),
+    _inFrame(false),
+    _frameBytesUsed(0),
+    _frameAllocations(0),
+    _frameFailedAllocations(0)
+{
+    memset(_fences, 0, sizeof(_fences));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Nothing.  Call Shutdown() while the context is still around to clean up.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+DynamicVertexBuffer::~DynamicVertexBuffer()
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes the buffer and maps it for good.
+Parameters:
+    bytesPerFrame   The most that one frame can allocate.  Rounded up to REGION_ALIGNMENT.
+    numFrames       How many frames can be in flight at once.  3 is the usual (one being
+                    written, one or two being drawn); at least 2 and at most MAX_FRAMES.
+Returns:
+    True if everything was made, false if the driver can't do persistent mapping.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool DynamicVertexBuffer::Init(size_t bytesPerFrame, unsigned int numFrames)
+{
+    Shutdown();
+    if (!glload::IsVersionGEQ(4, 4) && !glext_ARB_buffer_storage)
+    {
+        printf("dynamic vertex buffers need GL_ARB_buffer_storage (OpenGL 4.4)\n");
+        return false;
+    }
+
+    _bytesPerFrame = (bytesPerFrame + REGION_ALIGNMENT - 1) & ~(REGION_ALIGNMENT - 1);
+    _numFrames = (numFrames < 2) ? 2 : ((numFrames > MAX_FRAMES) ? MAX_FRAMES : numFrames);
+
+    // Note: "Coherent" means that writes show up to the GPU without having to call
+    // glFlushMappedBufferRange(...), and "persistent" means that the buffer can be drawn from
+    // while it's mapped.  There is no dynamic storage bit, since the contents only ever change
+    // through the mapping.
+    GlStateCache &stateCache = GlStateCache::Shared();
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLsizeiptr bufferSize = (GLsizeiptr)(_bytesPerFrame * _numFrames);
+    glGenBuffers(1, &_bufferId);
+    stateCache.BindBuffer(GL_ARRAY_BUFFER, _bufferId);
+    glBufferStorage(GL_ARRAY_BUFFER, bufferSize, 0, flags);
+    _mappedBytes = (unsigned char *)glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, flags);
+    if (_mappedBytes == 0)
+    {
+        printf("could not map a %u byte dynamic vertex buffer\n", (unsigned int)bufferSize);
+        Shutdown();
+        return false;
+    }
+
+    // the first BeginFrame() moves on to region 0
+    _frameIndex = _numFrames - 1;
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Waits for the GPU to finish with every region and deletes the buffer.  Safe to call more
+    than once.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void DynamicVertexBuffer::Shutdown()
+{
+    for (unsigned int frameCount = 0; frameCount < MAX_FRAMES; frameCount++)
+    {
+        if (_fences[frameCount] != 0)
+        {
+            glClientWaitSync((GLsync)_fences[frameCount], GL_SYNC_FLUSH_COMMANDS_BIT,
+                1000000000);
+            glDeleteSync((GLsync)_fences[frameCount]);
+            _fences[frameCount] = 0;
+        }
+    }
+
+    if (_bufferId != 0)
+    {
+        // Note: Deleting a mapped buffer unmaps it.
+        glDeleteBuffers(1, &_bufferId);
+        GlStateCache::Shared().ForgetBuffer(_bufferId);
+        _bufferId = 0;
+    }
+    _mappedBytes = 0;
+    _bytesPerFrame = 0;
+    _numFrames = 0;
+    _inFrame = false;
+    _frameBytesUsed = 0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Moves on to the next region, waiting for the GPU to finish reading it from numFrames frames
+    ago if it hasn't already (which it almost always has).  Does nothing if the buffer wasn't
+    made.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void DynamicVertexBuffer::BeginFrame()
+{
+    if (_mappedBytes == 0)
+    {
+        return;
+    }
+    if (_inFrame)
+    {
+        EndFrame();
+    }
+
+    _frameIndex = (_frameIndex + 1) % _numFrames;
+    GLsync fence = (GLsync)_fences[_frameIndex];
+    if (fence != 0)
+    {
+        // a timeout of 0 makes this a poll, and it's only a real wait if that says no
+        // Note: The flush bit makes sure that the fence is actually on its way to the GPU.
+        // Otherwise a driver that is sitting on a batch of commands could keep this waiting
+        // forever.
+        std::chrono::high_resolution_clock::time_point start =
+            std::chrono::high_resolution_clock::now();
+        GLenum waitResult = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (waitResult == GL_TIMEOUT_EXPIRED)
+        {
+            _stats.numStalls++;
+            do
+            {
+                waitResult = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            } while (waitResult == GL_TIMEOUT_EXPIRED);
+        }
+        std::chrono::duration<double> elapsed =
+            std::chrono::high_resolution_clock::now() - start;
+        _stats.waitSeconds += elapsed.count();
+
+        glDeleteSync(fence);
+        _fences[_frameIndex] = 0;
+    }
+
+    _frameBytesUsed = 0;
+    _frameAllocations = 0;
+    _frameFailedAllocations = 0;
+    _inFrame = true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Call once the frame's draws (everything that reads this frame's allocations) have been
+    issued.  Drops the fence that BeginFrame() checks when this region comes around again.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void DynamicVertexBuffer::EndFrame()
+{
+    if (!_inFrame)
+    {
+        return;
+    }
+
+    _fences[_frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _inFrame = false;
+
+    // Note: A failed allocation leaves the cursor where it was (see Allocate(...)), so this
+    // is never past the end.
+    size_t frameBytes = _frameBytesUsed.load(std::memory_order_relaxed);
+    _stats.numFrames++;
+    _stats.numAllocations += _frameAllocations.load(std::memory_order_relaxed);
+    _stats.failedAllocations += _frameFailedAllocations.load(std::memory_order_relaxed);
+    _stats.bytesAllocated += frameBytes;
+    if (frameBytes > _stats.peakFrameBytes)
+    {
+        _stats.peakFrameBytes = frameBytes;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Hands out the next piece of this frame's region.  Just an atomic add: no OpenGL, and no
+    lock, so any thread can call it.
+Parameters:
+    numBytes    How much room.
+    alignment   The piece's offset (in the whole buffer) will be a multiple of this.  It
+                doesn't have to be a power of 2, so the size of a vertex or instance works,
+                which lets a draw start at the piece with a base vertex or base instance.
+Returns:
+    The piece, or one with null data if there isn't room for it (or BeginFrame() wasn't
+    called).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+DynamicBufferAllocation DynamicVertexBuffer::Allocate(size_t numBytes, size_t alignment)
+{
+    DynamicBufferAllocation allocation = { 0, 0 };
+    if (!_inFrame)
+    {
+        return allocation;
+    }
+    alignment = (alignment == 0) ? 1 : alignment;
+
+    size_t regionStart = _frameIndex * _bytesPerFrame;
+    size_t used = _frameBytesUsed.load(std::memory_order_relaxed);
+    size_t offset = 0;
+    size_t newUsed = 0;
+    do
+    {
+        offset = regionStart + used;
+        offset = ((offset + alignment - 1) / alignment) * alignment;
+        newUsed = (offset - regionStart) + numBytes;
+        if (newUsed > _bytesPerFrame)
+        {
+            _frameFailedAllocations.fetch_add(1, std::memory_order_relaxed);
+            return allocation;
+        }
+    } while (!_frameBytesUsed.compare_exchange_weak(used, newUsed, std::memory_order_relaxed));
+
+    _frameAllocations.fetch_add(1, std::memory_order_relaxed);
+    allocation.data = _mappedBytes + offset;
+    allocation.offset = offset;
+    return allocation;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    True if Init(...) worked.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool DynamicVertexBuffer::IsReady() const
+{
+    return _mappedBytes != 0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The buffer, for binding as a vertex buffer (or any other kind).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int DynamicVertexBuffer::BufferId() const
+{
+    return _bufferId;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    How much each frame can allocate.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+size_t DynamicVertexBuffer::BytesPerFrame() const
+{
+    return _bytesPerFrame;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The totals for every finished frame so far (see EndFrame()).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const DynamicVertexBufferStats &DynamicVertexBuffer::Stats() const
+{
+    return _stats;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts the totals over.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void DynamicVertexBuffer::ResetStats()
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A piece of this frame's region of a DynamicVertexBuffer.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct DynamicBufferAllocation
+{
+    void *data;         // where to write; null if the frame's region was full
+    size_t offset;      // the same place as a byte offset into the buffer (for drawing)
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Running totals for a DynamicVertexBuffer.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct DynamicVertexBufferStats
+{
+    unsigned long long numFrames;
+    unsigned long long numAllocations;
+    unsigned long long bytesAllocated;
+    unsigned long long failedAllocations;   // the frame's region was full
+    unsigned long long numStalls;           // BeginFrame() had to wait for the GPU
+    double waitSeconds;                     // time spent waiting on (and polling) fences
+    size_t peakFrameBytes;                  // the most that any one frame used
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Room for geometry that changes every frame, written by the CPU straight into memory that
+    the GPU reads, with no copies and no waiting on the driver.
+
+    glBufferData(...) every frame (orphaning) asks the driver to find fresh memory for the
+    buffer so that it doesn't have to wait for draws that are still reading the old contents,
+    but how well that works is up to the driver, and some of them stall anyway.  Instead, this
+    is one buffer made with glBufferStorage(...) and mapped once, persistently and coherently,
+    for its whole life, and split into numFrames regions (3 is the usual).  Each frame gets
+    the next region, Allocate(...) hands out pieces of it from front to back, and EndFrame()
+    drops a fence after the frame's draws.  By the time that region comes around again, the
+    GPU has usually long since passed the fence, so BeginFrame()'s check of it is free; if the
+    GPU has fallen that far behind, BeginFrame() waits, which is the only wait there is.
+
+    Note: Allocate(...) can be called from any thread between BeginFrame() and EndFrame()
+    (only the pieces' writing has to be done before the draws that read them are issued).
+    Everything else needs the OpenGL thread.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class DynamicVertexBuffer
+{
+public:
+    DynamicVertexBuffer();
+    ~DynamicVertexBuffer();
+
+    // these need the OpenGL context to be current
+    bool Init(size_t bytesPerFrame, unsigned int numFrames);
+    void Shutdown();
+    void BeginFrame();
+    void EndFrame();
+
+    DynamicBufferAllocation Allocate(size_t numBytes, size_t alignment);
+
+    bool IsReady() const;
+    unsigned int BufferId() const;
+    size_t BytesPerFrame() const;
+    const DynamicVertexBufferStats &Stats() const;
+    void ResetStats();
+
+    static const unsigned int MAX_FRAMES = 4;
+
+private:
+    DynamicVertexBuffer(const DynamicVertexBuffer &);
+    DynamicVertexBuffer &operator=(const DynamicVertexBuffer &);
+
+    unsigned int _bufferId;
+    unsigned char *_mappedBytes;
+    size_t _bytesPerFrame;      // each region's size (and stride)
+    unsigned int _numFrames;
+    unsigned int _frameIndex;   // the region being written
+    bool _inFrame;
+
+    // how much of the current region has been handed out
+    std::atomic<size_t> _frameBytesUsed;
+
+    // GLsyncs, but this header doesn't need OpenGL
+    void *_fences[MAX_FRAMES];
+
+    DynamicVertexBufferStats _stats;
+    std::atomic<unsigned long long> _frameAllocations;
+    std::atomic<unsigned long long> _frameFailedAllocations;
+};
@@ -0,0 +1,353 @@
+#include "FileWatcher.h"
+
+#include <stdio.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Splits a path into its directory and file name.
+Parameters:
+    filePath    ex: "shaders/shader.vert" or "shader.vert"
+    directory   Gets the directory (ex: "shaders"), or "." if there isn't one.
+    fileName    Gets the file name (ex: "shader.vert").
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void SplitPath(const std::string &filePath, std::string *directory,
+    std::string *fileName)
+{
+    size_t slash = filePath.find_last_of("/\\");
+    if (slash == std::string::npos)
+    {
+        *directory = ".";
+        *fileName = filePath;
+    }
+    else
+    {
+        *directory = (slash == 0) ? "/" : filePath.substr(0, slash);
+        *fileName = filePath.substr(slash + 1);
+    }
+}
+
+#else
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    When a file was last written.
+Parameters:
+    filePath    The file.
+Returns:
+    The modification time in seconds, or -1 if the file isn't there (in the middle of being
+    replaced, for example).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static long long ModifiedTime(const std::string &filePath)
+{
+#ifdef _WIN32
+    struct _stat fileInfo;
+    return (_stat(filePath.c_str(), &fileInfo) == 0) ? (long long)fileInfo.st_mtime : -1;
+#else
+    struct stat fileInfo;
+    return (stat(filePath.c_str(), &fileInfo) == 0) ? (long long)fileInfo.st_mtime : -1;
+#endif
+}
+
+#endif
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out watching nothing.  See Start(...).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+FileWatcher::FileWatcher() :
+    _stopping(false),
+    _hasUnsettledChanges(false),
+    _inotifyFd(-1),
+    _wakeFd(-1)
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Stops the watching thread (a std::thread that is still running when it is destroyed ends
+    the program).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+FileWatcher::~FileWatcher()
+{
+    Stop();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts watching the given files on a background thread.
+Parameters:
+    filePaths   The files to watch.  They should exist, but they don't have to.
+Returns:
+    False if the watch couldn't be set up.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool FileWatcher::Start(const std::vector<std::string> &filePaths)
+{
+    Stop();
+    _filePaths = filePaths;
+    _changed.assign(filePaths.size(), false);
+    _hasUnsettledChanges = false;
+    _stopping = false;
+
+#ifdef __linux__
+    _inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    _wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((_inotifyFd < 0) || (_wakeFd < 0))
+    {
+        printf("could not start watching files (errno %i)\n", errno);
+        Stop();
+        return false;
+    }
+
+    // Note: A directory that's already watched gives back the same descriptor, so files in the
+    // same directory share a watch.
+    // Also Note: IN_CLOSE_WRITE is a file that was written in place, and IN_MOVED_TO is one
+    // that was renamed over the old one.
+    _watchDescriptors.clear();
+    for (size_t fileCount = 0; fileCount < _filePaths.size(); fileCount++)
+    {
+        std::string directory;
+        std::string fileName;
+        SplitPath(_filePaths[fileCount], &directory, &fileName);
+        int watchDescriptor = inotify_add_watch(_inotifyFd, directory.c_str(),
+            IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (watchDescriptor < 0)
+        {
+            printf("could not watch '%s' (errno %i)\n", directory.c_str(), errno);
+            Stop();
+            return false;
+        }
+        _watchDescriptors.push_back(watchDescriptor);
+    }
+#else
+    _modifiedTimes.clear();
+    for (size_t fileCount = 0; fileCount < _filePaths.size(); fileCount++)
+    {
+        _modifiedTimes.push_back(ModifiedTime(_filePaths[fileCount]));
+    }
+#endif
+
+    _thread = std::thread(&FileWatcher::WatchLoop, this);
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Stops watching and waits for the background thread to finish.  Safe to call more than
+    once.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void FileWatcher::Stop()
+{
+    _stopping = true;
+#ifdef __linux__
+    if (_wakeFd >= 0)
+    {
+        uint64_t one = 1;
+        ssize_t ignored = write(_wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+#endif
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+
+#ifdef __linux__
+    if (_inotifyFd >= 0)
+    {
+        close(_inotifyFd);
+        _inotifyFd = -1;
+    }
+    if (_wakeFd >= 0)
+    {
+        close(_wakeFd);
+        _wakeFd = -1;
+    }
+#endif
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether any of the files have changed (and then stayed put for SETTLE_MILLISECONDS).  Meant
+    to be called every frame.
+Parameters: None
+Returns:
+    True if TakeChanges() has something to give.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool FileWatcher::HasChanges() const
+{
+    // the usual case, and the reason why this is cheap
+    if (!_hasUnsettledChanges.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_changesLock);
+    std::chrono::steady_clock::duration sinceLastChange =
+        std::chrono::steady_clock::now() - _lastChangeTime;
+    return sinceLastChange >= std::chrono::milliseconds(SETTLE_MILLISECONDS);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Gets which files have changed since the last call and forgets about them.
+Parameters: None
+Returns:
+    The changed files' paths (as they were given to Start(...)).  Empty if nothing has
+    changed, or if the changes haven't settled yet.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+std::vector<std::string> FileWatcher::TakeChanges()
+{
+    std::vector<std::string> changedPaths;
+    if (!HasChanges())
+    {
+        return changedPaths;
+    }
+
+    std::lock_guard<std::mutex> lock(_changesLock);
+    for (size_t fileCount = 0; fileCount < _changed.size(); fileCount++)
+    {
+        if (_changed[fileCount])
+        {
+            changedPaths.push_back(_filePaths[fileCount]);
+            _changed[fileCount] = false;
+        }
+    }
+    _hasUnsettledChanges = false;
+    return changedPaths;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Called on the watching thread to note that a file changed.
+Parameters:
+    fileIndex   Which file (an index into _filePaths).
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void FileWatcher::FileChanged(size_t fileIndex)
+{
+    std::lock_guard<std::mutex> lock(_changesLock);
+    _changed[fileIndex] = true;
+    _lastChangeTime = std::chrono::steady_clock::now();
+    _hasUnsettledChanges = true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    What the background thread runs until Stop().
+
+    On Linux, it sleeps in poll(...) until inotify has events (or Stop() wakes it) and matches
+    each event's directory and name against the watched files.  Elsewhere, it checks the
+    files' modification times 4 times a second.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void FileWatcher::WatchLoop()
+{
+#ifdef __linux__
+    std::vector<std::string> fileNames(_filePaths.size());
+    for (size_t fileCount = 0; fileCount < _filePaths.size(); fileCount++)
+    {
+        std::string directory;
+        SplitPath(_filePaths[fileCount], &directory, &fileNames[fileCount]);
+    }
+
+    // Note: Aligned like the kernel's inotify_event, since the events are read straight into
+    // it.
+    alignas(struct inotify_event) char events[4096];
+    while (!_stopping)
+    {
+        struct pollfd fds[2] = { { _inotifyFd, POLLIN, 0 }, { _wakeFd, POLLIN, 0 } };
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        if ((fds[1].revents & POLLIN) || _stopping)
+        {
+            break;
+        }
+
+        ssize_t numBytes = 0;
+        while ((numBytes = read(_inotifyFd, events, sizeof(events))) > 0)
+        {
+            for (char *next = events; next < events + numBytes;)
+            {
+                const struct inotify_event *event = (const struct inotify_event *)next;
+                next += sizeof(struct inotify_event) + event->len;
+                if (event->len == 0)
+                {
+                    continue;
+                }
+
+                for (size_t fileCount = 0; fileCount < _filePaths.size(); fileCount++)
+                {
+                    if ((event->wd == _watchDescriptors[fileCount]) &&
+                        (strcmp(event->name, fileNames[fileCount].c_str()) == 0))
+                    {
+                        FileChanged(fileCount);
+                    }
+                }
+            }
+        }
+    }
+#else
+    while (!_stopping)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        for (size_t fileCount = 0; fileCount < _filePaths.size(); fileCount++)
+        {
+            long long modifiedTime = ModifiedTime(_filePaths[fileCount]);
+            if ((modifiedTime != -1) && (modifiedTime != _modifiedTimes[fileCount]))
+            {
+                _modifiedTimes[fileCount] = modifiedTime;
+                FileChanged(fileCount);
+            }
+        }
+    }
+#endif
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Watches a handful of files and says when any of them have been saved.
+
+    A background thread does all the watching (inotify on Linux, which sleeps until the kernel
+    says that something in one of the files' directories changed; elsewhere, a check of the
+    files' modification times a few times a second), so HasChanges() is just a load of an
+    atomic flag, and checking every frame costs nothing when nothing has changed.
+
+    Directories are watched rather than the files themselves because most editors save by
+    writing a new file and renaming it over the old one, which a watch on the old file would
+    never see.  For the same reason, changes are only reported once the files have been quiet
+    for SETTLE_MILLISECONDS, so that an editor's several writes turn into one change and a file
+    isn't read while half-written.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    bool Start(const std::vector<std::string> &filePaths);
+    void Stop();
+
+    bool HasChanges() const;
+    std::vector<std::string> TakeChanges();
+
+    static const unsigned int SETTLE_MILLISECONDS = 100;
+
+private:
+    FileWatcher(const FileWatcher &);
+    FileWatcher &operator=(const FileWatcher &);
+
+    void WatchLoop();
+    void FileChanged(size_t fileIndex);
+
+    std::vector<std::string> _filePaths;
+    std::thread _thread;
+    std::atomic<bool> _stopping;
+
+    // shared with the watching thread (under _changesLock, except for the atomic)
+    mutable std::mutex _changesLock;
+    std::vector<bool> _changed;
+    std::chrono::steady_clock::time_point _lastChangeTime;
+    std::atomic<bool> _hasUnsettledChanges;
+
+    // Linux: inotify's file descriptor, the one that wakes the thread up to stop, and which
+    // directory watch each file is under
+    int _inotifyFd;
+    int _wakeFd;
+    std::vector<int> _watchDescriptors;
+
+    // elsewhere: each file's last modification time
+    std::vector<long long> _modifiedTimes;
+};
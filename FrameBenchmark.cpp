@@ -0,0 +1,468 @@
+#include "glload/include/glload/gl_4_4.h"
+
+#include "FrameBenchmark.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Sorts a copy of the frame times and picks out the summary numbers.
+Parameters:
+    frameMs     One time per frame, in milliseconds.
+Returns:
+    A summary with numFrames = 0 (and everything else 0) if there were no frames.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static FrameTimeSummary Summarize(const std::vector<double> &frameMs)
+{
+    FrameTimeSummary summary = {};
+    if (frameMs.empty())
+    {
+        return summary;
+    }
+
+    std::vector<double> sorted(frameMs);
+    std::sort(sorted.begin(), sorted.end());
+    size_t count = sorted.size();
+
+    // nearest rank: the smallest value that at least p percent of the frames are at or below
+    auto percentile = [&sorted, count](double p)
+    {
+        size_t rank = (size_t)((p / 100.0) * count + 0.999999);
+        rank = std::max((size_t)1, std::min(rank, count));
+        return sorted[rank - 1];
+    };
+
+    double total = 0.0;
+    for (size_t frameCount = 0; frameCount < count; frameCount++)
+    {
+        total += sorted[frameCount];
+    }
+
+    summary.numFrames = (unsigned int)count;
+    summary.minMs = sorted.front();
+    summary.meanMs = total / count;
+    summary.p50Ms = percentile(50.0);
+    summary.p95Ms = percentile(95.0);
+    summary.p99Ms = percentile(99.0);
+    summary.maxMs = sorted.back();
+    return summary;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Writes a string as a JSON string literal, escaping the few characters that need it.  The
+    renderer and version strings come from the driver, so there's no telling what's in them.
+Parameters:
+    file    Where to write.
+    text    What to write.  May be null, which writes an empty string.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void WriteJsonString(FILE *file, const char *text)
+{
+    fputc('"', file);
+    for (const char *c = text; (c != 0) && (*c != '\0'); c++)
+    {
+        if ((*c == '"') || (*c == '\\'))
+        {
+            fputc('\\', file);
+            fputc(*c, file);
+        }
+        else if ((unsigned char)*c < 0x20)
+        {
+            fprintf(file, "\\u%04x", (unsigned int)(unsigned char)*c);
+        }
+        else
+        {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Writes a summary as a JSON object (no trailing comma or newline).
+Parameters:
+    file        Where to write.
+    summary     What to write.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void WriteJsonSummary(FILE *file, const FrameTimeSummary &summary)
+{
+    fprintf(file, "{ \"frames\": %u, \"min\": %.6f, \"mean\": %.6f, \"p50\": %.6f, "
+        "\"p95\": %.6f, \"p99\": %.6f, \"max\": %.6f }", summary.numFrames, summary.minMs,
+        summary.meanMs, summary.p50Ms, summary.p95Ms, summary.p99Ms, summary.maxMs);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out idle.  See Start(...).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+FrameBenchmark::FrameBenchmark() :
+    _nextQuery(0),
+    _running(false),
+    _inFrame(false),
+    _numFrames(0),
+    _numWarmupFrames(0),
+    _numFramesBegun(0)
+{
+    for (unsigned int queryCount = 0; queryCount < QUERY_RING_SIZE; queryCount++)
+    {
+        _queryIds[queryCount] = 0;
+        _queryPending[queryCount] = false;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Nothing.  The query objects are deleted in Finish(), while the context is still current.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+FrameBenchmark::~FrameBenchmark()
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Forgets any previous results and gets ready to time frames.
+Parameters:
+    numFrames           How many frames to time.
+    numWarmupFrames     How many frames to skip before that.  The first few frames are often
+                        slower (the driver finishing shader compiles, caches warming up) and
+                        would only make the results noisier.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void FrameBenchmark::Start(unsigned int numFrames, unsigned int numWarmupFrames)
+{
+    Finish();
+
+    glGenQueries(QUERY_RING_SIZE, _queryIds);
+    _nextQuery = 0;
+    _running = (numFrames > 0);
+    _inFrame = false;
+    _numFrames = numFrames;
+    _numWarmupFrames = numWarmupFrames;
+    _numFramesBegun = 0;
+    _cpuMs.clear();
+    _gpuMs.clear();
+    _cpuMs.reserve(numFrames);
+    _gpuMs.reserve(numFrames);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Call at the very start of the frame.  Does nothing if the benchmark isn't running, so it is
+    fine to call every frame.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void FrameBenchmark::BeginFrame()
+{
+    if (!_running || _inFrame)
+    {
+        return;
+    }
+
+    _inFrame = true;
+    _numFramesBegun++;
+    if (_numFramesBegun <= _numWarmupFrames)
+    {
+        // not timed
+        return;
+    }
+
+    _frameStart = std::chrono::high_resolution_clock::now();
+    if (_numFramesBegun == _numWarmupFrames + 1)
+    {
+        _firstTimedFrameStart = _frameStart;
+    }
+
+    // the query in this slot is from QUERY_RING_SIZE frames ago, so by now its result should
+    // be waiting
+    // Note: The clock started first so that if it does have to wait, that counts.
+    CollectQuery(_nextQuery);
+    glBeginQuery(GL_TIME_ELAPSED, _queryIds[_nextQuery]);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Call at the very end of the frame (after the buffer swap, if there is one).  Does nothing
+    if the benchmark isn't running.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void FrameBenchmark::EndFrame()
+{
+    if (!_running || !_inFrame)
+    {
+        return;
+    }
+
+    _inFrame = false;
+    if (_numFramesBegun <= _numWarmupFrames)
+    {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    _queryPending[_nextQuery] = true;
+    _nextQuery = (_nextQuery + 1) % QUERY_RING_SIZE;
+
+    _lastTimedFrameEnd = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = _lastTimedFrameEnd - _frameStart;
+    _cpuMs.push_back(elapsed.count());
+
+    if (_numFramesBegun == _numWarmupFrames + _numFrames)
+    {
+        _running = false;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Gets the results of the queries that are still out (this does wait for the GPU, but the
+    timing is over by now) and deletes the query objects.  Called by Start(...) too, so
+    calling it more than once is harmless.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void FrameBenchmark::Finish()
+{
+    if (_queryIds[0] == 0)
+    {
+        return;
+    }
+
+    if (_inFrame && (_numFramesBegun > _numWarmupFrames))
+    {
+        // stopped in the middle of a frame; that frame doesn't count
+        glEndQuery(GL_TIME_ELAPSED);
+    }
+    _running = false;
+    _inFrame = false;
+
+    // oldest first, so that the GPU times stay in frame order
+    for (unsigned int queryCount = 0; queryCount < QUERY_RING_SIZE; queryCount++)
+    {
+        CollectQuery((_nextQuery + queryCount) % QUERY_RING_SIZE);
+    }
+
+    glDeleteQueries(QUERY_RING_SIZE, _queryIds);
+    for (unsigned int queryCount = 0; queryCount < QUERY_RING_SIZE; queryCount++)
+    {
+        _queryIds[queryCount] = 0;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Records the result of one ring slot's query if there is one waiting.
+Parameters:
+    ringIndex   Which slot.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void FrameBenchmark::CollectQuery(unsigned int ringIndex)
+{
+    if (!_queryPending[ringIndex])
+    {
+        return;
+    }
+
+    // Note: GL_QUERY_RESULT waits if the result isn't in yet.  With a ring this deep that
+    // only happens when the GPU is more than QUERY_RING_SIZE frames behind, and then waiting
+    // is the right thing anyway.
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(_queryIds[ringIndex], GL_QUERY_RESULT, &nanoseconds);
+    _gpuMs.push_back((double)nanoseconds / 1000000.0);
+    _queryPending[ringIndex] = false;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether frames are still being timed.
+Parameters: None
+Returns:
+    True from Start(...) until the last timed frame's EndFrame().
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool FrameBenchmark::IsRunning() const
+{
+    return _running;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether all the requested frames have been timed.
+Parameters: None
+Returns:
+    True once the last timed frame has ended.  Call Finish() to get the last GPU times.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool FrameBenchmark::IsDone() const
+{
+    return !_running && (_numFrames > 0) && (_cpuMs.size() == _numFrames);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The CPU frame times summarized.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+FrameTimeSummary FrameBenchmark::CpuSummary() const
+{
+    return Summarize(_cpuMs);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The GPU frame times summarized.  Only complete after Finish().
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+FrameTimeSummary FrameBenchmark::GpuSummary() const
+{
+    return Summarize(_gpuMs);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Throughput over the whole run, from the start of the first timed frame to the end of the
+    last one.  Unlike 1000 / mean CPU time, this includes whatever happens between frames
+    (glut's main loop, for one).
+Parameters: None
+Returns:
+    Frames per second, or 0 if nothing was timed.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+double FrameBenchmark::FramesPerSecond() const
+{
+    if (_cpuMs.empty())
+    {
+        return 0.0;
+    }
+
+    std::chrono::duration<double> elapsed = _lastTimedFrameEnd - _firstTimedFrameStart;
+    return (elapsed.count() > 0.0) ? _cpuMs.size() / elapsed.count() : 0.0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Prints the CPU and GPU summaries as a little table.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void FrameBenchmark::PrintSummary() const
+{
+    FrameTimeSummary summaries[2] = { CpuSummary(), GpuSummary() };
+    const char *names[2] = { "cpu", "gpu" };
+
+    printf("bench: %u frames (after %u warmup), %.1f frames/s\n", (unsigned int)_cpuMs.size(),
+        _numWarmupFrames, FramesPerSecond());
+    printf("%-6s %10s %10s %10s %10s %10s %10s\n", "ms", "min", "mean", "p50", "p95", "p99",
+        "max");
+    for (int summaryCount = 0; summaryCount < 2; summaryCount++)
+    {
+        const FrameTimeSummary &s = summaries[summaryCount];
+        printf("%-6s %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", names[summaryCount],
+            s.minMs, s.meanMs, s.p50Ms, s.p95Ms, s.p99Ms, s.maxMs);
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Writes the results, the OpenGL driver that they came from, and whatever settings the
+    caller wants recorded as a JSON file, so that runs from different builds (or machines) can
+    be compared by a script.
+Parameters:
+    filePath    Where to write.
+    settings    Name/value pairs, written as strings under "settings".
+Returns:
+    True if the file was written.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool FrameBenchmark::WriteJsonReport(const char *filePath,
+    const std::map<std::string, std::string> &settings) const
+{
+    FILE *file = fopen(filePath, "w");
+    if (file == 0)
+    {
+        printf("could not open '%s' for writing\n", filePath);
+        return false;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"frames\": %u,\n", (unsigned int)_cpuMs.size());
+    fprintf(file, "  \"warmup_frames\": %u,\n", _numWarmupFrames);
+    fprintf(file, "  \"frames_per_second\": %.3f,\n", FramesPerSecond());
+
+    fprintf(file, "  \"gl\": { \"vendor\": ");
+    WriteJsonString(file, (const char *)glGetString(GL_VENDOR));
+    fprintf(file, ", \"renderer\": ");
+    WriteJsonString(file, (const char *)glGetString(GL_RENDERER));
+    fprintf(file, ", \"version\": ");
+    WriteJsonString(file, (const char *)glGetString(GL_VERSION));
+    fprintf(file, " },\n");
+
+    fprintf(file, "  \"settings\": {");
+    bool first = true;
+    for (auto setting = settings.begin(); setting != settings.end(); ++setting)
+    {
+        fprintf(file, first ? " " : ", ");
+        WriteJsonString(file, setting->first.c_str());
+        fprintf(file, ": ");
+        WriteJsonString(file, setting->second.c_str());
+        first = false;
+    }
+    fprintf(file, " },\n");
+
+    fprintf(file, "  \"cpu_ms\": ");
+    WriteJsonSummary(file, CpuSummary());
+    fprintf(file, ",\n  \"gpu_ms\": ");
+    WriteJsonSummary(file, GpuSummary());
+    fprintf(file, "\n}\n");
+
+    if (fclose(file) != 0)
+    {
+        printf("could not write all of '%s'\n", filePath);
+        return false;
+    }
+
+    return true;
+}
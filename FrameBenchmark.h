@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The usual summary of a pile of frame times, in milliseconds.  Percentiles are "nearest
+    rank", so p99 of 100 frames is the 99th slowest one and not an interpolation.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct FrameTimeSummary
+{
+    unsigned int numFrames;
+    double minMs;
+    double meanMs;
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+    double maxMs;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Times a fixed number of frames two ways: the CPU time from BeginFrame() to EndFrame()
+    (high resolution clock), and the GPU time for the same commands (a GL_TIME_ELAPSED query
+    around them).
+
+    Query results aren't asked for until QUERY_RING_SIZE frames later, when the GPU has almost
+    certainly finished with them, so that timing a frame doesn't make the CPU wait for the GPU
+    (which would change the very thing that is being measured).
+
+    Note: Only one GL_TIME_ELAPSED query can be active at a time, so nothing else may use one
+    between BeginFrame() and EndFrame().
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class FrameBenchmark
+{
+public:
+    FrameBenchmark();
+    ~FrameBenchmark();
+
+    // these need the OpenGL context to be current
+    void Start(unsigned int numFrames, unsigned int numWarmupFrames);
+    void BeginFrame();
+    void EndFrame();
+    void Finish();
+
+    bool IsRunning() const;
+    bool IsDone() const;
+    FrameTimeSummary CpuSummary() const;
+    FrameTimeSummary GpuSummary() const;
+    double FramesPerSecond() const;
+
+    void PrintSummary() const;
+    bool WriteJsonReport(const char *filePath,
+        const std::map<std::string, std::string> &settings) const;
+
+    static const unsigned int QUERY_RING_SIZE = 8;
+
+private:
+    FrameBenchmark(const FrameBenchmark &);
+    FrameBenchmark &operator=(const FrameBenchmark &);
+
+    void CollectQuery(unsigned int ringIndex);
+
+    unsigned int _queryIds[QUERY_RING_SIZE];
+    bool _queryPending[QUERY_RING_SIZE];
+    unsigned int _nextQuery;
+
+    bool _running;
+    bool _inFrame;
+    unsigned int _numFrames;
+    unsigned int _numWarmupFrames;
+    unsigned int _numFramesBegun;
+    std::chrono::high_resolution_clock::time_point _frameStart;
+    std::chrono::high_resolution_clock::time_point _firstTimedFrameStart;
+    std::chrono::high_resolution_clock::time_point _lastTimedFrameEnd;
+    std::vector<double> _cpuMs;
+    std::vector<double> _gpuMs;
+};
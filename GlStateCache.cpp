@@ -0,0 +1,630 @@
+#include "glload/include/glload/gl_4_4.h"
+
+#include "GlStateCache.h"
+
+#include <string.h>
+
+// what the shadow holds when it doesn't know (no real object has this ID, and no enum has this
+// value)
+static const unsigned int UNKNOWN = 0xFFFFFFFF;
+
+static const GLenum TEXTURE_TARGETS[] =
+{
+    GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_3D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BUFFER
+};
+
+// Note: GL_ELEMENT_ARRAY_BUFFER is first so that BindVertexArray(...) can find it.
+static const GLenum BUFFER_TARGETS[] =
+{
+    GL_ELEMENT_ARRAY_BUFFER, GL_ARRAY_BUFFER, GL_PIXEL_UNPACK_BUFFER, GL_PIXEL_PACK_BUFFER,
+    GL_UNIFORM_BUFFER, GL_SHADER_STORAGE_BUFFER, GL_DRAW_INDIRECT_BUFFER,
+    GL_DISPATCH_INDIRECT_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER
+};
+
+static const GLenum CAPABILITIES[] =
+{
+    GL_CULL_FACE, GL_DEPTH_TEST, GL_BLEND, GL_STENCIL_TEST, GL_SCISSOR_TEST,
+    GL_PRIMITIVE_RESTART, GL_RASTERIZER_DISCARD, GL_FRAMEBUFFER_SRGB, GL_MULTISAMPLE,
+    GL_POLYGON_OFFSET_FILL
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Finds an OpenGL enum in one of the tables above.
+Parameters:
+    value       The enum.
+    table       The table.
+    tableSize   How many entries are in the table.
+Returns:
+    The enum's index in the table, or -1 if it isn't there.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static int FindEnum(GLenum value, const GLenum *table, int tableSize)
+{
+    for (int index = 0; index < tableSize; index++)
+    {
+        if (table[index] == value)
+        {
+            return index;
+        }
+    }
+    return -1;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out not knowing anything about the context's state (see Invalidate()).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+GlStateCache::GlStateCache() :
+    _countingFrames(false),
+    _frameCalls(0),
+    _frameElided(0)
+{
+    static_assert(sizeof(TEXTURE_TARGETS) / sizeof(TEXTURE_TARGETS[0]) == NUM_TEXTURE_TARGETS,
+        "TEXTURE_TARGETS doesn't match NUM_TEXTURE_TARGETS");
+    static_assert(sizeof(BUFFER_TARGETS) / sizeof(BUFFER_TARGETS[0]) == NUM_BUFFER_TARGETS,
+        "BUFFER_TARGETS doesn't match NUM_BUFFER_TARGETS");
+    static_assert(sizeof(CAPABILITIES) / sizeof(CAPABILITIES[0]) == NUM_CAPABILITIES,
+        "CAPABILITIES doesn't match NUM_CAPABILITIES");
+
+    memset(&_stats, 0, sizeof(_stats));
+    Invalidate();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Rather than passing the cache around to everything that draws, they all share this one.
+    OpenGL state belongs to a context, and this program only ever has one.
+Parameters: None
+Returns:
+    The shared cache.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+GlStateCache &GlStateCache::Shared()
+{
+    static GlStateCache sharedCache;
+    return sharedCache;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Forgets everything, so that the next call of each kind goes through to OpenGL.  Call this
+    after any code that changed shadowed state without going through here.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::Invalidate()
+{
+    _program = UNKNOWN;
+    _vertexArray = UNKNOWN;
+    _activeTexture = UNKNOWN;
+    for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+    {
+        for (int targetIndex = 0; targetIndex < NUM_TEXTURE_TARGETS; targetIndex++)
+        {
+            _textures[unit][targetIndex] = UNKNOWN;
+        }
+    }
+    for (int targetIndex = 0; targetIndex < NUM_BUFFER_TARGETS; targetIndex++)
+    {
+        _buffers[targetIndex] = UNKNOWN;
+    }
+    for (int capabilityIndex = 0; capabilityIndex < NUM_CAPABILITIES; capabilityIndex++)
+    {
+        _enabled[capabilityIndex] = -1;
+    }
+    _cullFace = UNKNOWN;
+    _frontFace = UNKNOWN;
+    _depthMask = -1;
+    _depthFunc = UNKNOWN;
+    _clearColorKnown = false;
+    _clearDepthKnown = false;
+    _viewportKnown = false;
+    _uniforms.clear();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Call at the start of every frame.  Closes out the previous frame's counts.  Calls made
+    before the first frame (setup) aren't counted.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::BeginFrame()
+{
+    if (_countingFrames)
+    {
+        _stats.numFrames++;
+        _stats.numCalls += _frameCalls;
+        _stats.numElided += _frameElided;
+        _stats.lastFrameCalls = _frameCalls;
+        _stats.lastFrameElided = _frameElided;
+    }
+    _countingFrames = true;
+    _frameCalls = 0;
+    _frameElided = 0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The counts for every finished frame so far.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const GlStateCacheStats &GlStateCache::Stats() const
+{
+    return _stats;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    glUseProgram(...), unless it's already in use.
+Parameters:
+    programId   The program.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::UseProgram(unsigned int programId)
+{
+    if (Changes(_program != programId))
+    {
+        glUseProgram(programId);
+        _program = programId;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    glBindVertexArray(...), unless it's already bound.  The new VAO brings its own element
+    buffer, so that shadow is forgotten.
+Parameters:
+    vaoId   The vertex array object.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::BindVertexArray(unsigned int vaoId)
+{
+    if (Changes(_vertexArray != vaoId))
+    {
+        glBindVertexArray(vaoId);
+        _vertexArray = vaoId;
+        _buffers[0] = UNKNOWN;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    glActiveTexture(...), unless that unit is already active.  BindTexture(...) does this
+    itself when it has to, so this is only needed before other per-unit calls.
+Parameters:
+    unit    The texture unit, counting from 0 (not GL_TEXTURE0).
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::ActiveTexture(unsigned int unit)
+{
+    if (Changes(_activeTexture != unit))
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        _activeTexture = unit;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Binds a texture to a texture unit, unless it's already bound there.  Only switches the
+    active texture unit if it has to bind.
+Parameters:
+    unit        The texture unit, counting from 0 (not GL_TEXTURE0).
+    target      ex: GL_TEXTURE_2D
+    textureId   The texture.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::BindTexture(unsigned int unit, unsigned int target, unsigned int textureId)
+{
+    int targetIndex = FindEnum(target, TEXTURE_TARGETS, NUM_TEXTURE_TARGETS);
+    bool shadowed = (targetIndex >= 0) && (unit < MAX_TEXTURE_UNITS);
+    if (Changes(!shadowed || (_textures[unit][targetIndex] != textureId)))
+    {
+        if (_activeTexture != unit)
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            _activeTexture = unit;
+        }
+        glBindTexture(target, textureId);
+        if (shadowed)
+        {
+            _textures[unit][targetIndex] = textureId;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    glBindBuffer(...), unless it's already bound.
+Parameters:
+    target      ex: GL_ARRAY_BUFFER
+    bufferId    The buffer.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::BindBuffer(unsigned int target, unsigned int bufferId)
+{
+    int targetIndex = FindEnum(target, BUFFER_TARGETS, NUM_BUFFER_TARGETS);
+    if (Changes((targetIndex < 0) || (_buffers[targetIndex] != bufferId)))
+    {
+        glBindBuffer(target, bufferId);
+        if (targetIndex >= 0)
+        {
+            _buffers[targetIndex] = bufferId;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    glBindBufferRange(...), or glBindBufferBase(...) for the whole buffer.  Never skipped,
+    since the indexed binding points (shader storage and uniform blocks, mostly) aren't
+    shadowed, but OpenGL also binds the buffer to the target's general binding point, which
+    is, so that has to be kept up.
+Parameters:
+    target      ex: GL_SHADER_STORAGE_BUFFER
+    index       Which of the target's binding points.
+    bufferId    The buffer.
+    offset      Where the range starts.  Has to be a multiple of the target's offset alignment
+                (ex: GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT).
+    size        How many bytes, or 0 for the whole buffer (offset is then ignored).
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::BindBufferRange(unsigned int target, unsigned int index,
+    unsigned int bufferId, size_t offset, size_t size)
+{
+    Changes(true);
+    if (size == 0)
+    {
+        glBindBufferBase(target, index, bufferId);
+    }
+    else
+    {
+        glBindBufferRange(target, index, bufferId, offset, size);
+    }
+
+    int targetIndex = FindEnum(target, BUFFER_TARGETS, NUM_BUFFER_TARGETS);
+    if (targetIndex >= 0)
+    {
+        _buffers[targetIndex] = bufferId;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    glEnable(...) or glDisable(...), unless it's already that way.
+Parameters:
+    capability  ex: GL_DEPTH_TEST
+    enabled     True to enable it, false to disable it.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::SetEnabled(unsigned int capability, bool enabled)
+{
+    int capabilityIndex = FindEnum(capability, CAPABILITIES, NUM_CAPABILITIES);
+    int value = enabled ? 1 : 0;
+    if (Changes((capabilityIndex < 0) || (_enabled[capabilityIndex] != value)))
+    {
+        if (enabled)
+        {
+            glEnable(capability);
+        }
+        else
+        {
+            glDisable(capability);
+        }
+        if (capabilityIndex >= 0)
+        {
+            _enabled[capabilityIndex] = value;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    glCullFace(...), unless it's already set.
+Parameters:
+    mode    ex: GL_BACK
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::CullFace(unsigned int mode)
+{
+    if (Changes(_cullFace != mode))
+    {
+        glCullFace(mode);
+        _cullFace = mode;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    glFrontFace(...), unless it's already set.
+Parameters:
+    mode    ex: GL_CCW
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::FrontFace(unsigned int mode)
+{
+    if (Changes(_frontFace != mode))
+    {
+        glFrontFace(mode);
+        _frontFace = mode;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    glDepthMask(...), unless it's already set.
+Parameters:
+    writeDepth  True to write to the depth buffer.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::DepthMask(bool writeDepth)
+{
+    int value = writeDepth ? 1 : 0;
+    if (Changes(_depthMask != value))
+    {
+        glDepthMask(writeDepth ? GL_TRUE : GL_FALSE);
+        _depthMask = value;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    glDepthFunc(...), unless it's already set.
+Parameters:
+    func    ex: GL_LEQUAL
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::DepthFunc(unsigned int func)
+{
+    if (Changes(_depthFunc != func))
+    {
+        glDepthFunc(func);
+        _depthFunc = func;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    glClearColor(...), unless it's already set.
+Parameters:
+    red     0 - 1
+    green   0 - 1
+    blue    0 - 1
+    alpha   0 - 1
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::ClearColor(float red, float green, float blue, float alpha)
+{
+    float color[4] = { red, green, blue, alpha };
+    if (Changes(!_clearColorKnown || (memcmp(_clearColor, color, sizeof(color)) != 0)))
+    {
+        glClearColor(red, green, blue, alpha);
+        memcpy(_clearColor, color, sizeof(color));
+        _clearColorKnown = true;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    glClearDepth(...), unless it's already set.
+Parameters:
+    depth   0 - 1
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::ClearDepth(double depth)
+{
+    if (Changes(!_clearDepthKnown || (_clearDepth != depth)))
+    {
+        glClearDepth(depth);
+        _clearDepth = depth;
+        _clearDepthKnown = true;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    glViewport(...), unless it's already set.
+Parameters:
+    x       Left edge, in pixels.
+    y       Bottom edge, in pixels.
+    width   In pixels.
+    height  In pixels.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::Viewport(int x, int y, int width, int height)
+{
+    int viewport[4] = { x, y, width, height };
+    if (Changes(!_viewportKnown || (memcmp(_viewport, viewport, sizeof(viewport)) != 0)))
+    {
+        glViewport(x, y, width, height);
+        memcpy(_viewport, viewport, sizeof(viewport));
+        _viewportKnown = true;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    glUniform1i(...) on the current program, unless that uniform already has that value.
+    Uniform values belong to the program, so they are remembered per program.
+Parameters:
+    location    From glGetUniformLocation(...).
+    value       ex: a texture unit for a sampler
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::Uniform1i(int location, int value)
+{
+    if ((_program == UNKNOWN) || (location < 0))
+    {
+        // can't know whose uniform this is (or it's the "not found" location, which OpenGL
+        // ignores), so just pass it on
+        Changes(true);
+        glUniform1i(location, value);
+        return;
+    }
+
+    unsigned long long key = ((unsigned long long)_program << 32) | (unsigned int)location;
+    std::unordered_map<unsigned long long, int>::iterator shadow = _uniforms.find(key);
+    if (Changes((shadow == _uniforms.end()) || (shadow->second != value)))
+    {
+        glUniform1i(location, value);
+        _uniforms[key] = value;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Call after deleting a program.  Its uniform values are forgotten (a new program may get
+    the same ID), and if it was in use, so is the current program.
+Parameters:
+    programId   The deleted program.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::ForgetProgram(unsigned int programId)
+{
+    if (_program == programId)
+    {
+        _program = UNKNOWN;
+    }
+
+    for (std::unordered_map<unsigned long long, int>::iterator uniform = _uniforms.begin();
+        uniform != _uniforms.end();)
+    {
+        if ((unsigned int)(uniform->first >> 32) == programId)
+        {
+            uniform = _uniforms.erase(uniform);
+        }
+        else
+        {
+            ++uniform;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Call after deleting a texture.  OpenGL unbinds it from every unit that it was bound to.
+Parameters:
+    textureId   The deleted texture.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::ForgetTexture(unsigned int textureId)
+{
+    for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+    {
+        for (int targetIndex = 0; targetIndex < NUM_TEXTURE_TARGETS; targetIndex++)
+        {
+            if (_textures[unit][targetIndex] == textureId)
+            {
+                _textures[unit][targetIndex] = 0;
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Call after deleting a buffer.  OpenGL unbinds it from every target that it was bound to.
+Parameters:
+    bufferId    The deleted buffer.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::ForgetBuffer(unsigned int bufferId)
+{
+    for (int targetIndex = 0; targetIndex < NUM_BUFFER_TARGETS; targetIndex++)
+    {
+        if (_buffers[targetIndex] == bufferId)
+        {
+            _buffers[targetIndex] = 0;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Call after deleting a VAO.  If it was bound, OpenGL binds 0 in its place.
+Parameters:
+    vaoId   The deleted vertex array object.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GlStateCache::ForgetVertexArray(unsigned int vaoId)
+{
+    if (_vertexArray == vaoId)
+    {
+        _vertexArray = 0;
+        _buffers[0] = UNKNOWN;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Counts a call, and counts it as elided if it wouldn't change anything.
+Parameters:
+    changed     Whether the call would change the state.
+Returns:
+    "changed", so that it can wrap the condition.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool GlStateCache::Changes(bool changed)
+{
+    _frameCalls++;
+    if (!changed)
+    {
+        _frameElided++;
+    }
+    return changed;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stddef.h>
+#include <unordered_map>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How many calls went through a GlStateCache and how many of them it didn't pass on to
+    OpenGL because they wouldn't have changed anything.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct GlStateCacheStats
+{
+    unsigned long long numFrames;
+    unsigned long long numCalls;
+    unsigned long long numElided;
+    unsigned int lastFrameCalls;
+    unsigned int lastFrameElided;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Keeps a copy ("shadow") of the OpenGL state that gets set over and over (the current program,
+    VAO, texture bindings per unit, buffer bindings, enable flags, and a few others) and skips
+    any call that would set something to what it already is.  Every OpenGL call costs CPU time
+    in the driver whether it changes anything or not, and it adds up with lots of draws.
+
+    Note: The shadow is only right if everything that changes this state goes through here.
+    Code that calls OpenGL directly (one-time setup, mostly) should be followed by
+    Invalidate(), which makes the next call of each kind go through no matter what.  Deleting a
+    program, texture, buffer, or VAO should be followed by the matching Forget...(...), since
+    OpenGL unbinds deleted objects on its own (and may hand the same ID out again).
+
+    Also Note: GL_ELEMENT_ARRAY_BUFFER is part of the VAO, so its shadow is thrown out whenever
+    the VAO changes.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class GlStateCache
+{
+public:
+    GlStateCache();
+
+    // the one that the rest of the program shares (there's only one context)
+    static GlStateCache &Shared();
+
+    void Invalidate();
+    void BeginFrame();
+    const GlStateCacheStats &Stats() const;
+
+    void UseProgram(unsigned int programId);
+    void BindVertexArray(unsigned int vaoId);
+    void ActiveTexture(unsigned int unit);
+    void BindTexture(unsigned int unit, unsigned int target, unsigned int textureId);
+    void BindBuffer(unsigned int target, unsigned int bufferId);
+    void BindBufferRange(unsigned int target, unsigned int index, unsigned int bufferId,
+        size_t offset, size_t size);
+    void SetEnabled(unsigned int capability, bool enabled);
+    void CullFace(unsigned int mode);
+    void FrontFace(unsigned int mode);
+    void DepthMask(bool writeDepth);
+    void DepthFunc(unsigned int func);
+    void ClearColor(float red, float green, float blue, float alpha);
+    void ClearDepth(double depth);
+    void Viewport(int x, int y, int width, int height);
+
+    // sets a uniform of the current program (sampler units, mostly)
+    void Uniform1i(int location, int value);
+
+    void ForgetProgram(unsigned int programId);
+    void ForgetTexture(unsigned int textureId);
+    void ForgetBuffer(unsigned int bufferId);
+    void ForgetVertexArray(unsigned int vaoId);
+
+    static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+private:
+    GlStateCache(const GlStateCache &);
+    GlStateCache &operator=(const GlStateCache &);
+
+    bool Changes(bool changed);
+
+    // the kinds of texture and buffer bindings, and the capabilities, that are shadowed;
+    // anything else is passed straight through
+    enum
+    {
+        NUM_TEXTURE_TARGETS = 5,
+        NUM_BUFFER_TARGETS = 10,
+        NUM_CAPABILITIES = 10,
+    };
+
+    unsigned int _program;
+    unsigned int _vertexArray;
+    unsigned int _activeTexture;
+    unsigned int _textures[MAX_TEXTURE_UNITS][NUM_TEXTURE_TARGETS];
+    unsigned int _buffers[NUM_BUFFER_TARGETS];
+    int _enabled[NUM_CAPABILITIES];
+    unsigned int _cullFace;
+    unsigned int _frontFace;
+    int _depthMask;
+    unsigned int _depthFunc;
+    bool _clearColorKnown;
+    float _clearColor[4];
+    bool _clearDepthKnown;
+    double _clearDepth;
+    bool _viewportKnown;
+    int _viewport[4];
+
+    // (program << 32) | location -> value
+    std::unordered_map<unsigned long long, int> _uniforms;
+
+    // calls are only counted once frames start (see BeginFrame())
+    GlStateCacheStats _stats;
+    bool _countingFrames;
+    unsigned int _frameCalls;
+    unsigned int _frameElided;
+};
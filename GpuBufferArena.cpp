@@ -0,0 +1,404 @@
+#include "glload/include/glload/gl_4_4.h"
+
+#include "GpuBufferArena.h"
+#include "GlStateCache.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out with nothing.  See Init(...).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+GpuBufferArena::GpuBufferArena() :
+    _bufferId(0),
+    _elementSize(0),
+    _generation(0),
+    _numAllocations(0),
+    _numRepacks(0),
+    _bytesMoved(0)
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Nothing.  Call Shutdown() while the context is still around to clean up.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+GpuBufferArena::~GpuBufferArena()
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes the buffer, with nothing in it yet.
+Parameters:
+    elementSize     Bytes per element, ex: sizeof(MeshVertex) or sizeof(GLuint).
+    capacity        How many elements to start with.  It grows as needed, but each time it
+                    does, everything is copied.
+Returns:
+    False if the buffer couldn't be made.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool GpuBufferArena::Init(unsigned int elementSize, unsigned int capacity)
+{
+    Shutdown();
+    if ((elementSize == 0) || (capacity == 0))
+    {
+        return false;
+    }
+
+    glGenBuffers(1, &_bufferId);
+    if (_bufferId == 0)
+    {
+        printf("could not make a buffer arena\n");
+        return false;
+    }
+
+    // Note: Bound to GL_COPY_WRITE_BUFFER to fill it in, since nothing draws from there and
+    // the buffer could end up holding either vertices or indices.
+    // Also Note: Each range is only written once, but new ranges are written whenever a mesh
+    // comes along, so the buffer as a whole is GL_DYNAMIC_DRAW (and drivers complain about
+    // glBufferSubData(...) on a GL_STATIC_DRAW buffer).
+    GlStateCache::Shared().BindBuffer(GL_COPY_WRITE_BUFFER, _bufferId);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)capacity * elementSize, 0, GL_DYNAMIC_DRAW);
+    _elementSize = elementSize;
+    _allocator.Reset(capacity);
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Deletes the buffer and forgets every allocation.  Safe to call more than once.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GpuBufferArena::Shutdown()
+{
+    if (_bufferId != 0)
+    {
+        glDeleteBuffers(1, &_bufferId);
+        GlStateCache::Shared().ForgetBuffer(_bufferId);
+        _bufferId = 0;
+    }
+
+    _allocator.Reset(0);
+    _allocations.clear();
+    _freeHandles.clear();
+    _elementSize = 0;
+    _numAllocations = 0;
+    _generation++;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Sets aside a range of elements.  If there isn't a big enough free range, the arena
+    repacks, and grows if it has to.
+Parameters:
+    numElements     How many.  Not 0.
+Returns:
+    The range's handle, or NO_HANDLE if there is no arena or the buffer couldn't grow.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int GpuBufferArena::Allocate(unsigned int numElements)
+{
+    if (!IsReady() || (numElements == 0))
+    {
+        return NO_HANDLE;
+    }
+
+    unsigned int offset = 0;
+    unsigned int node = _allocator.Allocate(numElements, &offset);
+    if (node == OffsetAllocator::NO_NODE)
+    {
+        // repacking puts all of the free space at the end, so that's enough if there is
+        // enough free space in total, and otherwise it has to grow too
+        unsigned int capacity = _allocator.Size();
+        unsigned int used = capacity - _allocator.FreeSize();
+        unsigned long long needed = (unsigned long long)used + numElements;
+        unsigned long long newCapacity = capacity;
+        if (needed > capacity)
+        {
+            newCapacity = std::max((unsigned long long)capacity * 2, needed);
+            newCapacity = std::min(newCapacity, 0xFFFFFFFFull / _elementSize);
+        }
+        if ((needed > newCapacity) || !Repack((unsigned int)newCapacity))
+        {
+            printf("could not fit %u more elements in a buffer arena of %u\n", numElements,
+                capacity);
+            return NO_HANDLE;
+        }
+        node = _allocator.Allocate(numElements, &offset);
+        if (node == OffsetAllocator::NO_NODE)
+        {
+            return NO_HANDLE;
+        }
+    }
+
+    Allocation allocation = { offset, numElements, node };
+    unsigned int handle = NO_HANDLE;
+    if (!_freeHandles.empty())
+    {
+        handle = _freeHandles.back();
+        _freeHandles.pop_back();
+        _allocations[handle - 1] = allocation;
+    }
+    else
+    {
+        _allocations.push_back(allocation);
+        handle = (unsigned int)_allocations.size();
+    }
+    _numAllocations++;
+    return handle;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Gives a range back.  The handle may be handed out again by a later Allocate(...).
+Parameters:
+    handle  From Allocate(...).  NO_HANDLE and handles that were already freed are ignored.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GpuBufferArena::Free(unsigned int handle)
+{
+    if ((handle == NO_HANDLE) || (handle > _allocations.size()) ||
+        (_allocations[handle - 1].node == OffsetAllocator::NO_NODE))
+    {
+        return;
+    }
+
+    Allocation &allocation = _allocations[handle - 1];
+    _allocator.Free(allocation.node);
+    allocation.node = OffsetAllocator::NO_NODE;
+    allocation.count = 0;
+    _freeHandles.push_back(handle);
+    _numAllocations--;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Copies a range's elements into the buffer.
+Parameters:
+    handle  From Allocate(...).
+    data    Count(handle) elements.
+Returns:
+    False if there's no such range.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool GpuBufferArena::Upload(unsigned int handle, const void *data)
+{
+    if ((handle == NO_HANDLE) || (handle > _allocations.size()) ||
+        (_allocations[handle - 1].node == OffsetAllocator::NO_NODE))
+    {
+        return false;
+    }
+
+    const Allocation &allocation = _allocations[handle - 1];
+    GlStateCache::Shared().BindBuffer(GL_COPY_WRITE_BUFFER, _bufferId);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)allocation.offset * _elementSize,
+        (GLsizeiptr)allocation.count * _elementSize, data);
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Packs every live range together at the front of the buffer, so that all the free space is
+    one range at the end.  Allocate(...) does this on its own when it has to, but doing it at a
+    convenient time (like a level load) keeps it from happening in the middle of a frame.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GpuBufferArena::Defragment()
+{
+    if (IsReady())
+    {
+        Repack(_allocator.Size());
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether Allocate(...) will work.
+Parameters: None
+Returns:
+    True once Init(...) has been done.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool GpuBufferArena::IsReady() const
+{
+    return _bufferId != 0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The buffer.  This changes whenever Generation() does.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int GpuBufferArena::BufferId() const
+{
+    return _bufferId;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    Bytes per element.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int GpuBufferArena::ElementSize() const
+{
+    return _elementSize;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Where a range is in the buffer.  This changes whenever Generation() does.
+Parameters:
+    handle  From Allocate(...).
+Returns:
+    The offset, in elements (multiply by ElementSize() for bytes), or 0 if there's no such
+    range.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int GpuBufferArena::Offset(unsigned int handle) const
+{
+    return ((handle != NO_HANDLE) && (handle <= _allocations.size())) ?
+        _allocations[handle - 1].offset : 0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How big a range is.
+Parameters:
+    handle  From Allocate(...).
+Returns:
+    The number of elements, or 0 if there's no such range.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int GpuBufferArena::Count(unsigned int handle) const
+{
+    return ((handle != NO_HANDLE) && (handle <= _allocations.size())) ?
+        _allocations[handle - 1].count : 0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A number that changes whenever the buffer or the ranges' offsets do (see Repack(...)).
+Parameters: None
+Returns:
+    The number.  Only compare it with an earlier one.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int GpuBufferArena::Generation() const
+{
+    return _generation;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Gathers up how full the arena is.
+Parameters: None
+Returns:
+    A copy of the stats.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+GpuBufferArenaStats GpuBufferArena::Stats() const
+{
+    GpuBufferArenaStats stats;
+    stats.capacity = _allocator.Size();
+    stats.used = _allocator.Size() - _allocator.FreeSize();
+    stats.largestFreeRange = _allocator.LargestFreeRange();
+    stats.numAllocations = _numAllocations;
+    stats.numRepacks = _numRepacks;
+    stats.bytesMoved = _bytesMoved;
+    return stats;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes a new buffer, copies every live range into it back to back from the front (in the
+    order that they were in), and swaps it in for the old one.  The copies are GPU to GPU.
+Parameters:
+    newCapacity     The new buffer's size, in elements.  At least what is in use.
+Returns:
+    False if the new buffer couldn't be made, in which case nothing has changed.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool GpuBufferArena::Repack(unsigned int newCapacity)
+{
+    GLuint newBufferId = 0;
+    glGenBuffers(1, &newBufferId);
+    if (newBufferId == 0)
+    {
+        return false;
+    }
+
+    GlStateCache &stateCache = GlStateCache::Shared();
+    stateCache.BindBuffer(GL_COPY_WRITE_BUFFER, newBufferId);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)newCapacity * _elementSize, 0,
+        GL_DYNAMIC_DRAW);
+    stateCache.BindBuffer(GL_COPY_READ_BUFFER, _bufferId);
+
+    std::vector<Allocation *> live;
+    live.reserve(_numAllocations);
+    for (size_t allocationCount = 0; allocationCount < _allocations.size(); allocationCount++)
+    {
+        if (_allocations[allocationCount].node != OffsetAllocator::NO_NODE)
+        {
+            live.push_back(&_allocations[allocationCount]);
+        }
+    }
+    std::sort(live.begin(), live.end(), [](const Allocation *a, const Allocation *b) {
+        return a->offset < b->offset;
+    });
+
+    // a fresh allocator with one free range hands them out from the front, in order
+    _allocator.Reset(newCapacity);
+    for (size_t liveCount = 0; liveCount < live.size(); liveCount++)
+    {
+        Allocation &allocation = *live[liveCount];
+        unsigned int newOffset = 0;
+        allocation.node = _allocator.Allocate(allocation.count, &newOffset);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            (GLintptr)allocation.offset * _elementSize, (GLintptr)newOffset * _elementSize,
+            (GLsizeiptr)allocation.count * _elementSize);
+        _bytesMoved += (unsigned long long)allocation.count * _elementSize;
+        allocation.offset = newOffset;
+    }
+
+    glDeleteBuffers(1, &_bufferId);
+    stateCache.ForgetBuffer(_bufferId);
+    _bufferId = newBufferId;
+    _generation++;
+    _numRepacks++;
+    return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "OffsetAllocator.h"
+
+#include <vector>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How full a GpuBufferArena is and how much work it has done to stay that way.  Sizes are in
+    elements.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct GpuBufferArenaStats
+{
+    unsigned int capacity;
+    unsigned int used;
+    unsigned int largestFreeRange;  // the biggest Allocate(...) that fits without repacking
+    unsigned int numAllocations;
+    unsigned int numRepacks;        // Defragment() and growing
+    unsigned long long bytesMoved;  // by repacking
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    One big OpenGL buffer that lots of meshes' vertices (or indices) live in, instead of a
+    buffer object each.
+
+    The buffer is split into fixed-size elements (a vertex or an index), and an
+    OffsetAllocator hands out ranges of them.  A mesh's range is known by a handle, and
+    Offset(...) says where it is, in elements, which is exactly a draw's base vertex (for a
+    vertex arena) or first index (for an index arena).  Because all the meshes are in the same
+    buffer, one VAO works for all of them, and drawing a different mesh is only a different
+    base vertex and first index, not a different VAO or buffer binding.
+
+    Free(...) gives a range back.  When the free space gets too scattered for an Allocate(...)
+    to fit, or there just isn't enough of it, the arena repacks: it makes a new buffer (twice
+    as big, if it has to grow), copies every live range into it, back to back from the front,
+    with glCopyBufferSubData(...) (so the data never comes back to the CPU), and deletes the
+    old one.  Defragment() does the same without growing.
+
+    Note: Repacking changes the buffer's ID and the ranges' offsets, but not their handles.
+    Anything that remembers an offset or binds the buffer to a VAO should check Generation(),
+    which changes every time that happens, or look them up at draw time.
+
+    Also Note: Repacking briefly needs both the old and the new buffer.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class GpuBufferArena
+{
+public:
+    GpuBufferArena();
+    ~GpuBufferArena();
+
+    // these need the OpenGL context to be current
+    bool Init(unsigned int elementSize, unsigned int capacity);
+    void Shutdown();
+
+    unsigned int Allocate(unsigned int numElements);
+    void Free(unsigned int handle);
+    bool Upload(unsigned int handle, const void *data);
+    void Defragment();
+
+    bool IsReady() const;
+    unsigned int BufferId() const;
+    unsigned int ElementSize() const;
+    unsigned int Offset(unsigned int handle) const;
+    unsigned int Count(unsigned int handle) const;
+    unsigned int Generation() const;
+    GpuBufferArenaStats Stats() const;
+
+    static const unsigned int NO_HANDLE = 0;
+
+private:
+    GpuBufferArena(const GpuBufferArena &);
+    GpuBufferArena &operator=(const GpuBufferArena &);
+
+    struct Allocation
+    {
+        unsigned int offset;
+        unsigned int count;
+        unsigned int node;      // OffsetAllocator::NO_NODE if the handle isn't in use
+    };
+
+    bool Repack(unsigned int newCapacity);
+
+    unsigned int _bufferId;
+    unsigned int _elementSize;
+    OffsetAllocator _allocator;
+
+    // handle - 1 is the index
+    std::vector<Allocation> _allocations;
+    std::vector<unsigned int> _freeHandles;
+
+    unsigned int _generation;
+    unsigned int _numAllocations;
+    unsigned int _numRepacks;
+    unsigned long long _bytesMoved;
+};
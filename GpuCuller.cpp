@@ -0,0 +1,381 @@
+#include "glload/include/glload/gl_4_4.h"
+#include "glload/include/glload/gl_load.hpp"
+
+#include "GpuCuller.h"
+#include "GlStateCache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// cull.comp's uniforms
+static const unsigned int NUM_DRAWS_NAME_ID = InternName("numDraws");
+static const unsigned int GROUP_STARTS_NAME_ID = InternName("groupStarts");
+static const unsigned int NUM_VIEW_PLANES_NAME_ID = InternName("numViewPlanes");
+static const unsigned int VIEW_PLANES_NAME_ID = InternName("viewPlanes");
+
+// cull.comp's shader storage bindings
+static const GLuint MESHES_BINDING = 0;
+static const GLuint INPUTS_BINDING = 1;
+static const GLuint COMMANDS_BINDING = 2;
+static const GLuint INSTANCES_BINDING = 3;
+static const GLuint COUNT_BINDING = 4;
+
+// cull.comp's local_size_x
+static const unsigned int DRAWS_PER_WORK_GROUP = 64;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out with nothing, and with the view being all of normalized device coordinates
+    (-1 - 1 on each axis).  See Init().
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+GpuCuller::GpuCuller() :
+    _programId(0),
+    _numViewPlanes(0),
+    _commandBufferId(0),
+    _instanceBufferId(0),
+    _countBufferId(0),
+    _capacity(0),
+    _inputAlignment(0),
+    _hasDrawCount(false)
+{
+    float ndcPlanes[] =
+    {
+        +1.0f, 0.0f, 0.0f, 1.0f,    // x >= -1
+        -1.0f, 0.0f, 0.0f, 1.0f,    // x <= +1
+        0.0f, +1.0f, 0.0f, 1.0f,    // y >= -1
+        0.0f, -1.0f, 0.0f, 1.0f,    // y <= +1
+        0.0f, 0.0f, +1.0f, 1.0f,    // z >= -1
+        0.0f, 0.0f, -1.0f, 1.0f,    // z <= +1
+    };
+    SetViewPlanes(ndcPlanes, 6);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Nothing.  Call Shutdown() while the context is still around to clean up.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+GpuCuller::~GpuCuller()
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes the output buffers (empty until the first Cull(...)) and the counter, and checks
+    what the driver can do.  The program comes separately from SetProgram(...), since it is
+    built asynchronously.
+Parameters: None
+Returns:
+    False if the buffers couldn't be made.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool GpuCuller::Init()
+{
+    // Note: Compute shaders and shader storage buffers are OpenGL 4.3, and init(...) won't
+    // make a context older than 4.4, so only the draw count needs checking.
+    _hasDrawCount = (glext_ARB_indirect_parameters != 0);
+    GLint alignment = 0;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    _inputAlignment = (alignment > 0) ? (size_t)alignment : 256;
+
+    glGenBuffers(1, &_commandBufferId);
+    glGenBuffers(1, &_instanceBufferId);
+    glGenBuffers(1, &_countBufferId);
+    if ((_commandBufferId == 0) || (_instanceBufferId == 0) || (_countBufferId == 0))
+    {
+        printf("could not make the GPU culler's buffers\n");
+        Shutdown();
+        return false;
+    }
+
+    // Note: Buffers are bound to GL_COPY_WRITE_BUFFER to fill them in, since nothing draws
+    // from that binding.
+    GlStateCache &stateCache = GlStateCache::Shared();
+    stateCache.BindBuffer(GL_COPY_WRITE_BUFFER, _countBufferId);
+    glBufferData(GL_COPY_WRITE_BUFFER, MAX_GROUPS * sizeof(GLuint), 0, GL_DYNAMIC_COPY);
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Deletes everything, including the program.  Safe to call more than once.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GpuCuller::Shutdown()
+{
+    GlStateCache &stateCache = GlStateCache::Shared();
+    SetProgram(0);
+
+    GLuint bufferIds[] = { _commandBufferId, _instanceBufferId, _countBufferId };
+    for (int bufferCount = 0; bufferCount < 3; bufferCount++)
+    {
+        if (bufferIds[bufferCount] != 0)
+        {
+            glDeleteBuffers(1, &bufferIds[bufferCount]);
+            stateCache.ForgetBuffer(bufferIds[bufferCount]);
+        }
+    }
+    _commandBufferId = 0;
+    _instanceBufferId = 0;
+    _countBufferId = 0;
+    _capacity = 0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Gives the culler a program built from cull.comp.  The culler owns it from here on, and
+    deletes the previous one (if any).
+Parameters:
+    programId   The linked program, or 0 for none.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GpuCuller::SetProgram(unsigned int programId)
+{
+    if (_programId != 0)
+    {
+        glDeleteProgram(_programId);
+        GlStateCache::Shared().ForgetProgram(_programId);
+    }
+
+    _programId = programId;
+    _reflection.Clear();
+    if (programId != 0)
+    {
+        _reflection.Reflect(programId);
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Sets what is "in view" for the next Cull(...).  For a camera, these would be the frustum's
+    planes, in whatever space the instance positions are in.
+Parameters:
+    planes      numPlanes * 4 floats.  See MAX_VIEW_PLANES for what each plane means.
+    numPlanes   0 - MAX_VIEW_PLANES.  More are ignored.  0 keeps everything.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GpuCuller::SetViewPlanes(const float *planes, unsigned int numPlanes)
+{
+    _numViewPlanes = (numPlanes < MAX_VIEW_PLANES) ? numPlanes : MAX_VIEW_PLANES;
+    memset(_viewPlanes, 0, sizeof(_viewPlanes));
+    memcpy(_viewPlanes, planes, _numViewPlanes * 4 * sizeof(float));
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether Cull(...) will do anything.
+Parameters: None
+Returns:
+    True once both Init() and SetProgram(...) have been done.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool GpuCuller::IsReady() const
+{
+    return (_programId != 0) && (_countBufferId != 0);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    True if the draw can take its count from CountBufferId() (ARB_indirect_parameters), false
+    if it has to draw every slot.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool GpuCuller::HasDrawCount() const
+{
+    return _hasDrawCount;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    What the input buffer offset given to Cull(...) has to be a multiple of (the driver's
+    GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+size_t GpuCuller::InputAlignment() const
+{
+    return _inputAlignment;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Runs the culling shader over the draws.  When it returns, the GPU has been told to do the
+    culling, and anything drawn after this with the output buffers will wait for it.
+
+    Note: The counter (and, without a draw count, the commands) are zeroed by the GPU with
+    glClearBufferData(...), so this never waits on earlier frames to finish.
+Parameters:
+    meshInfoBufferId    One CullMeshInfo per mesh (see MultiDrawRenderer::UpdateMeshes()).
+    inputBufferId       Has a CullDrawInput per draw (the sum of numDrawsPerGroup)...
+    inputOffset         ...starting here, which has to be a multiple of InputAlignment().
+    numDrawsPerGroup    How many of the draws are of meshes in each group.  Group N's
+                        surviving draws start at the output slot that is the sum of the
+                        groups before it.
+    numGroups           1 - MAX_GROUPS.
+Returns:
+    False if the culler isn't ready or there's nothing to cull.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool GpuCuller::Cull(unsigned int meshInfoBufferId, unsigned int inputBufferId,
+    size_t inputOffset, const unsigned int *numDrawsPerGroup, unsigned int numGroups)
+{
+    GLint groupStarts[MAX_GROUPS] = {};
+    unsigned int numDraws = 0;
+    numGroups = (numGroups < MAX_GROUPS) ? numGroups : MAX_GROUPS;
+    for (unsigned int groupCount = 0; groupCount < numGroups; groupCount++)
+    {
+        groupStarts[groupCount] = (GLint)numDraws;
+        numDraws += numDrawsPerGroup[groupCount];
+    }
+    if (!IsReady() || (numDraws == 0))
+    {
+        return false;
+    }
+
+    GlStateCache &stateCache = GlStateCache::Shared();
+    if (numDraws > _capacity)
+    {
+        // grow by half again so that a slowly growing count doesn't reallocate every frame
+        _capacity = numDraws + (numDraws / 2);
+        stateCache.BindBuffer(GL_COPY_WRITE_BUFFER, _commandBufferId);
+        glBufferData(GL_COPY_WRITE_BUFFER, _capacity * sizeof(DrawElementsIndirectCommand), 0,
+            GL_DYNAMIC_COPY);
+        stateCache.BindBuffer(GL_COPY_WRITE_BUFFER, _instanceBufferId);
+        glBufferData(GL_COPY_WRITE_BUFFER, _capacity * sizeof(MeshInstance), 0,
+            GL_DYNAMIC_COPY);
+    }
+
+    // null data clears to 0
+    stateCache.BindBuffer(GL_COPY_WRITE_BUFFER, _countBufferId);
+    glClearBufferData(GL_COPY_WRITE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, 0);
+    if (!_hasDrawCount)
+    {
+        // the slots that nothing is written to become draws of 0 instances
+        stateCache.BindBuffer(GL_COPY_WRITE_BUFFER, _commandBufferId);
+        glClearBufferSubData(GL_COPY_WRITE_BUFFER, GL_R32UI, 0,
+            numDraws * sizeof(DrawElementsIndirectCommand), GL_RED_INTEGER, GL_UNSIGNED_INT, 0);
+    }
+
+    stateCache.UseProgram(_programId);
+    stateCache.Uniform1i(_reflection.UniformLocation(NUM_DRAWS_NAME_ID), (int)numDraws);
+    glUniform1iv(_reflection.UniformLocation(GROUP_STARTS_NAME_ID), MAX_GROUPS, groupStarts);
+    stateCache.Uniform1i(_reflection.UniformLocation(NUM_VIEW_PLANES_NAME_ID),
+        (int)_numViewPlanes);
+    if (_numViewPlanes > 0)
+    {
+        glUniform4fv(_reflection.UniformLocation(VIEW_PLANES_NAME_ID), _numViewPlanes,
+            _viewPlanes);
+    }
+
+    stateCache.BindBufferRange(GL_SHADER_STORAGE_BUFFER, MESHES_BINDING, meshInfoBufferId, 0,
+        0);
+    stateCache.BindBufferRange(GL_SHADER_STORAGE_BUFFER, INPUTS_BINDING, inputBufferId,
+        inputOffset, numDraws * sizeof(CullDrawInput));
+    stateCache.BindBufferRange(GL_SHADER_STORAGE_BUFFER, COMMANDS_BINDING, _commandBufferId, 0,
+        0);
+    stateCache.BindBufferRange(GL_SHADER_STORAGE_BUFFER, INSTANCES_BINDING, _instanceBufferId,
+        0, 0);
+    stateCache.BindBufferRange(GL_SHADER_STORAGE_BUFFER, COUNT_BINDING, _countBufferId, 0, 0);
+    glDispatchCompute((numDraws + DRAWS_PER_WORK_GROUP - 1) / DRAWS_PER_WORK_GROUP, 1, 1);
+
+    // the shader's writes have to land before they're read as draw commands, the draw count,
+    // and instance attributes
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The compacted DrawElementsIndirectCommands, for GL_DRAW_INDIRECT_BUFFER.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int GpuCuller::CommandBufferId() const
+{
+    return _commandBufferId;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The compacted MeshInstances, for the per-instance vertex attributes.  Each command's base
+    instance is its own slot, so command N uses instance N.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int GpuCuller::InstanceBufferId() const
+{
+    return _instanceBufferId;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    How many draws are in view, a uint per group (the first at offset 0), for
+    GL_PARAMETER_BUFFER_ARB.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int GpuCuller::CountBufferId() const
+{
+    return _countBufferId;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Reads back how many draws the last Cull(...) kept.  This waits for the GPU to finish the
+    culling, so it's for stats and tests, not for every frame.
+Parameters: None
+Returns:
+    The count (of every group together), or 0 if nothing has been culled.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int GpuCuller::VisibleCount() const
+{
+    GLuint counts[MAX_GROUPS] = {};
+    if (_countBufferId != 0)
+    {
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        GlStateCache::Shared().BindBuffer(GL_COPY_READ_BUFFER, _countBufferId);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(counts), counts);
+    }
+
+    unsigned int count = 0;
+    for (unsigned int groupCount = 0; groupCount < MAX_GROUPS; groupCount++)
+    {
+        count += counts[groupCount];
+    }
+    return count;
+}
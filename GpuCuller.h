@@ -0,0 +1,111 @@
+#pragma once
+
+#include "MultiDrawRenderer.h"
+#include "ProgramReflection.h"
+
+#include <stddef.h>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    One draw going into the culling shader: where the mesh goes, and which mesh.  This is also
+    the layout of cull.comp's DrawInput, so it is packed to 24 bytes.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct CullDrawInput
+{
+    MeshInstance instance;
+    unsigned int meshIndex;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    One mesh (or meshlet), as the culling shader sees it: the draw command it turns into, its
+    bounding sphere (in the same units as the vertices, so the instance moves and scales it),
+    and which group of the outputs its draws go in.  This is the layout of cull.comp's
+    MeshInfo (32 bytes).
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct CullMeshInfo
+{
+    unsigned int indexCount;
+    unsigned int firstIndex;
+    int baseVertex;
+    float radius;
+    float center[3];
+    unsigned int group;     // less than the numGroups given to GpuCuller::Cull(...)
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Decides on the GPU which draws are in view, so the CPU doesn't have to.
+
+    Cull(...) runs cull.comp over every draw (a CullDrawInput each, in a buffer that the
+    caller wrote).  The compute shader tests each one's bounding sphere (the mesh's sphere,
+    moved and scaled by the instance) against the view planes, and for each one that is in
+    view it bumps an atomic counter and writes a DrawElementsIndirectCommand and a
+    MeshInstance into that slot of its output buffers.  The draws that survive are packed at
+    the front, in no particular order.  The draw path then uses those buffers as the indirect
+    commands and instance attributes (see MultiDrawRenderer::SubmitCulled(...)), and nothing
+    is ever read back to the CPU.
+
+    The draws can be split into groups that have to be drawn separately (the renderer's are
+    index widths, since a draw call only takes one index type).  Each group gets a run of the
+    output slots as long as its number of draws, in group order, and a counter of its own.
+
+    Note: With ARB_indirect_parameters, each group's counter is its draw count
+    (glMultiDrawElementsIndirectCountARB(...)).  Without it, the command buffer is zeroed
+    before the shader runs, and the draw is for every slot, with the ones past the count
+    drawing 0 instances, which costs the GPU a little but still needs no readback.
+
+    Also Note: VisibleCount() does read the counter back, and waits for the GPU to do it.  It
+    is only for stats and tests.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class GpuCuller
+{
+public:
+    GpuCuller();
+    ~GpuCuller();
+
+    // these need the OpenGL context to be current
+    bool Init();
+    void Shutdown();
+    void SetProgram(unsigned int programId);
+    void SetViewPlanes(const float *planes, unsigned int numPlanes);
+
+    bool IsReady() const;
+    bool HasDrawCount() const;
+    size_t InputAlignment() const;
+
+    bool Cull(unsigned int meshInfoBufferId, unsigned int inputBufferId, size_t inputOffset,
+        const unsigned int *numDrawsPerGroup, unsigned int numGroups);
+    unsigned int CommandBufferId() const;
+    unsigned int InstanceBufferId() const;
+    unsigned int CountBufferId() const;
+
+    unsigned int VisibleCount() const;
+
+    // each plane is (a, b, c, d), and a point (x, y, z) is in view if ax + by + cz + d >= 0
+    static const unsigned int MAX_VIEW_PLANES = 6;
+
+    // the count buffer has a uint per group (cull.comp's visibleCounts)
+    static const unsigned int MAX_GROUPS = 4;
+
+private:
+    GpuCuller(const GpuCuller &);
+    GpuCuller &operator=(const GpuCuller &);
+
+    unsigned int _programId;
+    ProgramReflection _reflection;
+
+    float _viewPlanes[MAX_VIEW_PLANES * 4];
+    unsigned int _numViewPlanes;
+
+    // the compacted commands and instances, and the counter
+    unsigned int _commandBufferId;
+    unsigned int _instanceBufferId;
+    unsigned int _countBufferId;
+    unsigned int _capacity;
+    size_t _inputAlignment;
+    bool _hasDrawCount;
+};
@@ -0,0 +1,331 @@
+#include "glload/include/glload/gl_4_4.h"
+
+#include "GpuProfiler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out disabled, so every call is a cheap no-op until Init().
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+GpuProfiler::GpuProfiler() :
+    _enabled(false)
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Frees the scope bookkeeping.  The query objects themselves are deleted in Shutdown(),
+    while the context is still current.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+GpuProfiler::~GpuProfiler()
+{
+    for (size_t scopeCount = 0; scopeCount < _scopes.size(); scopeCount++)
+    {
+        delete _scopes[scopeCount];
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Turns profiling on.  Scopes (and their queries) are made the first time that their names
+    are used.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GpuProfiler::Init()
+{
+    _enabled = true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Deletes all the queries and scopes and turns profiling off.  Results that are still out
+    are thrown away.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GpuProfiler::Shutdown()
+{
+    for (size_t scopeCount = 0; scopeCount < _scopes.size(); scopeCount++)
+    {
+        Scope *scope = _scopes[scopeCount];
+        glDeleteQueries(RING_SIZE, scope->beginQueryIds);
+        glDeleteQueries(RING_SIZE, scope->endQueryIds);
+        delete scope;
+    }
+    _scopes.clear();
+    _openScopes.clear();
+    _enabled = false;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Call once per frame, before any scopes.  Picks up every result that the GPU has finished,
+    without waiting for the ones that it hasn't.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GpuProfiler::BeginFrame()
+{
+    if (!_enabled)
+    {
+        return;
+    }
+
+    for (size_t scopeCount = 0; scopeCount < _scopes.size(); scopeCount++)
+    {
+        Scope &scope = *_scopes[scopeCount];
+        while (CollectOldest(scope))
+        {
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts timing a named stretch of commands and opens a debug group with the same name.
+    Every BeginScope(...) needs an EndScope().
+Parameters:
+    name    What to call it.  Names are compared as strings, so it need not be a literal.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GpuProfiler::BeginScope(const char *name)
+{
+    if (!_enabled)
+    {
+        return;
+    }
+
+    OpenScope open;
+    open.scopeIndex = FindOrAddScope(name);
+    open.slot = 0;
+    Scope &scope = *_scopes[open.scopeIndex];
+
+    // a slot is only reused once its result is in; if it isn't, skip timing this one rather
+    // than wait for the GPU
+    // Note: The slot is taken now rather than in EndScope(), so that a scope of the same name
+    // nested inside this one gets a slot of its own instead of writing over this one's begin
+    // query.
+    open.timed = !scope.pending[scope.nextSlot] || CollectOldest(scope);
+    if (open.timed)
+    {
+        open.slot = scope.nextSlot;
+        scope.nextSlot = (scope.nextSlot + 1) % RING_SIZE;
+        glQueryCounter(scope.beginQueryIds[open.slot], GL_TIMESTAMP);
+    }
+    else
+    {
+        scope.numDropped++;
+    }
+    _openScopes.push_back(open);
+
+    // Note: The id is only used for filtering debug messages, and the scope index is as good
+    // as anything.
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, open.scopeIndex, -1, name);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Ends the most recently begun scope and closes its debug group.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GpuProfiler::EndScope()
+{
+    if (!_enabled || _openScopes.empty())
+    {
+        return;
+    }
+
+    OpenScope open = _openScopes.back();
+    _openScopes.pop_back();
+    glPopDebugGroup();
+
+    if (open.timed)
+    {
+        Scope &scope = *_scopes[open.scopeIndex];
+        glQueryCounter(scope.endQueryIds[open.slot], GL_TIMESTAMP);
+        scope.pending[open.slot] = true;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    True between Init() and Shutdown().
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool GpuProfiler::IsEnabled() const
+{
+    return _enabled;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Summarizes every scope's recent history.
+Parameters: None
+Returns:
+    One entry per scope, in the order that they were first used.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+std::vector<GpuScopeStats> GpuProfiler::Stats() const
+{
+    std::vector<GpuScopeStats> allStats;
+    for (size_t scopeCount = 0; scopeCount < _scopes.size(); scopeCount++)
+    {
+        const Scope &scope = *_scopes[scopeCount];
+        GpuScopeStats stats = {};
+        stats.name = scope.name;
+        stats.numSamples = scope.numSamples;
+        stats.numDropped = scope.numDropped;
+
+        unsigned int historyCount = (unsigned int)std::min(scope.numSamples,
+            (unsigned long long)HISTORY_SIZE);
+        if (historyCount > 0)
+        {
+            stats.lastMs = scope.historyMs[(scope.numSamples - 1) % HISTORY_SIZE];
+            stats.minMs = scope.historyMs[0];
+            stats.maxMs = scope.historyMs[0];
+            double total = 0.0;
+            for (unsigned int sampleCount = 0; sampleCount < historyCount; sampleCount++)
+            {
+                double ms = scope.historyMs[sampleCount];
+                stats.minMs = std::min(stats.minMs, ms);
+                stats.maxMs = std::max(stats.maxMs, ms);
+                total += ms;
+            }
+            stats.meanMs = total / historyCount;
+        }
+        allStats.push_back(stats);
+    }
+
+    return allStats;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Prints Stats() as a little table.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void GpuProfiler::PrintStats() const
+{
+    std::vector<GpuScopeStats> allStats = Stats();
+    printf("gpu profile (ms over the last %u samples):\n", HISTORY_SIZE);
+    printf("  %-12s %9s %9s %9s %9s %10s %8s\n", "scope", "last", "min", "mean", "max",
+        "samples", "dropped");
+    for (size_t statsCount = 0; statsCount < allStats.size(); statsCount++)
+    {
+        const GpuScopeStats &stats = allStats[statsCount];
+        printf("  %-12s %9.4f %9.4f %9.4f %9.4f %10llu %8llu\n", stats.name.c_str(),
+            stats.lastMs, stats.minMs, stats.meanMs, stats.maxMs, stats.numSamples,
+            stats.numDropped);
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Finds the scope with the given name, making it (and its queries) if it's new.
+Parameters:
+    name    The scope's name.
+Returns:
+    The scope's index in _scopes.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int GpuProfiler::FindOrAddScope(const char *name)
+{
+    // a handful of scopes, so a linear search is plenty
+    for (unsigned int scopeCount = 0; scopeCount < _scopes.size(); scopeCount++)
+    {
+        if (strcmp(_scopes[scopeCount]->name.c_str(), name) == 0)
+        {
+            return scopeCount;
+        }
+    }
+
+    // Note: Scopes are allocated one at a time so that a Scope & stays good when _scopes grows
+    // (and so that growing it doesn't copy all those histories around).
+    Scope *scope = new Scope();
+    scope->name = name;
+    glGenQueries(RING_SIZE, scope->beginQueryIds);
+    glGenQueries(RING_SIZE, scope->endQueryIds);
+    for (unsigned int slotCount = 0; slotCount < RING_SIZE; slotCount++)
+    {
+        scope->pending[slotCount] = false;
+    }
+    scope->nextSlot = 0;
+    scope->oldestSlot = 0;
+    scope->numSamples = 0;
+    scope->numDropped = 0;
+    _scopes.push_back(scope);
+    return (unsigned int)(_scopes.size() - 1);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    If the scope's oldest outstanding timing has finished on the GPU, records it and frees its
+    slot.  Never waits.
+Parameters:
+    scope   The scope to check.
+Returns:
+    True if a result was collected.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool GpuProfiler::CollectOldest(Scope &scope)
+{
+    unsigned int slot = scope.oldestSlot;
+    if (!scope.pending[slot])
+    {
+        return false;
+    }
+
+    // the end timestamp comes after the begin one, so if it's in, both are
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(scope.endQueryIds[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == GL_FALSE)
+    {
+        return false;
+    }
+
+    GLuint64 beginNanoseconds = 0;
+    GLuint64 endNanoseconds = 0;
+    glGetQueryObjectui64v(scope.beginQueryIds[slot], GL_QUERY_RESULT, &beginNanoseconds);
+    glGetQueryObjectui64v(scope.endQueryIds[slot], GL_QUERY_RESULT, &endNanoseconds);
+    double ms = (endNanoseconds > beginNanoseconds) ?
+        (double)(endNanoseconds - beginNanoseconds) / 1000000.0 : 0.0;
+
+    scope.historyMs[scope.numSamples % HISTORY_SIZE] = ms;
+    scope.numSamples++;
+    scope.pending[slot] = false;
+    scope.oldestSlot = (slot + 1) % RING_SIZE;
+    return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Rolling statistics for one named scope, in milliseconds of GPU time.  The min, mean, and max
+    are over the last (up to) HISTORY_SIZE samples.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct GpuScopeStats
+{
+    std::string name;
+    unsigned long long numSamples;      // all of them, not just the ones in the history
+    unsigned long long numDropped;      // times the scope wasn't timed because its ring was full
+    double lastMs;
+    double minMs;
+    double meanMs;
+    double maxMs;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Times named stretches of OpenGL commands ("clear", "draw", "swap") on the GPU without ever
+    making the CPU wait for the GPU.
+
+    Each scope drops a GL_TIMESTAMP query (glQueryCounter(...)) at its start and end.  Asking for
+    a query's result before the GPU has gotten to it makes the CPU wait until it has, and if that
+    happens every frame then the CPU and GPU take turns instead of working at the same time,
+    which is exactly the throughput being measured.  So each scope has a ring of query pairs,
+    and results are only read (in BeginFrame()) once GL_QUERY_RESULT_AVAILABLE says that they're
+    in, which is usually a few frames later.  If the GPU falls so far behind that a scope's ring
+    is full, that scope goes untimed for a frame rather than wait.
+
+    Each scope is also a debug group (glPushDebugGroup(...)), so that frame capture tools
+    (RenderDoc, Nsight, apitrace) show the same names.
+
+    Note: Scopes can nest, and the same name can be used more than once per frame (each use
+    takes a query pair).
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class GpuProfiler
+{
+public:
+    GpuProfiler();
+    ~GpuProfiler();
+
+    // these need the OpenGL context to be current
+    void Init();
+    void Shutdown();
+    void BeginFrame();
+    void BeginScope(const char *name);
+    void EndScope();
+
+    bool IsEnabled() const;
+    std::vector<GpuScopeStats> Stats() const;
+    void PrintStats() const;
+
+    // frames of results that can be waiting on the GPU at once, per scope
+    static const unsigned int RING_SIZE = 6;
+
+    // samples that the rolling statistics are over
+    static const unsigned int HISTORY_SIZE = 128;
+
+private:
+    GpuProfiler(const GpuProfiler &);
+    GpuProfiler &operator=(const GpuProfiler &);
+
+    struct Scope
+    {
+        std::string name;
+        unsigned int beginQueryIds[RING_SIZE];
+        unsigned int endQueryIds[RING_SIZE];
+        bool pending[RING_SIZE];
+        unsigned int nextSlot;      // where the next timing goes
+        unsigned int oldestSlot;    // the next one to collect a result from
+        double historyMs[HISTORY_SIZE];
+        unsigned long long numSamples;
+        unsigned long long numDropped;
+    };
+
+    // an entry in the stack of scopes that have begun but not ended yet
+    struct OpenScope
+    {
+        unsigned int scopeIndex;
+        unsigned int slot;          // the query pair that it took in its scope's ring
+        bool timed;
+    };
+
+    unsigned int FindOrAddScope(const char *name);
+    bool CollectOldest(Scope &scope);
+
+    bool _enabled;
+    std::vector<Scope *> _scopes;
+    std::vector<OpenScope> _openScopes;
+};
@@ -0,0 +1,234 @@
+#include "HeadlessContext.h"
+
+#include <stdio.h>
+
+#ifndef _WIN32
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <string.h>     // strstr(...)
+#endif
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out with no context.  See Create(...).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+HeadlessContext::HeadlessContext() :
+    _display(0),
+    _context(0),
+    _surface(0)
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Destroys the context if Destroy() hasn't already.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+HeadlessContext::~HeadlessContext()
+{
+    Destroy();
+}
+
+#ifdef _WIN32
+
+// no EGL here; see the other versions below for what these do
+bool HeadlessContext::Create(int majorVersion, int minorVersion, bool debug)
+{
+    printf("headless mode needs EGL, which this build doesn't have\n");
+    return false;
+}
+
+void HeadlessContext::Destroy()
+{
+}
+
+#else
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether an EGL extension string has the given extension in it.
+Parameters:
+    extensions  A space-separated list, from eglQueryString(...).  May be null.
+    name        The extension to look for.
+Returns:
+    True if the extension is in the list.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static bool HasEglExtension(const char *extensions, const char *name)
+{
+    if (extensions == 0)
+    {
+        return false;
+    }
+
+    // a plain strstr(...) would also match an extension whose name starts with this one
+    size_t nameLength = strlen(name);
+    for (const char *found = strstr(extensions, name); found != 0;
+        found = strstr(found + 1, name))
+    {
+        bool startsWord = (found == extensions) || (found[-1] == ' ');
+        bool endsWord = (found[nameLength] == ' ') || (found[nameLength] == '\0');
+        if (startsWord && endsWord)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes a core profile context of the given version and makes it current.
+
+    Mesa's surfaceless platform is tried first since it needs no display server and no GPU
+    at all.  Otherwise, whatever EGL calls the default display is used.  If the driver can
+    make a context without a config (EGL_KHR_no_config_context), there's no surface at all;
+    otherwise a 1x1 pbuffer is made just to have something to make current.
+Parameters:
+    majorVersion    ex: 4 for OpenGL 4.4
+    minorVersion    ex: 4 for OpenGL 4.4
+    debug           True for a debug context (so that glDebugMessageCallback(...) gets
+                    messages).
+Returns:
+    True if the context was made and is current.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool HeadlessContext::Create(int majorVersion, int minorVersion, bool debug)
+{
+    Destroy();
+
+    EGLDisplay display = EGL_NO_DISPLAY;
+    const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (HasEglExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay != 0)
+        {
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0);
+        }
+    }
+    if (display == EGL_NO_DISPLAY)
+    {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint eglMajor = 0;
+    EGLint eglMinor = 0;
+    if ((display == EGL_NO_DISPLAY) || !eglInitialize(display, &eglMajor, &eglMinor))
+    {
+        printf("could not initialize EGL (error 0x%x)\n", eglGetError());
+        return false;
+    }
+    _display = display;
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        printf("this EGL can't do desktop OpenGL\n");
+        Destroy();
+        return false;
+    }
+
+    EGLConfig config = 0;
+    bool needsConfig = !HasEglExtension(eglQueryString(display, EGL_EXTENSIONS),
+        "EGL_KHR_no_config_context");
+    if (needsConfig)
+    {
+        const EGLint configAttribs[] =
+        {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLint numConfigs = 0;
+        if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) ||
+            (numConfigs == 0))
+        {
+            printf("no EGL config can do OpenGL with a pbuffer\n");
+            Destroy();
+            return false;
+        }
+    }
+
+    // Note: EGL_CONTEXT_OPENGL_DEBUG and the version attributes are EGL 1.5, and the same
+    // values as the EGL_KHR_create_context ones that Mesa has had for years.
+    const EGLint contextAttribs[] =
+    {
+        EGL_CONTEXT_MAJOR_VERSION, majorVersion,
+        EGL_CONTEXT_MINOR_VERSION, minorVersion,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_CONTEXT_OPENGL_DEBUG, debug ? EGL_TRUE : EGL_FALSE,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, needsConfig ? config : EGL_NO_CONFIG_KHR,
+        EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT)
+    {
+        printf("could not make an OpenGL %i.%i core context (EGL error 0x%x)\n",
+            majorVersion, minorVersion, eglGetError());
+        Destroy();
+        return false;
+    }
+    _context = context;
+
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (needsConfig)
+    {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+        _surface = surface;
+    }
+
+    if (!eglMakeCurrent(display, surface, surface, context))
+    {
+        printf("could not make the headless context current (EGL error 0x%x)\n",
+            eglGetError());
+        Destroy();
+        return false;
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Releases and destroys the context.  Safe to call more than once.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void HeadlessContext::Destroy()
+{
+    if (_display == 0)
+    {
+        return;
+    }
+
+    EGLDisplay display = (EGLDisplay)_display;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (_surface != 0)
+    {
+        eglDestroySurface(display, (EGLSurface)_surface);
+        _surface = 0;
+    }
+    if (_context != 0)
+    {
+        eglDestroyContext(display, (EGLContext)_context);
+        _context = 0;
+    }
+    eglTerminate(display);
+    _display = 0;
+}
+
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    An OpenGL context with no window behind it, for running the rendering code on machines
+    that have no display or GPU (build servers, batch renderers).  It uses EGL with Mesa's
+    "surfaceless" platform, so on a plain Linux box it runs on llvmpipe (Mesa's CPU
+    rasterizer).  There is no default framebuffer, so draw into an OffscreenFramebuffer.
+
+    Build note: Needs the EGL headers and library (libEGL, "-lEGL").  Windows builds don't
+    have EGL, so there Create(...) just reports that and fails.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class HeadlessContext
+{
+public:
+    HeadlessContext();
+    ~HeadlessContext();
+
+    // makes the context current on the calling thread
+    bool Create(int majorVersion, int minorVersion, bool debug);
+    void Destroy();
+
+private:
+    HeadlessContext(const HeadlessContext &);
+    HeadlessContext &operator=(const HeadlessContext &);
+
+    // EGLDisplay, EGLContext, and EGLSurface are all pointers, and keeping them as void * keeps
+    // EGL out of this header
+    void *_display;
+    void *_context;
+    void *_surface;
+};
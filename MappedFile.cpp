@@ -0,0 +1,212 @@
+#include "MappedFile.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>      // open(...)
+#include <sys/mman.h>   // mmap(...)
+#include <sys/stat.h>   // fstat(...)
+#include <unistd.h>     // close(...)
+#endif
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out with nothing mapped.  See Open(...).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+MappedFile::MappedFile() :
+    _data(0),
+    _size(0),
+    _fileHandle(0),
+    _mappingHandle(0)
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Unmaps the file if Close() hasn't already.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Maps the whole file.  Closes whatever was mapped before.
+Parameters:
+    filePath    The file.  It can't be empty, since an empty file can't be mapped.
+Returns:
+    True if it's mapped.  What went wrong is printed if it isn't.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool MappedFile::Open(const char *filePath)
+{
+    Close();
+    HANDLE file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        printf("could not open '%s'\n", filePath);
+        return false;
+    }
+    _fileHandle = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart == 0))
+    {
+        printf("'%s' is empty\n", filePath);
+        Close();
+        return false;
+    }
+
+    _mappingHandle = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    _data = (_mappingHandle != 0) ? MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0) : 0;
+    if (_data == 0)
+    {
+        printf("could not map '%s'\n", filePath);
+        Close();
+        return false;
+    }
+    _size = (size_t)fileSize.QuadPart;
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Unmaps the file.  Anything that still points into Data() is garbage after this.  Safe to
+    call more than once.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void MappedFile::Close()
+{
+    if (_data != 0)
+    {
+        UnmapViewOfFile(_data);
+    }
+    if (_mappingHandle != 0)
+    {
+        CloseHandle(_mappingHandle);
+    }
+    if (_fileHandle != 0)
+    {
+        CloseHandle(_fileHandle);
+    }
+    _data = 0;
+    _size = 0;
+    _mappingHandle = 0;
+    _fileHandle = 0;
+}
+
+#else
+
+// same as above
+bool MappedFile::Open(const char *filePath)
+{
+    Close();
+    int file = open(filePath, O_RDONLY);
+    if (file == -1)
+    {
+        printf("could not open '%s'\n", filePath);
+        return false;
+    }
+
+    // Note: The mapping keeps the file open by itself, so the descriptor isn't kept.
+    struct stat fileInfo;
+    void *data = MAP_FAILED;
+    bool isEmpty = (fstat(file, &fileInfo) != 0) || (fileInfo.st_size == 0);
+    if (!isEmpty)
+    {
+        data = mmap(0, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    close(file);
+    if (isEmpty)
+    {
+        printf("'%s' is empty\n", filePath);
+        return false;
+    }
+    if (data == MAP_FAILED)
+    {
+        printf("could not map '%s'\n", filePath);
+        return false;
+    }
+
+    // the whole thing is about to be read front to back
+    madvise(data, (size_t)fileInfo.st_size, MADV_SEQUENTIAL);
+    madvise(data, (size_t)fileInfo.st_size, MADV_WILLNEED);
+    _data = data;
+    _size = (size_t)fileInfo.st_size;
+
+    return true;
+}
+
+// same as above
+void MappedFile::Close()
+{
+    if (_data != 0)
+    {
+        munmap((void *)_data, _size);
+    }
+    _data = 0;
+    _size = 0;
+}
+
+#endif
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    True if a file is mapped.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool MappedFile::IsOpen() const
+{
+    return _data != 0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The file's first byte, or null if nothing's mapped.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const void *MappedFile::Data() const
+{
+    return _data;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The file's size in bytes, or 0 if nothing's mapped.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+size_t MappedFile::Size() const
+{
+    return _size;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>     // size_t
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A whole file mapped read-only into memory (mmap(...) on Linux, MapViewOfFile(...) on
+    Windows).  Nothing is read when it's opened.  The OS pages the file in as the bytes are
+    touched, straight from its file cache, so handing Data() to glBufferData(...) or memcpy(...)
+    is the one and only copy, and a file that's already cached costs nothing but the page
+    table.
+
+    Note: The data starts on a page boundary, so anything in the file that is aligned from
+    the start of the file is just as aligned in memory.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool Open(const char *filePath);
+    void Close();
+
+    bool IsOpen() const;
+    const void *Data() const;
+    size_t Size() const;
+
+private:
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+    const void *_data;
+    size_t _size;
+
+    // Windows: the file and the mapping object, as HANDLEs (kept as void * so that this header
+    // doesn't need windows.h)
+    void *_fileHandle;
+    void *_mappingHandle;
+};
@@ -0,0 +1,189 @@
+#include "Mesh.h"
+
+#include <math.h>
+
+static const float PI = 3.14159265358979f;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Fills in a vertex.
+Parameters:
+    x, y, z     Position.
+    u, v        Texture coordinate.
+Returns:
+    The vertex.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static MeshVertex MakeVertex(float x, float y, float z, float u, float v)
+{
+    MeshVertex vertex = { { x, y, z }, { u, v } };
+    return vertex;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A flat, regular polygon made as a fan of triangles around a center vertex.  Every number
+    of sides is a different mesh with a different vertex and index count, which makes lots of
+    distinct meshes easy.
+Parameters:
+    numSides    At least 3.
+Returns:
+    The mesh.  Its texture coordinates map the -0.5 - 0.5 square to 0 - 1.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+MeshData MakePolygonMesh(unsigned int numSides)
+{
+    numSides = (numSides < 3) ? 3 : numSides;
+    MeshData mesh;
+    mesh.vertices.push_back(MakeVertex(0.0f, 0.0f, 0.0f, 0.5f, 0.5f));
+    for (unsigned int sideCount = 0; sideCount < numSides; sideCount++)
+    {
+        float angle = 2.0f * PI * sideCount / numSides;
+        float x = 0.5f * cosf(angle);
+        float y = 0.5f * sinf(angle);
+        mesh.vertices.push_back(MakeVertex(x, y, 0.0f, x + 0.5f, y + 0.5f));
+    }
+
+    // counterclockwise, since the angle goes counterclockwise
+    for (unsigned int sideCount = 0; sideCount < numSides; sideCount++)
+    {
+        mesh.indices.push_back(0);
+        mesh.indices.push_back(1 + sideCount);
+        mesh.indices.push_back(1 + ((sideCount + 1) % numSides));
+    }
+
+    return mesh;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A UV sphere with a diameter of 1.  The vertices at the seam (where the texture coordinate
+    wraps from 1 back to 0) and at the poles are duplicated, since they have different texture
+    coordinates, like a sphere from a modeling program would be.
+Parameters:
+    numRings        Bands from pole to pole.  At least 2.
+    numSegments     Slices around.  At least 3.
+Returns:
+    The mesh.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+MeshData MakeSphereMesh(unsigned int numRings, unsigned int numSegments)
+{
+    numRings = (numRings < 2) ? 2 : numRings;
+    numSegments = (numSegments < 3) ? 3 : numSegments;
+    MeshData mesh;
+
+    // Note: Segment 0 faces +Z, and the segments go toward +X, so that the triangles are
+    // counterclockwise from outside.
+    for (unsigned int ring = 0; ring <= numRings; ring++)
+    {
+        float theta = PI * ring / numRings;
+        for (unsigned int segment = 0; segment <= numSegments; segment++)
+        {
+            float phi = 2.0f * PI * segment / numSegments;
+            mesh.vertices.push_back(MakeVertex(0.5f * sinf(theta) * sinf(phi),
+                0.5f * cosf(theta), 0.5f * sinf(theta) * cosf(phi),
+                (float)segment / numSegments, 1.0f - ((float)ring / numRings)));
+        }
+    }
+
+    // the triangles that touch a pole would have two corners at the same place, so they're
+    // left out
+    unsigned int verticesPerRing = numSegments + 1;
+    for (unsigned int ring = 0; ring < numRings; ring++)
+    {
+        for (unsigned int segment = 0; segment < numSegments; segment++)
+        {
+            unsigned int topLeft = (ring * verticesPerRing) + segment;
+            unsigned int bottomLeft = topLeft + verticesPerRing;
+            if (ring != numRings - 1)
+            {
+                mesh.indices.push_back(topLeft);
+                mesh.indices.push_back(bottomLeft);
+                mesh.indices.push_back(bottomLeft + 1);
+            }
+            if (ring != 0)
+            {
+                mesh.indices.push_back(topLeft);
+                mesh.indices.push_back(bottomLeft + 1);
+                mesh.indices.push_back(topLeft + 1);
+            }
+        }
+    }
+
+    return mesh;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A flat grid of squares, each split into 2 triangles.
+Parameters:
+    numColumns  Squares across.  At least 1.
+    numRows     Squares up.  At least 1.
+Returns:
+    The mesh.  Its texture coordinates go 0 - 1 across the whole grid.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+MeshData MakeGridMesh(unsigned int numColumns, unsigned int numRows)
+{
+    numColumns = (numColumns < 1) ? 1 : numColumns;
+    numRows = (numRows < 1) ? 1 : numRows;
+    MeshData mesh;
+    for (unsigned int row = 0; row <= numRows; row++)
+    {
+        for (unsigned int column = 0; column <= numColumns; column++)
+        {
+            float u = (float)column / numColumns;
+            float v = (float)row / numRows;
+            mesh.vertices.push_back(MakeVertex(u - 0.5f, v - 0.5f, 0.0f, u, v));
+        }
+    }
+
+    unsigned int verticesPerRow = numColumns + 1;
+    for (unsigned int row = 0; row < numRows; row++)
+    {
+        for (unsigned int column = 0; column < numColumns; column++)
+        {
+            unsigned int bottomLeft = (row * verticesPerRow) + column;
+            unsigned int topLeft = bottomLeft + verticesPerRow;
+            mesh.indices.push_back(bottomLeft);
+            mesh.indices.push_back(bottomLeft + 1);
+            mesh.indices.push_back(topLeft + 1);
+            mesh.indices.push_back(bottomLeft);
+            mesh.indices.push_back(topLeft + 1);
+            mesh.indices.push_back(topLeft);
+        }
+    }
+
+    return mesh;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    One of an endless supply of different meshes, for filling a scene with thousands of them
+    without loading any files.  Goes through polygons, spheres, and grids with sizes that
+    change with the number, so neighboring numbers never have the same vertex or index count.
+Parameters:
+    meshNumber  Any number.  The same number always makes the same mesh.
+Returns:
+    The mesh, about 1 unit across.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+MeshData MakeAssortedMesh(unsigned int meshNumber)
+{
+    unsigned int variation = meshNumber / 3;
+    switch (meshNumber % 3)
+    {
+    case 0:
+        return MakePolygonMesh(3 + (variation % 29));
+    case 1:
+        return MakeSphereMesh(3 + (variation % 6), 5 + (variation % 11));
+    default:
+        return MakeGridMesh(1 + (variation % 4), 1 + ((variation / 4) % 4));
+    }
+}
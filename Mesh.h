@@ -0,0 +1,46 @@
+#pragma once
+
+#include "VertexLayout.h"
+
+#include <vector>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    One vertex, in the same interleaved layout as CreateGeometry()'s triangle in main.cpp:
+    3 floats of position and then 2 of texture coordinate.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct MeshVertex
+{
+    float pos[3];
+    float uv[2];
+};
+
+// what mesh.vert, sprite.vert, and shader.vert take at locations 0 and 1 (see VertexLayout.h)
+static constexpr VertexAttribute MESH_VERTEX_ATTRIBUTES[] =
+{
+    VERTEX_ATTRIBUTE(MeshVertex, pos, 0),
+    VERTEX_ATTRIBUTE(MeshVertex, uv, 1),
+};
+static_assert(VertexAttributesFit<MeshVertex>(MESH_VERTEX_ATTRIBUTES),
+    "MeshVertex's attributes don't fit it");
+static constexpr VertexLayout MESH_VERTEX_LAYOUT =
+    MakeVertexLayout<MeshVertex>(MESH_VERTEX_ATTRIBUTES, 0);
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    An indexed triangle list on the CPU.  Every 3 indices are a triangle, counterclockwise
+    from the front.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct MeshData
+{
+    std::vector<MeshVertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// procedural meshes, centered on the origin, facing +Z, and about 1 unit across (-0.5 - 0.5)
+MeshData MakePolygonMesh(unsigned int numSides);
+MeshData MakeSphereMesh(unsigned int numRings, unsigned int numSegments);
+MeshData MakeGridMesh(unsigned int numColumns, unsigned int numRows);
+MeshData MakeAssortedMesh(unsigned int meshNumber);
@@ -0,0 +1,535 @@
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+
+#include <stdio.h>
+#include <stdlib.h>     // strtof(...) and strtol(...)
+#include <string.h>     // memcpy(...), memcmp(...), and memset(...)
+#include <stdint.h>
+
+static const char MESH_FILE_MAGIC[4] = { 'M', 'E', 'S', 'H' };
+static const uint32_t MESH_FILE_VERSION = 2;
+
+// not an index
+static const unsigned int NO_INDEX = 0xFFFFFFFF;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Rounds a file offset up to the next MESH_FILE_ALIGNMENT boundary.
+Parameters:
+    offset  In bytes.
+Returns:
+    The aligned offset.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static uint64_t AlignOffset(uint64_t offset)
+{
+    uint64_t alignment = MeshFile::MESH_FILE_ALIGNMENT;
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Finds the biggest of a run of packed indices.
+Parameters:
+    indices     The indices, BytesPerIndex(width) bytes each.
+    numIndices  How many.
+    width       How wide they are.
+Returns:
+    The biggest index, or 0 if there are none.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static unsigned int FindMaxIndex(const void *indices, size_t numIndices, IndexWidth width)
+{
+    unsigned int maxIndex = 0;
+    for (size_t indexCount = 0; indexCount < numIndices; indexCount++)
+    {
+        unsigned int index = 0;
+        if (width == INDEX_WIDTH_8)
+        {
+            index = ((const uint8_t *)indices)[indexCount];
+        }
+        else if (width == INDEX_WIDTH_16)
+        {
+            index = ((const uint16_t *)indices)[indexCount];
+        }
+        else
+        {
+            index = ((const uint32_t *)indices)[indexCount];
+        }
+        maxIndex = (index > maxIndex) ? index : maxIndex;
+    }
+    return maxIndex;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out with no file.  See Open(...).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+MeshFile::MeshFile()
+{
+    memset(&_mesh, 0, sizeof(_mesh));
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Maps a mesh file and checks that its header makes sense, that everything it says is in
+    the file is really there, and that no index is past the last vertex.  Closes whatever was
+    open before.
+
+    Note: The index check is one pass over the mapped indices.  It's worth it, since the
+    meshes share one vertex arena, and a bad index would quietly draw some other mesh's
+    vertices instead of failing.
+Parameters:
+    filePath    From WriteMeshFile(...).
+Returns:
+    True if the mesh is ready to use.  What's wrong with it is printed if it isn't.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool MeshFile::Open(const char *filePath)
+{
+    Close();
+    if (!_mapping.Open(filePath))
+    {
+        // it said why
+        return false;
+    }
+
+    // the header has to be there before anything in it can be looked at
+    uint64_t fileSize = _mapping.Size();
+    if (fileSize < sizeof(MeshFileHeader))
+    {
+        printf("'%s' is too small to be a mesh file\n", filePath);
+        Close();
+        return false;
+    }
+
+    // Note: The sizes are worked out in 64 bits so that a bad count can't wrap around and
+    // pass.  The offsets can be anything up to 2^64 though, so each section is checked as
+    // "starts in the file, and fits in what's left after that" instead of adding the offset
+    // and the size (which would wrap for an offset near 2^64).
+    const MeshFileHeader &header = *(const MeshFileHeader *)_mapping.Data();
+    uint64_t vertexBytes = 0;
+    uint64_t indexBytes = (uint64_t)header.numIndices * header.bytesPerIndex;
+    bool good = (memcmp(header.magic, MESH_FILE_MAGIC, sizeof(header.magic)) == 0) &&
+        (header.fileVersion == MESH_FILE_VERSION) &&
+        (header.vertexFormat < VERTEX_FORMAT_COUNT) && ((header.numIndices % 3) == 0);
+    IndexWidth indexWidth = INDEX_WIDTH_COUNT;
+    for (int widthIndex = 0; good && (widthIndex < INDEX_WIDTH_COUNT); widthIndex++)
+    {
+        if (header.bytesPerIndex == BytesPerIndex((IndexWidth)widthIndex))
+        {
+            indexWidth = (IndexWidth)widthIndex;
+        }
+    }
+    good = good && (indexWidth != INDEX_WIDTH_COUNT);
+    if (good)
+    {
+        const VertexFormatDescription &description =
+            GetVertexFormatDescription((VertexFormat)header.vertexFormat);
+        vertexBytes = (uint64_t)header.numVertices * description.bytesPerVertex;
+        good = (header.bytesPerVertex == description.bytesPerVertex) &&
+            (header.vertexOffset == AlignOffset(header.vertexOffset)) &&
+            (header.indexOffset == AlignOffset(header.indexOffset)) &&
+            (header.vertexOffset >= sizeof(MeshFileHeader)) &&
+            (header.vertexOffset <= fileSize) &&
+            (vertexBytes <= fileSize - header.vertexOffset) &&
+            (header.indexOffset >= sizeof(MeshFileHeader)) &&
+            (header.indexOffset <= fileSize) &&
+            (indexBytes <= fileSize - header.indexOffset);
+    }
+    if (!good)
+    {
+        printf("'%s' isn't a mesh file (or is from a different version)\n", filePath);
+        Close();
+        return false;
+    }
+
+    const unsigned char *fileStart = (const unsigned char *)_mapping.Data();
+    if ((header.numIndices > 0) && (FindMaxIndex(fileStart + header.indexOffset,
+        header.numIndices, indexWidth) >= header.numVertices))
+    {
+        printf("'%s' has indices past its %u vertices\n", filePath, header.numVertices);
+        Close();
+        return false;
+    }
+
+    _mesh.format = (VertexFormat)header.vertexFormat;
+    _mesh.vertices = fileStart + header.vertexOffset;
+    _mesh.numVertices = header.numVertices;
+    _mesh.indices = fileStart + header.indexOffset;
+    _mesh.numIndices = header.numIndices;
+    _mesh.indexWidth = indexWidth;
+    _mesh.quantization.scale = header.quantizationScale;
+    memcpy(_mesh.quantization.bias, header.quantizationBias, sizeof(_mesh.quantization.bias));
+    _mesh.radius = header.radius;
+    memcpy(_mesh.packedCenter, header.packedCenter, sizeof(_mesh.packedCenter));
+    _mesh.packedRadius = header.packedRadius;
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Unmaps the file.  Mesh() is empty after this.  Safe to call more than once.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void MeshFile::Close()
+{
+    _mapping.Close();
+    memset(&_mesh, 0, sizeof(_mesh));
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    True if a mesh file is open.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool MeshFile::IsOpen() const
+{
+    return _mapping.IsOpen();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The mesh, pointing into the mapped file.  All 0s if nothing's open.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const PackedMesh &MeshFile::Mesh() const
+{
+    return _mesh;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Packs a mesh into a vertex format and saves it as a mesh file, so that the packing (and
+    whatever made the mesh, like ConvertObjFile(...)) only happens once, ahead of time.  The
+    indices are saved as narrow as the vertex count allows (see PackMesh(...)).
+
+    Note: The mesh is never cut into meshlets, so one with more than 65,536 vertices has
+    32-bit indices.
+Parameters:
+    filePath    Where to write it.  Overwritten if it exists.
+    mesh        A multiple of 3 indices, all less than the number of vertices.
+    format      What to pack the vertices into.  It has to be what the renderer uses.
+Returns:
+    True if the whole file was written.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool WriteMeshFile(const char *filePath, const MeshData &mesh, VertexFormat format)
+{
+    const VertexFormatDescription &description = GetVertexFormatDescription(format);
+    std::vector<unsigned char> vertexBytes;
+    std::vector<unsigned char> indexBytes;
+    PackedMesh packedMesh;
+    PackMesh(mesh, format, &vertexBytes, &indexBytes, &packedMesh);
+    size_t numVertexBytes = mesh.vertices.size() * description.bytesPerVertex;
+    size_t numIndexBytes = mesh.indices.size() * BytesPerIndex(packedMesh.indexWidth);
+
+    MeshFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MESH_FILE_MAGIC, sizeof(header.magic));
+    header.fileVersion = MESH_FILE_VERSION;
+    header.vertexFormat = (uint32_t)format;
+    header.bytesPerVertex = description.bytesPerVertex;
+    header.numVertices = (uint32_t)mesh.vertices.size();
+    header.numIndices = (uint32_t)mesh.indices.size();
+    header.bytesPerIndex = BytesPerIndex(packedMesh.indexWidth);
+    header.vertexOffset = AlignOffset(sizeof(MeshFileHeader));
+    header.indexOffset = AlignOffset(header.vertexOffset + numVertexBytes);
+    header.quantizationScale = packedMesh.quantization.scale;
+    memcpy(header.quantizationBias, packedMesh.quantization.bias,
+        sizeof(header.quantizationBias));
+    header.radius = packedMesh.radius;
+    memcpy(header.packedCenter, packedMesh.packedCenter, sizeof(header.packedCenter));
+    header.packedRadius = packedMesh.packedRadius;
+
+    FILE *file = fopen(filePath, "wb");
+    if (file == 0)
+    {
+        printf("could not open '%s' for writing\n", filePath);
+        return false;
+    }
+
+    // Note: The padding is 0s up to the next section.
+    const unsigned char padding[MeshFile::MESH_FILE_ALIGNMENT] = {};
+    size_t vertexPadding = (size_t)(header.vertexOffset - sizeof(MeshFileHeader));
+    size_t indexPadding = (size_t)(header.indexOffset - header.vertexOffset - numVertexBytes);
+    bool good = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+        (fwrite(padding, 1, vertexPadding, file) == vertexPadding) &&
+        (fwrite(packedMesh.vertices, 1, numVertexBytes, file) == numVertexBytes) &&
+        (fwrite(padding, 1, indexPadding, file) == indexPadding) &&
+        (fwrite(packedMesh.indices, 1, numIndexBytes, file) == numIndexBytes);
+    good = (fclose(file) == 0) && good;
+    if (!good)
+    {
+        printf("could not write '%s'\n", filePath);
+    }
+
+    return good;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    64-bit FNV-1a of a vertex's bytes, for the duplicate vertex table in ReadObjFile(...).
+Parameters:
+    vertex  The vertex.
+Returns:
+    The hash.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static uint64_t HashVertex(const MeshVertex &vertex)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    const unsigned char *bytes = (const unsigned char *)&vertex;
+    for (size_t byteCount = 0; byteCount < sizeof(MeshVertex); byteCount++)
+    {
+        hash ^= bytes[byteCount];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Turns an OBJ index (1-based, or negative to count back from the last one so far) into a
+    0-based one.
+Parameters:
+    objIndex    From the file.
+    count       How many positions (or texture coordinates) there are so far.
+Returns:
+    The 0-based index, or NO_INDEX if it's out of range (or 0, which OBJ doesn't use).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static unsigned int ObjIndex(long objIndex, size_t count)
+{
+    long index = (objIndex < 0) ? ((long)count + objIndex) : (objIndex - 1);
+    return ((objIndex == 0) || (index < 0) || ((size_t)index >= count)) ? NO_INDEX :
+        (unsigned int)index;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Reads the triangles out of a Wavefront OBJ file: the positions ("v"), texture coordinates
+    ("vt"), and faces ("f").  Faces with more than 3 corners become fans.  Everything else
+    (normals, groups, materials) is skipped, since MeshVertex has nowhere to put it.
+
+    OBJ indexes the positions and texture coordinates separately, so every corner of every
+    face is its own vertex until the duplicates are found.  A hash table of the vertices so
+    far (open addressing, sized up front to twice the number of corners so that it never has
+    to grow) finds each corner's vertex if it's already been made, so a vertex shared by 6
+    triangles is stored once instead of 6 times.  Whole vertices are compared rather than
+    the OBJ's index pairs, so repeated positions in the file are merged too.
+
+    Note: This is the slow part that mesh files are for.  Convert the OBJ once with
+    ConvertObjFile(...) and load that.
+Parameters:
+    filePath    The .obj file.
+    mesh        Gets the vertices and indices.
+Returns:
+    True if it was read.  What's wrong with it is printed if it isn't.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool ReadObjFile(const char *filePath, MeshData *mesh)
+{
+    // the whole file at once, with a 0 on the end so that strtof(...) stops
+    FILE *file = fopen(filePath, "rb");
+    if (file == 0)
+    {
+        printf("could not open '%s'\n", filePath);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    std::vector<char> text((fileSize > 0) ? (size_t)fileSize + 1 : 1, 0);
+    bool good = (fileSize >= 0) && (fread(text.data(), 1, text.size() - 1, file) ==
+        text.size() - 1);
+    fclose(file);
+    if (!good)
+    {
+        printf("could not read '%s'\n", filePath);
+        return false;
+    }
+
+    // every face corner as (position, texture coordinate) indices, fanned into triangles
+    std::vector<float> positions;
+    std::vector<float> texCoords;
+    std::vector<unsigned int> corners;
+    std::vector<unsigned int> faceCorners;
+    unsigned int lineNumber = 1;
+    for (char *line = text.data(); *line != 0; lineNumber++)
+    {
+        char *end = 0;
+        if ((line[0] == 'v') && (line[1] == ' '))
+        {
+            char *next = line + 2;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                positions.push_back(strtof(next, &end));
+                next = end;
+            }
+        }
+        else if ((line[0] == 'v') && (line[1] == 't') && (line[2] == ' '))
+        {
+            char *next = line + 3;
+            for (int component = 0; component < 2; component++)
+            {
+                texCoords.push_back(strtof(next, &end));
+                next = end;
+            }
+        }
+        else if ((line[0] == 'f') && (line[1] == ' '))
+        {
+            // "v", "v/vt", "v//vn", or "v/vt/vn"
+            faceCorners.clear();
+            char *next = line + 2;
+            while (true)
+            {
+                long objPosition = strtol(next, &end, 10);
+                if (end == next)
+                {
+                    break;
+                }
+                next = end;
+                long objTexCoord = 0;
+                if (*next == '/')
+                {
+                    next++;
+                    objTexCoord = strtol(next, &end, 10);
+                    next = end;
+                    if (*next == '/')
+                    {
+                        next++;
+                        strtol(next, &end, 10);
+                        next = end;
+                    }
+                }
+
+                unsigned int position = ObjIndex(objPosition, positions.size() / 3);
+                unsigned int texCoord = (objTexCoord == 0) ? NO_INDEX :
+                    ObjIndex(objTexCoord, texCoords.size() / 2);
+                if ((position == NO_INDEX) || ((objTexCoord != 0) && (texCoord == NO_INDEX)))
+                {
+                    printf("'%s' line %u: a face uses a vertex that isn't there\n", filePath,
+                        lineNumber);
+                    return false;
+                }
+                faceCorners.push_back(position);
+                faceCorners.push_back(texCoord);
+            }
+
+            for (size_t cornerCount = 4; cornerCount + 2 <= faceCorners.size(); cornerCount += 2)
+            {
+                corners.insert(corners.end(), faceCorners.begin(), faceCorners.begin() + 2);
+                corners.insert(corners.end(), faceCorners.begin() + cornerCount - 2,
+                    faceCorners.begin() + cornerCount + 2);
+            }
+        }
+
+        // on to the next line
+        while ((*line != 0) && (*line != '\n'))
+        {
+            line++;
+        }
+        line += (*line == '\n') ? 1 : 0;
+    }
+
+    // one vertex per different corner
+    size_t numCorners = corners.size() / 2;
+    size_t tableSize = 16;
+    while (tableSize < numCorners * 2)
+    {
+        tableSize *= 2;
+    }
+    std::vector<unsigned int> table(tableSize, NO_INDEX);
+    mesh->vertices.clear();
+    mesh->indices.clear();
+    mesh->indices.reserve(numCorners);
+    for (size_t cornerCount = 0; cornerCount < numCorners; cornerCount++)
+    {
+        MeshVertex vertex;
+        memset(&vertex, 0, sizeof(vertex));
+        memcpy(vertex.pos, &positions[corners[cornerCount * 2] * 3], sizeof(vertex.pos));
+        unsigned int texCoord = corners[(cornerCount * 2) + 1];
+        if (texCoord != NO_INDEX)
+        {
+            memcpy(vertex.uv, &texCoords[texCoord * 2], sizeof(vertex.uv));
+        }
+
+        size_t slot = (size_t)HashVertex(vertex) & (tableSize - 1);
+        while ((table[slot] != NO_INDEX) &&
+            (memcmp(&mesh->vertices[table[slot]], &vertex, sizeof(vertex)) != 0))
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] == NO_INDEX)
+        {
+            table[slot] = (unsigned int)mesh->vertices.size();
+            mesh->vertices.push_back(vertex);
+        }
+        mesh->indices.push_back(table[slot]);
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Reads an OBJ file (see ReadObjFile(...)), optimizes it for the GPU (see OptimizeMesh(...)),
+    and saves it as a mesh file in the given vertex format.  This is the offline step, so it
+    can afford to be slow.
+Parameters:
+    objFilePath     The .obj file.
+    meshFilePath    Where to write the mesh file.
+    format          What to pack the vertices into.
+Returns:
+    True if it worked.  It prints what it did, or what went wrong.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool ConvertObjFile(const char *objFilePath, const char *meshFilePath, VertexFormat format)
+{
+    MeshData mesh;
+    if (!ReadObjFile(objFilePath, &mesh))
+    {
+        return false;
+    }
+    if (mesh.indices.empty())
+    {
+        printf("'%s' has no triangles\n", objFilePath);
+        return false;
+    }
+    size_t numCorners = mesh.indices.size();
+    OptimizeMesh(&mesh);
+    if (!WriteMeshFile(meshFilePath, mesh, format))
+    {
+        return false;
+    }
+
+    printf("'%s': %u triangles, %u vertices (from %u face corners), '%s' vertices -> '%s'\n",
+        objFilePath, (unsigned int)(mesh.indices.size() / 3), (unsigned int)mesh.vertices.size(),
+        (unsigned int)numCorners, GetVertexFormatDescription(format).name, meshFilePath);
+    return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Mesh.h"
+#include "MeshPacking.h"
+#include "MappedFile.h"
+
+#include <stdint.h>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The start of every mesh file.  It's here rather than in MeshFile.cpp so that tools (and
+    BenchmarkMeshLoading(...), which damages one on purpose) can find their way around a file.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct MeshFileHeader
+{
+    char magic[4];
+    uint32_t fileVersion;
+    uint32_t vertexFormat;      // a VertexFormat
+    uint32_t bytesPerVertex;    // so a file from a build with different formats is rejected
+    uint32_t numVertices;
+    uint32_t numIndices;
+    uint32_t bytesPerIndex;     // 1, 2, or 4, whatever is the fewest for the vertex count
+    uint32_t reserved;
+    uint64_t vertexOffset;      // bytes from the start of the file
+    uint64_t indexOffset;
+    float quantizationScale;    // see PositionQuantization
+    float quantizationBias[3];
+    float radius;
+    float packedCenter[3];      // see PackedMesh
+    float packedRadius;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A mesh file that is already in the GPU's layout: a small header, and then the vertices
+    (packed into one of the VertexFormats) and the indices (as narrow as the vertex count
+    allows), each starting on a MESH_FILE_ALIGNMENT boundary.  Make one with
+    WriteMeshFile(...) or ConvertObjFile(...).
+
+    Open(...) maps the file (see MappedFile.h), checks the header, and makes one pass over the
+    indices to check that none is past the last vertex.  There's nothing to parse and nothing
+    to copy, so Mesh() points straight into the mapping, and
+    MultiDrawRenderer::AddMesh(...) uploads from there.  Loading a million vertices costs
+    about what copying them to the GPU does.
+
+    Note: Everything is little-endian, the same as x86/x64 memory, so the header is read and
+    written as a plain struct (like DdsFile.cpp does).
+    Also Note: The mesh must be used (uploaded) before the MeshFile is closed or destroyed.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class MeshFile
+{
+public:
+    MeshFile();
+
+    bool Open(const char *filePath);
+    void Close();
+
+    bool IsOpen() const;
+    const PackedMesh &Mesh() const;
+
+    // where the vertices and indices start in the file, so that they're just as aligned
+    // once they're mapped
+    static const unsigned int MESH_FILE_ALIGNMENT = 64;
+
+private:
+    MeshFile(const MeshFile &);
+    MeshFile &operator=(const MeshFile &);
+
+    MappedFile _mapping;
+    PackedMesh _mesh;
+};
+
+bool WriteMeshFile(const char *filePath, const MeshData &mesh, VertexFormat format);
+bool ReadObjFile(const char *filePath, MeshData *mesh);
+bool ConvertObjFile(const char *objFilePath, const char *meshFilePath, VertexFormat format);
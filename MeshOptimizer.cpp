@@ -0,0 +1,477 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>    // std::stable_sort(...)
+#include <math.h>
+
+// a vertex or triangle that isn't one
+static const unsigned int NO_INDEX = 0xFFFFFFFF;
+
+// clusters may be split as long as the cache doesn't get more than this much worse (see
+// OptimizeOverdraw(...))
+static const float OVERDRAW_CACHE_THRESHOLD = 1.05f;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Runs some triangles through a FIFO cache without moving anything around.  A vertex is in
+    the cache if fewer than cacheSize misses have happened since it went in, so the cache is
+    just a time stamp per vertex and "flushing" it is moving time far enough ahead.
+
+    This is the same cache that the optimizer itself assumes (see OptimizeVertexCache(...)).
+Parameters:
+    indices         The triangles.
+    firstTriangle   Where to start.
+    endTriangle     One past where to stop.
+    cacheSize       How many vertices fit.
+    cacheTimes      One per vertex.  When each went in the cache.
+    time            How many misses so far (plus a head start).  Goes up with each miss.
+Returns:
+    How many misses.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static unsigned int CountFifoMisses(const std::vector<unsigned int> &indices,
+    unsigned int firstTriangle, unsigned int endTriangle, unsigned int cacheSize,
+    std::vector<unsigned int> *cacheTimes, unsigned int *time)
+{
+    unsigned int numMisses = 0;
+    for (size_t indexCount = (size_t)firstTriangle * 3; indexCount < (size_t)endTriangle * 3;
+        indexCount++)
+    {
+        unsigned int vertex = indices[indexCount];
+        if (*time - (*cacheTimes)[vertex] > cacheSize)
+        {
+            (*cacheTimes)[vertex] = *time;
+            (*time)++;
+            numMisses++;
+        }
+    }
+
+    return numMisses;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Counts how many times the vertex shader would run for an index buffer on a GPU with a
+    vertex cache of the given size and kind.  This is how the optimizer's results are
+    measured, and it only needs the CPU.
+Parameters:
+    indices     Every 3 are a triangle.
+    numVertices How many vertices the indices index (one past the biggest index).
+    cacheSize   How many vertices the cache holds.  At least 1.
+    type        FIFO or LRU.
+Returns:
+    The counts and ratios.  Both ratios are 0 for no triangles.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+VertexCacheStats SimulateVertexCache(const std::vector<unsigned int> &indices,
+    size_t numVertices, unsigned int cacheSize, VertexCacheType type)
+{
+    VertexCacheStats stats = { 0, 0, 0, 0.0f, 0.0f };
+    stats.numTriangles = (unsigned int)(indices.size() / 3);
+    cacheSize = (cacheSize < 1) ? 1 : cacheSize;
+
+    std::vector<bool> isUsed(numVertices, false);
+    for (size_t indexCount = 0; indexCount < stats.numTriangles * 3; indexCount++)
+    {
+        if (!isUsed[indices[indexCount]])
+        {
+            isUsed[indices[indexCount]] = true;
+            stats.numVertices++;
+        }
+    }
+
+    if (type == VERTEX_CACHE_FIFO)
+    {
+        std::vector<unsigned int> cacheTimes(numVertices, 0);
+        unsigned int time = cacheSize + 1;
+        stats.numTransforms = CountFifoMisses(indices, 0, stats.numTriangles, cacheSize,
+            &cacheTimes, &time);
+    }
+    else
+    {
+        // most recent first
+        // Note: Searching it every time is slow for a big cache, but real ones are small.
+        std::vector<unsigned int> cache;
+        cache.reserve(cacheSize + 1);
+        for (size_t indexCount = 0; indexCount < stats.numTriangles * 3; indexCount++)
+        {
+            unsigned int vertex = indices[indexCount];
+            std::vector<unsigned int>::iterator found =
+                std::find(cache.begin(), cache.end(), vertex);
+            if (found == cache.end())
+            {
+                stats.numTransforms++;
+                if (cache.size() == cacheSize)
+                {
+                    cache.pop_back();
+                }
+                cache.insert(cache.begin(), vertex);
+            }
+            else
+            {
+                std::rotate(cache.begin(), found, found + 1);
+            }
+        }
+    }
+
+    if (stats.numTriangles > 0)
+    {
+        stats.acmr = (float)stats.numTransforms / stats.numTriangles;
+        stats.atvr = (float)stats.numTransforms / stats.numVertices;
+    }
+    return stats;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Reorders triangles so that the vertices they share are still in the GPU's post-transform
+    cache when they're needed again.  This is Tipsify (Sander, Nehab, and Barczak, "Fast
+    Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007): it draws every
+    remaining triangle around one vertex (a fan), and then picks the next vertex to fan
+    around from the ones that were just used, preferring the oldest one that will still be in
+    the cache once its own fan is done.  When none of them have triangles left it backs up to
+    a recently used vertex that does, and only when there are none of those does it jump
+    somewhere else in the mesh.
+
+    It runs in time proportional to the number of indices (no sorting or scoring of every
+    triangle, like Forsyth's), so it's cheap enough to run on every mesh as it's loaded.
+
+    Note: Those jumps empty the cache, so they're where the overdraw pass is allowed to move
+    things around (see OptimizeOverdraw(...)), and each one starts a new cluster.
+Parameters:
+    indices         Every 3 are a triangle.
+    numVertices     One past the biggest index.
+    cacheSize       The cache size to aim for (see OPTIMIZER_CACHE_SIZE).
+    optimized       Gets the same triangles in the new order.  Not the same as indices.
+    clusterStarts   Gets the first triangle of each cluster, starting with 0.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void OptimizeVertexCache(const std::vector<unsigned int> &indices, size_t numVertices,
+    unsigned int cacheSize, std::vector<unsigned int> *optimized,
+    std::vector<unsigned int> *clusterStarts)
+{
+    unsigned int numTriangles = (unsigned int)(indices.size() / 3);
+    optimized->clear();
+    optimized->reserve(numTriangles * 3);
+    clusterStarts->clear();
+    clusterStarts->push_back(0);
+    if (numTriangles == 0)
+    {
+        return;
+    }
+
+    // every vertex's triangles, back to back, and how many of them haven't been drawn yet
+    std::vector<unsigned int> numLiveTriangles(numVertices, 0);
+    for (size_t indexCount = 0; indexCount < numTriangles * 3; indexCount++)
+    {
+        numLiveTriangles[indices[indexCount]]++;
+    }
+    std::vector<unsigned int> firstAdjacent(numVertices + 1, 0);
+    for (size_t vertexCount = 0; vertexCount < numVertices; vertexCount++)
+    {
+        firstAdjacent[vertexCount + 1] = firstAdjacent[vertexCount] +
+            numLiveTriangles[vertexCount];
+    }
+    std::vector<unsigned int> adjacentTriangles(numTriangles * 3);
+    std::vector<unsigned int> nextAdjacent(firstAdjacent.begin(), firstAdjacent.end() - 1);
+    for (size_t indexCount = 0; indexCount < numTriangles * 3; indexCount++)
+    {
+        adjacentTriangles[nextAdjacent[indices[indexCount]]++] =
+            (unsigned int)(indexCount / 3);
+    }
+
+    std::vector<unsigned int> cacheTimes(numVertices, 0);
+    unsigned int time = cacheSize + 1;
+    std::vector<bool> isDrawn(numTriangles, false);
+    std::vector<unsigned int> deadEnds;
+    std::vector<unsigned int> candidates;
+    unsigned int nextUnusedVertex = 0;
+    unsigned int fanVertex = 0;
+    while (fanVertex != NO_INDEX)
+    {
+        // draw everything around this vertex
+        candidates.clear();
+        for (unsigned int adjacentCount = firstAdjacent[fanVertex];
+            adjacentCount < firstAdjacent[fanVertex + 1]; adjacentCount++)
+        {
+            unsigned int triangle = adjacentTriangles[adjacentCount];
+            if (isDrawn[triangle])
+            {
+                continue;
+            }
+            for (int cornerCount = 0; cornerCount < 3; cornerCount++)
+            {
+                unsigned int vertex = indices[(triangle * 3) + cornerCount];
+                optimized->push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                numLiveTriangles[vertex]--;
+                if (time - cacheTimes[vertex] > cacheSize)
+                {
+                    cacheTimes[vertex] = time;
+                    time++;
+                }
+            }
+            isDrawn[triangle] = true;
+        }
+
+        // the oldest vertex that will still be in the cache after its fan, or failing that, any
+        // with triangles left
+        // Note: A fan of N triangles adds about 2N vertices to the cache.
+        fanVertex = NO_INDEX;
+        int bestPriority = -1;
+        for (size_t candidateCount = 0; candidateCount < candidates.size(); candidateCount++)
+        {
+            unsigned int vertex = candidates[candidateCount];
+            if (numLiveTriangles[vertex] == 0)
+            {
+                continue;
+            }
+            int priority = 0;
+            if (time - cacheTimes[vertex] + (2 * numLiveTriangles[vertex]) <= cacheSize)
+            {
+                priority = (int)(time - cacheTimes[vertex]);
+            }
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fanVertex = vertex;
+            }
+        }
+
+        // dead end, so back up, or jump to the next vertex that's never been drawn
+        if (fanVertex == NO_INDEX)
+        {
+            while (!deadEnds.empty() && (fanVertex == NO_INDEX))
+            {
+                unsigned int vertex = deadEnds.back();
+                deadEnds.pop_back();
+                fanVertex = (numLiveTriangles[vertex] > 0) ? vertex : NO_INDEX;
+            }
+            while ((fanVertex == NO_INDEX) && (nextUnusedVertex < numVertices))
+            {
+                if (numLiveTriangles[nextUnusedVertex] > 0)
+                {
+                    fanVertex = nextUnusedVertex;
+                }
+                nextUnusedVertex++;
+            }
+            if ((fanVertex != NO_INDEX) && (time - cacheTimes[fanVertex] > cacheSize) &&
+                (optimized->size() > 0))
+            {
+                clusterStarts->push_back((unsigned int)(optimized->size() / 3));
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Reorders the clusters that OptimizeVertexCache(...) made so that the ones facing out from
+    the middle of the mesh are drawn first.  Those are the ones most likely to be in front,
+    so the ones behind them fail the depth test instead of being shaded and then drawn over
+    (overdraw).  The triangles inside a cluster keep their order, so the vertex cache barely
+    notices.
+
+    This is the second half of Sander, Nehab, and Barczak's paper.  First the clusters are
+    split up more wherever starting over with an empty cache wouldn't make the cluster's
+    ACMR more than threshold times worse, since smaller clusters sort better.  Then each one
+    is given its (area-weighted) center and normal, and they're sorted by how far the center
+    is in front of the mesh's center along the normal.
+
+    Note: A flat mesh has every cluster facing the same way through the middle, so its order
+    doesn't change (and it couldn't overdraw itself anyway).
+Parameters:
+    vertices        The mesh's vertices, for the positions.
+    clusterStarts   From OptimizeVertexCache(...).
+    cacheSize       Same as OptimizeVertexCache(...).
+    threshold       How much worse (1.05 is 5%) a cluster's ACMR is allowed to get from
+                    splitting it.  1 only uses the clusters as they are.
+    indices         From OptimizeVertexCache(...).  Reordered in place.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void OptimizeOverdraw(const std::vector<MeshVertex> &vertices,
+    const std::vector<unsigned int> &clusterStarts, unsigned int cacheSize, float threshold,
+    std::vector<unsigned int> *indices)
+{
+    unsigned int numTriangles = (unsigned int)(indices->size() / 3);
+    if (numTriangles == 0)
+    {
+        return;
+    }
+
+    // split the clusters where the cache can take it
+    std::vector<unsigned int> starts;
+    std::vector<unsigned int> cacheTimes(vertices.size(), 0);
+    unsigned int time = cacheSize + 1;
+    for (size_t clusterCount = 0; clusterCount < clusterStarts.size(); clusterCount++)
+    {
+        unsigned int first = clusterStarts[clusterCount];
+        unsigned int end = (clusterCount + 1 < clusterStarts.size()) ?
+            clusterStarts[clusterCount + 1] : numTriangles;
+        time += cacheSize + 1;
+        float clusterAcmr = (float)CountFifoMisses(*indices, first, end, cacheSize,
+            &cacheTimes, &time) / (end - first);
+
+        starts.push_back(first);
+        time += cacheSize + 1;
+        unsigned int numMisses = 0;
+        unsigned int numClusterTriangles = 0;
+        for (unsigned int triangle = first; triangle + 1 < end; triangle++)
+        {
+            numMisses += CountFifoMisses(*indices, triangle, triangle + 1, cacheSize,
+                &cacheTimes, &time);
+            numClusterTriangles++;
+            if ((float)numMisses / numClusterTriangles <= clusterAcmr * threshold)
+            {
+                starts.push_back(triangle + 1);
+                time += cacheSize + 1;
+                numMisses = 0;
+                numClusterTriangles = 0;
+            }
+        }
+    }
+
+    // each cluster's center and which way it faces, and the mesh's center
+    struct Cluster
+    {
+        unsigned int first;
+        unsigned int end;
+        float center[3];
+        float normal[3];
+        float sortKey;
+    };
+    std::vector<Cluster> clusters(starts.size());
+    float meshCenter[3] = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+    for (size_t clusterCount = 0; clusterCount < starts.size(); clusterCount++)
+    {
+        Cluster &cluster = clusters[clusterCount];
+        cluster.first = starts[clusterCount];
+        cluster.end = (clusterCount + 1 < starts.size()) ? starts[clusterCount + 1] :
+            numTriangles;
+        float area = 0.0f;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            cluster.center[axis] = 0.0f;
+            cluster.normal[axis] = 0.0f;
+        }
+        for (unsigned int triangle = cluster.first; triangle < cluster.end; triangle++)
+        {
+            const float *a = vertices[(*indices)[triangle * 3]].pos;
+            const float *b = vertices[(*indices)[(triangle * 3) + 1]].pos;
+            const float *c = vertices[(*indices)[(triangle * 3) + 2]].pos;
+            float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            float normal[3] =
+            {
+                (ab[1] * ac[2]) - (ab[2] * ac[1]),
+                (ab[2] * ac[0]) - (ab[0] * ac[2]),
+                (ab[0] * ac[1]) - (ab[1] * ac[0]),
+            };
+            float triangleArea = 0.5f * sqrtf((normal[0] * normal[0]) +
+                (normal[1] * normal[1]) + (normal[2] * normal[2]));
+            for (int axis = 0; axis < 3; axis++)
+            {
+                cluster.center[axis] += triangleArea * (a[axis] + b[axis] + c[axis]) / 3.0f;
+                cluster.normal[axis] += normal[axis];
+            }
+            area += triangleArea;
+        }
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            meshCenter[axis] += cluster.center[axis];
+            cluster.center[axis] = (area > 0.0f) ? (cluster.center[axis] / area) : 0.0f;
+        }
+        meshArea += area;
+    }
+    for (int axis = 0; axis < 3; axis++)
+    {
+        meshCenter[axis] = (meshArea > 0.0f) ? (meshCenter[axis] / meshArea) : 0.0f;
+    }
+
+    for (size_t clusterCount = 0; clusterCount < clusters.size(); clusterCount++)
+    {
+        Cluster &cluster = clusters[clusterCount];
+        const float *n = cluster.normal;
+        float length = sqrtf((n[0] * n[0]) + (n[1] * n[1]) + (n[2] * n[2]));
+        cluster.sortKey = 0.0f;
+        for (int axis = 0; (axis < 3) && (length > 0.0f); axis++)
+        {
+            cluster.sortKey += (cluster.center[axis] - meshCenter[axis]) * n[axis] / length;
+        }
+    }
+
+    // most outward first, and otherwise keep the order (which is the cache's)
+    std::stable_sort(clusters.begin(), clusters.end(),
+        [](const Cluster &a, const Cluster &b) { return a.sortKey > b.sortKey; });
+    std::vector<unsigned int> sorted;
+    sorted.reserve(indices->size());
+    for (size_t clusterCount = 0; clusterCount < clusters.size(); clusterCount++)
+    {
+        const Cluster &cluster = clusters[clusterCount];
+        sorted.insert(sorted.end(), indices->begin() + (cluster.first * 3),
+            indices->begin() + (cluster.end * 3));
+    }
+    indices->swap(sorted);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Puts the vertices in the order that the triangles first use them, so that the GPU reads
+    the vertex buffer mostly front to back instead of jumping around in it, and renumbers the
+    indices to match.  Do this last, since it follows whatever order the triangles are in.
+
+    Note: Vertices that no triangle uses are dropped.
+Parameters:
+    mesh    Its vertices and indices are both changed.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void OptimizeVertexFetch(MeshData *mesh)
+{
+    std::vector<unsigned int> newIndices(mesh->vertices.size(), NO_INDEX);
+    std::vector<MeshVertex> vertices;
+    vertices.reserve(mesh->vertices.size());
+    for (size_t indexCount = 0; indexCount < mesh->indices.size(); indexCount++)
+    {
+        unsigned int &index = mesh->indices[indexCount];
+        if (newIndices[index] == NO_INDEX)
+        {
+            newIndices[index] = (unsigned int)vertices.size();
+            vertices.push_back(mesh->vertices[index]);
+        }
+        index = newIndices[index];
+    }
+    mesh->vertices.swap(vertices);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The whole pipeline, for a mesh that's about to go to the GPU: triangles for the vertex
+    cache, then clusters of them for overdraw, then vertices for fetching.  What it looks
+    like doesn't change.
+Parameters:
+    mesh    Reordered in place.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void OptimizeMesh(MeshData *mesh)
+{
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> clusterStarts;
+    OptimizeVertexCache(mesh->indices, mesh->vertices.size(), OPTIMIZER_CACHE_SIZE, &indices,
+        &clusterStarts);
+    OptimizeOverdraw(mesh->vertices, clusterStarts, OPTIMIZER_CACHE_SIZE,
+        OVERDRAW_CACHE_THRESHOLD, &indices);
+    mesh->indices.swap(indices);
+    OptimizeVertexFetch(mesh);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Mesh.h"
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Which kind of post-transform vertex cache SimulateVertexCache(...) pretends the GPU has.
+    Real GPUs are somewhere in between (and don't say), so the optimizer is measured against
+    both.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+enum VertexCacheType
+{
+    VERTEX_CACHE_FIFO = 0,  // a hit doesn't keep a vertex around any longer
+    VERTEX_CACHE_LRU,       // a hit moves it to the front
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How well an index order uses a vertex cache.  Every miss is another run of the vertex
+    shader (a "transform").
+
+    ACMR (average cache miss ratio) is transforms per triangle: 3 is the worst (nothing
+    shared) and a big regular grid can get close to 0.5.  ATVR (average transform to vertex
+    ratio) is transforms per vertex, and 1 (every vertex transformed exactly once) is the
+    best there is, which makes it easier to compare between meshes.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct VertexCacheStats
+{
+    unsigned int numTriangles;
+    unsigned int numVertices;       // different vertices that the triangles use
+    unsigned int numTransforms;     // cache misses
+    float acmr;
+    float atvr;
+};
+
+// the cache size that the optimizer aims for
+// Note: Too small only costs a little.  Too big thrashes on a GPU with a smaller cache, so
+// this errs small.
+static const unsigned int OPTIMIZER_CACHE_SIZE = 16;
+
+VertexCacheStats SimulateVertexCache(const std::vector<unsigned int> &indices,
+    size_t numVertices, unsigned int cacheSize, VertexCacheType type);
+void OptimizeVertexCache(const std::vector<unsigned int> &indices, size_t numVertices,
+    unsigned int cacheSize, std::vector<unsigned int> *optimized,
+    std::vector<unsigned int> *clusterStarts);
+void OptimizeOverdraw(const std::vector<MeshVertex> &vertices,
+    const std::vector<unsigned int> &clusterStarts, unsigned int cacheSize, float threshold,
+    std::vector<unsigned int> *indices);
+void OptimizeVertexFetch(MeshData *mesh);
+void OptimizeMesh(MeshData *mesh);
@@ -0,0 +1,269 @@
+#include "glload/include/glload/gl_4_4.h"
+
+#include "MeshPacking.h"
+
+#include <string.h>     // memcpy(...)
+
+// a vertex that isn't in the meshlet yet
+static const unsigned int NO_INDEX = 0xFFFFFFFF;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple lookup.
+Parameters:
+    width   One of the IndexWidth values (not INDEX_WIDTH_COUNT).
+Returns:
+    1, 2, or 4.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int BytesPerIndex(IndexWidth width)
+{
+    static const unsigned int BYTES_PER_INDEX[INDEX_WIDTH_COUNT] =
+    {
+        sizeof(GLubyte), sizeof(GLushort), sizeof(GLuint)
+    };
+    return BYTES_PER_INDEX[width];
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple lookup.
+Parameters:
+    width   One of the IndexWidth values (not INDEX_WIDTH_COUNT).
+Returns:
+    The "type" that glDrawElements...(...) takes for these indices (ex: GL_UNSIGNED_SHORT).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int IndexType(IndexWidth width)
+{
+    static const GLenum INDEX_TYPES[INDEX_WIDTH_COUNT] =
+    {
+        GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_UNSIGNED_INT
+    };
+    return INDEX_TYPES[width];
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple lookup.
+Parameters:
+    width   One of the IndexWidth values (not INDEX_WIDTH_COUNT).
+Returns:
+    What to call it in printouts.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const char *IndexWidthName(IndexWidth width)
+{
+    static const char *INDEX_WIDTH_NAMES[INDEX_WIDTH_COUNT] = { "8-bit", "16-bit", "32-bit" };
+    return INDEX_WIDTH_NAMES[width];
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Picks the narrowest index that can reach every vertex of a mesh.
+Parameters:
+    numVertices     How many vertices the indices index.
+Returns:
+    The index width.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+IndexWidth ChooseIndexWidth(size_t numVertices)
+{
+    if (numVertices <= MAX_VERTICES_8_BIT_INDICES)
+    {
+        return INDEX_WIDTH_8;
+    }
+    else if (numVertices <= MAX_VERTICES_16_BIT_INDICES)
+    {
+        return INDEX_WIDTH_16;
+    }
+    return INDEX_WIDTH_32;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Copies 32-bit indices into narrower (or the same) ones.
+Parameters:
+    indices     The indices, every one small enough for the width (see ChooseIndexWidth(...)).
+    numIndices  How many.
+    width       What to write.
+    dest        Gets numIndices * BytesPerIndex(width) bytes.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void NarrowIndices(const unsigned int *indices, size_t numIndices, IndexWidth width,
+    void *dest)
+{
+    if (width == INDEX_WIDTH_8)
+    {
+        GLubyte *narrow = (GLubyte *)dest;
+        for (size_t indexCount = 0; indexCount < numIndices; indexCount++)
+        {
+            narrow[indexCount] = (GLubyte)indices[indexCount];
+        }
+    }
+    else if (width == INDEX_WIDTH_16)
+    {
+        GLushort *narrow = (GLushort *)dest;
+        for (size_t indexCount = 0; indexCount < numIndices; indexCount++)
+        {
+            narrow[indexCount] = (GLushort)indices[indexCount];
+        }
+    }
+    else
+    {
+        memcpy(dest, indices, numIndices * sizeof(GLuint));
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Gets a mesh ready for the arenas: packs the vertices into a vertex format (fit to the
+    mesh's own bounding box; see QuantizeVertices(...)), narrows the indices to the fewest
+    bytes that can reach every vertex, and works out the bounding spheres.
+
+    Note: Whatever is already in the right form isn't copied.  Float vertices and 32-bit
+    indices are pointed at right where they are in the mesh.
+Parameters:
+    mesh            Any number of vertices, and a multiple of 3 indices.
+    format          What to pack the vertices into.
+    vertexBytes     Gets the packed vertices, unless they're floats.
+    indexBytes      Gets the narrowed indices, unless they're 32 bits.
+    packedMesh      Points into mesh, vertexBytes, and indexBytes, so it is only good for as
+                    long as all three are.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void PackMesh(const MeshData &mesh, VertexFormat format,
+    std::vector<unsigned char> *vertexBytes, std::vector<unsigned char> *indexBytes,
+    PackedMesh *packedMesh)
+{
+    const MeshVertex *vertices = mesh.vertices.data();
+    size_t numVertices = mesh.vertices.size();
+    PositionQuantization noQuantization = { 1.0f, { 0.0f, 0.0f, 0.0f } };
+    PositionQuantization box = FitPositionQuantization(vertices, numVertices);
+
+    packedMesh->format = format;
+    packedMesh->numVertices = (unsigned int)numVertices;
+    packedMesh->numIndices = (unsigned int)mesh.indices.size();
+    packedMesh->indexWidth = ChooseIndexWidth(numVertices);
+    packedMesh->quantization = (format == VERTEX_FORMAT_FLOAT) ? noQuantization : box;
+    packedMesh->radius = BoundingRadius(vertices, numVertices, noQuantization);
+
+    // the sphere is around the middle of the box, in the packing's units
+    const PositionQuantization &quantization = packedMesh->quantization;
+    PositionQuantization sphere = box;
+    sphere.scale = quantization.scale;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        packedMesh->packedCenter[axis] =
+            (box.bias[axis] - quantization.bias[axis]) / quantization.scale;
+    }
+    packedMesh->packedRadius = BoundingRadius(vertices, numVertices, sphere);
+
+    if (format == VERTEX_FORMAT_FLOAT)
+    {
+        packedMesh->vertices = vertices;
+    }
+    else
+    {
+        vertexBytes->resize(numVertices * GetVertexFormatDescription(format).bytesPerVertex);
+        QuantizeVertices(vertices, numVertices, format, quantization, vertexBytes->data());
+        packedMesh->vertices = vertexBytes->data();
+    }
+
+    if (packedMesh->indexWidth == INDEX_WIDTH_32)
+    {
+        packedMesh->indices = mesh.indices.data();
+    }
+    else
+    {
+        indexBytes->resize(mesh.indices.size() * BytesPerIndex(packedMesh->indexWidth));
+        NarrowIndices(mesh.indices.data(), mesh.indices.size(), packedMesh->indexWidth,
+            indexBytes->data());
+        packedMesh->indices = indexBytes->data();
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Cuts a mesh into pieces ("meshlets") of no more than so many vertices each, so that each
+    one can have narrower indices than the whole mesh could and a bounding sphere of its own
+    for culling.  A mesh of any size can then be drawn with 16-bit (or 8-bit) indices.
+
+    The triangles are taken in order, and a meshlet is finished when the next triangle would
+    take it past the limit.  The vertices that each meshlet uses are copied into it (in the
+    order they're first used, which is the order that the GPU fetches them), so a vertex on
+    the edge between two meshlets is in both.  Run OptimizeMesh(...) first, so that each run
+    of triangles is a compact patch of the mesh instead of a long strip across it, which
+    makes for fewer of those duplicates and tighter bounds.
+Parameters:
+    mesh            Any number of vertices, and a multiple of 3 indices.
+    maxVertices     The most vertices per meshlet (ex: MAX_VERTICES_16_BIT_INDICES).  At
+                    least 3.
+    meshlets        Gets the meshlets, each with its own vertices and indices.  Just one if
+                    the mesh is already small enough.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void SplitIntoMeshlets(const MeshData &mesh, unsigned int maxVertices,
+    std::vector<MeshData> *meshlets)
+{
+    meshlets->clear();
+    maxVertices = (maxVertices < 3) ? 3 : maxVertices;
+
+    // each of the mesh's vertices' index in the meshlet so far, and which of them those are
+    std::vector<unsigned int> meshletIndices(mesh.vertices.size(), NO_INDEX);
+    std::vector<unsigned int> meshletVertices;
+    MeshData meshlet;
+    size_t numTriangles = mesh.indices.size() / 3;
+    for (size_t triangleCount = 0; triangleCount <= numTriangles; triangleCount++)
+    {
+        // Note: One past the last triangle finishes the last meshlet.
+        const unsigned int *corners = mesh.indices.data() + (triangleCount * 3);
+        unsigned int numNewVertices = 0;
+        if (triangleCount < numTriangles)
+        {
+            numNewVertices = (meshletIndices[corners[0]] == NO_INDEX) ? 1 : 0;
+            numNewVertices += ((meshletIndices[corners[1]] == NO_INDEX) &&
+                (corners[1] != corners[0])) ? 1 : 0;
+            numNewVertices += ((meshletIndices[corners[2]] == NO_INDEX) &&
+                (corners[2] != corners[0]) && (corners[2] != corners[1])) ? 1 : 0;
+        }
+        bool isFull = (meshlet.vertices.size() + numNewVertices > maxVertices);
+        if ((isFull || (triangleCount == numTriangles)) && !meshlet.indices.empty())
+        {
+            for (size_t vertexCount = 0; vertexCount < meshletVertices.size(); vertexCount++)
+            {
+                meshletIndices[meshletVertices[vertexCount]] = NO_INDEX;
+            }
+            meshletVertices.clear();
+            meshlets->push_back(MeshData());
+            meshlets->back().vertices.swap(meshlet.vertices);
+            meshlets->back().indices.swap(meshlet.indices);
+        }
+        if (triangleCount == numTriangles)
+        {
+            break;
+        }
+
+        for (int cornerCount = 0; cornerCount < 3; cornerCount++)
+        {
+            unsigned int vertex = corners[cornerCount];
+            if (meshletIndices[vertex] == NO_INDEX)
+            {
+                meshletIndices[vertex] = (unsigned int)meshlet.vertices.size();
+                meshletVertices.push_back(vertex);
+                meshlet.vertices.push_back(mesh.vertices[vertex]);
+            }
+            meshlet.indices.push_back(meshletIndices[vertex]);
+        }
+    }
+}
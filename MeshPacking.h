@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Mesh.h"
+#include "VertexQuantizer.h"
+
+#include <stddef.h>
+#include <vector>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How big each index is.  An index only has to count up to the mesh's last vertex, so a
+    mesh with 200 vertices needs 1 byte per index and one with 60,000 needs 2, and 4 is only
+    for meshes bigger than that (see ChooseIndexWidth(...)).  Every index is read by the GPU
+    every time the mesh is drawn, so the narrower the better.
+
+    Note: 8-bit indices are OpenGL's GL_UNSIGNED_BYTE.  Some drivers quietly widen them to 16
+    bits before the GPU sees them, so they save memory more surely than they save time.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+enum IndexWidth
+{
+    INDEX_WIDTH_8 = 0,      // up to 256 vertices
+    INDEX_WIDTH_16,         // up to 65,536
+    INDEX_WIDTH_32,         // any number
+    INDEX_WIDTH_COUNT,
+};
+
+// the most vertices that each index width can reach
+static const unsigned int MAX_VERTICES_8_BIT_INDICES = 256;
+static const unsigned int MAX_VERTICES_16_BIT_INDICES = 65536;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A mesh whose vertices and indices are already packed, in exactly the bytes that go in the
+    arenas, plus what the renderer needs to know about them.  It only points at the vertices
+    and indices, which live somewhere else (ex: a mapped file; see MeshFile.h).
+
+    The bounding sphere is in packed units, so that a draw's instance can scale and move it
+    like the mesh itself (see MultiDrawRenderer::Draw(...)).  Its center is the middle of the
+    mesh's bounding box, which is always 0 for the quantized formats (the bias is the box's
+    middle) but not for floats, which aren't moved.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct PackedMesh
+{
+    VertexFormat format;
+    const void *vertices;
+    unsigned int numVertices;
+    const void *indices;
+    unsigned int numIndices;
+    IndexWidth indexWidth;
+    PositionQuantization quantization;
+    float radius;               // the farthest vertex from the mesh's origin
+    float packedCenter[3];      // the bounding sphere, in packed units
+    float packedRadius;
+};
+
+unsigned int BytesPerIndex(IndexWidth width);
+unsigned int IndexType(IndexWidth width);
+const char *IndexWidthName(IndexWidth width);
+IndexWidth ChooseIndexWidth(size_t numVertices);
+void NarrowIndices(const unsigned int *indices, size_t numIndices, IndexWidth width,
+    void *dest);
+
+void PackMesh(const MeshData &mesh, VertexFormat format,
+    std::vector<unsigned char> *vertexBytes, std::vector<unsigned char> *indexBytes,
+    PackedMesh *packedMesh);
+void SplitIntoMeshlets(const MeshData &mesh, unsigned int maxVertices,
+    std::vector<MeshData> *meshlets);
@@ -0,0 +1,867 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+
+#include <algorithm>    // std::sort(...)
+#include <utility>      // std::move(...)
+#include <float.h>
+#include <math.h>
+
+// a vertex that isn't one
+static const unsigned int NO_INDEX = 0xFFFFFFFF;
+
+// how much an open edge's plane counts for, compared to a triangle's of about the same size
+// (see AddQuadrics(...))
+static const double BORDER_WEIGHT = 10.0;
+
+// how far past the cost of the collapses that would reach the target a pass goes (see
+// SimplifyMesh(...))
+static const double PASS_COST_SCALE = 2.25;
+
+// and if a pass doesn't manage at least 1 / this of the collapses that it needs, it goes past
+// that cost
+static const size_t MIN_PASS_FRACTION = 8;
+
+// each level of detail aims for this much of the one before it, and the chain ends once a
+// level doesn't get at least this much smaller (ex: all that's left is seams and borders) or
+// is down to this many triangles
+static const float LOD_TRIANGLE_RATIO = 0.5f;
+static const float LOD_MIN_REDUCTION = 0.8f;
+static const unsigned int LOD_MIN_TRIANGLES = 8;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How a vertex is allowed to move.  The simplifier only ever collapses a vertex onto one of
+    its neighbors (see SimplifyMesh(...)), so this is about which neighbors.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+enum VertexKind
+{
+    VERTEX_KIND_MANIFOLD = 0,   // triangles all the way around; any neighbor
+    VERTEX_KIND_BORDER,         // on an open edge; only along that edge
+    VERTEX_KIND_LOCKED,         // on a UV seam (more than one vertex at its position); none
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The sum of the squared distances from a point to a set of planes, as a symmetric 4x4
+    matrix (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics", 1997).
+    Each vertex starts with the planes of the triangles around it, and when it collapses onto
+    another vertex, that vertex gets its planes too, so the error of a collapse is how far the
+    new spot is from every triangle that was ever merged into it.
+
+    Note: Each plane is weighted by its triangle's area, and the error is divided by the total
+    weight, so that it's an average squared distance (in the mesh's units squared) instead of
+    something that grows with the number of triangles.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct Quadric
+{
+    // the upper triangle of the matrix: xx, xy, xz, xw, yy, yz, yw, zz, zw, ww
+    double m[10];
+    double weight;
+};
+
+// one way that an edge could collapse: the first vertex onto the second
+struct Collapse
+{
+    unsigned int from;
+    unsigned int to;
+    double cost;        // squared (see Quadric)
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Everything that the simplifier's passes share.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct SimplifierState
+{
+    const std::vector<MeshVertex> *vertices;
+
+    // the first vertex with the same position as each vertex (vertices on a UV seam have the
+    // same position but different texture coordinates), and what each vertex is allowed to do
+    std::vector<unsigned int> positionIds;
+    std::vector<unsigned char> kinds;
+    std::vector<Quadric> quadrics;
+
+    // the triangles so far, and the ones around each vertex (the ones for vertex N are
+    // vertexTriangles[triangleStarts[N]] up to vertexTriangles[triangleStarts[N + 1]])
+    // Note: The lists are only rebuilt between passes, so during a pass, some of the
+    // triangles have collapsed down to lines (two corners the same).
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> triangleStarts;
+    std::vector<unsigned int> vertexTriangles;
+
+    // vertices that changed in this pass, whose collapses' costs are out of date
+    std::vector<unsigned char> isTouched;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Adds a plane (ax + by + cz + d = 0, with (a, b, c) 1 long) to a quadric.
+Parameters:
+    a, b, c, d  The plane.
+    weight      How much it counts.
+    quadric     Gets the plane.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void AddPlane(double a, double b, double c, double d, double weight, Quadric *quadric)
+{
+    quadric->m[0] += weight * a * a;
+    quadric->m[1] += weight * a * b;
+    quadric->m[2] += weight * a * c;
+    quadric->m[3] += weight * a * d;
+    quadric->m[4] += weight * b * b;
+    quadric->m[5] += weight * b * c;
+    quadric->m[6] += weight * b * d;
+    quadric->m[7] += weight * c * c;
+    quadric->m[8] += weight * c * d;
+    quadric->m[9] += weight * d * d;
+    quadric->weight += weight;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How far a point is from the planes of two quadrics together (the two ends of an edge),
+    without adding them up first.
+Parameters:
+    first   One end's quadric.
+    second  The other's.
+    pos     Where the merged vertex would be.
+Returns:
+    The average squared distance (see Quadric).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static double QuadricError(const Quadric &first, const Quadric &second, const float *pos)
+{
+    double m[10];
+    for (int termCount = 0; termCount < 10; termCount++)
+    {
+        m[termCount] = first.m[termCount] + second.m[termCount];
+    }
+    double weight = first.weight + second.weight;
+    double x = pos[0];
+    double y = pos[1];
+    double z = pos[2];
+    double error = (m[0] * x * x) + (2.0 * m[1] * x * y) + (2.0 * m[2] * x * z) +
+        (2.0 * m[3] * x) + (m[4] * y * y) + (2.0 * m[5] * y * z) + (2.0 * m[6] * y) +
+        (m[7] * z * z) + (2.0 * m[8] * z) + m[9];
+
+    // Note: It can't really be negative, but rounding can make it a tiny bit less than 0.
+    return (weight > 0.0) ? std::max(error, 0.0) / weight : 0.0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The (not normalized) normal of a triangle, counterclockwise.
+Parameters:
+    a, b, c     The corners' positions.
+    normal      Gets 3 doubles, twice the triangle's area long.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void TriangleNormal(const float *a, const float *b, const float *c, double *normal)
+{
+    double ab[3] = { (double)b[0] - a[0], (double)b[1] - a[1], (double)b[2] - a[2] };
+    double ac[3] = { (double)c[0] - a[0], (double)c[1] - a[1], (double)c[2] - a[2] };
+    normal[0] = (ab[1] * ac[2]) - (ab[2] * ac[1]);
+    normal[1] = (ab[2] * ac[0]) - (ab[0] * ac[2]);
+    normal[2] = (ab[0] * ac[1]) - (ab[1] * ac[0]);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Finds the vertices that are at the same position, by sorting them by position.
+Parameters:
+    vertices        The mesh's vertices.
+    positionIds     Gets, for each vertex, the lowest-numbered vertex at its position.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void FindPositionIds(const std::vector<MeshVertex> &vertices,
+    std::vector<unsigned int> *positionIds)
+{
+    std::vector<unsigned int> sorted(vertices.size());
+    for (size_t vertexCount = 0; vertexCount < sorted.size(); vertexCount++)
+    {
+        sorted[vertexCount] = (unsigned int)vertexCount;
+    }
+    auto samePosition = [&](unsigned int first, unsigned int second)
+    {
+        const float *firstPos = vertices[first].pos;
+        const float *secondPos = vertices[second].pos;
+        return (firstPos[0] == secondPos[0]) && (firstPos[1] == secondPos[1]) &&
+            (firstPos[2] == secondPos[2]);
+    };
+    std::sort(sorted.begin(), sorted.end(), [&](unsigned int first, unsigned int second)
+    {
+        const float *firstPos = vertices[first].pos;
+        const float *secondPos = vertices[second].pos;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (firstPos[axis] != secondPos[axis])
+            {
+                return firstPos[axis] < secondPos[axis];
+            }
+        }
+        return first < second;
+    });
+
+    positionIds->resize(vertices.size());
+    unsigned int positionId = 0;
+    for (size_t sortedCount = 0; sortedCount < sorted.size(); sortedCount++)
+    {
+        unsigned int vertex = sorted[sortedCount];
+        if ((sortedCount == 0) || !samePosition(vertex, sorted[sortedCount - 1]))
+        {
+            positionId = vertex;
+        }
+        (*positionIds)[vertex] = positionId;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Drops the triangles that have collapsed down to a line or a point.
+Parameters:
+    indices     The triangles.  Gets the ones that are left, in the same order.
+Returns:
+    How many triangles are left.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static size_t RemoveDegenerateTriangles(std::vector<unsigned int> *indices)
+{
+    size_t numKept = 0;
+    for (size_t indexCount = 0; indexCount + 2 < indices->size(); indexCount += 3)
+    {
+        unsigned int a = (*indices)[indexCount];
+        unsigned int b = (*indices)[indexCount + 1];
+        unsigned int c = (*indices)[indexCount + 2];
+        if ((a != b) && (b != c) && (c != a))
+        {
+            (*indices)[numKept++] = a;
+            (*indices)[numKept++] = b;
+            (*indices)[numKept++] = c;
+        }
+    }
+    indices->resize(numKept);
+    return numKept / 3;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Lists the triangles around each vertex (see SimplifierState), in two passes over the
+    indices: one to count them and one to fill them in.
+Parameters:
+    state   Has the triangles.  Gets the lists.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void BuildVertexTriangles(SimplifierState *state)
+{
+    const std::vector<unsigned int> &indices = state->indices;
+    std::vector<unsigned int> &triangleStarts = state->triangleStarts;
+    triangleStarts.assign(state->vertices->size() + 1, 0);
+    for (size_t indexCount = 0; indexCount < indices.size(); indexCount++)
+    {
+        triangleStarts[indices[indexCount] + 1]++;
+    }
+    for (size_t vertexCount = 1; vertexCount < triangleStarts.size(); vertexCount++)
+    {
+        triangleStarts[vertexCount] += triangleStarts[vertexCount - 1];
+    }
+
+    std::vector<unsigned int> nextSlots(triangleStarts.begin(), triangleStarts.end() - 1);
+    state->vertexTriangles.resize(indices.size());
+    for (size_t indexCount = 0; indexCount < indices.size(); indexCount++)
+    {
+        state->vertexTriangles[nextSlots[indices[indexCount]]++] =
+            (unsigned int)(indexCount / 3);
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether any triangle around a vertex has an edge from one position to another, in that
+    direction.
+Parameters:
+    state           The triangles.
+    vertex          The only vertex at one of the two positions, so that its triangles are
+                    every triangle that could have the edge.
+    fromPosition    Where the edge starts (see SimplifierState::positionIds).
+    toPosition      Where it ends.
+Returns:
+    True if one does.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static bool HasPositionEdge(const SimplifierState &state, unsigned int vertex,
+    unsigned int fromPosition, unsigned int toPosition)
+{
+    for (unsigned int slot = state.triangleStarts[vertex];
+        slot < state.triangleStarts[vertex + 1]; slot++)
+    {
+        const unsigned int *corners = &state.indices[state.vertexTriangles[slot] * 3];
+        for (int cornerCount = 0; cornerCount < 3; cornerCount++)
+        {
+            if ((state.positionIds[corners[cornerCount]] == fromPosition) &&
+                (state.positionIds[corners[(cornerCount + 1) % 3]] == toPosition))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether any triangle around a vertex has an edge from it to another vertex.
+Parameters:
+    state   The triangles.
+    from    Where the edge starts.
+    to      Where it ends.
+Returns:
+    True if one does.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static bool HasIndexEdge(const SimplifierState &state, unsigned int from, unsigned int to)
+{
+    for (unsigned int slot = state.triangleStarts[from]; slot < state.triangleStarts[from + 1];
+        slot++)
+    {
+        const unsigned int *corners = &state.indices[state.vertexTriangles[slot] * 3];
+        if (((corners[0] == from) && (corners[1] == to)) ||
+            ((corners[1] == from) && (corners[2] == to)) ||
+            ((corners[2] == from) && (corners[0] == to)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether an edge is open, meaning that there's a triangle on only one side of it.  Edges
+    are compared by position, so an edge along a UV seam isn't open.
+Parameters:
+    state   The triangles.
+    vertex  One end, and the only vertex at its position (so not VERTEX_KIND_LOCKED).
+    other   The other end.
+Returns:
+    True if it is.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static bool IsBorderEdge(const SimplifierState &state, unsigned int vertex, unsigned int other)
+{
+    unsigned int vertexPosition = state.positionIds[vertex];
+    unsigned int otherPosition = state.positionIds[other];
+    return !HasPositionEdge(state, vertex, vertexPosition, otherPosition) ||
+        !HasPositionEdge(state, vertex, otherPosition, vertexPosition);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Works out each vertex's kind (see VertexKind).  A vertex that shares its position with
+    another is on a UV seam, and it's locked so that the texture doesn't tear or stretch
+    along the seam.  Otherwise it's on a border if any of its edges is open.
+Parameters:
+    state   Has the triangles and position IDs.  Gets the kinds.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void ClassifyVertices(SimplifierState *state)
+{
+    size_t numVertices = state->vertices->size();
+    std::vector<unsigned int> numAtPosition(numVertices, 0);
+    for (size_t vertexCount = 0; vertexCount < numVertices; vertexCount++)
+    {
+        numAtPosition[state->positionIds[vertexCount]]++;
+    }
+
+    state->kinds.assign(numVertices, VERTEX_KIND_MANIFOLD);
+    for (unsigned int vertex = 0; vertex < numVertices; vertex++)
+    {
+        if (numAtPosition[state->positionIds[vertex]] > 1)
+        {
+            state->kinds[vertex] = VERTEX_KIND_LOCKED;
+            continue;
+        }
+        for (unsigned int slot = state->triangleStarts[vertex];
+            slot < state->triangleStarts[vertex + 1]; slot++)
+        {
+            const unsigned int *corners = &state->indices[state->vertexTriangles[slot] * 3];
+            for (int cornerCount = 0; cornerCount < 3; cornerCount++)
+            {
+                if ((corners[cornerCount] != vertex) &&
+                    IsBorderEdge(*state, vertex, corners[cornerCount]))
+                {
+                    state->kinds[vertex] = VERTEX_KIND_BORDER;
+                }
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts each vertex's quadric with the planes of the triangles around it.  Each open edge
+    also adds a plane through the edge that stands straight up from its triangle, to both of
+    its ends, so that sliding a border vertex anywhere but along the border costs a lot and
+    the mesh's outline keeps its shape.
+Parameters:
+    state   Has the triangles and kinds.  Gets the quadrics.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void AddQuadrics(SimplifierState *state)
+{
+    const std::vector<MeshVertex> &vertices = *state->vertices;
+    Quadric zero = {};
+    state->quadrics.assign(vertices.size(), zero);
+    for (size_t indexCount = 0; indexCount < state->indices.size(); indexCount += 3)
+    {
+        const unsigned int *corners = &state->indices[indexCount];
+        double normal[3];
+        TriangleNormal(vertices[corners[0]].pos, vertices[corners[1]].pos,
+            vertices[corners[2]].pos, normal);
+        double length = sqrt((normal[0] * normal[0]) + (normal[1] * normal[1]) +
+            (normal[2] * normal[2]));
+        if (length == 0.0)
+        {
+            continue;
+        }
+        for (int axis = 0; axis < 3; axis++)
+        {
+            normal[axis] /= length;
+        }
+        const float *pos = vertices[corners[0]].pos;
+        double d = -((normal[0] * pos[0]) + (normal[1] * pos[1]) + (normal[2] * pos[2]));
+        for (int cornerCount = 0; cornerCount < 3; cornerCount++)
+        {
+            AddPlane(normal[0], normal[1], normal[2], d, length * 0.5,
+                &state->quadrics[corners[cornerCount]]);
+        }
+
+        for (int cornerCount = 0; cornerCount < 3; cornerCount++)
+        {
+            // Note: An edge between two seam vertices can't be checked (neither one has all
+            // of the triangles at its position), but both ends are locked anyway.
+            unsigned int from = corners[cornerCount];
+            unsigned int to = corners[(cornerCount + 1) % 3];
+            unsigned int single = (state->kinds[from] != VERTEX_KIND_LOCKED) ? from :
+                ((state->kinds[to] != VERTEX_KIND_LOCKED) ? to : NO_INDEX);
+            if ((single == NO_INDEX) || HasPositionEdge(*state, single,
+                state->positionIds[to], state->positionIds[from]))
+            {
+                continue;
+            }
+
+            const float *fromPos = vertices[from].pos;
+            const float *toPos = vertices[to].pos;
+            double edge[3] =
+            {
+                (double)toPos[0] - fromPos[0], (double)toPos[1] - fromPos[1],
+                (double)toPos[2] - fromPos[2]
+            };
+            double edgeNormal[3] =
+            {
+                (edge[1] * normal[2]) - (edge[2] * normal[1]),
+                (edge[2] * normal[0]) - (edge[0] * normal[2]),
+                (edge[0] * normal[1]) - (edge[1] * normal[0])
+            };
+            double edgeLength = sqrt((edgeNormal[0] * edgeNormal[0]) +
+                (edgeNormal[1] * edgeNormal[1]) + (edgeNormal[2] * edgeNormal[2]));
+            if (edgeLength == 0.0)
+            {
+                continue;
+            }
+            for (int axis = 0; axis < 3; axis++)
+            {
+                edgeNormal[axis] /= edgeLength;
+            }
+            double edgeD = -((edgeNormal[0] * fromPos[0]) + (edgeNormal[1] * fromPos[1]) +
+                (edgeNormal[2] * fromPos[2]));
+            double weight = BORDER_WEIGHT * edgeLength * edgeLength;
+            AddPlane(edgeNormal[0], edgeNormal[1], edgeNormal[2], edgeD, weight,
+                &state->quadrics[from]);
+            AddPlane(edgeNormal[0], edgeNormal[1], edgeNormal[2], edgeD, weight,
+                &state->quadrics[to]);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether a vertex's kind lets it collapse onto a neighbor (see VertexKind).  A border
+    vertex can only go to another border (or seam) vertex along an open edge, so that the
+    outline doesn't cave in.
+Parameters:
+    state   The triangles and kinds.
+    from    The vertex that would go away.
+    to      Where it would go.
+Returns:
+    True if it can.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static bool CanCollapse(const SimplifierState &state, unsigned int from, unsigned int to)
+{
+    switch (state.kinds[from])
+    {
+    case VERTEX_KIND_MANIFOLD:
+        return true;
+    case VERTEX_KIND_BORDER:
+        return (state.kinds[to] != VERTEX_KIND_MANIFOLD) && IsBorderEdge(state, from, to);
+    default:
+        return false;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether collapsing a vertex would turn any of its triangles over (or squash one flat),
+    which the quadrics don't notice since the flipped triangle is still in the same plane.
+    The triangles that have both ends of the edge go away, so they don't count.
+Parameters:
+    state   The triangles.
+    from    The vertex that would go away.
+    to      Where it would go.
+Returns:
+    True if it would.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static bool CollapseFlips(const SimplifierState &state, unsigned int from, unsigned int to)
+{
+    const std::vector<MeshVertex> &vertices = *state.vertices;
+    for (unsigned int slot = state.triangleStarts[from]; slot < state.triangleStarts[from + 1];
+        slot++)
+    {
+        const unsigned int *corners = &state.indices[state.vertexTriangles[slot] * 3];
+        if ((corners[0] == corners[1]) || (corners[1] == corners[2]) ||
+            (corners[2] == corners[0]) || (corners[0] == to) || (corners[1] == to) ||
+            (corners[2] == to))
+        {
+            continue;
+        }
+
+        const float *before[3];
+        const float *after[3];
+        for (int cornerCount = 0; cornerCount < 3; cornerCount++)
+        {
+            before[cornerCount] = vertices[corners[cornerCount]].pos;
+            after[cornerCount] = (corners[cornerCount] == from) ? vertices[to].pos :
+                before[cornerCount];
+        }
+        double beforeNormal[3];
+        double afterNormal[3];
+        TriangleNormal(before[0], before[1], before[2], beforeNormal);
+        TriangleNormal(after[0], after[1], after[2], afterNormal);
+        double dot = (beforeNormal[0] * afterNormal[0]) + (beforeNormal[1] * afterNormal[1]) +
+            (beforeNormal[2] * afterNormal[2]);
+        bool wasFlat = (beforeNormal[0] == 0.0) && (beforeNormal[1] == 0.0) &&
+            (beforeNormal[2] == 0.0);
+        if ((dot <= 0.0) && !wasFlat)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    One pass's collapses: goes through them cheapest first and does each one that's still
+    good.  A vertex that has already changed in this pass (either end of an earlier collapse)
+    is left alone until the next one, since its costs are out of date.
+
+    Note: The vertices touched so far are kept in the state, so that this can be called
+    again in the same pass with a higher cost limit.
+Parameters:
+    state               The triangles and quadrics.  Gets the collapses.
+    collapses           Sorted by cost.
+    maxCost             Stops at the first collapse that costs more than this.
+    targetNumTriangles  Stops once there are this many triangles.
+    numTriangles        How many there are.  Goes down with each collapse.
+    worstCost           Goes up to the cost of the worst collapse that was done.
+Returns:
+    How many collapses were done.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static size_t CollapseEdges(SimplifierState *state, const std::vector<Collapse> &collapses,
+    double maxCost, unsigned int targetNumTriangles, size_t *numTriangles, double *worstCost)
+{
+    size_t numCollapsed = 0;
+    for (size_t collapseCount = 0; (collapseCount < collapses.size()) &&
+        (*numTriangles > targetNumTriangles); collapseCount++)
+    {
+        const Collapse &collapse = collapses[collapseCount];
+        if (collapse.cost > maxCost)
+        {
+            break;
+        }
+        if (state->isTouched[collapse.from] || state->isTouched[collapse.to] ||
+            CollapseFlips(*state, collapse.from, collapse.to))
+        {
+            continue;
+        }
+
+        Quadric &toQuadric = state->quadrics[collapse.to];
+        const Quadric &fromQuadric = state->quadrics[collapse.from];
+        for (int termCount = 0; termCount < 10; termCount++)
+        {
+            toQuadric.m[termCount] += fromQuadric.m[termCount];
+        }
+        toQuadric.weight += fromQuadric.weight;
+
+        // the triangles with both ends of the edge become lines
+        for (unsigned int slot = state->triangleStarts[collapse.from];
+            slot < state->triangleStarts[collapse.from + 1]; slot++)
+        {
+            unsigned int *corners = &state->indices[state->vertexTriangles[slot] * 3];
+            if ((corners[0] == corners[1]) || (corners[1] == corners[2]) ||
+                (corners[2] == corners[0]))
+            {
+                continue;
+            }
+            for (int cornerCount = 0; cornerCount < 3; cornerCount++)
+            {
+                corners[cornerCount] = (corners[cornerCount] == collapse.from) ? collapse.to :
+                    corners[cornerCount];
+            }
+            if ((corners[0] == corners[1]) || (corners[1] == corners[2]) ||
+                (corners[2] == corners[0]))
+            {
+                (*numTriangles)--;
+            }
+        }
+
+        state->isTouched[collapse.from] = 1;
+        state->isTouched[collapse.to] = 1;
+        *worstCost = std::max(*worstCost, collapse.cost);
+        numCollapsed++;
+    }
+    return numCollapsed;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Takes triangles out of a mesh until it's down to a target, by collapsing edges: one end
+    of the edge goes away and its triangles use the other end instead, which takes the two
+    triangles on the edge with it.  The collapses that move the surface the least go first,
+    by quadric error (see Quadric).
+
+    Only existing vertices are used (a collapse moves one vertex onto another, rather than
+    to a new spot in between), so every vertex keeps its own texture coordinates and nothing
+    has to be interpolated.  Vertices on a UV seam don't move at all, and ones on an open
+    edge only slide along it (see VertexKind).
+
+    It works in passes.  Each pass finds every edge's cheaper way to collapse, sorts them,
+    and does as many of the cheapest ones as it can without collapsing a vertex whose
+    neighborhood already changed in the same pass.  Then it rebuilds what changed and goes
+    again, until the target is reached, the error limit is, or nothing else can collapse.
+
+    Note: The mesh may not get all the way down to the target.  A mesh that's all seams and
+    borders, or one that's already down to a few triangles, may have nothing left that can
+    collapse.
+Parameters:
+    mesh                Any number of vertices, and a multiple of 3 indices.
+    targetNumTriangles  How many triangles to stop at.
+    maxError            The most that the surface is allowed to move, in the mesh's units.
+                        FLT_MAX for no limit.
+    simplified          Gets the simplified mesh, with only the vertices that it uses, in the
+                        order they're used (see OptimizeVertexFetch(...)).
+Returns:
+    About how far the surface moved, in the mesh's units: the square root of the worst
+    collapse's error.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+float SimplifyMesh(const MeshData &mesh, unsigned int targetNumTriangles, float maxError,
+    MeshData *simplified)
+{
+    SimplifierState state;
+    state.vertices = &mesh.vertices;
+    state.indices = mesh.indices;
+    size_t numTriangles = RemoveDegenerateTriangles(&state.indices);
+    FindPositionIds(mesh.vertices, &state.positionIds);
+    BuildVertexTriangles(&state);
+    ClassifyVertices(&state);
+    AddQuadrics(&state);
+    state.isTouched.resize(mesh.vertices.size());
+
+    double maxCost = (maxError >= FLT_MAX) ? DBL_MAX : (double)maxError * maxError;
+    double worstCost = 0.0;
+    std::vector<Collapse> collapses;
+    while (numTriangles > targetNumTriangles)
+    {
+        // every edge, whichever way is cheaper (if either way is allowed)
+        // Note: Most edges are in two triangles, one going each way, so only the one going
+        // from the lower-numbered vertex is used.
+        collapses.clear();
+        const std::vector<MeshVertex> &vertices = mesh.vertices;
+        for (size_t indexCount = 0; indexCount < state.indices.size(); indexCount++)
+        {
+            unsigned int first = state.indices[indexCount];
+            unsigned int second = state.indices[(indexCount % 3 == 2) ? indexCount - 2 :
+                indexCount + 1];
+            if ((first > second) && HasIndexEdge(state, second, first))
+            {
+                continue;
+            }
+            Collapse collapse = { NO_INDEX, NO_INDEX, DBL_MAX };
+            if (CanCollapse(state, first, second))
+            {
+                collapse.from = first;
+                collapse.to = second;
+                collapse.cost = QuadricError(state.quadrics[first], state.quadrics[second],
+                    vertices[second].pos);
+            }
+            if (CanCollapse(state, second, first))
+            {
+                double cost = QuadricError(state.quadrics[second], state.quadrics[first],
+                    vertices[first].pos);
+                if (cost < collapse.cost)
+                {
+                    collapse.from = second;
+                    collapse.to = first;
+                    collapse.cost = cost;
+                }
+            }
+            if (collapse.from != NO_INDEX)
+            {
+                collapses.push_back(collapse);
+            }
+        }
+        if (collapses.empty())
+        {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(),
+            [](const Collapse &first, const Collapse &second)
+        {
+            return first.cost < second.cost;
+        });
+
+        // Note: A pass doesn't go much past the cost of the collapses that it would take to
+        // get to the target (each one takes about 2 triangles), so that the expensive ones
+        // wait for the next pass, when cheaper ones may have turned up.  Lots of collapses
+        // are skipped for sharing a vertex with an earlier one, so it allows half again as
+        // far (2.25 times the squared error) as the cheapest ones that would be enough.  If
+        // it falls far short anyway (ex: the cheapest ones would flip triangles, and they're
+        // still the cheapest in every pass), it goes on to the rest.
+        size_t numWanted = ((numTriangles - targetNumTriangles) / 2) + 1;
+        double passMaxCost = maxCost;
+        if (numWanted < collapses.size())
+        {
+            passMaxCost = std::min(maxCost, collapses[numWanted].cost * PASS_COST_SCALE);
+        }
+        std::fill(state.isTouched.begin(), state.isTouched.end(), 0);
+        size_t numCollapsed = CollapseEdges(&state, collapses, passMaxCost,
+            targetNumTriangles, &numTriangles, &worstCost);
+        if ((numCollapsed < numWanted / MIN_PASS_FRACTION) && (passMaxCost < maxCost))
+        {
+            numCollapsed += CollapseEdges(&state, collapses, maxCost, targetNumTriangles,
+                &numTriangles, &worstCost);
+        }
+        if (numCollapsed == 0)
+        {
+            break;
+        }
+
+        RemoveDegenerateTriangles(&state.indices);
+        BuildVertexTriangles(&state);
+    }
+
+    simplified->vertices = mesh.vertices;
+    simplified->indices.swap(state.indices);
+    OptimizeVertexFetch(simplified);
+    return (float)sqrt(worstCost);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes a chain of levels of detail for a mesh, each with about half the triangles of the
+    one before.  The first is the mesh itself.
+
+    Each level is simplified from the one before it rather than from the full mesh, which is
+    a lot less work for the small ones.  That makes each level's error the sum of the steps'
+    errors, which can only overstate how far off it is, so a level is never picked when it's
+    too coarse.
+Parameters:
+    mesh        Any number of vertices, and a multiple of 3 indices.
+    maxLods     The most levels, counting the mesh itself (ex: MAX_LODS).
+    lods        Gets the levels, finest first.  There's only one if the mesh couldn't be
+                simplified (ex: it's already tiny).
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BuildLodChain(const MeshData &mesh, unsigned int maxLods, std::vector<MeshLod> *lods)
+{
+    lods->clear();
+    lods->push_back(MeshLod());
+    lods->back().mesh = mesh;
+    lods->back().error = 0.0f;
+    while (lods->size() < maxLods)
+    {
+        const MeshLod &previous = lods->back();
+        unsigned int numTriangles = (unsigned int)(previous.mesh.indices.size() / 3);
+        if (numTriangles <= LOD_MIN_TRIANGLES)
+        {
+            break;
+        }
+
+        MeshLod lod;
+        float stepError = SimplifyMesh(previous.mesh,
+            (unsigned int)(numTriangles * LOD_TRIANGLE_RATIO), FLT_MAX, &lod.mesh);
+        if (lod.mesh.indices.size() / 3 > numTriangles * LOD_MIN_REDUCTION)
+        {
+            break;
+        }
+        lod.error = previous.error + stepError;
+        lods->push_back(std::move(lod));
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Same, for lots of meshes at once, spread across the shared thread pool (see
+    ThreadPool.h).  Each mesh is simplified on its own, so they don't need to share
+    anything, and a set of meshes goes about as many times faster as there are cores.
+Parameters:
+    meshes      Any number of meshes.
+    maxLods     The most levels per mesh.
+    lodChains   Gets a chain per mesh, in the same order.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void BuildLodChains(const std::vector<MeshData> &meshes, unsigned int maxLods,
+    std::vector<std::vector<MeshLod>> *lodChains)
+{
+    lodChains->resize(meshes.size());
+    ThreadPool::Shared().ParallelFor(meshes.size(), 1,
+        [&meshes, maxLods, lodChains](size_t beginMesh, size_t endMesh)
+    {
+        for (size_t meshCount = beginMesh; meshCount < endMesh; meshCount++)
+        {
+            BuildLodChain(meshes[meshCount], maxLods, &(*lodChains)[meshCount]);
+        }
+    });
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <vector>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    One level of detail of a mesh: the mesh with fewer triangles, and about how far its
+    surface strays from the full-detail mesh's.  The error is in the mesh's own units, so
+    times a draw's scale it's how far off the draw is on the screen (see
+    MultiDrawRenderer::SetLodSelection(...)).
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct MeshLod
+{
+    MeshData mesh;
+    float error;    // 0 for the full-detail mesh
+};
+
+// the most levels that BuildLodChain(...) makes, counting the full-detail mesh
+static const unsigned int MAX_LODS = 8;
+
+float SimplifyMesh(const MeshData &mesh, unsigned int targetNumTriangles, float maxError,
+    MeshData *simplified);
+void BuildLodChain(const MeshData &mesh, unsigned int maxLods, std::vector<MeshLod> *lods);
+void BuildLodChains(const std::vector<MeshData> &meshes, unsigned int maxLods,
+    std::vector<std::vector<MeshLod>> *lodChains);
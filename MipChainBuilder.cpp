@@ -0,0 +1,245 @@
+#include "MipChainBuilder.h"
+#include "ThreadPool.h"
+#include "SimdSupport.h"
+
+#include <algorithm>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How many levels a full mipmap chain has for a texture of the given size, including level 0.
+    This is the same count that glTexStorage2D(...) expects: keep halving the larger side
+    until it is 1.
+Parameters:
+    width   Level 0 width.
+    height  Level 0 height.
+Returns:
+    The number of levels.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int NumMipLevels(unsigned int width, unsigned int height)
+{
+    unsigned int largest = std::max(width, height);
+    unsigned int numLevels = 1;
+    while (largest > 1)
+    {
+        largest /= 2;
+        numLevels++;
+    }
+
+    return numLevels;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    For reporting which version of DownsampleRows(...) got compiled in.
+Parameters: None
+Returns:
+    A string literal that names the instruction set.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const char *MipFilterInstructionSet()
+{
+#if defined(SIMD_AVX)
+    return "AVX";
+#elif defined(SIMD_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes rows [beginRow, endRow) of the next mip level from the current one with a 2x2 box
+    filter: every destination texel is the average of the 4 source texels under it.
+
+    When a source dimension is odd, the last row/column is dropped, which is what OpenGL's
+    own level sizes (floor(size / 2)) imply.  When a source dimension is already 1, the
+    single row/column is used twice.
+
+    Note: Every version (AVX, SSE2, scalar) adds the 4 texels in the same order, so they all
+    come out bit-for-bit identical.  Floating point addition is not associative, so that
+    order matters.
+Parameters:
+    source          The whole source level.
+    sourceWidth     Source level width.
+    sourceHeight    Source level height.
+    dest            The whole destination level.
+    destWidth       Destination level width.
+    beginRow        First destination row to make.
+    endRow          One past the last destination row to make.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void DownsampleRows(const texel *source, unsigned int sourceWidth, unsigned int sourceHeight,
+    texel *dest, unsigned int destWidth, unsigned int beginRow, unsigned int endRow)
+{
+    for (unsigned int destRow = beginRow; destRow < endRow; destRow++)
+    {
+        unsigned int sourceRow0 = destRow * 2;
+        unsigned int sourceRow1 = std::min(sourceRow0 + 1, sourceHeight - 1);
+        const texel *row0 = source + ((size_t)sourceRow0 * sourceWidth);
+        const texel *row1 = source + ((size_t)sourceRow1 * sourceWidth);
+        texel *destTexels = dest + ((size_t)destRow * destWidth);
+
+        unsigned int destCol = 0;
+        if (sourceWidth >= 2)
+        {
+#if defined(SIMD_AVX)
+            // two destination texels per loop
+            // Note: Each 256bit register holds two neighboring texels.  Adding the rows first
+            // gives [t0, t1] and [t2, t3]; swapping 128bit halves around lines up t0 with t1
+            // and t2 with t3 for the horizontal add.
+            __m256 quarter = _mm256_set1_ps(0.25f);
+            for (; destCol + 2 <= destWidth; destCol += 2)
+            {
+                const float *src0 = (const float *)(row0 + (destCol * 2));
+                const float *src1 = (const float *)(row1 + (destCol * 2));
+                __m256 sumA = _mm256_add_ps(_mm256_loadu_ps(src0), _mm256_loadu_ps(src1));
+                __m256 sumB = _mm256_add_ps(_mm256_loadu_ps(src0 + 8), _mm256_loadu_ps(src1 + 8));
+                __m256 evens = _mm256_permute2f128_ps(sumA, sumB, 0x20);
+                __m256 odds = _mm256_permute2f128_ps(sumA, sumB, 0x31);
+                _mm256_storeu_ps((float *)(destTexels + destCol),
+                    _mm256_mul_ps(_mm256_add_ps(evens, odds), quarter));
+            }
+#elif defined(SIMD_SSE2)
+            // one destination texel (one register) per loop
+            __m128 quarter = _mm_set1_ps(0.25f);
+            for (; destCol < destWidth; destCol++)
+            {
+                const float *src0 = (const float *)(row0 + (destCol * 2));
+                const float *src1 = (const float *)(row1 + (destCol * 2));
+                __m128 left = _mm_add_ps(_mm_load_ps(src0), _mm_load_ps(src1));
+                __m128 right = _mm_add_ps(_mm_load_ps(src0 + 4), _mm_load_ps(src1 + 4));
+                _mm_store_ps((float *)(destTexels + destCol),
+                    _mm_mul_ps(_mm_add_ps(left, right), quarter));
+            }
+#endif
+        }
+
+        // leftovers, or everything if there's no SIMD or the source is 1 texel wide
+        for (; destCol < destWidth; destCol++)
+        {
+            unsigned int sourceCol0 = destCol * 2;
+            unsigned int sourceCol1 = std::min(sourceCol0 + 1, sourceWidth - 1);
+            const texel &a = row0[sourceCol0];
+            const texel &b = row0[sourceCol1];
+            const texel &c = row1[sourceCol0];
+            const texel &d = row1[sourceCol1];
+            texel t =
+            {
+                ((a.r + c.r) + (b.r + d.r)) * 0.25f,
+                ((a.g + c.g) + (b.g + d.g)) * 0.25f,
+                ((a.b + c.b) + (b.b + d.b)) * 0.25f,
+                ((a.a + c.a) + (b.a + d.a)) * 0.25f,
+            };
+            destTexels[destCol] = t;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Builds every mip level after level 0 on the CPU.
+
+    Each level depends on the one before it, so the obvious "one level at a time" approach
+    makes every thread wait at the end of every level.  Instead, level 0 is cut into bands of
+    2^N rows, and each band is taken all the way down N levels by one thread: a 64-row band
+    becomes 32 rows of level 1, then 16 rows of level 2, and so on.  No band needs anything
+    from any other band, so all of those levels are built at once without waiting, and a band
+    stays in that thread's cache as it shrinks.  Whatever small levels are left after that
+    are built one at a time.
+Parameters:
+    level0  The full-size texels.
+    width   Level 0 width.
+    height  Level 0 height.
+Returns:
+    Levels 1 through the 1x1 level (level 0 is not copied).  Empty if the texture is already
+    1x1 or an allocation failed.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+std::vector<MipLevel> BuildMipChain(const texel *level0, unsigned int width,
+    unsigned int height)
+{
+    std::vector<MipLevel> levels;
+    unsigned int numLevels = NumMipLevels(width, height);
+    if ((width == 0) || (height == 0) || (numLevels <= 1))
+    {
+        return levels;
+    }
+
+    levels.resize(numLevels - 1);
+    unsigned int levelWidth = width;
+    unsigned int levelHeight = height;
+    for (size_t levelIndex = 0; levelIndex < levels.size(); levelIndex++)
+    {
+        levelWidth = std::max(levelWidth / 2, 1u);
+        levelHeight = std::max(levelHeight / 2, 1u);
+        levels[levelIndex].width = levelWidth;
+        levels[levelIndex].height = levelHeight;
+        levels[levelIndex].texels.Resize((size_t)levelWidth * levelHeight);
+        if (levels[levelIndex].texels.Data() == 0)
+        {
+            levels.clear();
+            return levels;
+        }
+    }
+
+    // pick the band height: as tall as 64 rows so that a band goes down 6 levels, but short
+    // enough that there are a few bands for every thread
+    unsigned int numThreads = ThreadPool::Shared().NumWorkers() + 1;
+    unsigned int bandLevels = std::min(6u, numLevels - 1);
+    while ((bandLevels > 1) && (((height >> bandLevels) + 1) < (numThreads * 4)))
+    {
+        bandLevels--;
+    }
+    unsigned int bandRows = 1u << bandLevels;
+    unsigned int numBands = (height + bandRows - 1) / bandRows;
+
+    ThreadPool::Shared().ParallelFor(numBands, 1,
+        [&levels, level0, width, height, bandLevels, bandRows](size_t beginBand, size_t endBand)
+    {
+        for (size_t band = beginBand; band < endBand; band++)
+        {
+            const texel *source = level0;
+            unsigned int sourceWidth = width;
+            unsigned int sourceHeight = height;
+            for (unsigned int level = 1; level <= bandLevels; level++)
+            {
+                // this band's rows in this level; the last band may be cut short
+                MipLevel &dest = levels[level - 1];
+                unsigned int beginRow = (unsigned int)((band * bandRows) >> level);
+                unsigned int endRow = (unsigned int)(((band + 1) * bandRows) >> level);
+                endRow = std::min(endRow, dest.height);
+                if (beginRow < endRow)
+                {
+                    DownsampleRows(source, sourceWidth, sourceHeight, dest.texels.Data(),
+                        dest.width, beginRow, endRow);
+                }
+
+                source = dest.texels.Data();
+                sourceWidth = dest.width;
+                sourceHeight = dest.height;
+            }
+        }
+    });
+
+    // the leftover small levels
+    for (unsigned int level = bandLevels + 1; level < numLevels; level++)
+    {
+        const MipLevel &source = levels[level - 2];
+        MipLevel &dest = levels[level - 1];
+        ThreadPool::Shared().ParallelFor(dest.height, 16,
+            [&source, &dest](size_t beginRow, size_t endRow)
+        {
+            DownsampleRows(source.texels.Data(), source.width, source.height,
+                dest.texels.Data(), dest.width, (unsigned int)beginRow, (unsigned int)endRow);
+        });
+    }
+
+    return levels;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "TextureGenerator.h"
+
+#include <vector>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    One level of a mipmap chain.  Level 0 is the full-size texture and each level after that is
+    half the width and height (rounded down, but never less than 1) of the one before it.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct MipLevel
+{
+    unsigned int width;
+    unsigned int height;
+    TexelBuffer texels;
+};
+
+unsigned int NumMipLevels(unsigned int width, unsigned int height);
+std::vector<MipLevel> BuildMipChain(const texel *level0, unsigned int width,
+    unsigned int height);
+void DownsampleRows(const texel *source, unsigned int sourceWidth, unsigned int sourceHeight,
+    texel *dest, unsigned int destWidth, unsigned int beginRow, unsigned int endRow);
+const char *MipFilterInstructionSet();
@@ -0,0 +1,1093 @@
+#include "glload/include/glload/gl_4_4.h"
+
+#include "MultiDrawRenderer.h"
+#include "GlStateCache.h"
+#include "DynamicVertexBuffer.h"
+#include "GpuCuller.h"
+#include "GpuBufferArena.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+// the mesh shaders' sampler (see mesh.frag)
+static const unsigned int TEX_NAME_ID = InternName("tex");
+
+// the vertex buffer bindings that the mesh vertices and the per-draw instances read from
+static const GLuint VERTEX_BINDING = 0;
+static const GLuint INSTANCE_BINDING = 1;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out with nothing.  See Init().
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+MultiDrawRenderer::MultiDrawRenderer() :
+    _programId(0),
+    _dynamicBuffer(0),
+    _vertexFormat(VERTEX_FORMAT_FLOAT),
+    _vertexArena(0),
+    _vertexArenaGeneration(0),
+    _maxMeshletVertices(MAX_VERTICES_16_BIT_INDICES),
+    _lodPixelsPerUnit(0.0f),
+    _maxLodPixelError(1.0f),
+    _meshesChanged(false),
+    _meshInfoBufferId(0),
+    _vaoId(0),
+    _numFullDetailIndices(0)
+{
+    memset(_indexArenas, 0, sizeof(_indexArenas));
+    memset(_indexArenaGenerations, 0, sizeof(_indexArenaGenerations));
+    memset(_numDrawsPerWidth, 0, sizeof(_numDrawsPerWidth));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Nothing.  Call Shutdown() while the context is still around to clean up.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+MultiDrawRenderer::~MultiDrawRenderer()
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes the VAO that describes the meshes' vertices and the per-draw instances.  The
+    program comes separately from SetProgram(...), since it is built asynchronously, and the
+    meshes from AddMesh(...).
+Parameters:
+    vertexArena     Already Init()ed with vertexFormat's bytesPerVertex elements.  Other
+                    things' meshes can be in it too (in the same format).  The caller owns it,
+                    and it has to outlive the renderer.
+    indexArenas     Same, an array of INDEX_WIDTH_COUNT of them, each with the elements of
+                    that IndexWidth (1, 2, and 4 bytes).
+    vertexFormat    What AddMesh(...) packs the vertices into (see VertexQuantizer.h).
+Returns:
+    False if the arenas are the wrong kind or the VAO couldn't be made.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool MultiDrawRenderer::Init(GpuBufferArena &vertexArena, GpuBufferArena *indexArenas,
+    VertexFormat vertexFormat)
+{
+    const VertexFormatDescription &description = GetVertexFormatDescription(vertexFormat);
+    bool goodArenas = (vertexArena.ElementSize() == description.bytesPerVertex);
+    for (int widthIndex = 0; widthIndex < INDEX_WIDTH_COUNT; widthIndex++)
+    {
+        goodArenas = goodArenas && (indexArenas[widthIndex].ElementSize() ==
+            BytesPerIndex((IndexWidth)widthIndex));
+    }
+    if (!goodArenas)
+    {
+        printf("the multi-draw renderer needs a '%s' vertex arena and an 8, 16, and 32-bit "
+            "index arena\n", description.name);
+        return false;
+    }
+    _vertexFormat = vertexFormat;
+    _vertexArena = &vertexArena;
+    for (int widthIndex = 0; widthIndex < INDEX_WIDTH_COUNT; widthIndex++)
+    {
+        _indexArenas[widthIndex] = &indexArenas[widthIndex];
+    }
+
+    // Note: The arenas' buffers are attached in UpdateMeshes(), since repacking changes them.
+    GlStateCache &stateCache = GlStateCache::Shared();
+    glGenBuffers(1, &_meshInfoBufferId);
+    glGenVertexArrays(1, &_vaoId);
+    if ((_meshInfoBufferId == 0) || (_vaoId == 0))
+    {
+        printf("could not make the multi-draw renderer's buffers\n");
+        Shutdown();
+        return false;
+    }
+
+    // the mesh vertices advance per vertex and the instances once per instance (the divisor),
+    // which the draw's base instance starts at
+    // Note: The buffers are attached separately from the attribute formats (OpenGL 4.3's
+    // glVertexAttribFormat(...) and glBindVertexBuffer(...)) so that each Submit...() can
+    // point the instances at wherever they went in the dynamic buffer with one call.
+    stateCache.BindVertexArray(_vaoId);
+    SetVertexLayout(description.layout, VERTEX_BINDING);
+    SetVertexLayout(MESH_INSTANCE_LAYOUT, INSTANCE_BINDING);
+    stateCache.BindVertexArray(0);
+    _meshesChanged = true;
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Deletes everything, including the program, and gives the meshes back to the arenas.  Safe
+    to call more than once.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void MultiDrawRenderer::Shutdown()
+{
+    GlStateCache &stateCache = GlStateCache::Shared();
+    SetProgram(0);
+
+    if (_vaoId != 0)
+    {
+        glDeleteVertexArrays(1, &_vaoId);
+        stateCache.ForgetVertexArray(_vaoId);
+        _vaoId = 0;
+    }
+
+    if (_meshInfoBufferId != 0)
+    {
+        glDeleteBuffers(1, &_meshInfoBufferId);
+        stateCache.ForgetBuffer(_meshInfoBufferId);
+        _meshInfoBufferId = 0;
+    }
+
+    for (unsigned int meshCount = 0; meshCount < _meshes.size(); meshCount++)
+    {
+        RemoveMesh(meshCount);
+    }
+    _meshes.clear();
+    _meshlets.clear();
+    _vertexArena = 0;
+    memset(_indexArenas, 0, sizeof(_indexArenas));
+    _meshesChanged = false;
+    _drawMeshletIndices.clear();
+    _drawInstances.clear();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Gives the renderer a program built from mesh.vert and mesh.frag.  The renderer owns it
+    from here on, and deletes the previous one (if any).
+
+    Note: A program whose inputs don't match the vertex format and MeshInstance is deleted
+    too, and the renderer is left without one (see VertexLayoutsMatchProgram(...)).
+Parameters:
+    programId   The linked program, or 0 for none.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void MultiDrawRenderer::SetProgram(unsigned int programId)
+{
+    if (_programId != 0)
+    {
+        glDeleteProgram(_programId);
+        GlStateCache::Shared().ForgetProgram(_programId);
+    }
+
+    _programId = programId;
+    _reflection.Clear();
+    if (programId != 0)
+    {
+        _reflection.Reflect(programId);
+        VertexLayout layouts[] =
+        {
+            GetVertexFormatDescription(_vertexFormat).layout, MESH_INSTANCE_LAYOUT
+        };
+        if (!VertexLayoutsMatchProgram(_reflection, layouts, 2, "mesh"))
+        {
+            SetProgram(0);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Where each frame's commands and instances go.  The caller owns it and brackets each frame
+    with its BeginFrame() and EndFrame().
+
+    Note: Unlike the sprite batcher, there's no fallback without one.  The draw commands
+    themselves have to be in a buffer, and a persistently mapped one is the cheapest place to
+    write them every frame.
+Parameters:
+    dynamicBuffer   The buffer, or null for none (and no drawing).
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void MultiDrawRenderer::SetDynamicBuffer(DynamicVertexBuffer *dynamicBuffer)
+{
+    _dynamicBuffer = dynamicBuffer;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How big a mesh can get before AddMesh(...) cuts it into meshlets.  The default is
+    MAX_VERTICES_16_BIT_INDICES, so that no mesh needs 32-bit indices.  Smaller meshlets
+    (ex: MAX_VERTICES_8_BIT_INDICES) have narrower indices still and are culled more finely,
+    but each one is a draw of its own and the vertices on their edges are repeated.
+
+    Note: Meshes that are already packed (ex: from a MeshFile) are never cut up.  They get
+    32-bit indices if they need them.
+Parameters:
+    maxVertices     The most vertices per meshlet.  0 never cuts meshes up.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void MultiDrawRenderer::SetMaxMeshletVertices(unsigned int maxVertices)
+{
+    _maxMeshletVertices = maxVertices;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How Draw(...) picks a level of detail for meshes that have them (see AddMeshLods(...)).
+    The instances are in normalized device coordinates, which are 2 units from the bottom of
+    the screen to the top, so a mesh drawn at some scale is scale * screenHeight / 2 pixels
+    per unit of its own.  A level's error (see MeshLod) times that is about how many pixels
+    off it would be on the screen, and the coarsest level that's off by no more than
+    maxPixelError is drawn.
+
+    Note: A level whose error is under a pixel looks the same as the full mesh (the pixels
+    that the triangles cover barely change), so 1 loses nothing that can be seen.
+Parameters:
+    screenHeight    In pixels (ex: the window's height).  0 always draws the finest level.
+    maxPixelError   How far off a draw is allowed to be, in pixels.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void MultiDrawRenderer::SetLodSelection(float screenHeight, float maxPixelError)
+{
+    _lodPixelsPerUnit = screenHeight * 0.5f;
+    _maxLodPixelError = maxPixelError;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Puts a mesh's vertices and indices in the arenas.  The indices stay relative to the mesh's
+    own first vertex, and the draw's base vertex moves them to wherever the mesh landed.  Only
+    this mesh is uploaded, so adding one doesn't cost more when there are lots already.
+
+    The vertices are packed into the renderer's vertex format first, with the positions fit to
+    the mesh's own bounding box, and the indices are narrowed to the fewest bytes that reach
+    every vertex (see PackMesh(...)).  A mesh with more vertices than SetMaxMeshletVertices(...)
+    is cut into meshlets first, and each one is packed (and later drawn) on its own.
+Parameters:
+    mesh    Any number of vertices, and a multiple of 3 indices.
+Returns:
+    The mesh's index, for Draw(...), or NO_MESH if it didn't fit or Init(...) hasn't been
+    done.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int MultiDrawRenderer::AddMesh(const MeshData &mesh)
+{
+    if ((_vertexArena == 0) || mesh.vertices.empty() || mesh.indices.empty())
+    {
+        return NO_MESH;
+    }
+
+    std::vector<MeshData> meshlets;
+    const MeshData *pieces = &mesh;
+    size_t numPieces = 1;
+    if ((_maxMeshletVertices != 0) && (mesh.vertices.size() > _maxMeshletVertices))
+    {
+        SplitIntoMeshlets(mesh, _maxMeshletVertices, &meshlets);
+        pieces = meshlets.data();
+        numPieces = meshlets.size();
+    }
+
+    MeshMeshlets meshMeshlets;
+    meshMeshlets.firstMeshlet = (unsigned int)_meshlets.size();
+    meshMeshlets.numMeshlets = (unsigned int)numPieces;
+    meshMeshlets.numIndices = (unsigned int)mesh.indices.size();
+    meshMeshlets.radius = 0.0f;
+    meshMeshlets.coarserMesh = NO_MESH;
+    meshMeshlets.lodError = 0.0f;
+    std::vector<unsigned char> vertexBytes;
+    std::vector<unsigned char> indexBytes;
+    for (size_t pieceCount = 0; pieceCount < numPieces; pieceCount++)
+    {
+        PackedMesh packedMesh;
+        PackMesh(pieces[pieceCount], _vertexFormat, &vertexBytes, &indexBytes, &packedMesh);
+        if (!AddMeshlet(packedMesh))
+        {
+            // give back the ones that did fit
+            for (size_t meshletIndex = meshMeshlets.firstMeshlet; meshletIndex < _meshlets.size();
+                meshletIndex++)
+            {
+                _vertexArena->Free(_meshlets[meshletIndex].vertexHandle);
+                _indexArenas[_meshlets[meshletIndex].indexWidth]->Free(
+                    _meshlets[meshletIndex].indexHandle);
+            }
+            _meshlets.resize(meshMeshlets.firstMeshlet);
+            return NO_MESH;
+        }
+
+        // the farthest vertex of any of them is the farthest of the whole mesh
+        meshMeshlets.radius = (packedMesh.radius > meshMeshlets.radius) ? packedMesh.radius :
+            meshMeshlets.radius;
+    }
+
+    _meshes.push_back(meshMeshlets);
+    return (unsigned int)(_meshes.size() - 1);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Same, but for a mesh that's already packed (ex: straight out of a mapped MeshFile), so the
+    vertices and indices go from wherever they are to the arenas' buffers with nothing in
+    between.  It is never cut into meshlets, since that would take unpacking it.
+Parameters:
+    mesh    Packed into the renderer's vertex format, with a multiple of 3 indices of any
+            width.
+Returns:
+    The mesh's index, or NO_MESH if it's in some other vertex format, didn't fit, or Init(...)
+    hasn't been done.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int MultiDrawRenderer::AddMesh(const PackedMesh &mesh)
+{
+    if ((_vertexArena == 0) || (mesh.numVertices == 0) || (mesh.numIndices == 0))
+    {
+        return NO_MESH;
+    }
+    if (mesh.format != _vertexFormat)
+    {
+        printf("a '%s' mesh can't go in a '%s' vertex arena\n",
+            GetVertexFormatDescription(mesh.format).name,
+            GetVertexFormatDescription(_vertexFormat).name);
+        return NO_MESH;
+    }
+    if (!AddMeshlet(mesh))
+    {
+        return NO_MESH;
+    }
+
+    MeshMeshlets meshMeshlets;
+    meshMeshlets.firstMeshlet = (unsigned int)(_meshlets.size() - 1);
+    meshMeshlets.numMeshlets = 1;
+    meshMeshlets.numIndices = mesh.numIndices;
+    meshMeshlets.radius = mesh.radius;
+    meshMeshlets.coarserMesh = NO_MESH;
+    meshMeshlets.lodError = 0.0f;
+    _meshes.push_back(meshMeshlets);
+    return (unsigned int)(_meshes.size() - 1);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Adds a mesh along with its levels of detail (see BuildLodChain(...)).  Each level is
+    added like any other mesh (and may be cut into meshlets), but only the finest one's
+    index is handed back, and Draw(...)s of it pick whichever level fits the draw's size on
+    the screen (see SetLodSelection(...)).
+Parameters:
+    lods    Finest first, each with its error.
+Returns:
+    The finest level's mesh index, or NO_MESH if there were no levels or any of them didn't
+    fit (and then none of them are added).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int MultiDrawRenderer::AddMeshLods(const std::vector<MeshLod> &lods)
+{
+    unsigned int finestMesh = NO_MESH;
+    unsigned int previousMesh = NO_MESH;
+    for (size_t lodCount = 0; lodCount < lods.size(); lodCount++)
+    {
+        unsigned int meshIndex = AddMesh(lods[lodCount].mesh);
+        if (meshIndex == NO_MESH)
+        {
+            // takes the levels that did fit with it
+            RemoveMesh(finestMesh);
+            return NO_MESH;
+        }
+
+        _meshes[meshIndex].lodError = lods[lodCount].error;
+        if (previousMesh == NO_MESH)
+        {
+            finestMesh = meshIndex;
+        }
+        else
+        {
+            _meshes[previousMesh].coarserMesh = meshIndex;
+        }
+        previousMesh = meshIndex;
+    }
+    return finestMesh;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Gives a mesh's vertices and indices back to the arenas, along with its coarser levels of
+    detail (if it has any).  Draws of it are ignored from then on.
+
+    Note: Mesh indices aren't handed out again, so that a stale one can't draw some other
+    mesh.
+Parameters:
+    meshIndex   From AddMesh(...).  Anything else (including a mesh that was already removed)
+                is ignored.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void MultiDrawRenderer::RemoveMesh(unsigned int meshIndex)
+{
+    for (unsigned int lodIndex = meshIndex; lodIndex < _meshes.size();
+        lodIndex = _meshes[lodIndex].coarserMesh)
+    {
+        MeshMeshlets &meshMeshlets = _meshes[lodIndex];
+        for (unsigned int meshletCount = 0; meshletCount < meshMeshlets.numMeshlets;
+            meshletCount++)
+        {
+            Meshlet &meshlet = _meshlets[meshMeshlets.firstMeshlet + meshletCount];
+            if (_vertexArena != 0)
+            {
+                _vertexArena->Free(meshlet.vertexHandle);
+                _indexArenas[meshlet.indexWidth]->Free(meshlet.indexHandle);
+            }
+            meshlet.vertexHandle = GpuBufferArena::NO_HANDLE;
+            meshlet.indexHandle = GpuBufferArena::NO_HANDLE;
+            meshlet.indexCount = 0;
+        }
+        meshMeshlets.numMeshlets = 0;
+        meshMeshlets.numIndices = 0;
+        _meshesChanged = true;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    How many meshes have been added, counting each level of detail as one.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int MultiDrawRenderer::NumMeshes() const
+{
+    return (unsigned int)_meshes.size();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How many pieces AddMesh(...) cut a mesh into, which is how many draws each Draw(...) of
+    it makes.
+Parameters:
+    meshIndex   From AddMesh(...).
+Returns:
+    1 for a mesh that wasn't cut up, or 0 if there's no such mesh (or it was removed).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int MultiDrawRenderer::NumMeshlets(unsigned int meshIndex) const
+{
+    return (meshIndex < _meshes.size()) ? _meshes[meshIndex].numMeshlets : 0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    What the meshes' vertices are packed into in the vertex arena.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+VertexFormat MultiDrawRenderer::Format() const
+{
+    return _vertexFormat;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How far the mesh reaches from its origin, for culling it.
+Parameters:
+    meshIndex   From AddMesh(...).
+Returns:
+    The distance to its farthest vertex, or 0 if there's no such mesh.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+float MultiDrawRenderer::MeshRadius(unsigned int meshIndex) const
+{
+    return (meshIndex < _meshes.size()) ? _meshes[meshIndex].radius : 0.0f;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The bounding sphere that GpuCuller tests one of a mesh's meshlets with, in the mesh's own
+    units, so that the CPU can do the same test: the packed sphere that goes into its
+    CullMeshInfo, taken through the packing the way that Draw(...) folds it into the instance.
+    An instance then moves and scales it like it does the vertices.
+Parameters:
+    meshIndex       From AddMesh(...).
+    meshletCount    0 - NumMeshlets(meshIndex) - 1.
+    center          Gets the sphere's center (3 floats).
+    radius          Gets its radius.
+Returns:
+    False (and nothing is written) if there's no such mesh or meshlet, otherwise true.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool MultiDrawRenderer::MeshletBounds(unsigned int meshIndex, unsigned int meshletCount,
+    float *center, float *radius) const
+{
+    if ((meshIndex >= _meshes.size()) || (meshletCount >= _meshes[meshIndex].numMeshlets))
+    {
+        return false;
+    }
+
+    const Meshlet &meshlet = _meshlets[_meshes[meshIndex].firstMeshlet + meshletCount];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        center[axis] = meshlet.quantization.bias[axis] +
+            (meshlet.packedCenter[axis] * meshlet.quantization.scale);
+    }
+    *radius = meshlet.packedRadius * meshlet.quantization.scale;
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether Submit...() will draw anything.
+Parameters: None
+Returns:
+    True once Init(), SetProgram(...), and SetDynamicBuffer(...) have all been done.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool MultiDrawRenderer::IsReady() const
+{
+    bool ready = (_programId != 0) && (_vaoId != 0) && (_vertexArena != 0) &&
+        _vertexArena->IsReady() && (_dynamicBuffer != 0) && _dynamicBuffer->IsReady();
+    for (int widthIndex = 0; ready && (widthIndex < INDEX_WIDTH_COUNT); widthIndex++)
+    {
+        ready = _indexArenas[widthIndex]->IsReady();
+    }
+    return ready;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts a new frame's draws, throwing out any that weren't submitted.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void MultiDrawRenderer::Begin()
+{
+    _drawMeshletIndices.clear();
+    _drawInstances.clear();
+    _numFullDetailIndices = 0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Queues up a mesh to draw, as a draw per meshlet.  Nothing is drawn until Submit...().
+
+    If the mesh's positions are packed, the instance is changed so that mesh.vert turns them
+    back into the real positions without knowing it: the shader does
+    instancePosition + (pos * instanceScale), so the packing's bias (scaled) goes into the
+    position and its scale goes into the scale.  That's 4 multiply-adds here instead of a
+    per-mesh uniform or another attribute for every draw.  Each meshlet has a packing of its
+    own, so each one's instance is a little different.
+
+    If the mesh has levels of detail, the coarsest one that's close enough at the instance's
+    scale is drawn instead (see SetLodSelection(...)).
+Parameters:
+    meshIndex   From AddMesh(...).  Anything else (including removed meshes) is ignored.
+    instance    Where it goes and what color.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void MultiDrawRenderer::Draw(unsigned int meshIndex, const MeshInstance &instance)
+{
+    if (meshIndex >= _meshes.size())
+    {
+        return;
+    }
+
+    // Note: The levels' errors only go up, so the first one that's too far off ends it.
+    unsigned int lodIndex = meshIndex;
+    if (_lodPixelsPerUnit > 0.0f)
+    {
+        float pixelsPerUnit = instance.scale * _lodPixelsPerUnit;
+        while ((_meshes[lodIndex].coarserMesh != NO_MESH) &&
+            (_meshes[_meshes[lodIndex].coarserMesh].lodError * pixelsPerUnit <=
+            _maxLodPixelError))
+        {
+            lodIndex = _meshes[lodIndex].coarserMesh;
+        }
+    }
+    _numFullDetailIndices += _meshes[meshIndex].numIndices;
+
+    const MeshMeshlets &meshMeshlets = _meshes[lodIndex];
+    for (unsigned int meshletCount = 0; meshletCount < meshMeshlets.numMeshlets; meshletCount++)
+    {
+        unsigned int meshletIndex = meshMeshlets.firstMeshlet + meshletCount;
+        const PositionQuantization &quantization = _meshlets[meshletIndex].quantization;
+        MeshInstance packedInstance = instance;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            packedInstance.position[axis] += quantization.bias[axis] * instance.scale;
+        }
+        packedInstance.scale = instance.scale * quantization.scale;
+        _drawMeshletIndices.push_back(meshletIndex);
+        _drawInstances.push_back(packedInstance);
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Draws every queued mesh with one glMultiDrawElementsIndirect(...) per index width, and
+    empties the queue.  The commands are read by the GPU straight out of the dynamic buffer,
+    so the driver never looks at them one by one.
+Parameters:
+    textureId   The 2D texture that every mesh is drawn with.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void MultiDrawRenderer::Submit(unsigned int textureId)
+{
+    std::chrono::high_resolution_clock::time_point start =
+        std::chrono::high_resolution_clock::now();
+
+    memset(&_stats, 0, sizeof(_stats));
+    size_t instanceOffset = 0;
+    size_t commandOffset = 0;
+    if (!WriteFrameData(true, &instanceOffset, &commandOffset))
+    {
+        Begin();
+        return;
+    }
+
+    // Note: The element buffer belongs to the VAO, so it is switched with the VAO bound.
+    GlStateCache &stateCache = GlStateCache::Shared();
+    BindForDrawing(textureId, _dynamicBuffer->BufferId(), instanceOffset);
+    stateCache.BindBuffer(GL_DRAW_INDIRECT_BUFFER, _dynamicBuffer->BufferId());
+    for (int widthIndex = 0; widthIndex < INDEX_WIDTH_COUNT; widthIndex++)
+    {
+        if (_numDrawsPerWidth[widthIndex] > 0)
+        {
+            IndexWidth width = (IndexWidth)widthIndex;
+            stateCache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexArenas[width]->BufferId());
+            glMultiDrawElementsIndirect(GL_TRIANGLES, IndexType(width), (void *)commandOffset,
+                (GLsizei)_numDrawsPerWidth[width], 0);
+            commandOffset += _numDrawsPerWidth[width] * sizeof(DrawElementsIndirectCommand);
+            _stats.numDrawCalls++;
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    _stats.cpuSeconds = elapsed.count();
+    Begin();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Has the GPU cull the queued draws against the culler's view and then draws the ones that
+    are left with one indirect draw call per index width, and empties the queue.  The CPU
+    writes one CullDrawInput per draw and never finds out how many were kept: the commands,
+    the instances, and (with ARB_indirect_parameters) the draw counts all come from the
+    culler's buffers.
+
+    Each index width is one of the culler's groups, so each width's surviving draws come out
+    together and are drawn together.
+Parameters:
+    textureId   The 2D texture that every mesh is drawn with.
+    culler      Already Init()ed and with its program set.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void MultiDrawRenderer::SubmitCulled(unsigned int textureId, GpuCuller &culler)
+{
+    std::chrono::high_resolution_clock::time_point start =
+        std::chrono::high_resolution_clock::now();
+
+    memset(&_stats, 0, sizeof(_stats));
+    if (!IsReady() || !culler.IsReady() || _drawMeshletIndices.empty())
+    {
+        Begin();
+        return;
+    }
+    if (ArenasChanged())
+    {
+        UpdateMeshes();
+    }
+
+    size_t numDraws = _drawMeshletIndices.size();
+    DynamicBufferAllocation allocation = _dynamicBuffer->Allocate(
+        numDraws * sizeof(CullDrawInput), culler.InputAlignment());
+    if (allocation.data == 0)
+    {
+        printf("the dynamic buffer had no room for %u mesh draws\n", (unsigned int)numDraws);
+        Begin();
+        return;
+    }
+
+    // Note: The culler sorts the draws out by index width, so they're written in order here.
+    CullDrawInput *inputs = (CullDrawInput *)allocation.data;
+    unsigned int numIndices = 0;
+    memset(_numDrawsPerWidth, 0, sizeof(_numDrawsPerWidth));
+    for (size_t drawCount = 0; drawCount < numDraws; drawCount++)
+    {
+        const Meshlet &meshlet = _meshlets[_drawMeshletIndices[drawCount]];
+        inputs[drawCount].instance = _drawInstances[drawCount];
+        inputs[drawCount].meshIndex = _drawMeshletIndices[drawCount];
+        numIndices += meshlet.indexCount;
+        _numDrawsPerWidth[meshlet.indexWidth]++;
+    }
+    culler.Cull(_meshInfoBufferId, _dynamicBuffer->BufferId(), allocation.offset,
+        _numDrawsPerWidth, INDEX_WIDTH_COUNT);
+
+    // Note: Without a draw count, the slots past each width's last visible draw were zeroed,
+    // so they draw nothing.
+    GlStateCache &stateCache = GlStateCache::Shared();
+    BindForDrawing(textureId, culler.InstanceBufferId(), 0);
+    stateCache.BindBuffer(GL_DRAW_INDIRECT_BUFFER, culler.CommandBufferId());
+    if (culler.HasDrawCount())
+    {
+        stateCache.BindBuffer(GL_PARAMETER_BUFFER_ARB, culler.CountBufferId());
+    }
+    size_t commandOffset = 0;
+    for (int widthIndex = 0; widthIndex < INDEX_WIDTH_COUNT; widthIndex++)
+    {
+        IndexWidth width = (IndexWidth)widthIndex;
+        if (_numDrawsPerWidth[width] == 0)
+        {
+            continue;
+        }
+
+        stateCache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexArenas[width]->BufferId());
+        if (culler.HasDrawCount())
+        {
+            glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, IndexType(width),
+                (GLintptr)commandOffset, (GLintptr)(width * sizeof(GLuint)),
+                (GLsizei)_numDrawsPerWidth[width], 0);
+        }
+        else
+        {
+            glMultiDrawElementsIndirect(GL_TRIANGLES, IndexType(width), (void *)commandOffset,
+                (GLsizei)_numDrawsPerWidth[width], 0);
+        }
+        commandOffset += _numDrawsPerWidth[width] * sizeof(DrawElementsIndirectCommand);
+        _stats.numDrawCalls++;
+    }
+
+    // Note: Some drivers (ex: Mesa) read a plain glMultiDrawElementsIndirect(...)'s count out
+    // of a parameter buffer that's still bound, so it's put back for Submit(...).
+    if (culler.HasDrawCount())
+    {
+        stateCache.BindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+    }
+
+    _stats.numDraws = (unsigned int)numDraws;
+    _stats.numTriangles = numIndices / 3;
+    _stats.numFullDetailTriangles = _numFullDetailIndices / 3;
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    _stats.cpuSeconds = elapsed.count();
+    Begin();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Draws every queued mesh with a draw call of its own, the way it would be done without
+    indirect drawing, and empties the queue.  The instances still go through the dynamic
+    buffer so that only the draw calls differ from Submit(...).  Only here to compare against
+    it.
+Parameters:
+    textureId   The 2D texture that every mesh is drawn with.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void MultiDrawRenderer::SubmitOneDrawPerMesh(unsigned int textureId)
+{
+    std::chrono::high_resolution_clock::time_point start =
+        std::chrono::high_resolution_clock::now();
+
+    memset(&_stats, 0, sizeof(_stats));
+    size_t instanceOffset = 0;
+    if (!WriteFrameData(false, &instanceOffset, 0))
+    {
+        Begin();
+        return;
+    }
+
+    // Note: The state cache only switches the element buffer when the index width changes.
+    GlStateCache &stateCache = GlStateCache::Shared();
+    BindForDrawing(textureId, _dynamicBuffer->BufferId(), instanceOffset);
+    for (size_t slot = 0; slot < _drawOrder.size(); slot++)
+    {
+        const Meshlet &meshlet = _meshlets[_drawMeshletIndices[_drawOrder[slot]]];
+        stateCache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+            _indexArenas[meshlet.indexWidth]->BufferId());
+        glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, meshlet.indexCount,
+            IndexType(meshlet.indexWidth),
+            (void *)((size_t)meshlet.firstIndex * BytesPerIndex(meshlet.indexWidth)), 1,
+            meshlet.baseVertex, (GLuint)slot);
+    }
+    _stats.numDrawCalls = (unsigned int)_drawOrder.size();
+
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    _stats.cpuSeconds = elapsed.count();
+    Begin();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    How the last Submit...() went.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const MultiDrawStats &MultiDrawRenderer::Stats() const
+{
+    return _stats;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Puts one mesh (or meshlet) in the vertex arena and the index arena for its index width.
+Parameters:
+    mesh    Packed into the renderer's vertex format.
+Returns:
+    False if it didn't fit.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool MultiDrawRenderer::AddMeshlet(const PackedMesh &mesh)
+{
+    GpuBufferArena *indexArena = _indexArenas[mesh.indexWidth];
+    Meshlet meshlet;
+    meshlet.vertexHandle = _vertexArena->Allocate(mesh.numVertices);
+    meshlet.indexHandle = indexArena->Allocate(mesh.numIndices);
+    meshlet.indexWidth = mesh.indexWidth;
+    if ((meshlet.vertexHandle == GpuBufferArena::NO_HANDLE) ||
+        (meshlet.indexHandle == GpuBufferArena::NO_HANDLE))
+    {
+        _vertexArena->Free(meshlet.vertexHandle);
+        indexArena->Free(meshlet.indexHandle);
+        return false;
+    }
+    _vertexArena->Upload(meshlet.vertexHandle, mesh.vertices);
+    indexArena->Upload(meshlet.indexHandle, mesh.indices);
+
+    // Note: The offsets are filled in by UpdateMeshes(), since the allocations above could
+    // have repacked the arenas and moved other meshes too.
+    meshlet.firstIndex = 0;
+    meshlet.indexCount = mesh.numIndices;
+    meshlet.baseVertex = 0;
+    meshlet.quantization = mesh.quantization;
+    memcpy(meshlet.packedCenter, mesh.packedCenter, sizeof(meshlet.packedCenter));
+    meshlet.packedRadius = mesh.packedRadius;
+    _meshlets.push_back(meshlet);
+    _meshesChanged = true;
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Uploads any new meshes and then copies the queued draws' instances (and, if asked, one
+    DrawElementsIndirectCommand per draw) into the dynamic buffer's current frame.  Also fills
+    in the draw and triangle counts.
+
+    The draws are grouped by index width on the way, since each width is a draw call of its
+    own.  _numDrawsPerWidth says how many of each there are, and _drawOrder which draw went
+    in each slot.  Each slot's command and instance are in the same place, so the command's
+    base instance is the slot.
+Parameters:
+    writeCommands   True to write the indirect commands too.
+    instanceOffset  Gets where in the dynamic buffer the instances start.
+    commandOffset   Gets where the commands start.  Can be null if writeCommands is false.
+Returns:
+    False if there's nothing to draw, the renderer isn't ready, or the frame is full.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool MultiDrawRenderer::WriteFrameData(bool writeCommands, size_t *instanceOffset,
+    size_t *commandOffset)
+{
+    if (!IsReady() || _drawMeshletIndices.empty())
+    {
+        return false;
+    }
+    if (ArenasChanged())
+    {
+        UpdateMeshes();
+    }
+
+    // a counting sort by index width, so that each width's draws are together
+    size_t numDraws = _drawMeshletIndices.size();
+    unsigned int nextSlots[INDEX_WIDTH_COUNT];
+    memset(_numDrawsPerWidth, 0, sizeof(_numDrawsPerWidth));
+    for (size_t drawCount = 0; drawCount < numDraws; drawCount++)
+    {
+        _numDrawsPerWidth[_meshlets[_drawMeshletIndices[drawCount]].indexWidth]++;
+    }
+    nextSlots[0] = 0;
+    for (int widthIndex = 1; widthIndex < INDEX_WIDTH_COUNT; widthIndex++)
+    {
+        nextSlots[widthIndex] = nextSlots[widthIndex - 1] + _numDrawsPerWidth[widthIndex - 1];
+    }
+    _drawOrder.resize(numDraws);
+    for (size_t drawCount = 0; drawCount < numDraws; drawCount++)
+    {
+        IndexWidth width = _meshlets[_drawMeshletIndices[drawCount]].indexWidth;
+        _drawOrder[nextSlots[width]++] = (unsigned int)drawCount;
+    }
+
+    DynamicBufferAllocation instances = _dynamicBuffer->Allocate(
+        numDraws * sizeof(MeshInstance), sizeof(MeshInstance));
+    DynamicBufferAllocation commands = { 0, 0 };
+    if (writeCommands)
+    {
+        // Note: OpenGL only asks that the commands be 4 byte aligned.
+        commands = _dynamicBuffer->Allocate(numDraws * sizeof(DrawElementsIndirectCommand), 4);
+    }
+    if ((instances.data == 0) || (writeCommands && (commands.data == 0)))
+    {
+        printf("the dynamic buffer had no room for %u mesh draws\n", (unsigned int)numDraws);
+        return false;
+    }
+    *instanceOffset = instances.offset;
+
+    // Note: The slots are written front to back, since the dynamic buffer is usually
+    // write-combined memory that is slow to write any other way.
+    MeshInstance *instance = (MeshInstance *)instances.data;
+    DrawElementsIndirectCommand *command = (DrawElementsIndirectCommand *)commands.data;
+    unsigned int numIndices = 0;
+    for (size_t slot = 0; slot < numDraws; slot++)
+    {
+        unsigned int drawIndex = _drawOrder[slot];
+        const Meshlet &meshlet = _meshlets[_drawMeshletIndices[drawIndex]];
+        instance[slot] = _drawInstances[drawIndex];
+        numIndices += meshlet.indexCount;
+        if (writeCommands)
+        {
+            command[slot].count = meshlet.indexCount;
+            command[slot].instanceCount = 1;
+            command[slot].firstIndex = meshlet.firstIndex;
+            command[slot].baseVertex = meshlet.baseVertex;
+            command[slot].baseInstance = (unsigned int)slot;
+        }
+    }
+    if (writeCommands)
+    {
+        *commandOffset = commands.offset;
+    }
+
+    _stats.numDraws = (unsigned int)numDraws;
+    _stats.numTriangles = numIndices / 3;
+    _stats.numFullDetailTriangles = _numFullDetailIndices / 3;
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Sets up everything that all the draws share: program, VAO, texture, and where the
+    instances are.
+Parameters:
+    textureId           The 2D texture that every mesh is drawn with.
+    instanceBufferId    The buffer with the instances...
+    instanceOffset      ...starting here.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void MultiDrawRenderer::BindForDrawing(unsigned int textureId, unsigned int instanceBufferId,
+    size_t instanceOffset)
+{
+    GlStateCache &stateCache = GlStateCache::Shared();
+    stateCache.UseProgram(_programId);
+    stateCache.Uniform1i(_reflection.UniformLocation(TEX_NAME_ID), 0);
+    stateCache.BindVertexArray(_vaoId);
+    stateCache.BindTexture(0, GL_TEXTURE_2D, textureId);
+    glBindVertexBuffer(INSTANCE_BINDING, instanceBufferId, instanceOffset,
+        MESH_INSTANCE_LAYOUT.stride);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether UpdateMeshes() has anything to catch up with.
+Parameters: None
+Returns:
+    True if meshes were added or removed or any of the arenas repacked since it last ran.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool MultiDrawRenderer::ArenasChanged() const
+{
+    bool changed = _meshesChanged || (_vertexArena->Generation() != _vertexArenaGeneration);
+    for (int widthIndex = 0; widthIndex < INDEX_WIDTH_COUNT; widthIndex++)
+    {
+        changed = changed ||
+            (_indexArenas[widthIndex]->Generation() != _indexArenaGenerations[widthIndex]);
+    }
+    return changed;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Catches up with the meshes that were added or removed and with the arenas repacking:
+    looks up where each meshlet is now, points the VAO at the vertex arena's buffer, and
+    replaces the mesh info that GpuCuller reads.
+
+    Note: The index arenas' buffers are bound by each draw call, since there's one per width.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void MultiDrawRenderer::UpdateMeshes()
+{
+    for (size_t meshletCount = 0; meshletCount < _meshlets.size(); meshletCount++)
+    {
+        Meshlet &meshlet = _meshlets[meshletCount];
+        meshlet.firstIndex = _indexArenas[meshlet.indexWidth]->Offset(meshlet.indexHandle);
+        meshlet.baseVertex = (int)_vertexArena->Offset(meshlet.vertexHandle);
+    }
+    _vertexArenaGeneration = _vertexArena->Generation();
+    for (int widthIndex = 0; widthIndex < INDEX_WIDTH_COUNT; widthIndex++)
+    {
+        _indexArenaGenerations[widthIndex] = _indexArenas[widthIndex]->Generation();
+    }
+
+    GlStateCache &stateCache = GlStateCache::Shared();
+    stateCache.BindVertexArray(_vaoId);
+    glBindVertexBuffer(VERTEX_BINDING, _vertexArena->BufferId(), 0,
+        GetVertexFormatDescription(_vertexFormat).layout.stride);
+
+    // removed meshes have an index count of 0, so the culler's commands for them (if there
+    // were any) would draw nothing
+    std::vector<CullMeshInfo> meshInfos(_meshlets.size());
+    for (size_t meshletCount = 0; meshletCount < _meshlets.size(); meshletCount++)
+    {
+        const Meshlet &meshlet = _meshlets[meshletCount];
+        meshInfos[meshletCount].indexCount = meshlet.indexCount;
+        meshInfos[meshletCount].firstIndex = meshlet.firstIndex;
+        meshInfos[meshletCount].baseVertex = meshlet.baseVertex;
+        meshInfos[meshletCount].radius = meshlet.packedRadius;
+        memcpy(meshInfos[meshletCount].center, meshlet.packedCenter,
+            sizeof(meshInfos[meshletCount].center));
+        meshInfos[meshletCount].group = meshlet.indexWidth;
+    }
+    if (!meshInfos.empty())
+    {
+        stateCache.BindBuffer(GL_COPY_WRITE_BUFFER, _meshInfoBufferId);
+        glBufferData(GL_COPY_WRITE_BUFFER, meshInfos.size() * sizeof(CullMeshInfo),
+            meshInfos.data(), GL_STATIC_DRAW);
+    }
+    _meshesChanged = false;
+}
@@ -0,0 +1,216 @@
+#pragma once
+
+#include "Mesh.h"
+#include "MeshPacking.h"
+#include "MeshSimplifier.h"
+#include "ProgramReflection.h"
+
+#include <vector>
+
+class DynamicVertexBuffer;
+class GpuCuller;
+class GpuBufferArena;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    One draw in a glMultiDrawElementsIndirect(...) call.  The layout is OpenGL's (see the
+    spec's DrawElementsIndirectCommand), so it can't change.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct DrawElementsIndirectCommand
+{
+    unsigned int count;         // indices
+    unsigned int instanceCount;
+    unsigned int firstIndex;    // in the shared index buffer
+    int baseVertex;             // added to each index, to find the mesh in the shared vertices
+    unsigned int baseInstance;  // which MeshInstance the draw's attributes come from
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Where one drawn mesh goes and what color it's tinted.  This is also the layout of the
+    per-draw vertex attributes (see mesh.vert), so it is packed to 20 bytes.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct MeshInstance
+{
+    float position[3];      // in normalized device coordinates
+    float scale;            // meshes are about 1 unit across before this
+    unsigned char tint[4];  // RGBA, multiplied with the texture
+};
+
+// mesh.vert's per-draw inputs
+// Note: The tint is 4 bytes that the shader sees as 0 - 1 floats (normalized).
+static constexpr VertexAttribute MESH_INSTANCE_ATTRIBUTES[] =
+{
+    VERTEX_ATTRIBUTE(MeshInstance, position, 2),
+    VERTEX_ATTRIBUTE(MeshInstance, scale, 3),
+    VERTEX_ATTRIBUTE_NORMALIZED(MeshInstance, tint, 4),
+};
+static_assert(VertexAttributesFit<MeshInstance>(MESH_INSTANCE_ATTRIBUTES),
+    "MeshInstance's attributes don't fit it");
+static constexpr VertexLayout MESH_INSTANCE_LAYOUT =
+    MakeVertexLayout<MeshInstance>(MESH_INSTANCE_ATTRIBUTES, 1);
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How the last Submit...() went.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct MultiDrawStats
+{
+    unsigned int numDraws;          // before culling, for SubmitCulled(...), one per meshlet
+    unsigned int numDrawCalls;      // OpenGL draw calls that it took (one per index width)
+    unsigned int numTriangles;      // same
+    unsigned int numFullDetailTriangles;    // what it would have been without LODs
+    double cpuSeconds;              // writing the commands and instances, and the draw calls
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Draws lots of different meshes with one draw call (or one per index width; see below).
+
+    Every mesh goes into a shared vertex arena and one of the shared index arenas (see
+    GpuBufferArena.h, and AddMesh(...)), and is known from then on by where it landed: its
+    first index, index count, and base vertex.  Each frame, Draw(...) queues up a mesh and
+    where to put it, and Submit() writes a DrawElementsIndirectCommand and a MeshInstance per
+    draw into the frame's piece of a DynamicVertexBuffer and hands all of them to the GPU with
+    one glMultiDrawElementsIndirect(...) (OpenGL 4.3).  Nothing changes between the draws (no
+    VAO, no buffers, no uniforms), so the driver's cost per draw is small and the CPU's is two
+    small structs, which keeps the cost of a frame nearly the same whether it has 100 meshes
+    or 10,000.  Each command's base instance picks its MeshInstance.
+
+    Note: All the meshes share one texture per Submit(...), since one draw call can't change
+    textures.
+
+    SubmitCulled(...) has the GPU decide which draws are in view and write the commands for
+    just those (see GpuCuller.h), so the CPU only writes where each mesh goes.
+
+    Each mesh's indices are as narrow as its vertex count allows (see IndexWidth), in an index
+    arena per width, and a mesh with more vertices than SetMaxMeshletVertices(...) is cut into
+    meshlets (see SplitIntoMeshlets(...)) that are each drawn, and culled, on their own.  A
+    draw call can only have one index type, so Submit...() groups the draws by index width
+    and makes a glMultiDrawElementsIndirect(...) for each width that has any: 3 draw calls at
+    most, however many meshes.
+
+    A mesh can come with levels of detail (see AddMeshLods(...)), and then Draw(...) picks
+    the coarsest one that still looks the same at the size that the draw is on the screen.
+
+    Also Note: SubmitOneDrawPerMesh() draws the same things with a draw call per mesh, for
+    comparing against (see BenchmarkMultiDraw(...)).
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class MultiDrawRenderer
+{
+public:
+    MultiDrawRenderer();
+    ~MultiDrawRenderer();
+
+    // these need the OpenGL context to be current
+    bool Init(GpuBufferArena &vertexArena, GpuBufferArena *indexArenas,
+        VertexFormat vertexFormat);
+    void Shutdown();
+    void SetProgram(unsigned int programId);
+    void SetDynamicBuffer(DynamicVertexBuffer *dynamicBuffer);
+    void SetMaxMeshletVertices(unsigned int maxVertices);
+    void SetLodSelection(float screenHeight, float maxPixelError);
+
+    unsigned int AddMesh(const MeshData &mesh);
+    unsigned int AddMesh(const PackedMesh &mesh);
+    unsigned int AddMeshLods(const std::vector<MeshLod> &lods);
+    void RemoveMesh(unsigned int meshIndex);
+    unsigned int NumMeshes() const;
+    unsigned int NumMeshlets(unsigned int meshIndex) const;
+    VertexFormat Format() const;
+    float MeshRadius(unsigned int meshIndex) const;
+    bool MeshletBounds(unsigned int meshIndex, unsigned int meshletCount, float *center,
+        float *radius) const;
+    bool IsReady() const;
+
+    void Begin();
+    void Draw(unsigned int meshIndex, const MeshInstance &instance);
+    void Submit(unsigned int textureId);
+    void SubmitCulled(unsigned int textureId, GpuCuller &culler);
+    void SubmitOneDrawPerMesh(unsigned int textureId);
+
+    const MultiDrawStats &Stats() const;
+
+    // how much of a DynamicVertexBuffer's frame each draw (each meshlet) takes (plus
+    // alignment)
+    static const unsigned int BYTES_PER_DRAW =
+        sizeof(DrawElementsIndirectCommand) + sizeof(MeshInstance);
+
+    static const unsigned int NO_MESH = 0xFFFFFFFF;
+
+private:
+    MultiDrawRenderer(const MultiDrawRenderer &);
+    MultiDrawRenderer &operator=(const MultiDrawRenderer &);
+
+    // one draw's worth of a mesh: all of it, or one of its meshlets
+    struct Meshlet
+    {
+        unsigned int vertexHandle;  // in the arenas
+        unsigned int indexHandle;
+        IndexWidth indexWidth;      // which index arena
+
+        // where the arenas' handles are right now
+        unsigned int firstIndex;
+        unsigned int indexCount;
+        int baseVertex;
+
+        // how the positions were packed (scale 1 and bias 0 for floats), and the bounding
+        // sphere in units of the scale, for the GPU culler (see Draw(...))
+        PositionQuantization quantization;
+        float packedCenter[3];
+        float packedRadius;
+    };
+
+    // the meshlets that make up a mesh, which are always next to each other in _meshlets,
+    // and the mesh's next coarser level of detail (if it has one)
+    struct MeshMeshlets
+    {
+        unsigned int firstMeshlet;
+        unsigned int numMeshlets;
+        unsigned int numIndices;    // in all of them
+        float radius;               // the farthest vertex from the mesh's origin
+        unsigned int coarserMesh;   // NO_MESH if this is the coarsest (or only) one
+        float lodError;             // how far this level strays from the finest (see MeshLod)
+    };
+
+    bool AddMeshlet(const PackedMesh &mesh);
+    bool WriteFrameData(bool writeCommands, size_t *instanceOffset, size_t *commandOffset);
+    void BindForDrawing(unsigned int textureId, unsigned int instanceBufferId,
+        size_t instanceOffset);
+    bool ArenasChanged() const;
+    void UpdateMeshes();
+
+    unsigned int _programId;
+    ProgramReflection _reflection;
+    DynamicVertexBuffer *_dynamicBuffer;
+
+    // where every mesh's vertices and indices are, and what the vertices look like
+    // Note: Repacking an arena moves them, and its generation says when to look again.
+    VertexFormat _vertexFormat;
+    GpuBufferArena *_vertexArena;
+    GpuBufferArena *_indexArenas[INDEX_WIDTH_COUNT];
+    unsigned int _vertexArenaGeneration;
+    unsigned int _indexArenaGenerations[INDEX_WIDTH_COUNT];
+    std::vector<MeshMeshlets> _meshes;
+    std::vector<Meshlet> _meshlets;
+    unsigned int _maxMeshletVertices;
+    float _lodPixelsPerUnit;        // 0 for always the finest level of detail
+    float _maxLodPixelError;
+    bool _meshesChanged;
+    unsigned int _meshInfoBufferId;     // a CullMeshInfo per meshlet, for GpuCuller
+    unsigned int _vaoId;
+
+    // this frame's draws, a meshlet each, and which draw is in each slot once they're
+    // grouped by index width
+    std::vector<unsigned int> _drawMeshletIndices;
+    std::vector<MeshInstance> _drawInstances;
+    std::vector<unsigned int> _drawOrder;
+    unsigned int _numDrawsPerWidth[INDEX_WIDTH_COUNT];
+    unsigned int _numFullDetailIndices;
+
+    MultiDrawStats _stats;
+};
@@ -0,0 +1,225 @@
+#include "glload/include/glload/gl_4_4.h"
+
+#include "OffscreenFramebuffer.h"
+
+#include <stdio.h>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out with nothing made.  See Create(...).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+OffscreenFramebuffer::OffscreenFramebuffer() :
+    _framebufferId(0),
+    _colorRenderbufferId(0),
+    _depthStencilRenderbufferId(0),
+    _width(0),
+    _height(0)
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Nothing.  OpenGL objects can only be deleted while the context is current, which it
+    usually isn't by the time a global is destroyed, so call Destroy() before that.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+OffscreenFramebuffer::~OffscreenFramebuffer()
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes the framebuffer and its attachments.
+Parameters:
+    width   In pixels.
+    height  In pixels.
+Returns:
+    True if the framebuffer is complete and ready to draw into.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool OffscreenFramebuffer::Create(unsigned int width, unsigned int height)
+{
+    Destroy();
+    _width = width;
+    _height = height;
+
+    glGenRenderbuffers(1, &_colorRenderbufferId);
+    glBindRenderbuffer(GL_RENDERBUFFER, _colorRenderbufferId);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &_depthStencilRenderbufferId);
+    glBindRenderbuffer(GL_RENDERBUFFER, _depthStencilRenderbufferId);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &_framebufferId);
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebufferId);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+        _colorRenderbufferId);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER,
+        _depthStencilRenderbufferId);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        printf("offscreen framebuffer is incomplete (status 0x%x)\n", status);
+        Destroy();
+        return false;
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Deletes the framebuffer and its attachments.  Safe to call more than once.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void OffscreenFramebuffer::Destroy()
+{
+    if (_framebufferId != 0)
+    {
+        glDeleteFramebuffers(1, &_framebufferId);
+        _framebufferId = 0;
+    }
+    if (_colorRenderbufferId != 0)
+    {
+        glDeleteRenderbuffers(1, &_colorRenderbufferId);
+        _colorRenderbufferId = 0;
+    }
+    if (_depthStencilRenderbufferId != 0)
+    {
+        glDeleteRenderbuffers(1, &_depthStencilRenderbufferId);
+        _depthStencilRenderbufferId = 0;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes this the framebuffer that draws (and reads) go to, and sets the viewport to cover
+    it.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void OffscreenFramebuffer::Bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebufferId);
+    glViewport(0, 0, _width, _height);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Copies the color attachment back to the CPU.  This waits for all drawing to finish.
+Parameters:
+    rgba8Pixels     Gets width * height pixels, 4 bytes each, bottom row first.
+Returns:
+    False if there's no framebuffer.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool OffscreenFramebuffer::ReadPixels(std::vector<unsigned char> *rgba8Pixels)
+{
+    if (_framebufferId == 0)
+    {
+        return false;
+    }
+
+    rgba8Pixels->resize((size_t)_width * _height * 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebufferId);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, rgba8Pixels->data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Saves what was drawn as a binary .ppm image (about the simplest image format there is, and
+    most image viewers open it) so that a headless run can be checked by eye.
+Parameters:
+    filePath    Where to save it.
+Returns:
+    True if the file was written.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool OffscreenFramebuffer::WritePpmFile(const char *filePath)
+{
+    std::vector<unsigned char> pixels;
+    if (!ReadPixels(&pixels))
+    {
+        return false;
+    }
+
+    FILE *file = fopen(filePath, "wb");
+    if (file == 0)
+    {
+        printf("could not open '%s' for writing\n", filePath);
+        return false;
+    }
+
+    // .ppm rows go top to bottom, OpenGL's go bottom to top, and .ppm has no alpha
+    fprintf(file, "P6\n%u %u\n255\n", _width, _height);
+    std::vector<unsigned char> row((size_t)_width * 3);
+    bool good = true;
+    for (unsigned int rowCount = 0; good && (rowCount < _height); rowCount++)
+    {
+        const unsigned char *source = &pixels[(size_t)(_height - 1 - rowCount) * _width * 4];
+        for (unsigned int col = 0; col < _width; col++)
+        {
+            row[(col * 3) + 0] = source[(col * 4) + 0];
+            row[(col * 3) + 1] = source[(col * 4) + 1];
+            row[(col * 3) + 2] = source[(col * 4) + 2];
+        }
+        good = (fwrite(row.data(), row.size(), 1, file) == 1);
+    }
+
+    if ((fclose(file) != 0) || !good)
+    {
+        printf("could not write all of '%s'\n", filePath);
+        return false;
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The width in pixels.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int OffscreenFramebuffer::Width() const
+{
+    return _width;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The height in pixels.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int OffscreenFramebuffer::Height() const
+{
+    return _height;
+}
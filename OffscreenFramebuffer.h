@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A framebuffer object with a color and a depth/stencil renderbuffer, for drawing without a
+    window.  It matches what the glut window asks for (RGBA, depth, stencil) so that display()
+    draws the same thing into either one.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class OffscreenFramebuffer
+{
+public:
+    OffscreenFramebuffer();
+    ~OffscreenFramebuffer();
+
+    // these need a current OpenGL context
+    bool Create(unsigned int width, unsigned int height);
+    void Destroy();
+    void Bind();
+    bool ReadPixels(std::vector<unsigned char> *rgba8Pixels);
+    bool WritePpmFile(const char *filePath);
+
+    unsigned int Width() const;
+    unsigned int Height() const;
+
+private:
+    OffscreenFramebuffer(const OffscreenFramebuffer &);
+    OffscreenFramebuffer &operator=(const OffscreenFramebuffer &);
+
+    unsigned int _framebufferId;
+    unsigned int _colorRenderbufferId;
+    unsigned int _depthStencilRenderbufferId;
+    unsigned int _width;
+    unsigned int _height;
+};
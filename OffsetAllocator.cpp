@@ -0,0 +1,396 @@
+#include "OffsetAllocator.h"
+
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>     // _BitScanForward(...) and _BitScanReverse(...)
+#endif
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Finds the lowest bit that is set.
+Parameters:
+    value   Not 0.
+Returns:
+    The bit's index (0 - 31).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static unsigned int LowestSetBit(unsigned int value)
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward(&index, value);
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctz(value);
+#endif
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Finds the highest bit that is set.
+Parameters:
+    value   Not 0.
+Returns:
+    The bit's index (0 - 31).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static unsigned int HighestSetBit(unsigned int value)
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanReverse(&index, value);
+    return (unsigned int)index;
+#else
+    return 31 - (unsigned int)__builtin_clz(value);
+#endif
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Which bin a size goes in.  Sizes under 8 get a bin each, and above that, the bin is the
+    size's highest set bit (the "exponent") and the 3 bits after it (the "mantissa"), so each
+    power of 2 is split into 8 bins.
+Parameters:
+    size        Not 0.
+    roundUp     False for the bin whose sizes are the closest at or below this size (where a
+                free range of this size is kept), true for the one whose sizes are all at least
+                this size (where a request of this size is certain to fit).
+Returns:
+    The bin (0 - 240).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static unsigned int SizeToBin(unsigned int size, bool roundUp)
+{
+    if (size < 8)
+    {
+        return size;
+    }
+
+    unsigned int mantissaStartBit = HighestSetBit(size) - 3;
+    unsigned int exponent = mantissaStartBit + 1;
+    unsigned int mantissa = (size >> mantissaStartBit) & 7;
+    unsigned int bin = (exponent << 3) | mantissa;
+    if (roundUp && ((size & ((1u << mantissaStartBit) - 1)) != 0))
+    {
+        // carries into the exponent on its own if the mantissa was 7
+        bin++;
+    }
+    return bin;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out with nothing to hand out.  See Reset(...).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+OffsetAllocator::OffsetAllocator()
+{
+    Reset(0);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Forgets every range that was handed out and makes the whole space (0 - size) one free
+    range.
+Parameters:
+    size    How big the space is, in whatever units the caller wants.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void OffsetAllocator::Reset(unsigned int size)
+{
+    _size = size;
+    _freeSize = 0;
+    _usedTopBins = 0;
+    memset(_usedBins, 0, sizeof(_usedBins));
+    for (unsigned int binCount = 0; binCount < NUM_BINS; binCount++)
+    {
+        _binHeads[binCount] = NO_NODE;
+    }
+    _nodes.clear();
+    _unusedNodes.clear();
+
+    if (size > 0)
+    {
+        InsertFree(NewNode(0, size));
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Takes a range of the given size from the front of the smallest free range that is certain
+    to fit it, and puts the rest of that free range back.
+Parameters:
+    size    How much.  Not 0.
+    offset  Gets where the range starts.
+Returns:
+    The range's node, for Free(...), or NO_NODE if no free range is big enough.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int OffsetAllocator::Allocate(unsigned int size, unsigned int *offset)
+{
+    if ((size == 0) || (size > _freeSize))
+    {
+        return NO_NODE;
+    }
+
+    // the first non-empty bin at or after the smallest one that fits: first in the same top
+    // bin, and then in the top bins after it
+    unsigned int node = NO_NODE;
+    unsigned int minBin = SizeToBin(size, true);
+    unsigned int topBin = minBin / BINS_PER_TOP_BIN;
+    unsigned int bins = _usedBins[topBin] & (0xFFu << (minBin % BINS_PER_TOP_BIN)) & 0xFFu;
+    if (bins == 0)
+    {
+        unsigned int topBins = (topBin + 1 < NUM_TOP_BINS) ?
+            (_usedTopBins & (0xFFFFFFFFu << (topBin + 1))) : 0;
+        if (topBins != 0)
+        {
+            topBin = LowestSetBit(topBins);
+            bins = _usedBins[topBin];
+        }
+    }
+    if (bins != 0)
+    {
+        node = _binHeads[(topBin * BINS_PER_TOP_BIN) + LowestSetBit(bins)];
+    }
+    else
+    {
+        // the ranges in the bin just below might still be big enough, just not certain to be
+        // (like the one free range that's left right after GpuBufferArena repacks for exactly 
+        // this size)
+        node = _binHeads[SizeToBin(size, false)];
+        while ((node != NO_NODE) && (_nodes[node].size < size))
+        {
+            node = _nodes[node].binNext;
+        }
+        if (node == NO_NODE)
+        {
+            return NO_NODE;
+        }
+    }
+
+    RemoveFree(node);
+    unsigned int remainder = _nodes[node].size - size;
+    _nodes[node].size = size;
+    _nodes[node].used = true;
+    if (remainder > 0)
+    {
+        // Note: NewNode(...) can move _nodes, so no references across it.
+        unsigned int rest = NewNode(_nodes[node].offset + size, remainder);
+        unsigned int next = _nodes[node].neighborNext;
+        _nodes[rest].neighborPrev = node;
+        _nodes[rest].neighborNext = next;
+        if (next != NO_NODE)
+        {
+            _nodes[next].neighborPrev = rest;
+        }
+        _nodes[node].neighborNext = rest;
+        InsertFree(rest);
+    }
+
+    *offset = _nodes[node].offset;
+    return node;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Gives a range back, merged with the free ranges right before and after it (if they are).
+Parameters:
+    node    From Allocate(...).  NO_NODE and nodes that are already free are ignored.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void OffsetAllocator::Free(unsigned int node)
+{
+    if ((node >= _nodes.size()) || !_nodes[node].used)
+    {
+        return;
+    }
+    _nodes[node].used = false;
+
+    unsigned int prev = _nodes[node].neighborPrev;
+    if ((prev != NO_NODE) && !_nodes[prev].used)
+    {
+        RemoveFree(prev);
+        _nodes[node].offset = _nodes[prev].offset;
+        _nodes[node].size += _nodes[prev].size;
+        _nodes[node].neighborPrev = _nodes[prev].neighborPrev;
+        if (_nodes[node].neighborPrev != NO_NODE)
+        {
+            _nodes[_nodes[node].neighborPrev].neighborNext = node;
+        }
+        _unusedNodes.push_back(prev);
+    }
+
+    unsigned int next = _nodes[node].neighborNext;
+    if ((next != NO_NODE) && !_nodes[next].used)
+    {
+        RemoveFree(next);
+        _nodes[node].size += _nodes[next].size;
+        _nodes[node].neighborNext = _nodes[next].neighborNext;
+        if (_nodes[node].neighborNext != NO_NODE)
+        {
+            _nodes[_nodes[node].neighborNext].neighborPrev = node;
+        }
+        _unusedNodes.push_back(next);
+    }
+
+    InsertFree(node);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The size given to Reset(...).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int OffsetAllocator::Size() const
+{
+    return _size;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    How much isn't handed out, in total.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int OffsetAllocator::FreeSize() const
+{
+    return _freeSize;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Finds the biggest free range, which is the most that one Allocate(...) could get.  When
+    this is much smaller than FreeSize(), the space is fragmented.
+Parameters: None
+Returns:
+    Its size, or 0 if nothing is free.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int OffsetAllocator::LargestFreeRange() const
+{
+    if (_usedTopBins == 0)
+    {
+        return 0;
+    }
+
+    // the biggest ranges are in the last non-empty bin, but its ranges aren't all one size
+    unsigned int topBin = HighestSetBit(_usedTopBins);
+    unsigned int bin = (topBin * BINS_PER_TOP_BIN) + HighestSetBit(_usedBins[topBin]);
+    unsigned int largest = 0;
+    for (unsigned int node = _binHeads[bin]; node != NO_NODE; node = _nodes[node].binNext)
+    {
+        largest = (_nodes[node].size > largest) ? _nodes[node].size : largest;
+    }
+    return largest;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Gets a node to describe a range, reusing one from a merge if there is one.
+Parameters:
+    offset  Where the range starts.
+    size    How big it is.
+Returns:
+    The node.  It is marked used and isn't linked to anything.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int OffsetAllocator::NewNode(unsigned int offset, unsigned int size)
+{
+    Node newNode = { offset, size, true, NO_NODE, NO_NODE, NO_NODE, NO_NODE };
+    if (!_unusedNodes.empty())
+    {
+        unsigned int node = _unusedNodes.back();
+        _unusedNodes.pop_back();
+        _nodes[node] = newNode;
+        return node;
+    }
+    _nodes.push_back(newNode);
+    return (unsigned int)(_nodes.size() - 1);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Marks a range free and puts it at the front of its bin.
+Parameters:
+    node    The range.  Not in a bin already.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void OffsetAllocator::InsertFree(unsigned int node)
+{
+    unsigned int bin = SizeToBin(_nodes[node].size, false);
+    _nodes[node].used = false;
+    _nodes[node].binPrev = NO_NODE;
+    _nodes[node].binNext = _binHeads[bin];
+    if (_binHeads[bin] != NO_NODE)
+    {
+        _nodes[_binHeads[bin]].binPrev = node;
+    }
+    _binHeads[bin] = node;
+
+    _usedTopBins |= 1u << (bin / BINS_PER_TOP_BIN);
+    _usedBins[bin / BINS_PER_TOP_BIN] |= (unsigned char)(1u << (bin % BINS_PER_TOP_BIN));
+    _freeSize += _nodes[node].size;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Takes a free range out of its bin.
+Parameters:
+    node    The range.  In a bin.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void OffsetAllocator::RemoveFree(unsigned int node)
+{
+    unsigned int bin = SizeToBin(_nodes[node].size, false);
+    unsigned int prev = _nodes[node].binPrev;
+    unsigned int next = _nodes[node].binNext;
+    if (prev != NO_NODE)
+    {
+        _nodes[prev].binNext = next;
+    }
+    else
+    {
+        _binHeads[bin] = next;
+    }
+    if (next != NO_NODE)
+    {
+        _nodes[next].binPrev = prev;
+    }
+
+    if (_binHeads[bin] == NO_NODE)
+    {
+        unsigned int topBin = bin / BINS_PER_TOP_BIN;
+        _usedBins[topBin] &= (unsigned char)~(1u << (bin % BINS_PER_TOP_BIN));
+        if (_usedBins[topBin] == 0)
+        {
+            _usedTopBins &= ~(1u << topBin);
+        }
+    }
+    _freeSize -= _nodes[node].size;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Hands out ranges of some linear space (the elements of a GPU buffer, in GpuBufferArena's
+    case) without ever touching the space itself, so it knows nothing about OpenGL.
+
+    This is a TLSF ("two-level segregated fit") allocator.  Free ranges are kept in 256 lists
+    ("bins") by size, where each power of 2 is split into 8 bins (like a float with a 3-bit
+    mantissa), and two levels of bitmasks say which bins have anything in them.  Allocating
+    finds the first non-empty bin that is certain to fit with a couple of bit scans, and
+    freeing merges the range with the free ranges on either side of it.  Both take the same
+    small amount of time no matter how many ranges there are, and the waste from rounding up
+    is at most 1/8th.
+
+    Note: The free ranges that are left over can still be too scattered to fit a big request
+    even when there is enough free space in total.  That's what GpuBufferArena::Defragment()
+    is for.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class OffsetAllocator
+{
+public:
+    OffsetAllocator();
+
+    void Reset(unsigned int size);
+
+    unsigned int Allocate(unsigned int size, unsigned int *offset);
+    void Free(unsigned int node);
+
+    unsigned int Size() const;
+    unsigned int FreeSize() const;
+    unsigned int LargestFreeRange() const;
+
+    static const unsigned int NO_NODE = 0xFFFFFFFF;
+
+private:
+    struct Node
+    {
+        unsigned int offset;
+        unsigned int size;
+        bool used;
+
+        // the other free ranges in the same bin
+        unsigned int binPrev;
+        unsigned int binNext;
+
+        // the ranges right before and after this one in the space
+        unsigned int neighborPrev;
+        unsigned int neighborNext;
+    };
+
+    unsigned int NewNode(unsigned int offset, unsigned int size);
+    void InsertFree(unsigned int node);
+    void RemoveFree(unsigned int node);
+
+    static const unsigned int NUM_TOP_BINS = 32;
+    static const unsigned int BINS_PER_TOP_BIN = 8;
+    static const unsigned int NUM_BINS = NUM_TOP_BINS * BINS_PER_TOP_BIN;
+
+    unsigned int _size;
+    unsigned int _freeSize;
+
+    // which top bins have a non-empty bin, and which of their bins are non-empty
+    unsigned int _usedTopBins;
+    unsigned char _usedBins[NUM_TOP_BINS];
+    unsigned int _binHeads[NUM_BINS];
+
+    std::vector<Node> _nodes;
+    std::vector<unsigned int> _unusedNodes;
+};
@@ -0,0 +1,274 @@
+#include "glload/include/glload/gl_4_4.h"
+
+#include "ProgramBinaryCache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <direct.h>     // _mkdir(...)
+#else
+#include <sys/stat.h>   // mkdir(...)
+#endif
+
+// at the start of every cache file, so that a truncated or foreign file is rejected before
+// the driver ever sees it
+struct ProgramCacheFileHeader
+{
+    char magic[4];
+    uint32_t fileVersion;
+    uint32_t binaryFormat;
+    uint32_t numBinaryBytes;
+};
+
+static const char PROGRAM_CACHE_MAGIC[4] = { 'P', 'B', 'I', 'N' };
+static const uint32_t PROGRAM_CACHE_FILE_VERSION = 1;
+
+// where FNV-1a hashes start (see HashBytes(...))
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    64-bit FNV-1a.  Not cryptographic, but plenty to tell shader sources apart, and simple
+    enough to not need a library.
+Parameters:
+    hash    The hash so far (start with FNV_OFFSET_BASIS).
+    bytes   What to add to it.
+    count   How many bytes.
+Returns:
+    The updated hash.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static uint64_t HashBytes(uint64_t hash, const void *bytes, size_t count)
+{
+    const unsigned char *byte = (const unsigned char *)bytes;
+    for (size_t byteCount = 0; byteCount < count; byteCount++)
+    {
+        hash ^= byte[byteCount];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Adds a string and its length to the hash.  The length is there so that moving text from
+    the end of one source to the start of the next still changes the hash.
+Parameters:
+    hash    The hash so far.
+    text    What to add.  May be null (for a glGetString(...) that failed).
+Returns:
+    The updated hash.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static uint64_t HashString(uint64_t hash, const char *text)
+{
+    uint64_t length = (text != 0) ? strlen(text) : 0;
+    hash = HashBytes(hash, &length, sizeof(length));
+    return HashBytes(hash, text, (size_t)length);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Where a program's cache file goes.
+Parameters:
+    cacheDirectory  The cache's directory.
+    cacheKey        From MakeProgramCacheKey(...).
+Returns:
+    The file's path.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static std::string CacheFilePath(const char *cacheDirectory, const std::string &cacheKey)
+{
+    return std::string(cacheDirectory) + "/" + cacheKey + ".bin";
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Program binaries are core since OpenGL 4.1, but a driver is allowed to support zero binary
+    formats, in which case there's nothing to cache.
+Parameters: None
+Returns:
+    True if the driver can hand back (and take) program binaries.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool IsProgramBinaryCacheSupported()
+{
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    return numFormats > 0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes the name that a program is cached under.
+
+    A program binary is only good for the exact driver that made it, so the driver's vendor,
+    renderer, and version strings go into the hash along with the sources.  The driver can
+    still reject a binary (see LoadCachedProgram(...)), but this way that's rare.
+Parameters:
+    shaderSources   The full text of every shader in the program, in the order that they're
+                    attached.
+Returns:
+    16 hex digits.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+std::string MakeProgramCacheKey(const std::vector<std::string> &shaderSources)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    hash = HashString(hash, (const char *)glGetString(GL_VENDOR));
+    hash = HashString(hash, (const char *)glGetString(GL_RENDERER));
+    hash = HashString(hash, (const char *)glGetString(GL_VERSION));
+    for (size_t sourceCount = 0; sourceCount < shaderSources.size(); sourceCount++)
+    {
+        hash = HashString(hash, shaderSources[sourceCount].c_str());
+    }
+
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+    return std::string(key);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes a program from its cached binary, if there is one.
+
+    Even with the driver's strings in the key, the driver may still say no (they don't have to
+    bump their version string for every change that affects binaries), so the link status is
+    checked.  A rejected file is deleted so that the program gets compiled and cached again.
+Parameters:
+    cacheDirectory  The cache's directory.
+    cacheKey        From MakeProgramCacheKey(...).
+Returns:
+    The OpenGL ID of the linked program, or 0 if there's no usable cache entry (compile it
+    from source instead).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int LoadCachedProgram(const char *cacheDirectory, const std::string &cacheKey)
+{
+    std::string filePath = CacheFilePath(cacheDirectory, cacheKey);
+    FILE *file = fopen(filePath.c_str(), "rb");
+    if (file == 0)
+    {
+        // not cached yet; not an error
+        return 0;
+    }
+
+    ProgramCacheFileHeader header;
+    memset(&header, 0, sizeof(header));
+    std::vector<unsigned char> binary;
+    bool good = (fread(&header, sizeof(header), 1, file) == 1) &&
+        (memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) == 0) &&
+        (header.fileVersion == PROGRAM_CACHE_FILE_VERSION) && (header.numBinaryBytes > 0);
+    if (good)
+    {
+        binary.resize(header.numBinaryBytes);
+        good = (fread(binary.data(), binary.size(), 1, file) == 1);
+    }
+    fclose(file);
+
+    GLuint programId = 0;
+    if (good)
+    {
+        programId = glCreateProgram();
+        glProgramBinary(programId, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+        GLint isLinked = GL_FALSE;
+        glGetProgramiv(programId, GL_LINK_STATUS, &isLinked);
+        if (isLinked == GL_FALSE)
+        {
+            glDeleteProgram(programId);
+            programId = 0;
+            good = false;
+        }
+    }
+
+    if (!good)
+    {
+        printf("program cache entry '%s' was rejected; recompiling\n", filePath.c_str());
+        remove(filePath.c_str());
+    }
+
+    return programId;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Saves a linked program's binary so that LoadCachedProgram(...) can skip compiling it next
+    time.  The directory is made if it doesn't exist.
+
+    Note: Set GL_PROGRAM_BINARY_RETRIEVABLE_HINT on the program before linking it.  Some
+    drivers won't hand back a binary otherwise.
+    Also Note: The file is written under a temporary name and then renamed, so a crash part way
+    through can't leave a truncated entry under the real name.
+Parameters:
+    cacheDirectory  The cache's directory.
+    cacheKey        From MakeProgramCacheKey(...).
+    programId       A successfully linked program.
+Returns:
+    True if the entry was written.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool SaveCachedProgram(const char *cacheDirectory, const std::string &cacheKey,
+    unsigned int programId)
+{
+    GLint numBinaryBytes = 0;
+    glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &numBinaryBytes);
+    if (numBinaryBytes <= 0)
+    {
+        return false;
+    }
+
+    std::vector<unsigned char> binary(numBinaryBytes);
+    GLenum binaryFormat = 0;
+    GLsizei numBytesWritten = 0;
+    glGetProgramBinary(programId, numBinaryBytes, &numBytesWritten, &binaryFormat,
+        binary.data());
+    if (numBytesWritten <= 0)
+    {
+        return false;
+    }
+
+    // fails harmlessly if it's already there
+#ifdef _WIN32
+    _mkdir(cacheDirectory);
+#else
+    mkdir(cacheDirectory, 0755);
+#endif
+
+    std::string filePath = CacheFilePath(cacheDirectory, cacheKey);
+    std::string tempFilePath = filePath + ".tmp";
+    FILE *file = fopen(tempFilePath.c_str(), "wb");
+    if (file == 0)
+    {
+        printf("could not open '%s' for writing\n", tempFilePath.c_str());
+        return false;
+    }
+
+    ProgramCacheFileHeader header;
+    memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+    header.fileVersion = PROGRAM_CACHE_FILE_VERSION;
+    header.binaryFormat = binaryFormat;
+    header.numBinaryBytes = (uint32_t)numBytesWritten;
+    bool good = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+        (fwrite(binary.data(), numBytesWritten, 1, file) == 1);
+    good = (fclose(file) == 0) && good;
+
+    // Note: rename(...) won't replace an existing file on Windows.
+    remove(filePath.c_str());
+    if (!good || (rename(tempFilePath.c_str(), filePath.c_str()) != 0))
+    {
+        printf("could not write '%s'\n", filePath.c_str());
+        remove(tempFilePath.c_str());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// A cache of linked programs on disk (glGetProgramBinary(...) output), one file per program in
+// cacheDirectory, named after a hash of the program's shader sources and the driver's vendor,
+// renderer, and version strings.  A driver update or a shader edit changes the hash, so stale
+// entries are simply never looked at again.
+
+// these need a current OpenGL context
+bool IsProgramBinaryCacheSupported();
+std::string MakeProgramCacheKey(const std::vector<std::string> &shaderSources);
+unsigned int LoadCachedProgram(const char *cacheDirectory, const std::string &cacheKey);
+bool SaveCachedProgram(const char *cacheDirectory, const std::string &cacheKey,
+    unsigned int programId);
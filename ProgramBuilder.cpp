@@ -0,0 +1,358 @@
+#include "glload/include/glload/gl_4_4.h"
+
+#include "ProgramBuilder.h"
+#include "ProgramBinaryCache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// from GL_ARB_parallel_shader_compile (and the KHR one, which has the same value), which
+// glload's headers predate
+#ifndef GL_COMPLETION_STATUS_ARB
+#define GL_COMPLETION_STATUS_ARB 0x91B1
+#endif
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Prints a shader's whole info log (not just the first 128 characters of it).
+Parameters:
+    shaderId    The shader.
+    name        What to call it in the message.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void PrintShaderLog(GLuint shaderId, const std::string &name)
+{
+    GLint logLength = 0;
+    glGetShaderiv(shaderId, GL_INFO_LOG_LENGTH, &logLength);
+    std::vector<GLchar> log(logLength + 1, 0);
+    glGetShaderInfoLog(shaderId, (GLsizei)log.size(), 0, log.data());
+    printf("%s failed: '%s'\n", name.c_str(), log.data());
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Prints a program's whole info log.
+Parameters:
+    programId   The program.
+    name        What to call it in the message.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void PrintProgramLog(GLuint programId, const std::string &name)
+{
+    GLint logLength = 0;
+    glGetProgramiv(programId, GL_INFO_LOG_LENGTH, &logLength);
+    std::vector<GLchar> log(logLength + 1, 0);
+    glGetProgramInfoLog(programId, (GLsizei)log.size(), 0, log.data());
+    printf("program '%s' didn't link: '%s'\n", name.c_str(), log.data());
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out with no cache and nothing pending.  See Init(...).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+ProgramBuilder::ProgramBuilder() :
+    _cacheDirectory(0),
+    _useCache(false),
+    _parallelCompile(false)
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Nothing.  Anything still pending at this point is left for the context to clean up.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+ProgramBuilder::~ProgramBuilder()
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Checks what the driver can do.
+
+    Note: GL_ARB_parallel_shader_compile also has glMaxShaderCompilerThreadsARB(...), but its
+    default is already "as many as the driver likes", which is what this wants anyway.
+Parameters:
+    cacheDirectory  Where to cache linked programs, or null to not cache them.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ProgramBuilder::Init(const char *cacheDirectory)
+{
+    _cacheDirectory = cacheDirectory;
+    _useCache = (cacheDirectory != 0) && IsProgramBinaryCacheSupported();
+
+    _parallelCompile = false;
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    for (GLint extensionCount = 0; extensionCount < numExtensions; extensionCount++)
+    {
+        const char *name = (const char *)glGetStringi(GL_EXTENSIONS, extensionCount);
+        if ((strcmp(name, "GL_ARB_parallel_shader_compile") == 0) ||
+            (strcmp(name, "GL_KHR_parallel_shader_compile") == 0))
+        {
+            _parallelCompile = true;
+            break;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts building a program and returns without waiting for any of it.  The callback gets
+    the result from a later Poll() or WaitForAll().
+Parameters:
+    programName     For messages.
+    shaders         The program's shaders.  The sources are copied into OpenGL before this
+                    returns.
+    callback        Gets the program when it's ready (or 0 if it failed).
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ProgramBuilder::Submit(const char *programName, const std::vector<ShaderSource> &shaders,
+    const ProgramReadyCallback &callback)
+{
+    PendingProgram program;
+    program.name = programName;
+    program.programId = 0;
+    program.fromCache = false;
+    program.callback = callback;
+    program.submitTime = std::chrono::high_resolution_clock::now();
+
+    if (_useCache)
+    {
+        std::vector<std::string> shaderSources;
+        for (size_t shaderCount = 0; shaderCount < shaders.size(); shaderCount++)
+        {
+            shaderSources.push_back(shaders[shaderCount].source);
+        }
+        program.cacheKey = MakeProgramCacheKey(shaderSources);
+        program.programId = LoadCachedProgram(_cacheDirectory, program.cacheKey);
+        program.fromCache = (program.programId != 0);
+    }
+
+    if (!program.fromCache)
+    {
+        // Note: No status checks in here.  Each one would wait for the compiler.
+        program.programId = glCreateProgram();
+        if (_useCache)
+        {
+            // some drivers won't hand the binary back out unless asked to keep it before
+            // linking
+            glProgramParameteri(program.programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        for (size_t shaderCount = 0; shaderCount < shaders.size(); shaderCount++)
+        {
+            const ShaderSource &shader = shaders[shaderCount];
+            GLuint shaderId = glCreateShader(shader.shaderType);
+            const GLchar *bytes[] = { shader.source.c_str() };
+            const GLint strLengths[] = { (GLint)shader.source.length() };
+            glShaderSource(shaderId, 1, bytes, strLengths);
+            glCompileShader(shaderId);
+            glAttachShader(program.programId, shaderId);
+            program.shaderIds.push_back(shaderId);
+            program.shaderNames.push_back(shader.name);
+        }
+
+        // a shader that failed to compile just makes the link fail, so there's no need to
+        // wait and see before linking
+        glLinkProgram(program.programId);
+    }
+
+    _pending.push_back(program);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Hands every program that has finished building to its callback.  With parallel compiling,
+    this never waits.  Call it every frame (it is nearly free when nothing is pending).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ProgramBuilder::Poll()
+{
+    if (_pending.empty())
+    {
+        return;
+    }
+
+    // take the finished ones out first, since a callback is allowed to Submit(...) again
+    std::vector<PendingProgram> finished;
+    for (size_t programCount = 0; programCount < _pending.size();)
+    {
+        if (IsDone(_pending[programCount]))
+        {
+            finished.push_back(_pending[programCount]);
+            _pending.erase(_pending.begin() + programCount);
+        }
+        else
+        {
+            programCount++;
+        }
+    }
+
+    for (size_t programCount = 0; programCount < finished.size(); programCount++)
+    {
+        Finish(finished[programCount]);
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Waits for every pending program (including any that the callbacks submit) and hands them
+    to their callbacks.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ProgramBuilder::WaitForAll()
+{
+    while (!_pending.empty())
+    {
+        std::vector<PendingProgram> finished;
+        finished.swap(_pending);
+        for (size_t programCount = 0; programCount < finished.size(); programCount++)
+        {
+            Finish(finished[programCount]);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    True if any program is still being built.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool ProgramBuilder::IsBusy() const
+{
+    return !_pending.empty();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    True if the driver has GL_ARB_parallel_shader_compile (or the KHR version).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool ProgramBuilder::HasParallelCompile() const
+{
+    return _parallelCompile;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether the program can be finished without waiting.
+Parameters:
+    program     The pending program.
+Returns:
+    True if the driver is done with it.  Without parallel compiling there's no way to ask, so
+    the answer is always yes and Finish(...) waits if it must.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool ProgramBuilder::IsDone(const PendingProgram &program) const
+{
+    if (!_parallelCompile || program.fromCache)
+    {
+        return true;
+    }
+
+    GLint isComplete = GL_FALSE;
+    glGetProgramiv(program.programId, GL_COMPLETION_STATUS_ARB, &isComplete);
+    return isComplete != GL_FALSE;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Checks how the build went, reports any errors, cleans up the shader objects, caches the
+    program if it linked, and calls the program's callback.
+Parameters:
+    program     The pending program.  It's finished with after this.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ProgramBuilder::Finish(PendingProgram &program)
+{
+    GLint isLinked = GL_FALSE;
+    glGetProgramiv(program.programId, GL_LINK_STATUS, &isLinked);
+    if (isLinked == GL_FALSE)
+    {
+        // find out which shader it was, if it was one
+        bool allCompiled = true;
+        for (size_t shaderCount = 0; shaderCount < program.shaderIds.size(); shaderCount++)
+        {
+            GLint isCompiled = GL_FALSE;
+            glGetShaderiv(program.shaderIds[shaderCount], GL_COMPILE_STATUS, &isCompiled);
+            if (isCompiled == GL_FALSE)
+            {
+                PrintShaderLog(program.shaderIds[shaderCount], program.shaderNames[shaderCount]);
+                allCompiled = false;
+            }
+        }
+        if (allCompiled)
+        {
+            PrintProgramLog(program.programId, program.name);
+        }
+    }
+
+    // the program contains binary, linked versions of the shaders, so clean up the compile
+    // objects
+    // Note: Shader objects need to be un-linked before they can be deleted.
+    for (size_t shaderCount = 0; shaderCount < program.shaderIds.size(); shaderCount++)
+    {
+        glDetachShader(program.programId, program.shaderIds[shaderCount]);
+        glDeleteShader(program.shaderIds[shaderCount]);
+    }
+    program.shaderIds.clear();
+
+    GLuint programId = program.programId;
+    if (isLinked == GL_FALSE)
+    {
+        glDeleteProgram(programId);
+        programId = 0;
+    }
+    else
+    {
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::high_resolution_clock::now() - program.submitTime;
+        if (program.fromCache)
+        {
+            printf("program '%s': loaded from the cache in %.3f ms\n", program.name.c_str(),
+                elapsed.count());
+        }
+        else
+        {
+            bool cached = _useCache &&
+                SaveCachedProgram(_cacheDirectory, program.cacheKey, programId);
+            printf("program '%s': compiled and linked %.3f ms after submitting%s%s\n",
+                program.name.c_str(), elapsed.count(), _parallelCompile ? " (in parallel)" : "",
+                cached ? " (cached for next time)" : "");
+        }
+    }
+
+    program.callback(programId);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    One shader to go into a program.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct ShaderSource
+{
+    unsigned int shaderType;    // GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, etc.
+    std::string name;           // for error messages (usually the file name)
+    std::string source;
+};
+
+// Gets the linked program, or 0 if it failed to build (the errors have already been printed).
+// Called on the OpenGL thread from ProgramBuilder::Poll() or WaitForAll().
+typedef std::function<void(unsigned int programId)> ProgramReadyCallback;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Builds shader programs without waiting on each step.
+
+    Asking for GL_COMPILE_STATUS right after glCompileShader(...) (or GL_LINK_STATUS right after
+    glLinkProgram(...)) makes the CPU wait for the compiler to finish, so compiling one shader
+    after another that way keeps only one compiler busy at a time.  Instead, Submit(...) hands
+    every shader and the link to the driver straight away without asking for anything back,
+    and Poll() only checks on programs whose GL_COMPLETION_STATUS_ARB (GL_ARB/KHR_parallel_
+    shader_compile) says they're done.  Drivers with that extension compile on their own
+    threads, so several programs (and the rest of init(...)) can overlap.  Without it, Poll()
+    takes each program's status as it comes, which still lets the driver defer as long as it
+    can.
+
+    Linked programs are also cached on disk (see ProgramBinaryCache.h), and a program that was
+    cached is ready right away.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class ProgramBuilder
+{
+public:
+    ProgramBuilder();
+    ~ProgramBuilder();
+
+    // these need the OpenGL context to be current
+    void Init(const char *cacheDirectory);
+    void Submit(const char *programName, const std::vector<ShaderSource> &shaders,
+        const ProgramReadyCallback &callback);
+    void Poll();
+    void WaitForAll();
+
+    bool IsBusy() const;
+    bool HasParallelCompile() const;
+
+private:
+    ProgramBuilder(const ProgramBuilder &);
+    ProgramBuilder &operator=(const ProgramBuilder &);
+
+    struct PendingProgram
+    {
+        std::string name;
+        unsigned int programId;
+        std::vector<unsigned int> shaderIds;
+        std::vector<std::string> shaderNames;
+        std::string cacheKey;
+        bool fromCache;
+        ProgramReadyCallback callback;
+        std::chrono::high_resolution_clock::time_point submitTime;
+    };
+
+    bool IsDone(const PendingProgram &program) const;
+    void Finish(PendingProgram &program);
+
+    const char *_cacheDirectory;
+    bool _useCache;
+    bool _parallelCompile;
+    std::vector<PendingProgram> _pending;
+};
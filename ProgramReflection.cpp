@@ -0,0 +1,571 @@
+#include "glload/include/glload/gl_4_4.h"
+
+#include "ProgramReflection.h"
+
+#include <stdio.h>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+// what an empty hash table slot holds, and what a resource with no second name has
+static const unsigned int NO_NAME = 0xFFFFFFFF;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The interned names.  The strings are kept in a deque so that references to them stay good
+    as more are added.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct NameTable
+{
+    std::mutex lock;
+    std::unordered_map<std::string, unsigned int> ids;
+    std::deque<std::string> names;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The one name table, made the first time that it's needed (so names can be interned while
+    other globals are being constructed).
+Parameters: None
+Returns:
+    The name table.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static NameTable &Names()
+{
+    static NameTable names;
+    return names;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Gets the ID for a name, giving it one if it doesn't have one yet.  The same name always
+    gets the same ID, and IDs are handed out counting up from 0.
+Parameters:
+    name    ex: "tex"
+Returns:
+    The name's ID.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int InternName(const char *name)
+{
+    NameTable &names = Names();
+    std::lock_guard<std::mutex> lock(names.lock);
+    std::unordered_map<std::string, unsigned int>::iterator found = names.ids.find(name);
+    if (found != names.ids.end())
+    {
+        return found->second;
+    }
+
+    unsigned int nameId = (unsigned int)names.names.size();
+    names.names.push_back(name);
+    names.ids[name] = nameId;
+    return nameId;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Goes the other way from InternName(...), for messages.
+Parameters:
+    nameId  From InternName(...).
+Returns:
+    The name, or an empty string if the ID was never handed out.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const std::string &InternedName(unsigned int nameId)
+{
+    static const std::string noName;
+    NameTable &names = Names();
+    std::lock_guard<std::mutex> lock(names.lock);
+    return (nameId < names.names.size()) ? names.names[nameId] : noName;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Gets the names of the resources of one kind and what was asked of them.
+Parameters:
+    programId       The linked program.
+    programInterface    ex: GL_UNIFORM
+    properties      What to ask about each resource (ex: GL_TYPE).
+    values          Gets each resource's answers, one after another (resources x properties).
+    names           Gets each resource's name.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void QueryResources(GLuint programId, GLenum programInterface,
+    const std::vector<GLenum> &properties, std::vector<GLint> *values,
+    std::vector<std::string> *names)
+{
+    GLint numResources = 0;
+    GLint maxNameLength = 0;
+    glGetProgramInterfaceiv(programId, programInterface, GL_ACTIVE_RESOURCES, &numResources);
+    glGetProgramInterfaceiv(programId, programInterface, GL_MAX_NAME_LENGTH, &maxNameLength);
+
+    values->assign(numResources * properties.size(), 0);
+    names->clear();
+    std::vector<GLchar> name(maxNameLength + 1, 0);
+    for (GLint resourceIndex = 0; resourceIndex < numResources; resourceIndex++)
+    {
+        glGetProgramResourceiv(programId, programInterface, resourceIndex,
+            (GLsizei)properties.size(), properties.data(), (GLsizei)properties.size(), 0,
+            values->data() + resourceIndex * properties.size());
+        glGetProgramResourceName(programId, programInterface, resourceIndex,
+            (GLsizei)name.size(), 0, name.data());
+        names->push_back(name.data());
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Interns the plain name of an array ("name" for "name[0]").
+Parameters:
+    name    A resource name.
+Returns:
+    The plain name's ID, or NO_NAME if the name isn't an array's.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static unsigned int InternArrayBaseName(const std::string &name)
+{
+    size_t length = name.length();
+    if ((length > 3) && (name.compare(length - 3, 3, "[0]") == 0))
+    {
+        return InternName(name.substr(0, length - 3).c_str());
+    }
+    return NO_NAME;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out empty.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+ProgramReflection::ResourceTable::ResourceTable() :
+    _hashShift(32)
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Forgets all the resources.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ProgramReflection::ResourceTable::Clear()
+{
+    _resources.clear();
+    _alsoNameIds.clear();
+    _slots.clear();
+    _hashShift = 32;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Adds a resource.  It can't be found until Build().
+Parameters:
+    resource    The resource.
+    alsoNameId  Another name that it can be found by, or NO_NAME.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ProgramReflection::ResourceTable::Add(const ProgramResource &resource,
+    unsigned int alsoNameId)
+{
+    _resources.push_back(resource);
+    _alsoNameIds.push_back(alsoNameId);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes the hash table out of what was added.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ProgramReflection::ResourceTable::Build()
+{
+    size_t numNames = 0;
+    for (size_t resourceCount = 0; resourceCount < _resources.size(); resourceCount++)
+    {
+        numNames += (_alsoNameIds[resourceCount] == NO_NAME) ? 1 : 2;
+    }
+
+    // at least twice as many slots as names keeps the probes short
+    unsigned int numBits = 3;
+    while (((size_t)1 << numBits) < numNames * 2)
+    {
+        numBits++;
+    }
+    Slot emptySlot = { NO_NAME, 0 };
+    _slots.assign((size_t)1 << numBits, emptySlot);
+    _hashShift = 32 - numBits;
+
+    for (size_t resourceCount = 0; resourceCount < _resources.size(); resourceCount++)
+    {
+        Insert(_resources[resourceCount].nameId, (unsigned int)resourceCount);
+        if (_alsoNameIds[resourceCount] != NO_NAME)
+        {
+            Insert(_alsoNameIds[resourceCount], (unsigned int)resourceCount);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Finds a resource by name.
+Parameters:
+    nameId  From InternName(...).
+Returns:
+    The resource, or null if there isn't one by that name.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const ProgramResource *ProgramReflection::ResourceTable::Find(unsigned int nameId) const
+{
+    if (_slots.empty())
+    {
+        return 0;
+    }
+
+    // Fibonacci hashing: the multiply spreads consecutive IDs out, and the top bits are the
+    // best-mixed ones
+    size_t mask = _slots.size() - 1;
+    size_t slotIndex = (nameId * 2654435769u) >> _hashShift;
+    while (_slots[slotIndex].nameId != NO_NAME)
+    {
+        if (_slots[slotIndex].nameId == nameId)
+        {
+            return &_resources[_slots[slotIndex].resourceIndex];
+        }
+        slotIndex = (slotIndex + 1) & mask;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    All the resources, in the order that OpenGL gave them.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const std::vector<ProgramResource> &ProgramReflection::ResourceTable::Resources() const
+{
+    return _resources;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Puts a name in the hash table.  The first resource with a name keeps it.
+Parameters:
+    nameId          The name.
+    resourceIndex   What it finds.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ProgramReflection::ResourceTable::Insert(unsigned int nameId, unsigned int resourceIndex)
+{
+    size_t mask = _slots.size() - 1;
+    size_t slotIndex = (nameId * 2654435769u) >> _hashShift;
+    while (_slots[slotIndex].nameId != NO_NAME)
+    {
+        if (_slots[slotIndex].nameId == nameId)
+        {
+            return;
+        }
+        slotIndex = (slotIndex + 1) & mask;
+    }
+    _slots[slotIndex].nameId = nameId;
+    _slots[slotIndex].resourceIndex = resourceIndex;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out with no program.  See Reflect(...).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+ProgramReflection::ProgramReflection() :
+    _programId(0)
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Asks OpenGL for all of a program's active uniforms, uniform blocks, and vertex attributes
+    (and forgets any previous program's).
+Parameters:
+    programId   A linked program.
+Returns:
+    False if the program isn't linked.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool ProgramReflection::Reflect(unsigned int programId)
+{
+    Clear();
+    GLint isLinked = GL_FALSE;
+    if (programId != 0)
+    {
+        glGetProgramiv(programId, GL_LINK_STATUS, &isLinked);
+    }
+    if (isLinked == GL_FALSE)
+    {
+        printf("can't reflect program %u because it isn't linked\n", programId);
+        return false;
+    }
+    _programId = programId;
+
+    std::vector<GLint> values;
+    std::vector<std::string> names;
+
+    const std::vector<GLenum> uniformProperties =
+    {
+        GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION, GL_BLOCK_INDEX, GL_OFFSET
+    };
+    QueryResources(programId, GL_UNIFORM, uniformProperties, &values, &names);
+    for (size_t resourceCount = 0; resourceCount < names.size(); resourceCount++)
+    {
+        const GLint *value = values.data() + resourceCount * uniformProperties.size();
+        ProgramResource uniform;
+        uniform.nameId = InternName(names[resourceCount].c_str());
+        uniform.type = (unsigned int)value[0];
+        uniform.arraySize = value[1];
+        uniform.location = value[2];
+        uniform.blockIndex = value[3];
+        uniform.offset = value[4];
+        uniform.dataSize = 0;
+        _uniforms.Add(uniform, InternArrayBaseName(names[resourceCount]));
+    }
+
+    const std::vector<GLenum> blockProperties = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+    QueryResources(programId, GL_UNIFORM_BLOCK, blockProperties, &values, &names);
+    for (size_t resourceCount = 0; resourceCount < names.size(); resourceCount++)
+    {
+        const GLint *value = values.data() + resourceCount * blockProperties.size();
+        ProgramResource block;
+        block.nameId = InternName(names[resourceCount].c_str());
+        block.location = value[0];
+        block.type = 0;
+        block.arraySize = 1;
+        block.blockIndex = (int)resourceCount;
+        block.offset = -1;
+        block.dataSize = value[1];
+        _uniformBlocks.Add(block, NO_NAME);
+    }
+
+    // Note: Built-in inputs (gl_VertexID and the like) are in here too, but they have no
+    // location and can't be given one, so they're left out.
+    const std::vector<GLenum> attributeProperties = { GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION };
+    QueryResources(programId, GL_PROGRAM_INPUT, attributeProperties, &values, &names);
+    for (size_t resourceCount = 0; resourceCount < names.size(); resourceCount++)
+    {
+        if (names[resourceCount].compare(0, 3, "gl_") == 0)
+        {
+            continue;
+        }
+
+        const GLint *value = values.data() + resourceCount * attributeProperties.size();
+        ProgramResource attribute;
+        attribute.nameId = InternName(names[resourceCount].c_str());
+        attribute.type = (unsigned int)value[0];
+        attribute.arraySize = value[1];
+        attribute.location = value[2];
+        attribute.blockIndex = -1;
+        attribute.offset = -1;
+        attribute.dataSize = 0;
+        _attributes.Add(attribute, InternArrayBaseName(names[resourceCount]));
+    }
+
+    _uniforms.Build();
+    _uniformBlocks.Build();
+    _attributes.Build();
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Forgets the program.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ProgramReflection::Clear()
+{
+    _programId = 0;
+    _uniforms.Clear();
+    _uniformBlocks.Clear();
+    _attributes.Clear();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The program that was last reflected, or 0.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int ProgramReflection::ProgramId() const
+{
+    return _programId;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Finds an active uniform.
+Parameters:
+    nameId  From InternName(...).
+Returns:
+    The uniform, or null if the program doesn't have one by that name.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const ProgramResource *ProgramReflection::FindUniform(unsigned int nameId) const
+{
+    return _uniforms.Find(nameId);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Finds an active uniform block.
+Parameters:
+    nameId  From InternName(...).  This is the block's name, not its instance name.
+Returns:
+    The block, or null if the program doesn't have one by that name.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const ProgramResource *ProgramReflection::FindUniformBlock(unsigned int nameId) const
+{
+    return _uniformBlocks.Find(nameId);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Finds an active vertex attribute.
+Parameters:
+    nameId  From InternName(...).
+Returns:
+    The attribute, or null if the program doesn't have one by that name.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const ProgramResource *ProgramReflection::FindAttribute(unsigned int nameId) const
+{
+    return _attributes.Find(nameId);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    Every active vertex attribute, in the order that OpenGL reports them (its resource
+    indices).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const std::vector<ProgramResource> &ProgramReflection::Attributes() const
+{
+    return _attributes.Resources();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The per-frame lookup.  Meant to take the place of glGetUniformLocation(...).
+Parameters:
+    nameId  From InternName(...).
+Returns:
+    The uniform's location, or -1 if the program doesn't have it (or it's in a block).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+int ProgramReflection::UniformLocation(unsigned int nameId) const
+{
+    const ProgramResource *uniform = _uniforms.Find(nameId);
+    return (uniform != 0) ? uniform->location : -1;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Meant to take the place of glGetAttribLocation(...).
+Parameters:
+    nameId  From InternName(...).
+Returns:
+    The attribute's location, or -1 if the program doesn't have it.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+int ProgramReflection::AttributeLocation(unsigned int nameId) const
+{
+    const ProgramResource *attribute = _attributes.Find(nameId);
+    return (attribute != 0) ? attribute->location : -1;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Lists everything that was found.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ProgramReflection::Print() const
+{
+    printf("program %u: %u uniforms, %u uniform blocks, %u attributes\n", _programId,
+        (unsigned int)_uniforms.Resources().size(),
+        (unsigned int)_uniformBlocks.Resources().size(),
+        (unsigned int)_attributes.Resources().size());
+
+    const std::vector<ProgramResource> &uniforms = _uniforms.Resources();
+    for (size_t resourceCount = 0; resourceCount < uniforms.size(); resourceCount++)
+    {
+        const ProgramResource &uniform = uniforms[resourceCount];
+        printf("    uniform '%s': location %i, type 0x%04X, array size %i",
+            InternedName(uniform.nameId).c_str(), uniform.location, uniform.type,
+            uniform.arraySize);
+        if (uniform.blockIndex >= 0)
+        {
+            printf(", block %i offset %i", uniform.blockIndex, uniform.offset);
+        }
+        printf("\n");
+    }
+
+    const std::vector<ProgramResource> &blocks = _uniformBlocks.Resources();
+    for (size_t resourceCount = 0; resourceCount < blocks.size(); resourceCount++)
+    {
+        const ProgramResource &block = blocks[resourceCount];
+        printf("    uniform block '%s': index %i, binding %i, %i bytes\n",
+            InternedName(block.nameId).c_str(), block.blockIndex, block.location,
+            block.dataSize);
+    }
+
+    const std::vector<ProgramResource> &attributes = _attributes.Resources();
+    for (size_t resourceCount = 0; resourceCount < attributes.size(); resourceCount++)
+    {
+        const ProgramResource &attribute = attributes[resourceCount];
+        printf("    attribute '%s': location %i, type 0x%04X, array size %i\n",
+            InternedName(attribute.nameId).c_str(), attribute.location, attribute.type,
+            attribute.arraySize);
+    }
+}
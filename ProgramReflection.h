@@ -0,0 +1,119 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// interned names: each distinct string gets a small, permanent ID, so that lookups by name
+// are just integer compares (see ProgramReflection)
+// Note: Intern names once (at startup, or into a static) rather than every frame.  Interning
+// hashes the string, which is the thing that the IDs are for avoiding.
+unsigned int InternName(const char *name);
+const std::string &InternedName(unsigned int nameId);
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    One active uniform, uniform block, or vertex attribute of a linked program.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct ProgramResource
+{
+    unsigned int nameId;    // see InternName(...)
+
+    // uniforms and attributes: the location (-1 for uniforms in a block)
+    // uniform blocks: the buffer binding point
+    int location;
+
+    // uniforms and attributes: ex: GL_FLOAT_VEC4; uniform blocks: 0
+    unsigned int type;
+
+    // elements if it's an array, 1 if it isn't (the elements of a default-block uniform array
+    // are at location + 0, 1, 2...)
+    int arraySize;
+
+    // uniforms: the index of the block that they're in, or -1
+    // uniform blocks: their own index (for glUniformBlockBinding(...))
+    int blockIndex;
+
+    // uniforms in a block: the byte offset in the block's buffer; everything else: -1
+    int offset;
+
+    // uniform blocks: the bytes that the block's buffer needs; everything else: 0
+    int dataSize;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Everything that a linked program takes as input, found by asking OpenGL once after linking
+    (glGetProgramInterfaceiv(...) and glGetProgramResource*(...)) instead of looking things up
+    by string whenever they're needed.
+
+    Each kind of resource goes in a flat, open-addressed hash table keyed by interned name ID
+    (see InternName(...)), so finding a uniform's location each frame is a multiply, a shift,
+    and (usually) one compare, with no strings involved.
+
+    Note: Array uniforms and attributes are reported by OpenGL as "name[0]".  They can be found
+    by that or by plain "name".
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class ProgramReflection
+{
+public:
+    ProgramReflection();
+
+    // needs the OpenGL context to be current
+    bool Reflect(unsigned int programId);
+    void Clear();
+
+    unsigned int ProgramId() const;
+    const ProgramResource *FindUniform(unsigned int nameId) const;
+    const ProgramResource *FindUniformBlock(unsigned int nameId) const;
+    const ProgramResource *FindAttribute(unsigned int nameId) const;
+    const std::vector<ProgramResource> &Attributes() const;
+
+    // -1 if the program doesn't have it (which OpenGL's uniform calls quietly ignore)
+    int UniformLocation(unsigned int nameId) const;
+    int AttributeLocation(unsigned int nameId) const;
+
+    void Print() const;
+
+private:
+    /*-------------------------------------------------------------------------------------------
+    Description:
+        The resources of one kind, and the hash table that finds them by name ID.  Add(...) them
+        all, then Build().
+    Creator:
+    -------------------------------------------------------------------------------------------*/
+    class ResourceTable
+    {
+    public:
+        ResourceTable();
+        void Clear();
+        void Add(const ProgramResource &resource, unsigned int alsoNameId);
+        void Build();
+        const ProgramResource *Find(unsigned int nameId) const;
+        const std::vector<ProgramResource> &Resources() const;
+
+    private:
+        struct Slot
+        {
+            unsigned int nameId;
+            unsigned int resourceIndex;
+        };
+
+        void Insert(unsigned int nameId, unsigned int resourceIndex);
+
+        std::vector<ProgramResource> _resources;
+
+        // resource index -> the extra name to find it by (ex: "name" for "name[0]"), if any
+        std::vector<unsigned int> _alsoNameIds;
+
+        // a power of 2 in size and never more than half full, so a probe always ends
+        std::vector<Slot> _slots;
+        unsigned int _hashShift;
+    };
+
+    unsigned int _programId;
+    ResourceTable _uniforms;
+    ResourceTable _uniformBlocks;
+    ResourceTable _attributes;
+};
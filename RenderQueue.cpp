@@ -0,0 +1,323 @@
+#include "glload/include/glload/gl_4_4.h"
+
+#include "RenderQueue.h"
+#include "GlStateCache.h"
+
+#include <string.h>
+#include <chrono>
+
+// the radix sort goes a byte of the key at a time
+static const unsigned int RADIX_BITS = 8;
+static const unsigned int RADIX_SIZE = 1 << RADIX_BITS;
+static const unsigned int NUM_RADIX_PASSES = 64 / RADIX_BITS;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out with nothing queued, and sorting.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+RenderQueue::RenderQueue() :
+    _sortDraws(true),
+    _numUnsortedChanges(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts a new frame's draws, throwing out any that weren't submitted.
+Parameters:
+    sortDraws   True to sort them by their keys, false to draw them in the order that they
+                are added (for comparing against).
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void RenderQueue::Begin(bool sortDraws)
+{
+    _sortDraws = sortDraws;
+    _draws.clear();
+    _items.clear();
+    _numUnsortedChanges = 0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Queues up a draw.  Nothing is drawn until Submit().
+Parameters:
+    layer   Draws in a lower layer are all drawn before any in a higher one, whatever their
+            state (ex: opaque, then blended, then the HUD).  Only the low LAYER_BITS count.
+    depth   0 (near) - 1 (far), for ordering the draws that share all their state.
+    draw    The state and the geometry.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void RenderQueue::Add(unsigned int layer, float depth, const RenderQueueDraw &draw)
+{
+    // count what it would take to draw it right after the previous one, for the stats
+    if (_draws.empty())
+    {
+        _numUnsortedChanges += 3;
+    }
+    else
+    {
+        const RenderQueueDraw &previous = _draws.back();
+        _numUnsortedChanges += (draw.programId != previous.programId) ? 1 : 0;
+        _numUnsortedChanges += (draw.textureId != previous.textureId) ? 1 : 0;
+        _numUnsortedChanges += (draw.vaoId != previous.vaoId) ? 1 : 0;
+    }
+
+    SortItem item;
+    item.key = MakeKey(layer,
+        SortId(&_programSortIds, draw.programId, PROGRAM_BITS),
+        SortId(&_textureSortIds, draw.textureId, TEXTURE_BITS),
+        SortId(&_vaoSortIds, draw.vaoId, VAO_BITS),
+        depth);
+    item.drawIndex = (unsigned int)_draws.size();
+    _items.push_back(item);
+    _draws.push_back(draw);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Sorts the queued draws (unless Begin(...) said not to), draws them, and empties the queue.
+    A program, texture, or VAO is only set when it's different from the previous draw's.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void RenderQueue::Submit()
+{
+    memset(&_stats, 0, sizeof(_stats));
+    std::chrono::high_resolution_clock::time_point start =
+        std::chrono::high_resolution_clock::now();
+
+    if (_sortDraws)
+    {
+        SortKeys();
+        std::chrono::duration<double> sortElapsed =
+            std::chrono::high_resolution_clock::now() - start;
+        _stats.sortSeconds = sortElapsed.count();
+    }
+
+    GlStateCache &stateCache = GlStateCache::Shared();
+    unsigned int lastVertexBufferId = 0;
+    unsigned int lastVertexStride = 0;
+    for (size_t itemCount = 0; itemCount < _items.size(); itemCount++)
+    {
+        const RenderQueueDraw &draw = _draws[_items[itemCount].drawIndex];
+        const RenderQueueDraw *previous = (itemCount == 0) ? 0 :
+            &_draws[_items[itemCount - 1].drawIndex];
+        if ((previous == 0) || (draw.programId != previous->programId))
+        {
+            stateCache.UseProgram(draw.programId);
+            _stats.numProgramChanges++;
+        }
+        if ((previous == 0) || (draw.textureId != previous->textureId))
+        {
+            stateCache.BindTexture(0, GL_TEXTURE_2D, draw.textureId);
+            _stats.numTextureChanges++;
+        }
+        if ((previous == 0) || (draw.vaoId != previous->vaoId))
+        {
+            stateCache.BindVertexArray(draw.vaoId);
+            _stats.numVaoChanges++;
+
+            // the vertex buffer binding is part of the VAO
+            lastVertexBufferId = 0;
+        }
+
+        // Note: glBindVertexBuffer(...) doesn't go through the state cache, so repeats are
+        // skipped here.
+        if ((draw.vertexBufferId != 0) && ((draw.vertexBufferId != lastVertexBufferId) ||
+            (draw.vertexStride != lastVertexStride)))
+        {
+            glBindVertexBuffer(0, draw.vertexBufferId, 0, draw.vertexStride);
+            lastVertexBufferId = draw.vertexBufferId;
+            lastVertexStride = draw.vertexStride;
+        }
+        stateCache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, draw.indexBufferId);
+        glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)draw.indexCount, draw.indexType,
+            (void *)draw.firstIndexBytes, draw.baseVertex);
+    }
+
+    _stats.numDraws = (unsigned int)_items.size();
+    unsigned int numChanges =
+        _stats.numProgramChanges + _stats.numTextureChanges + _stats.numVaoChanges;
+    _stats.numChangesAvoided =
+        (_numUnsortedChanges > numChanges) ? (_numUnsortedChanges - numChanges) : 0;
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    _stats.cpuSeconds = elapsed.count();
+
+    _draws.clear();
+    _items.clear();
+    _numUnsortedChanges = 0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    How many draws are waiting for Submit().
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int RenderQueue::NumQueued() const
+{
+    return (unsigned int)_draws.size();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    A reference to the last Submit()'s stats.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const RenderQueueStats &RenderQueue::Stats() const
+{
+    return _stats;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Packs a draw's sort key: the layer in the top LAYER_BITS, then the program, texture, and
+    VAO, and the depth in the bottom DEPTH_BITS.  Anything too big for its bits is cut down to
+    them (the layer) or clamped (the depth).
+Parameters:
+    layer           See Add(...).
+    programSortId   The small numbers that stand for the program, texture, and VAO (see
+    textureSortId   SortId(...)).
+    vaoSortId
+    depth           0 (near) - 1 (far).
+Returns:
+    The key.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned long long RenderQueue::MakeKey(unsigned int layer, unsigned int programSortId,
+    unsigned int textureSortId, unsigned int vaoSortId, float depth)
+{
+    const unsigned int MAX_DEPTH = (1u << DEPTH_BITS) - 1;
+    float clampedDepth = (depth < 0.0f) ? 0.0f : ((depth > 1.0f) ? 1.0f : depth);
+
+    // Note: The depth is scaled in double, since 2^24 - 1 + 0.5 rounds up to 2^24 in a float,
+    // which would spill into the VAO's bits.
+    unsigned long long key = layer & ((1u << LAYER_BITS) - 1);
+    key = (key << PROGRAM_BITS) | (programSortId & ((1u << PROGRAM_BITS) - 1));
+    key = (key << TEXTURE_BITS) | (textureSortId & ((1u << TEXTURE_BITS) - 1));
+    key = (key << VAO_BITS) | (vaoSortId & ((1u << VAO_BITS) - 1));
+    key = (key << DEPTH_BITS) | (unsigned int)((clampedDepth * (double)MAX_DEPTH) + 0.5);
+    return key;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Finds the small number that stands for an OpenGL ID in the keys, and gives it the next
+    one if it doesn't have one yet.
+
+    Note: Past 2^numBits different IDs, the rest all share the last number.  They still draw
+    right (the draws say which ID to bind), but they won't be grouped with their own.
+Parameters:
+    sortIds     The IDs of one kind (programs, textures, or VAOs) seen so far.
+    glId        The OpenGL ID.
+    numBits     How many bits of the key it gets.
+Returns:
+    The number.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int RenderQueue::SortId(std::unordered_map<unsigned int, unsigned int> *sortIds,
+    unsigned int glId, unsigned int numBits)
+{
+    unsigned int maxSortId = (1u << numBits) - 1;
+    std::unordered_map<unsigned int, unsigned int>::iterator found = sortIds->find(glId);
+    if (found != sortIds->end())
+    {
+        return found->second;
+    }
+
+    unsigned int sortId = (unsigned int)sortIds->size();
+    if (sortId > maxSortId)
+    {
+        return maxSortId;
+    }
+    (*sortIds)[glId] = sortId;
+    return sortId;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Sorts _items by key with a least-significant-digit radix sort: one counting pass over the
+    keys for all 8 bytes' histograms, and then, for each byte from the lowest up, a pass that
+    moves every item to its byte's place in _scratch (and the two swap).  Each pass keeps the
+    order of the items with the same byte, so after the last one they're in order by the
+    whole key, and draws with the same key stay in the order that they were added.
+
+    A byte that's the same in every key (all of them land in one bucket) would move nothing,
+    so its pass is skipped.  With a few layers, programs, textures, and VAOs, that's most of
+    the top half of the key.
+
+    Note: It's O(n) instead of std::sort(...)'s O(n log n), and every pass reads one array
+    from front to back and writes to 256 places in the other that each move forward, which
+    the caches handle well.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void RenderQueue::SortKeys()
+{
+    size_t numItems = _items.size();
+    if (numItems < 2)
+    {
+        return;
+    }
+
+    unsigned int counts[NUM_RADIX_PASSES][RADIX_SIZE];
+    memset(counts, 0, sizeof(counts));
+    for (size_t itemCount = 0; itemCount < numItems; itemCount++)
+    {
+        unsigned long long key = _items[itemCount].key;
+        for (unsigned int passCount = 0; passCount < NUM_RADIX_PASSES; passCount++)
+        {
+            counts[passCount][(key >> (passCount * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+        }
+    }
+
+    _scratch.resize(numItems);
+    for (unsigned int passCount = 0; passCount < NUM_RADIX_PASSES; passCount++)
+    {
+        unsigned int shift = passCount * RADIX_BITS;
+        unsigned int *passCounts = counts[passCount];
+        if (passCounts[(_items[0].key >> shift) & (RADIX_SIZE - 1)] == numItems)
+        {
+            continue;
+        }
+
+        // each byte value's first place in the output
+        unsigned int offsets[RADIX_SIZE];
+        unsigned int offset = 0;
+        for (unsigned int bucket = 0; bucket < RADIX_SIZE; bucket++)
+        {
+            offsets[bucket] = offset;
+            offset += passCounts[bucket];
+        }
+
+        const SortItem *from = _items.data();
+        SortItem *to = _scratch.data();
+        for (size_t itemCount = 0; itemCount < numItems; itemCount++)
+        {
+            to[offsets[(from[itemCount].key >> shift) & (RADIX_SIZE - 1)]++] = from[itemCount];
+        }
+        _items.swap(_scratch);
+    }
+}
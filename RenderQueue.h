@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stddef.h>
+#include <unordered_map>
+#include <vector>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Everything that one glDrawElementsBaseVertex(...) needs: the state to draw it with and
+    where its vertices and indices are.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct RenderQueueDraw
+{
+    unsigned int programId;
+    unsigned int vaoId;
+    unsigned int textureId;         // 2D, on unit 0 (0 for none)
+
+    // attached to the VAO's binding 0 at draw time, since arenas can move (0 to leave the
+    // VAO's alone)
+    unsigned int vertexBufferId;
+    unsigned int vertexStride;
+
+    unsigned int indexBufferId;
+    unsigned int indexType;         // GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, or GL_UNSIGNED_INT
+    unsigned int indexCount;
+    size_t firstIndexBytes;         // into the index buffer
+    int baseVertex;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How the last Submit() went.  The changes are counted in the order that the draws were
+    drawn, and "avoided" is how many more there would have been in the order that they were
+    added.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct RenderQueueStats
+{
+    unsigned int numDraws;
+    unsigned int numProgramChanges;
+    unsigned int numTextureChanges;
+    unsigned int numVaoChanges;
+    unsigned int numChangesAvoided;
+    double sortSeconds;
+    double cpuSeconds;              // sorting, and the state changes and the draw calls
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Collects a frame's draws, sorts them so that draws that use the same state are next to
+    each other, and then draws them.
+
+    Each Add(...) packs the draw's layer, program, texture, VAO, and depth into a 64-bit key,
+    most important first (see MakeKey(...)), so sorting the keys as plain numbers puts the
+    draws in layer order, and within a layer, groups them by program, then texture, then VAO,
+    and front to back within those.  Every program change is then followed by all of that
+    program's draws, and so on down, which is the fewest changes of the most expensive state.
+    The sort is a radix sort (a byte at a time, least significant first; see SortKeys()),
+    which goes over the keys in straight lines instead of comparing them, and skips any byte
+    that's the same in every key (ex: the layer, if there's only one).
+
+    The OpenGL IDs are too wide to fit, so each program, texture, and VAO is given a small
+    number the first time that the queue sees it (see SortId(...)), and keeps it from frame to
+    frame so that the order doesn't jump around.
+
+    Note: Depth is 0 (near) - 1 (far), so a layer of blended draws, which need to go back to
+    front, should pass 1 - depth instead.  Draws that need to stay in the order that they're
+    added can go in layers of their own, or Begin(...) can be told not to sort.
+
+    Also Note: The state changes go through GlStateCache like everything else, so the ones
+    that a sort saves were never repeats that the cache would have caught anyway.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class RenderQueue
+{
+public:
+    RenderQueue();
+
+    void Begin(bool sortDraws);
+    void Add(unsigned int layer, float depth, const RenderQueueDraw &draw);
+
+    // needs the OpenGL context to be current
+    void Submit();
+
+    unsigned int NumQueued() const;
+    const RenderQueueStats &Stats() const;
+
+    static unsigned long long MakeKey(unsigned int layer, unsigned int programSortId,
+        unsigned int textureSortId, unsigned int vaoSortId, float depth);
+
+    // how many bits of the key each field gets, most important first (64 in all)
+    static const unsigned int LAYER_BITS = 8;
+    static const unsigned int PROGRAM_BITS = 10;
+    static const unsigned int TEXTURE_BITS = 12;
+    static const unsigned int VAO_BITS = 10;
+    static const unsigned int DEPTH_BITS = 24;
+
+private:
+    RenderQueue(const RenderQueue &);
+    RenderQueue &operator=(const RenderQueue &);
+
+    // a draw's key and where it is in _draws
+    // Note: The sort moves these instead of the draws themselves, which are 5 times bigger.
+    struct SortItem
+    {
+        unsigned long long key;
+        unsigned int drawIndex;
+    };
+
+    static unsigned int SortId(std::unordered_map<unsigned int, unsigned int> *sortIds,
+        unsigned int glId, unsigned int numBits);
+    void SortKeys();
+
+    bool _sortDraws;
+    std::vector<RenderQueueDraw> _draws;
+    std::vector<SortItem> _items;
+    std::vector<SortItem> _scratch;     // the radix sort's other half
+
+    // OpenGL ID -> the small number that stands for it in the keys
+    std::unordered_map<unsigned int, unsigned int> _programSortIds;
+    std::unordered_map<unsigned int, unsigned int> _textureSortIds;
+    std::unordered_map<unsigned int, unsigned int> _vaoSortIds;
+
+    // the state changes that the draws would take in the order that they were added
+    unsigned int _numUnsortedChanges;
+
+    RenderQueueStats _stats;
+};
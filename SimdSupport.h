@@ -0,0 +1,27 @@
+#pragma once
+
+// Build note: The SIMD code paths are picked at compile time from what the compiler is allowed
+// to emit.  VS enables SSE2 for every x64 build and enables AVX/AVX2 with "Enable Enhanced
+// Instruction Set" under "C/C++" -> "Code Generation" (/arch:AVX2).  GCC/Clang need -mavx2
+// (or -march=native).  Anything else falls back to plain C++ loops.
+#if defined(__AVX2__)
+#define SIMD_AVX2 1
+#endif
+
+#if defined(__AVX__) || defined(__AVX2__)
+#define SIMD_AVX 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SIMD_SSE2 1
+#endif
+
+// Note: VS doesn't define __F16C__, but every CPU with AVX2 also has the half-float
+// conversion instructions.
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define SIMD_F16C 1
+#endif
+
+#if defined(SIMD_AVX) || defined(SIMD_SSE2)
+#include <immintrin.h>
+#endif
@@ -0,0 +1,479 @@
+#include "glload/include/glload/gl_4_4.h"
+
+#include "SpriteBatcher.h"
+#include "GlStateCache.h"
+#include "DynamicVertexBuffer.h"
+#include "Mesh.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+// the sprite shaders' sampler (see sprite.frag)
+static const unsigned int TEX_NAME_ID = InternName("tex");
+
+// the vertex buffer bindings that the quad's vertices and the instances read from
+static const GLuint QUAD_BINDING = 0;
+static const GLuint INSTANCE_BINDING = 1;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out with nothing.  See Init().
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+SpriteBatcher::SpriteBatcher() :
+    _programId(0),
+    _quadBufferId(0),
+    _quadIndexBufferId(0),
+    _instancedVaoId(0),
+    _instanceBufferId(0),
+    _instanceBufferSize(0),
+    _dynamicBuffer(0),
+    _singleVaoId(0),
+    _sortByTexture(false)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Nothing.  Call Shutdown() while the context is still around to clean up.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+SpriteBatcher::~SpriteBatcher()
+{
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes the unit quad, the (empty) instance buffer, and the VAOs that tie them together.  The
+    program comes separately from SetProgram(...), since it is built asynchronously.
+Parameters: None
+Returns:
+    False if the buffers couldn't be made.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool SpriteBatcher::Init()
+{
+    // the same layout as CreateGeometry()'s triangle (a MeshVertex)
+    // Note: Counterclockwise, like the triangle, since back faces are culled.
+    MeshVertex quadVerts[] =
+    {
+        { { -1.0f, -1.0f, 0.0f }, { 0.0f, 0.0f } },     // left bottom corner, and the bottom
+                                                        // left of the UV rectangle
+        { { +1.0f, -1.0f, 0.0f }, { 1.0f, 0.0f } },     // right bottom corner
+        { { +1.0f, +1.0f, 0.0f }, { 1.0f, 1.0f } },     // right top corner
+        { { -1.0f, +1.0f, 0.0f }, { 0.0f, 1.0f } },     // left top corner
+    };
+    GLushort quadIndices[] =
+    {
+        0, 1, 2,
+        0, 2, 3,
+    };
+
+    GlStateCache &stateCache = GlStateCache::Shared();
+    glGenBuffers(1, &_quadBufferId);
+    glGenBuffers(1, &_quadIndexBufferId);
+    glGenBuffers(1, &_instanceBufferId);
+    glGenVertexArrays(1, &_instancedVaoId);
+    glGenVertexArrays(1, &_singleVaoId);
+    if ((_quadBufferId == 0) || (_quadIndexBufferId == 0) || (_instanceBufferId == 0) ||
+        (_instancedVaoId == 0) || (_singleVaoId == 0))
+    {
+        printf("could not make the sprite batcher's buffers\n");
+        Shutdown();
+        return false;
+    }
+
+    stateCache.BindBuffer(GL_ARRAY_BUFFER, _quadBufferId);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVerts), quadVerts, GL_STATIC_DRAW);
+
+    // both VAOs get the quad, but only one of them gets the instance attributes
+    GLuint vaoIds[] = { _instancedVaoId, _singleVaoId };
+    for (int vaoCount = 0; vaoCount < 2; vaoCount++)
+    {
+        stateCache.BindVertexArray(vaoIds[vaoCount]);
+        SetVertexLayout(MESH_VERTEX_LAYOUT, QUAD_BINDING);
+        glBindVertexBuffer(QUAD_BINDING, _quadBufferId, 0, MESH_VERTEX_LAYOUT.stride);
+        stateCache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, _quadIndexBufferId);
+        if (vaoCount == 0)
+        {
+            // the element buffer's contents only need to go in once
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(quadIndices), quadIndices,
+                GL_STATIC_DRAW);
+        }
+    }
+
+    // the instance attributes advance once per instance (the divisor) instead of per vertex
+    // Note: They're described separately from the buffer that they come from (OpenGL 4.3's
+    // glVertexAttribFormat(...) and glBindVertexBuffer(...)), so that Flush() can point them
+    // at whichever buffer and offset the instances went to with one call.
+    // Also Note: The tint is 4 bytes that the shader sees as 0 - 1 floats (normalized).
+    stateCache.BindVertexArray(_instancedVaoId);
+    SetVertexLayout(SPRITE_INSTANCE_LAYOUT, INSTANCE_BINDING);
+    glBindVertexBuffer(INSTANCE_BINDING, _instanceBufferId, 0, SPRITE_INSTANCE_LAYOUT.stride);
+    stateCache.BindVertexArray(0);
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Deletes everything, including the program.  Safe to call more than once.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void SpriteBatcher::Shutdown()
+{
+    GlStateCache &stateCache = GlStateCache::Shared();
+    SetProgram(0);
+
+    GLuint vaoIds[] = { _instancedVaoId, _singleVaoId };
+    for (int vaoCount = 0; vaoCount < 2; vaoCount++)
+    {
+        if (vaoIds[vaoCount] != 0)
+        {
+            glDeleteVertexArrays(1, &vaoIds[vaoCount]);
+            stateCache.ForgetVertexArray(vaoIds[vaoCount]);
+        }
+    }
+    _instancedVaoId = 0;
+    _singleVaoId = 0;
+
+    GLuint bufferIds[] = { _quadBufferId, _quadIndexBufferId, _instanceBufferId };
+    for (int bufferCount = 0; bufferCount < 3; bufferCount++)
+    {
+        if (bufferIds[bufferCount] != 0)
+        {
+            glDeleteBuffers(1, &bufferIds[bufferCount]);
+            stateCache.ForgetBuffer(bufferIds[bufferCount]);
+        }
+    }
+    _quadBufferId = 0;
+    _quadIndexBufferId = 0;
+    _instanceBufferId = 0;
+    _instanceBufferSize = 0;
+
+    _sprites.clear();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Gives the batcher a program built from sprite.vert and sprite.frag.  The batcher owns it
+    from here on, and deletes the previous one (if any).
+
+    Note: A program whose inputs don't match the quad's MeshVertex and SpriteInstance is
+    deleted too, and the batcher is left without one.
+Parameters:
+    programId   The linked program, or 0 for none.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void SpriteBatcher::SetProgram(unsigned int programId)
+{
+    if (_programId != 0)
+    {
+        glDeleteProgram(_programId);
+        GlStateCache::Shared().ForgetProgram(_programId);
+    }
+
+    _programId = programId;
+    _reflection.Clear();
+    if (programId != 0)
+    {
+        _reflection.Reflect(programId);
+        VertexLayout layouts[] = { MESH_VERTEX_LAYOUT, SPRITE_INSTANCE_LAYOUT };
+        if (!VertexLayoutsMatchProgram(_reflection, layouts, 2, "sprite"))
+        {
+            SetProgram(0);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Has Flush() write the instances into a persistently mapped DynamicVertexBuffer.  The
+    caller owns it and brackets each frame with its BeginFrame() and EndFrame().
+Parameters:
+    dynamicBuffer   The buffer, or null to go back to orphaning the batcher's own buffer.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void SpriteBatcher::SetDynamicBuffer(DynamicVertexBuffer *dynamicBuffer)
+{
+    _dynamicBuffer = dynamicBuffer;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The sprite program, or 0 if there isn't one yet.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int SpriteBatcher::ProgramId() const
+{
+    return _programId;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether Flush...() will draw anything.
+Parameters: None
+Returns:
+    True once both Init() and SetProgram(...) have been done.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool SpriteBatcher::IsReady() const
+{
+    return (_programId != 0) && (_instancedVaoId != 0);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts a new batch, throwing out any sprites that weren't flushed.
+Parameters:
+    sortByTexture   True to group the sprites by texture for the fewest draw calls, false to
+                    draw them in the order that they are added.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void SpriteBatcher::Begin(bool sortByTexture)
+{
+    _sortByTexture = sortByTexture;
+    _sprites.clear();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Queues up a sprite.  Nothing is drawn until Flush...().
+Parameters:
+    textureId   The 2D texture that the sprite's UV rectangle is in.
+    sprite      Where it goes and what it looks like.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void SpriteBatcher::Add(unsigned int textureId, const SpriteInstance &sprite)
+{
+    QueuedSprite queued;
+    queued.textureId = textureId;
+    queued.instance = sprite;
+    _sprites.push_back(queued);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Draws every queued sprite with one instanced draw call per run of sprites that share a
+    texture, and empties the queue.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void SpriteBatcher::Flush()
+{
+    memset(&_stats, 0, sizeof(_stats));
+    if (!IsReady() || _sprites.empty())
+    {
+        _sprites.clear();
+        return;
+    }
+    SortIfAsked();
+
+    unsigned int bufferId = 0;
+    size_t offset = 0;
+    if (!WriteInstances(&bufferId, &offset))
+    {
+        _sprites.clear();
+        return;
+    }
+
+    GlStateCache &stateCache = GlStateCache::Shared();
+    stateCache.UseProgram(_programId);
+    stateCache.Uniform1i(_reflection.UniformLocation(TEX_NAME_ID), 0);
+    stateCache.BindVertexArray(_instancedVaoId);
+    glBindVertexBuffer(INSTANCE_BINDING, bufferId, offset, SPRITE_INSTANCE_LAYOUT.stride);
+
+    // Note: The base instance says where in the instances each run starts, so the buffer
+    // binding doesn't have to move between runs.
+    size_t runStart = 0;
+    while (runStart < _sprites.size())
+    {
+        unsigned int textureId = _sprites[runStart].textureId;
+        size_t runEnd = runStart + 1;
+        while ((runEnd < _sprites.size()) && (_sprites[runEnd].textureId == textureId))
+        {
+            runEnd++;
+        }
+
+        stateCache.BindTexture(0, GL_TEXTURE_2D, textureId);
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0,
+            (GLsizei)(runEnd - runStart), (GLuint)runStart);
+        _stats.numDrawCalls++;
+        _stats.numTextureChanges++;
+        runStart = runEnd;
+    }
+
+    _stats.numSprites = (unsigned int)_sprites.size();
+    _sprites.clear();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Draws every queued sprite the way it would be done without instancing: the per-sprite
+    attributes are set with glVertexAttrib*(...) (which is what an attribute with no array
+    gets) and then a glDrawElements(...) for each one.  Only here to compare against Flush().
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void SpriteBatcher::FlushOneDrawPerSprite()
+{
+    memset(&_stats, 0, sizeof(_stats));
+    if (!IsReady() || _sprites.empty())
+    {
+        _sprites.clear();
+        return;
+    }
+    SortIfAsked();
+
+    GlStateCache &stateCache = GlStateCache::Shared();
+    stateCache.UseProgram(_programId);
+    stateCache.Uniform1i(_reflection.UniformLocation(TEX_NAME_ID), 0);
+    stateCache.BindVertexArray(_singleVaoId);
+    unsigned int lastTextureId = 0;
+    for (size_t spriteCount = 0; spriteCount < _sprites.size(); spriteCount++)
+    {
+        const QueuedSprite &sprite = _sprites[spriteCount];
+        if ((spriteCount == 0) || (sprite.textureId != lastTextureId))
+        {
+            stateCache.BindTexture(0, GL_TEXTURE_2D, sprite.textureId);
+            lastTextureId = sprite.textureId;
+            _stats.numTextureChanges++;
+        }
+
+        const SpriteInstance &instance = sprite.instance;
+        glVertexAttrib2fv(2, instance.position);
+        glVertexAttrib2fv(3, instance.scale);
+        glVertexAttrib4fv(4, instance.uvRect);
+        glVertexAttrib4Nub(5, instance.tint[0], instance.tint[1], instance.tint[2],
+            instance.tint[3]);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+        _stats.numDrawCalls++;
+    }
+
+    _stats.numSprites = (unsigned int)_sprites.size();
+    _sprites.clear();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    How the last Flush...() went.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const SpriteBatcherStats &SpriteBatcher::Stats() const
+{
+    return _stats;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Copies the queued sprites' instances to where the GPU can read them: a piece of the
+    dynamic buffer's frame if there is one and it has room, or else the batcher's own buffer,
+    orphaned first (glBufferData(...) with no data) so that the driver hands back fresh memory
+    instead of waiting for earlier draws to finish reading the old contents.
+Parameters:
+    bufferId    Gets the buffer that the instances went to.
+    offset      Gets where in it they start.
+Returns:
+    False if there was nowhere to put them.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool SpriteBatcher::WriteInstances(unsigned int *bufferId, size_t *offset)
+{
+    size_t numBytes = _sprites.size() * sizeof(SpriteInstance);
+    SpriteInstance *instances = 0;
+    if ((_dynamicBuffer != 0) && _dynamicBuffer->IsReady())
+    {
+        DynamicBufferAllocation allocation = _dynamicBuffer->Allocate(numBytes,
+            sizeof(SpriteInstance));
+        instances = (SpriteInstance *)allocation.data;
+        *bufferId = _dynamicBuffer->BufferId();
+        *offset = allocation.offset;
+    }
+
+    bool mapped = false;
+    if (instances == 0)
+    {
+        GlStateCache::Shared().BindBuffer(GL_ARRAY_BUFFER, _instanceBufferId);
+        if (numBytes > _instanceBufferSize)
+        {
+            // grow by half again so that a slowly growing count doesn't reallocate every
+            // frame
+            _instanceBufferSize = numBytes + (numBytes / 2);
+        }
+        glBufferData(GL_ARRAY_BUFFER, _instanceBufferSize, 0, GL_STREAM_DRAW);
+        instances = (SpriteInstance *)glMapBufferRange(GL_ARRAY_BUFFER, 0, numBytes,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (instances == 0)
+        {
+            printf("could not map the sprite instance buffer\n");
+            return false;
+        }
+        *bufferId = _instanceBufferId;
+        *offset = 0;
+        mapped = true;
+    }
+
+    for (size_t spriteCount = 0; spriteCount < _sprites.size(); spriteCount++)
+    {
+        instances[spriteCount] = _sprites[spriteCount].instance;
+    }
+    if (mapped)
+    {
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Groups the queued sprites by texture if Begin(...) asked for it.  The sort is stable, so
+    sprites with the same texture keep their order.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void SpriteBatcher::SortIfAsked()
+{
+    if (_sortByTexture)
+    {
+        std::stable_sort(_sprites.begin(), _sprites.end(),
+            [](const QueuedSprite &a, const QueuedSprite &b) {
+                return a.textureId < b.textureId;
+            });
+    }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "ProgramReflection.h"
+#include "VertexLayout.h"
+
+#include <vector>
+
+class DynamicVertexBuffer;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    What makes one sprite different from another.  This is also the layout of the per-instance
+    vertex attributes (see sprite.vert), so it is packed to 36 bytes.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct SpriteInstance
+{
+    float position[2];      // the center, in normalized device coordinates
+    float scale[2];         // half the width and height, same units
+    float uvRect[4];        // texture coordinates of the bottom left and top right corners
+    unsigned char tint[4];  // RGBA, multiplied with the texture
+};
+
+// sprite.vert's per-instance inputs
+static constexpr VertexAttribute SPRITE_INSTANCE_ATTRIBUTES[] =
+{
+    VERTEX_ATTRIBUTE(SpriteInstance, position, 2),
+    VERTEX_ATTRIBUTE(SpriteInstance, scale, 3),
+    VERTEX_ATTRIBUTE(SpriteInstance, uvRect, 4),
+    VERTEX_ATTRIBUTE_NORMALIZED(SpriteInstance, tint, 5),
+};
+static_assert(VertexAttributesFit<SpriteInstance>(SPRITE_INSTANCE_ATTRIBUTES),
+    "SpriteInstance's attributes don't fit it");
+static constexpr VertexLayout SPRITE_INSTANCE_LAYOUT =
+    MakeVertexLayout<SpriteInstance>(SPRITE_INSTANCE_ATTRIBUTES, 1);
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How the last Flush...() went.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct SpriteBatcherStats
+{
+    unsigned int numSprites;
+    unsigned int numDrawCalls;
+    unsigned int numTextureChanges;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Draws lots of textured quads ("sprites") in a handful of draw calls.
+
+    There is one unit quad (in the same interleaved position + texture coordinate layout as
+    CreateGeometry() in main.cpp, at attribute locations 0 and 1) and a buffer with one
+    SpriteInstance per sprite, whose attributes (locations 2 - 5) advance once per instance
+    instead of once per vertex.  Flush() writes all the queued sprites into that buffer and
+    draws each run of sprites that share a texture with one glDrawElementsInstanced...(...),
+    so 100,000 sprites with one texture are one draw call instead of 100,000.
+
+    Note: Sprites are drawn in the order that they were added unless Begin(...) is told to sort
+    them by texture, which makes the fewest draw calls but changes which sprite is drawn on top
+    of which.
+
+    Also Note: Given a DynamicVertexBuffer (see SetDynamicBuffer(...)), the instances are
+    written straight into its persistently mapped memory instead of into an orphaned buffer of
+    the batcher's own, which is then only used if the dynamic buffer's frame is full.
+
+    FlushOneDrawPerSprite() draws the same sprites the old way, with one glDrawElements(...)
+    per sprite, for comparing against (see BenchmarkSpriteBatching(...)).
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class SpriteBatcher
+{
+public:
+    SpriteBatcher();
+    ~SpriteBatcher();
+
+    // these need the OpenGL context to be current
+    bool Init();
+    void Shutdown();
+    void SetProgram(unsigned int programId);
+    void SetDynamicBuffer(DynamicVertexBuffer *dynamicBuffer);
+
+    unsigned int ProgramId() const;
+    bool IsReady() const;
+
+    void Begin(bool sortByTexture);
+    void Add(unsigned int textureId, const SpriteInstance &sprite);
+    void Flush();
+    void FlushOneDrawPerSprite();
+
+    const SpriteBatcherStats &Stats() const;
+
+private:
+    SpriteBatcher(const SpriteBatcher &);
+    SpriteBatcher &operator=(const SpriteBatcher &);
+
+    struct QueuedSprite
+    {
+        unsigned int textureId;
+        SpriteInstance instance;
+    };
+
+    void SortIfAsked();
+    bool WriteInstances(unsigned int *bufferId, size_t *offset);
+
+    unsigned int _programId;
+    ProgramReflection _reflection;
+
+    // the unit quad's vertices and indices, shared by both VAOs
+    unsigned int _quadBufferId;
+    unsigned int _quadIndexBufferId;
+
+    // the quad plus the per-instance attributes, for Flush()
+    unsigned int _instancedVaoId;
+    unsigned int _instanceBufferId;
+    size_t _instanceBufferSize;
+    DynamicVertexBuffer *_dynamicBuffer;
+
+    // the quad alone, for FlushOneDrawPerSprite(), which sets the per-sprite attributes one
+    // sprite at a time with glVertexAttrib*(...)
+    unsigned int _singleVaoId;
+
+    bool _sortByTexture;
+    std::vector<QueuedSprite> _sprites;
+    SpriteBatcherStats _stats;
+};
@@ -0,0 +1,618 @@
+// only for the GL_* enums that describe each format
+#include "glload/include/glload/gl_4_4.h"
+
+#include "TexelFormatConverter.h"
+#include "ThreadPool.h"
+#include "SimdSupport.h"
+
+#include <string.h>     // memcpy(...) and strcmp(...)
+#include <math.h>       // lrintf(...)
+#include <algorithm>
+
+// Note: The "type" is what the packed bits look like in memory and the "format" is which
+// channels are in there.  Both have to agree with the conversion code below.
+static const TexelFormatDescription FORMAT_DESCRIPTIONS[TEXEL_FORMAT_COUNT] =
+{
+    { "rgba32f", GL_RGBA32F, GL_RGBA, GL_FLOAT, 16 },
+    { "rgba16f", GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, 8 },
+    { "rgba8", GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4 },
+    { "r11g11b10f", GL_R11F_G11F_B10F, GL_RGB, GL_UNSIGNED_INT_10F_11F_11F_REV, 4 },
+    { "rgb565", GL_RGB565, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, 2 },
+};
+
+// the bit patterns of the destination's +infinity and largest finite value
+#define SMALL_FLOAT_INFINITY(mantissaBits) (0x1Fu << (mantissaBits))
+#define SMALL_FLOAT_MAX_FINITE(mantissaBits) (SMALL_FLOAT_INFINITY(mantissaBits) - 1)
+
+// All three small float formats (half, 11bit, 10bit) have a 5bit exponent with a bias of 15,
+// so they all overflow at 2^16 and all go denormal below 2^-14.  These are float bit patterns.
+static const unsigned int FLOAT_BITS_2_POW_16 = (127 + 16) << 23;
+static const unsigned int FLOAT_BITS_2_POW_MINUS_14 = (127 - 14) << 23;
+static const unsigned int FLOAT_BITS_INFINITY = 0x7F800000;
+
+// Adding this to a value that will end up as a denormal lines the value's mantissa up with the
+// destination's so that the float add does the round-to-nearest-even for free.
+#define DENORMAL_MAGIC_BITS(mantissaBits) (((127 - 15) + (23 - (mantissaBits)) + 1) << 23)
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Looks up the GL enums and size for one of the formats.
+Parameters:
+    format  One of the TexelFormat values (not TEXEL_FORMAT_COUNT).
+Returns:
+    A reference to a description that lives for the whole program.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const TexelFormatDescription &GetTexelFormatDescription(TexelFormat format)
+{
+    return FORMAT_DESCRIPTIONS[format];
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Turns a command line string like "rgba8" into the matching TexelFormat.
+Parameters:
+    name    The format's name as it appears in FORMAT_DESCRIPTIONS.
+    format  Gets the matching format if there is one.  Untouched otherwise.
+Returns:
+    True if the name matched one of the formats, otherwise false.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool ParseTexelFormat(const char *name, TexelFormat *format)
+{
+    for (int formatIndex = 0; formatIndex < TEXEL_FORMAT_COUNT; formatIndex++)
+    {
+        if (strcmp(name, FORMAT_DESCRIPTIONS[formatIndex].name) == 0)
+        {
+            *format = (TexelFormat)formatIndex;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    For reporting which version of the conversion got compiled in for a given format.
+Parameters:
+    format  One of the TexelFormat values.
+Returns:
+    A string literal that names the instruction set.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const char *TexelConversionInstructionSet(TexelFormat format)
+{
+    if (format == TEXEL_FORMAT_RGBA32F)
+    {
+        return "memcpy";
+    }
+
+#if defined(SIMD_F16C) && defined(SIMD_AVX)
+    if (format == TEXEL_FORMAT_RGBA16F)
+    {
+        return "AVX+F16C";
+    }
+#elif defined(SIMD_F16C)
+    if (format == TEXEL_FORMAT_RGBA16F)
+    {
+        return "F16C";
+    }
+#endif
+
+#if defined(SIMD_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+
+// ---------------------------------------------------------------------------------------------
+// scalar reference versions
+// Note: The SIMD versions must produce exactly the same bits as these, including for NaN,
+// infinity, negatives, and denormals.  Every comparison and rounding step here is written to
+// mirror what the SSE instructions do rather than what would be the most "natural" C++.
+// ---------------------------------------------------------------------------------------------
+
+static inline unsigned int FloatBits(float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static inline float BitsToFloat(unsigned int bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Clamps to [0, 1], scales, and rounds to the nearest integer (ties to even).  This is the
+    conversion for all of the unsigned normalized formats.
+
+    Note: The comparisons are the same as minps/maxps, which return the second operand when
+    either one is NaN, so NaN becomes 1 and then clamps to 1.
+Parameters:
+    value       A color channel.
+    maxValue    The largest integer that the channel can hold (ex: 255 for 8 bits).
+Returns:
+    The integer value of the channel.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static inline unsigned int FloatToUnorm(float value, float maxValue)
+{
+    value = (value < 1.0f) ? value : 1.0f;
+    value = (value > 0.0f) ? value : 0.0f;
+
+    // lrintf(...) rounds in the current rounding mode (nearest-even unless someone changed
+    // it), which is the same thing that cvtps2dq does
+    return (unsigned int)lrintf(value * maxValue);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Converts a 32bit float to a smaller float with a 5bit exponent (bias 15) and the given
+    number of mantissa bits, rounding to nearest-even.  This covers IEEE half floats (signed,
+    10 mantissa bits) and the unsigned 11bit/10bit floats of GL_R11F_G11F_B10F (6 and 5
+    mantissa bits).
+
+    Half floats follow IEEE (and the F16C instructions): too big becomes infinity and NaN
+    stays a quiet NaN with the top of its payload.  The unsigned formats follow
+    EXT_packed_float: negatives become 0, and finite values that are too big become the
+    largest finite value rather than infinity.
+Parameters:
+    value           The float to convert.
+    mantissaBits    10 for half, 6 for 11bit, 5 for 10bit.
+    isSigned        True for half, false for the 11bit/10bit floats.
+Returns:
+    The small float's bits in the low bits of the return value.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static unsigned int FloatToSmallFloat(float value, unsigned int mantissaBits, bool isSigned)
+{
+    unsigned int bits = FloatBits(value);
+    unsigned int sign = bits & 0x80000000;
+    bits ^= sign;
+    unsigned int shift = 23 - mantissaBits;
+    bool isInfinity = (bits == FLOAT_BITS_INFINITY);
+
+    unsigned int result = 0;
+    if (bits > FLOAT_BITS_INFINITY)
+    {
+        // NaN, so make it quiet and keep whatever of the payload fits
+        result = SMALL_FLOAT_INFINITY(mantissaBits) | (1 << (mantissaBits - 1)) |
+            ((bits & 0x007FFFFF) >> shift);
+        return isSigned ? (result | (sign >> 16)) : result;
+    }
+    else if (isInfinity)
+    {
+        result = SMALL_FLOAT_INFINITY(mantissaBits);
+    }
+    else if (bits >= FLOAT_BITS_2_POW_16)
+    {
+        result = isSigned ? SMALL_FLOAT_INFINITY(mantissaBits) :
+            SMALL_FLOAT_MAX_FINITE(mantissaBits);
+    }
+    else if (bits < FLOAT_BITS_2_POW_MINUS_14)
+    {
+        // denormal (or zero) in the destination
+        unsigned int magicBits = DENORMAL_MAGIC_BITS(mantissaBits);
+        result = FloatBits(BitsToFloat(bits) + BitsToFloat(magicBits)) - magicBits;
+    }
+    else
+    {
+        // normal, so re-bias the exponent and round the mantissa (ties go to the even side,
+        // and a mantissa that rounds up past all 1s carries into the exponent on its own)
+        unsigned int mantissaIsOdd = (bits >> shift) & 1;
+        bits += ((unsigned int)(15 - 127) << 23) + (1 << (shift - 1)) - 1 + mantissaIsOdd;
+        result = bits >> shift;
+    }
+
+    if (isSigned)
+    {
+        return result | (sign >> 16);
+    }
+    else if (sign != 0)
+    {
+        return 0;
+    }
+
+    // rounding right below 2^16 can carry into infinity, and that has to stop at the largest
+    // finite value too
+    if ((result > SMALL_FLOAT_MAX_FINITE(mantissaBits)) && !isInfinity)
+    {
+        result = SMALL_FLOAT_MAX_FINITE(mantissaBits);
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Converts a 32bit float to an IEEE half float, the same way as RGBA16F texels.
+Parameters:
+    value   The float to convert.
+Returns:
+    The half's bits.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned short FloatToHalf(float value)
+{
+    return (unsigned short)FloatToSmallFloat(value, 10, true);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The plain C++ version of every conversion.  This is what the SIMD versions are checked
+    against, and it is also what handles the last few texels that don't fill a whole SIMD
+    register.
+Parameters:
+    texels      The RGBA32F source.
+    numTexels   How many to convert.
+    format      What to convert them to.
+    dest        Where to write.  Must hold numTexels * bytesPerTexel bytes.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ConvertTexelsScalar(const texel *texels, size_t numTexels, TexelFormat format, void *dest)
+{
+    switch (format)
+    {
+    case TEXEL_FORMAT_RGBA32F:
+    {
+        memcpy(dest, texels, numTexels * sizeof(texel));
+        break;
+    }
+    case TEXEL_FORMAT_RGBA16F:
+    {
+        unsigned short *halfs = (unsigned short *)dest;
+        for (size_t texelCount = 0; texelCount < numTexels; texelCount++)
+        {
+            const texel &t = texels[texelCount];
+            halfs[(texelCount * 4) + 0] = (unsigned short)FloatToSmallFloat(t.r, 10, true);
+            halfs[(texelCount * 4) + 1] = (unsigned short)FloatToSmallFloat(t.g, 10, true);
+            halfs[(texelCount * 4) + 2] = (unsigned short)FloatToSmallFloat(t.b, 10, true);
+            halfs[(texelCount * 4) + 3] = (unsigned short)FloatToSmallFloat(t.a, 10, true);
+        }
+        break;
+    }
+    case TEXEL_FORMAT_RGBA8:
+    {
+        unsigned char *bytes = (unsigned char *)dest;
+        for (size_t texelCount = 0; texelCount < numTexels; texelCount++)
+        {
+            const texel &t = texels[texelCount];
+            bytes[(texelCount * 4) + 0] = (unsigned char)FloatToUnorm(t.r, 255.0f);
+            bytes[(texelCount * 4) + 1] = (unsigned char)FloatToUnorm(t.g, 255.0f);
+            bytes[(texelCount * 4) + 2] = (unsigned char)FloatToUnorm(t.b, 255.0f);
+            bytes[(texelCount * 4) + 3] = (unsigned char)FloatToUnorm(t.a, 255.0f);
+        }
+        break;
+    }
+    case TEXEL_FORMAT_R11G11B10F:
+    {
+        // GL_UNSIGNED_INT_10F_11F_11F_REV puts red in the lowest bits
+        unsigned int *packed = (unsigned int *)dest;
+        for (size_t texelCount = 0; texelCount < numTexels; texelCount++)
+        {
+            const texel &t = texels[texelCount];
+            packed[texelCount] = FloatToSmallFloat(t.r, 6, false) |
+                (FloatToSmallFloat(t.g, 6, false) << 11) |
+                (FloatToSmallFloat(t.b, 5, false) << 22);
+        }
+        break;
+    }
+    case TEXEL_FORMAT_RGB565:
+    {
+        // GL_UNSIGNED_SHORT_5_6_5 puts red in the highest bits
+        unsigned short *packed = (unsigned short *)dest;
+        for (size_t texelCount = 0; texelCount < numTexels; texelCount++)
+        {
+            const texel &t = texels[texelCount];
+            packed[texelCount] = (unsigned short)((FloatToUnorm(t.r, 31.0f) << 11) |
+                (FloatToUnorm(t.g, 63.0f) << 5) | FloatToUnorm(t.b, 31.0f));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+
+// ---------------------------------------------------------------------------------------------
+// SIMD versions
+// ---------------------------------------------------------------------------------------------
+
+#if defined(SIMD_SSE2)
+
+// picks "a" where the mask is all 1s and "b" where it is all 0s
+static inline __m128i Select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    FloatToSmallFloat(...), four lanes at a time.  Every case is computed for every lane and
+    then the right answer is picked with masks, since there is no branching per lane.
+Parameters:
+    value   Four floats, all going to the same small float format.
+Returns:
+    The four small floats, one in the low bits of each 32bit lane.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+template<unsigned int mantissaBits, bool isSigned>
+static inline __m128i FloatToSmallFloatSse2(__m128 value)
+{
+    const int shift = 23 - mantissaBits;
+    const unsigned int magicBits = DENORMAL_MAGIC_BITS(mantissaBits);
+
+    __m128i bits = _mm_castps_si128(value);
+    __m128i sign = _mm_and_si128(bits, _mm_set1_epi32((int)0x80000000));
+    bits = _mm_xor_si128(bits, sign);
+
+    // Note: The sign bit is gone, so the signed integer compares are safe.
+    __m128i isNan = _mm_cmpgt_epi32(bits, _mm_set1_epi32(FLOAT_BITS_INFINITY));
+    __m128i isInfinity = _mm_cmpeq_epi32(bits, _mm_set1_epi32(FLOAT_BITS_INFINITY));
+    __m128i isTooBig = _mm_cmpgt_epi32(bits, _mm_set1_epi32(FLOAT_BITS_2_POW_16 - 1));
+    __m128i isDenormal = _mm_cmplt_epi32(bits, _mm_set1_epi32(FLOAT_BITS_2_POW_MINUS_14));
+
+    __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(magicBits));
+    __m128i denormalResult = _mm_sub_epi32(
+        _mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), magic)), _mm_set1_epi32(magicBits));
+
+    __m128i mantissaIsOdd = _mm_and_si128(_mm_srli_epi32(bits, shift), _mm_set1_epi32(1));
+    __m128i normalResult = _mm_add_epi32(bits,
+        _mm_set1_epi32((int)(((unsigned int)(15 - 127) << 23) + (1 << (shift - 1)) - 1)));
+    normalResult = _mm_srli_epi32(_mm_add_epi32(normalResult, mantissaIsOdd), shift);
+
+    __m128i nanResult = _mm_or_si128(
+        _mm_set1_epi32(SMALL_FLOAT_INFINITY(mantissaBits) | (1 << (mantissaBits - 1))),
+        _mm_srli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), shift));
+
+    __m128i result = Select(isDenormal, denormalResult, normalResult);
+    if (isSigned)
+    {
+        result = Select(isTooBig, _mm_set1_epi32(SMALL_FLOAT_INFINITY(mantissaBits)), result);
+        result = Select(isNan, nanResult, result);
+        result = _mm_or_si128(result, _mm_srli_epi32(sign, 16));
+    }
+    else
+    {
+        // finite overflow (including rounding up into infinity) stops at the largest finite
+        __m128i maxFinite = _mm_set1_epi32(SMALL_FLOAT_MAX_FINITE(mantissaBits));
+        result = Select(_mm_cmpgt_epi32(result, maxFinite), maxFinite, result);
+        result = Select(isTooBig, maxFinite, result);
+        result = Select(isInfinity, _mm_set1_epi32(SMALL_FLOAT_INFINITY(mantissaBits)), result);
+
+        // negatives become 0, but NaN is still NaN regardless of its sign
+        __m128i isNegative = _mm_cmpeq_epi32(sign, _mm_set1_epi32((int)0x80000000));
+        result = _mm_andnot_si128(isNegative, result);
+        result = Select(isNan, nanResult, result);
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    FloatToUnorm(...), four lanes at a time.  Each lane can have its own scale, which is how
+    RGB565 gets 31/63/31 out of one multiply.
+Parameters:
+    value       Four floats.
+    maxValues   The largest integer for each lane.
+Returns:
+    Four integers, one per 32bit lane.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static inline __m128i FloatToUnormSse2(__m128 value, __m128 maxValues)
+{
+    value = _mm_min_ps(value, _mm_set1_ps(1.0f));
+    value = _mm_max_ps(value, _mm_setzero_ps());
+    return _mm_cvtps_epi32(_mm_mul_ps(value, maxValues));
+}
+
+// _mm_packs_epi32(...) saturates to *signed* 16bit, so shift the 16bit values down into the
+// signed range, pack, then flip the top bit to get the original bits back
+static inline __m128i PackLow16(__m128i a, __m128i b)
+{
+    __m128i bias = _mm_set1_epi32(0x8000);
+    __m128i packed = _mm_packs_epi32(_mm_sub_epi32(a, bias), _mm_sub_epi32(b, bias));
+    return _mm_xor_si128(packed, _mm_set1_epi16((short)0x8000));
+}
+
+#endif // SIMD_SSE2
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Same as ConvertTexelsScalar(...), but several texels at a time with whatever SIMD the build
+    allows.  Whatever doesn't fill a whole register at the end goes through the scalar version.
+Parameters:
+    texels      The RGBA32F source.  Must be 16-byte aligned (every texel in a TexelBuffer is).
+    numTexels   How many to convert.
+    format      What to convert them to.
+    dest        Where to write.  Must hold numTexels * bytesPerTexel bytes.  No alignment
+                requirement.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ConvertTexelsSimd(const texel *texels, size_t numTexels, TexelFormat format, void *dest)
+{
+    size_t texelCount = 0;
+    const float *src = (const float *)texels;
+    unsigned char *destBytes = (unsigned char *)dest;
+#if !defined(SIMD_SSE2) && !defined(SIMD_F16C)
+    (void)src;
+#endif
+
+    switch (format)
+    {
+    case TEXEL_FORMAT_RGBA16F:
+    {
+#if defined(SIMD_F16C) && defined(SIMD_AVX)
+        // the hardware does it: 8 floats in, 8 halfs out
+        for (; texelCount + 2 <= numTexels; texelCount += 2)
+        {
+            __m128i halfs = _mm256_cvtps_ph(_mm256_loadu_ps(src + (texelCount * 4)),
+                _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128((__m128i *)(destBytes + (texelCount * 8)), halfs);
+        }
+#elif defined(SIMD_F16C)
+        for (; texelCount + 1 <= numTexels; texelCount += 1)
+        {
+            __m128i halfs = _mm_cvtps_ph(_mm_load_ps(src + (texelCount * 4)),
+                _MM_FROUND_TO_NEAREST_INT);
+            _mm_storel_epi64((__m128i *)(destBytes + (texelCount * 8)), halfs);
+        }
+#elif defined(SIMD_SSE2)
+        for (; texelCount + 2 <= numTexels; texelCount += 2)
+        {
+            __m128i first = FloatToSmallFloatSse2<10, true>(_mm_load_ps(src + (texelCount * 4)));
+            __m128i second = FloatToSmallFloatSse2<10, true>(
+                _mm_load_ps(src + (texelCount * 4) + 4));
+            _mm_storeu_si128((__m128i *)(destBytes + (texelCount * 8)), PackLow16(first, second));
+        }
+#endif
+        break;
+    }
+    case TEXEL_FORMAT_RGBA8:
+    {
+#if defined(SIMD_SSE2)
+        __m128 maxValues = _mm_set1_ps(255.0f);
+        for (; texelCount + 4 <= numTexels; texelCount += 4)
+        {
+            const float *texelSrc = src + (texelCount * 4);
+            __m128i t0 = FloatToUnormSse2(_mm_load_ps(texelSrc + 0), maxValues);
+            __m128i t1 = FloatToUnormSse2(_mm_load_ps(texelSrc + 4), maxValues);
+            __m128i t2 = FloatToUnormSse2(_mm_load_ps(texelSrc + 8), maxValues);
+            __m128i t3 = FloatToUnormSse2(_mm_load_ps(texelSrc + 12), maxValues);
+
+            // 32bit -> 16bit -> 8bit; every value is already 0-255, so nothing saturates
+            __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(t0, t1), _mm_packs_epi32(t2, t3));
+            _mm_storeu_si128((__m128i *)(destBytes + (texelCount * 4)), bytes);
+        }
+#endif
+        break;
+    }
+    case TEXEL_FORMAT_R11G11B10F:
+    {
+#if defined(SIMD_SSE2)
+        // the channels have different mantissa sizes, so turn 4 RGBA texels into RRRR, GGGG,
+        // BBBB, AAAA to give every lane in a register the same conversion
+        for (; texelCount + 4 <= numTexels; texelCount += 4)
+        {
+            const float *texelSrc = src + (texelCount * 4);
+            __m128 r = _mm_load_ps(texelSrc + 0);
+            __m128 g = _mm_load_ps(texelSrc + 4);
+            __m128 b = _mm_load_ps(texelSrc + 8);
+            __m128 a = _mm_load_ps(texelSrc + 12);
+            _MM_TRANSPOSE4_PS(r, g, b, a);
+
+            __m128i packed = FloatToSmallFloatSse2<6, false>(r);
+            packed = _mm_or_si128(packed, _mm_slli_epi32(FloatToSmallFloatSse2<6, false>(g), 11));
+            packed = _mm_or_si128(packed, _mm_slli_epi32(FloatToSmallFloatSse2<5, false>(b), 22));
+            _mm_storeu_si128((__m128i *)(destBytes + (texelCount * 4)), packed);
+        }
+#endif
+        break;
+    }
+    case TEXEL_FORMAT_RGB565:
+    {
+#if defined(SIMD_SSE2)
+        __m128 maxValues = _mm_setr_ps(31.0f, 63.0f, 31.0f, 0.0f);
+        for (; texelCount + 8 <= numTexels; texelCount += 8)
+        {
+            __m128i packed[2];
+            for (int half = 0; half < 2; half++)
+            {
+                const float *texelSrc = src + ((texelCount + (half * 4)) * 4);
+                __m128 r = _mm_load_ps(texelSrc + 0);
+                __m128 g = _mm_load_ps(texelSrc + 4);
+                __m128 b = _mm_load_ps(texelSrc + 8);
+                __m128 a = _mm_load_ps(texelSrc + 12);
+                _MM_TRANSPOSE4_PS(r, g, b, a);
+
+                __m128i r5 = FloatToUnormSse2(r, _mm_shuffle_ps(maxValues, maxValues, 0x00));
+                __m128i g6 = FloatToUnormSse2(g, _mm_shuffle_ps(maxValues, maxValues, 0x55));
+                __m128i b5 = FloatToUnormSse2(b, _mm_shuffle_ps(maxValues, maxValues, 0xAA));
+                packed[half] = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r5, 11),
+                    _mm_slli_epi32(g6, 5)), b5);
+            }
+            _mm_storeu_si128((__m128i *)(destBytes + (texelCount * 2)),
+                PackLow16(packed[0], packed[1]));
+        }
+#endif
+        break;
+    }
+    default:
+        break;
+    }
+
+    // leftovers (or everything, if there was no SIMD version for this format)
+    const TexelFormatDescription &description = FORMAT_DESCRIPTIONS[format];
+    ConvertTexelsScalar(texels + texelCount, numTexels - texelCount, format,
+        destBytes + (texelCount * description.bytesPerTexel));
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Packs a whole texture into the given format on the shared thread pool.
+Parameters:
+    texels      The RGBA32F source, as made by the texture generator.
+    numTexels   How many texels there are.
+    format      What to convert them to.
+    dest        Where to write.  Must hold numTexels * bytesPerTexel bytes.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ConvertTexels(const texel *texels, size_t numTexels, TexelFormat format, void *dest)
+{
+    unsigned int bytesPerTexel = FORMAT_DESCRIPTIONS[format].bytesPerTexel;
+    unsigned char *destBytes = (unsigned char *)dest;
+    ThreadPool::Shared().ParallelFor(numTexels, 16 * 1024,
+        [texels, format, destBytes, bytesPerTexel](size_t begin, size_t end)
+    {
+        ConvertTexelsSimd(texels + begin, end - begin, format,
+            destBytes + (begin * bytesPerTexel));
+    });
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Allocates a buffer of the right size and packs a whole texture into it, ready to hand to 
+    glTexImage2D(...) with the format's description.
+Parameters:
+    texels      The RGBA32F source, as made by the texture generator.
+    numTexels   How many texels there are.
+    format      What to convert them to.
+Returns:
+    The packed bytes, or an empty buffer if the allocation failed.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+PackedTexelBuffer ConvertTexels(const texel *texels, size_t numTexels, TexelFormat format)
+{
+    PackedTexelBuffer packed(numTexels * FORMAT_DESCRIPTIONS[format].bytesPerTexel);
+    if (packed.Data() != 0)
+    {
+        ConvertTexels(texels, numTexels, format, packed.Data());
+    }
+
+    return packed;
+}
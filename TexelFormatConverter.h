@@ -0,0 +1,49 @@
+#pragma once
+
+#include "TextureGenerator.h"
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The layouts that a texture can be packed into before it goes to glTexImage2D(...).  The
+    generator makes RGBA32F (16 bytes per texel), which is far more precision than a color
+    texture needs, and every one of those bytes has to cross the bus.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+enum TexelFormat
+{
+    TEXEL_FORMAT_RGBA32F = 0,   // 16 bytes, no conversion
+    TEXEL_FORMAT_RGBA16F,       // 8 bytes, IEEE half floats
+    TEXEL_FORMAT_RGBA8,         // 4 bytes, unsigned normalized
+    TEXEL_FORMAT_R11G11B10F,    // 4 bytes, unsigned small floats, no alpha
+    TEXEL_FORMAT_RGB565,        // 2 bytes, unsigned normalized, no alpha
+    TEXEL_FORMAT_COUNT,
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Everything that glTexImage2D(...) needs to know about a packed format.  The internal format
+    is always a sized one so that the driver doesn't get to pick the storage on its own.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct TexelFormatDescription
+{
+    const char *name;
+    int internalFormat;         // ex: GL_RGBA8
+    unsigned int format;        // ex: GL_RGBA
+    unsigned int type;          // ex: GL_UNSIGNED_BYTE
+    unsigned int bytesPerTexel;
+};
+
+typedef AlignedBuffer<unsigned char, 32> PackedTexelBuffer;
+
+const TexelFormatDescription &GetTexelFormatDescription(TexelFormat format);
+bool ParseTexelFormat(const char *name, TexelFormat *format);
+const char *TexelConversionInstructionSet(TexelFormat format);
+
+PackedTexelBuffer ConvertTexels(const texel *texels, size_t numTexels, TexelFormat format);
+void ConvertTexels(const texel *texels, size_t numTexels, TexelFormat format, void *dest);
+void ConvertTexelsSimd(const texel *texels, size_t numTexels, TexelFormat format, void *dest);
+void ConvertTexelsScalar(const texel *texels, size_t numTexels, TexelFormat format, void *dest);
+
+// the same IEEE half that RGBA16F texels get (and that F16C makes), for other things to use
+unsigned short FloatToHalf(float value);
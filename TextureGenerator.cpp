@@ -0,0 +1,239 @@
+#include "TextureGenerator.h"
+#include "ThreadPool.h"
+#include "SimdSupport.h"
+
+#include <algorithm>
+
+// Past this many bytes, a fill will not fit in cache anyway, so write around the cache with
+// "streaming" stores instead of evicting everything else for data that won't be read again
+// until glTexImage2D(...).
+static const size_t STREAMING_STORE_THRESHOLD_BYTES = 4 * 1024 * 1024;
+
+// the bottom third is red, the middle third green, and the top third blue
+static const texel TRICOLOR_COLORS[3] =
+{
+    { 1.0f, 0.0f, 0.0f, 1.0f },
+    { 0.0f, 1.0f, 0.0f, 1.0f },
+    { 0.0f, 0.0f, 1.0f, 1.0f },
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Sets every texel in [dest, dest + numTexels) to the same color using the widest stores
+    that the build allows (see SimdSupport.h).
+Parameters:
+    dest        Where to start writing.  Must be at least 16-byte aligned (every texel in a
+                TexelBuffer is).
+    numTexels   How many texels to write.
+    color       What to write.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void FillTexels(texel *dest, size_t numTexels, const texel &color)
+{
+    size_t texelCount = 0;
+    bool stream = (numTexels * sizeof(texel)) >= STREAMING_STORE_THRESHOLD_BYTES;
+
+#if defined(SIMD_AVX)
+    // one 256bit register holds two texels
+    // Note: The AVX stores need 32-byte alignment but texels are 16 bytes, so a band that
+    // starts on an odd texel gets one texel written by itself first.
+    if ((numTexels > 0) && (((size_t)dest & 31) != 0))
+    {
+        dest[0] = color;
+        texelCount = 1;
+    }
+
+    __m256 twoTexels = _mm256_setr_ps(color.r, color.g, color.b, color.a,
+        color.r, color.g, color.b, color.a);
+    float *destFloats = (float *)dest;
+    if (stream)
+    {
+        for (; texelCount + 8 <= numTexels; texelCount += 8)
+        {
+            _mm256_stream_ps(destFloats + (texelCount * 4) + 0, twoTexels);
+            _mm256_stream_ps(destFloats + (texelCount * 4) + 8, twoTexels);
+            _mm256_stream_ps(destFloats + (texelCount * 4) + 16, twoTexels);
+            _mm256_stream_ps(destFloats + (texelCount * 4) + 24, twoTexels);
+        }
+        // streaming stores are weakly ordered, so make sure that they are all visible before
+        // anyone else (ex: the thread that waits on this band) reads them
+        _mm_sfence();
+    }
+    else
+    {
+        for (; texelCount + 8 <= numTexels; texelCount += 8)
+        {
+            _mm256_store_ps(destFloats + (texelCount * 4) + 0, twoTexels);
+            _mm256_store_ps(destFloats + (texelCount * 4) + 8, twoTexels);
+            _mm256_store_ps(destFloats + (texelCount * 4) + 16, twoTexels);
+            _mm256_store_ps(destFloats + (texelCount * 4) + 24, twoTexels);
+        }
+    }
+#elif defined(SIMD_SSE2)
+    // one 128bit register holds exactly one texel
+    __m128 oneTexel = _mm_setr_ps(color.r, color.g, color.b, color.a);
+    float *destFloats = (float *)dest;
+    if (stream)
+    {
+        for (; texelCount + 4 <= numTexels; texelCount += 4)
+        {
+            _mm_stream_ps(destFloats + (texelCount * 4) + 0, oneTexel);
+            _mm_stream_ps(destFloats + (texelCount * 4) + 4, oneTexel);
+            _mm_stream_ps(destFloats + (texelCount * 4) + 8, oneTexel);
+            _mm_stream_ps(destFloats + (texelCount * 4) + 12, oneTexel);
+        }
+        _mm_sfence();
+    }
+    else
+    {
+        for (; texelCount + 4 <= numTexels; texelCount += 4)
+        {
+            _mm_store_ps(destFloats + (texelCount * 4) + 0, oneTexel);
+            _mm_store_ps(destFloats + (texelCount * 4) + 4, oneTexel);
+            _mm_store_ps(destFloats + (texelCount * 4) + 8, oneTexel);
+            _mm_store_ps(destFloats + (texelCount * 4) + 12, oneTexel);
+        }
+    }
+#else
+    (void)stream;
+#endif
+
+    // whatever is left over (or everything, if there is no SIMD)
+    for (; texelCount < numTexels; texelCount++)
+    {
+        dest[texelCount] = color;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    For reporting which version of FillTexels(...) got compiled in.
+Parameters: None
+Returns:
+    A string literal that names the instruction set.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const char *TexelFillInstructionSet()
+{
+#if defined(SIMD_AVX)
+    return "AVX";
+#elif defined(SIMD_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Fills rows [beginRow, endRow) of the red/green/blue texture.  Every row is a single color,
+    and rows are contiguous in memory, so a run of same-colored rows is one big FillTexels(...).
+Parameters:
+    texels          The start of the whole texture (not the start of the band).
+    texelsPerRow    Texture width.
+    numRows         Texture height (needed to figure out where the thirds are).
+    beginRow        First row to fill.
+    endRow          One past the last row to fill.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static void FillTricolorRows(texel *texels, size_t texelsPerRow, size_t numRows,
+    size_t beginRow, size_t endRow)
+{
+    // same boundaries as the original loop: rows < 1/3 are red, rows < 2/3 are green
+    const size_t bandEnds[3] = { numRows / 3, (2 * numRows) / 3, numRows };
+
+    size_t row = beginRow;
+    for (size_t colorIndex = 0; (colorIndex < 3) && (row < endRow); colorIndex++)
+    {
+        size_t bandEnd = std::min(bandEnds[colorIndex], endRow);
+        if (row >= bandEnd)
+        {
+            continue;
+        }
+
+        FillTexels(texels + (row * texelsPerRow), (bandEnd - row) * texelsPerRow,
+            TRICOLOR_COLORS[colorIndex]);
+        row = bandEnd;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Writes the demo's texture (bottom third red, middle third green, top third blue) into
+    already-allocated memory.  The rows are split into bands and the bands are filled by the
+    shared thread pool.
+
+    The layout is the one that glTexImage2D(...) wants: the first texel is the lower left
+    corner, then left-to-right across the bottom row, then on up through the higher rows.
+Parameters:
+    texels          Where to write.  Must hold texelsPerRow * numRows texels and be at least
+                    16-byte aligned.
+    texelsPerRow    How many texels wide.
+    numRows         How many texels tall.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void FillTricolorTexture(texel *texels, unsigned int texelsPerRow, unsigned int numRows)
+{
+    if ((texelsPerRow == 0) || (numRows == 0))
+    {
+        return;
+    }
+
+    // Note: Handing out bands of less than ~64KB costs more in thread handoff than it saves.
+    size_t minRowsPerBand = std::max((size_t)1, 
+        (64 * 1024) / ((size_t)texelsPerRow * sizeof(texel)));
+    ThreadPool::Shared().ParallelFor(numRows, minRowsPerBand,
+        [texels, texelsPerRow, numRows](size_t beginRow, size_t endRow)
+    {
+        FillTricolorRows(texels, texelsPerRow, numRows, beginRow, endRow);
+    });
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Same as FillTricolorTexture(...), but all on the calling thread.  Useful for telling how
+    much of the speedup comes from the threads and how much from the SIMD stores.
+Parameters:
+    texels          Where to write.  Must hold texelsPerRow * numRows texels and be at least
+                    16-byte aligned.
+    texelsPerRow    How many texels wide.
+    numRows         How many texels tall.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void FillTricolorTextureSingleThreaded(texel *texels, unsigned int texelsPerRow,
+    unsigned int numRows)
+{
+    FillTricolorRows(texels, texelsPerRow, numRows, 0, numRows);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Allocates a heap buffer of the right size and alignment and fills it with
+    FillTricolorTexture(...).
+Parameters:
+    texelsPerRow    How many texels wide.
+    numRows         How many texels tall.
+Returns:
+    The texels, or an empty buffer if the allocation failed.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+TexelBuffer GenerateTricolorTexture(unsigned int texelsPerRow, unsigned int numRows)
+{
+    TexelBuffer texels((size_t)texelsPerRow * numRows);
+    if (texels.Data() != 0)
+    {
+        FillTricolorTexture(texels.Data(), texelsPerRow, numRows);
+    }
+
+    return texels;
+}
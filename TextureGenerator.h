@@ -0,0 +1,32 @@
+#pragma once
+
+#include "AlignedBuffer.h"
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    One RGBA texel as glTexImage2D(...) expects it when given GL_RGBA + GL_FLOAT.
+
+    Note: Do NOT define any methods or else the "texel t = { ... }" array-style assignments
+    will stop compiling.  Even a constructor that takes nothing and does nothing will prevent
+    it.
+    Also Note: It is plain "float" rather than "GLfloat" so that the CPU-side texture code
+    doesn't need to drag in the OpenGL headers.  They're the same thing.
+Creator:    John Cox (2-24-2016)
+-----------------------------------------------------------------------------------------------*/
+struct texel
+{
+    float r;
+    float g;
+    float b;
+    float a;  // alpha
+};
+
+// 32-byte aligned so that AVX can store two texels at a time
+typedef AlignedBuffer<texel, 32> TexelBuffer;
+
+TexelBuffer GenerateTricolorTexture(unsigned int texelsPerRow, unsigned int numRows);
+void FillTricolorTexture(texel *texels, unsigned int texelsPerRow, unsigned int numRows);
+void FillTricolorTextureSingleThreaded(texel *texels, unsigned int texelsPerRow,
+    unsigned int numRows);
+void FillTexels(texel *dest, size_t numTexels, const texel &color);
+const char *TexelFillInstructionSet();
@@ -0,0 +1,455 @@
+#include "glload/include/glload/gl_4_4.h"
+#include "glload/include/glload/gl_load.hpp"
+
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
+#include "GlStateCache.h"
+
+#include <stdio.h>
+#include <string.h>     // memset(...)
+#include <chrono>
+
+// Note: Buffer offsets that glTexSubImage2D(...) reads from must be a multiple of the texel
+// size, and anything cache-line aligned or better is kinder to the producers writing into
+// them.
+static const size_t SLOT_ALIGNMENT = 256;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts out empty.  Nothing happens until Init(...).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+TextureStreamer::TextureStreamer() :
+    _textureId(0),
+    _bufferId(0),
+    _mappedBytes(0),
+    _width(0),
+    _height(0),
+    _texelFormat(TEXEL_FORMAT_RGBA8),
+    _bytesPerImage(0),
+    _slotStride(0),
+    _numSlots(0),
+    _nextProduceSlot(0),
+    _nextUploadSlot(0),
+    _nextFrameNumber(0),
+    _numProducing(0)
+{
+    for (unsigned int slotIndex = 0; slotIndex < MAX_SLOTS; slotIndex++)
+    {
+        _slots[slotIndex].state = SLOT_FREE;
+        _slots[slotIndex].fence = 0;
+        _slots[slotIndex].frameNumber = 0;
+    }
+    ResetStats();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Waits for any producers that are still running.
+
+    Note: If Init(...) succeeded, then Shutdown() must be called while the context is still
+    current.  By the time a global streamer is destroyed, the context is usually gone.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+TextureStreamer::~TextureStreamer()
+{
+    std::unique_lock<std::mutex> lock(_producingLock);
+    _producersDone.wait(lock, [this]() { return _numProducing == 0; });
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes the texture (one level, immutable storage) and the persistently mapped ring of
+    slots, makes the first image right away so that the texture is never undefined, and
+    starts the producers on the rest of the slots.
+Parameters:
+    width           Texture width.
+    height          Texture height.
+    texelFormat     What the producer writes and the texture stores.
+    numSlots        How many images can be in the pipeline at once (being written, waiting,
+                    or being read by the GPU).  3 is the usual; at most MAX_SLOTS.
+    producer        Makes each image.  Must be safe to call from several threads at once.
+Returns:
+    True if everything was made, false if the driver can't do persistent mapping.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool TextureStreamer::Init(unsigned int width, unsigned int height, TexelFormat texelFormat,
+    unsigned int numSlots, const TextureProducer &producer)
+{
+    Shutdown();
+    if (!glload::IsVersionGEQ(4, 4) && !glext_ARB_buffer_storage)
+    {
+        printf("texture streaming needs GL_ARB_buffer_storage (OpenGL 4.4)\n");
+        return false;
+    }
+
+    const TexelFormatDescription &description = GetTexelFormatDescription(texelFormat);
+    _width = width;
+    _height = height;
+    _texelFormat = texelFormat;
+    _bytesPerImage = (size_t)width * height * description.bytesPerTexel;
+    _slotStride = (_bytesPerImage + SLOT_ALIGNMENT - 1) & ~(SLOT_ALIGNMENT - 1);
+    _numSlots = (numSlots < 2) ? 2 : ((numSlots > MAX_SLOTS) ? MAX_SLOTS : numSlots);
+    _producer = producer;
+
+    // Note: The binds go through the state cache like Update()'s, so that its shadow of
+    // texture unit 0 and the unpack buffer stays right without an Invalidate().
+    GlStateCache &stateCache = GlStateCache::Shared();
+    glGenTextures(1, &_textureId);
+    stateCache.BindTexture(0, GL_TEXTURE_2D, _textureId);
+    glTexStorage2D(GL_TEXTURE_2D, 1, description.internalFormat, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    stateCache.BindTexture(0, GL_TEXTURE_2D, 0);
+
+    // Note: "Coherent" means that the producers' writes show up to the GPU without having to
+    // call glFlushMappedBufferRange(...), which would have to happen on the OpenGL thread.
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLsizeiptr bufferSize = (GLsizeiptr)(_slotStride * _numSlots);
+    glGenBuffers(1, &_bufferId);
+    stateCache.BindBuffer(GL_PIXEL_UNPACK_BUFFER, _bufferId);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, bufferSize, 0, flags);
+    _mappedBytes = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bufferSize,
+        flags);
+    stateCache.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (_mappedBytes == 0)
+    {
+        printf("could not map a %u byte streaming buffer\n", (unsigned int)bufferSize);
+        Shutdown();
+        return false;
+    }
+
+    // the first image is made right here so that the first frame has something to draw
+    _producer(0, _mappedBytes);
+    _slots[0].frameNumber = 0;
+    _slots[0].state = SLOT_READY;
+    _nextFrameNumber = 1;
+    _nextProduceSlot = 1;
+    _nextUploadSlot = 0;
+    Update();
+    ResetStats();
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Waits for the producers to finish, then deletes the fences, the buffer, and the texture.
+    Safe to call more than once.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void TextureStreamer::Shutdown()
+{
+    {
+        std::unique_lock<std::mutex> lock(_producingLock);
+        _producersDone.wait(lock, [this]() { return _numProducing == 0; });
+    }
+
+    for (unsigned int slotIndex = 0; slotIndex < MAX_SLOTS; slotIndex++)
+    {
+        if (_slots[slotIndex].fence != 0)
+        {
+            glDeleteSync((GLsync)_slots[slotIndex].fence);
+            _slots[slotIndex].fence = 0;
+        }
+        _slots[slotIndex].state = SLOT_FREE;
+    }
+
+    // Note: OpenGL hands deleted IDs out again, so the state cache has to forget them (see
+    // GlStateCache.h).
+    GlStateCache &stateCache = GlStateCache::Shared();
+    if (_bufferId != 0)
+    {
+        if (_mappedBytes != 0)
+        {
+            stateCache.BindBuffer(GL_PIXEL_UNPACK_BUFFER, _bufferId);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            stateCache.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            _mappedBytes = 0;
+        }
+        glDeleteBuffers(1, &_bufferId);
+        stateCache.ForgetBuffer(_bufferId);
+        _bufferId = 0;
+    }
+
+    if (_textureId != 0)
+    {
+        glDeleteTextures(1, &_textureId);
+        stateCache.ForgetTexture(_textureId);
+        _textureId = 0;
+    }
+    _numSlots = 0;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Call once per frame on the OpenGL thread, before drawing with the texture.  If the next
+    image is finished, its upload is queued up; then every slot that the GPU is done with is
+    handed back to a producer.  Never waits on anything.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void TextureStreamer::Update()
+{
+    if (_numSlots == 0)
+    {
+        return;
+    }
+
+    std::chrono::high_resolution_clock::time_point start =
+        std::chrono::high_resolution_clock::now();
+    _stats.numFrames++;
+
+    // uploads go in the same order as the slots were handed out, so frames never go backwards
+    Slot &uploadSlot = _slots[_nextUploadSlot];
+    if (uploadSlot.state.load(std::memory_order_acquire) == SLOT_READY)
+    {
+        const TexelFormatDescription &description = GetTexelFormatDescription(_texelFormat);
+        size_t offset = _nextUploadSlot * _slotStride;
+
+        // with a buffer bound to GL_PIXEL_UNPACK_BUFFER, the "pixels" pointer is an offset
+        // into that buffer, and the driver copies from there on its own time
+        // Note: Through the state cache, so the texture stays bound for drawing (it's usually
+        // the one that gets drawn), but the buffer is still unbound afterwards so that uploads
+        // elsewhere that pass a real pointer aren't taken as offsets into it.
+        GlStateCache &stateCache = GlStateCache::Shared();
+        stateCache.BindBuffer(GL_PIXEL_UNPACK_BUFFER, _bufferId);
+        stateCache.BindTexture(0, GL_TEXTURE_2D, _textureId);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, (description.bytesPerTexel >= 4) ? 4 :
+            description.bytesPerTexel);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _width, _height, description.format,
+            description.type, (const GLvoid *)offset);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        stateCache.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        // the fence passes once the GPU has read everything above, slot included
+        uploadSlot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        uploadSlot.state.store(SLOT_IN_FLIGHT, std::memory_order_relaxed);
+        _nextUploadSlot = (_nextUploadSlot + 1) % _numSlots;
+        _stats.numUploads++;
+        _stats.bytesUploaded += _bytesPerImage;
+    }
+    else
+    {
+        _stats.framesWithoutNewTexels++;
+    }
+
+    // refill, in order, as far as the GPU has caught up
+    for (unsigned int slotCount = 0; slotCount < _numSlots; slotCount++)
+    {
+        Slot &slot = _slots[_nextProduceSlot];
+        if (!IsSlotIdle(slot))
+        {
+            break;
+        }
+
+        StartProducing(slot, _nextProduceSlot);
+        _nextProduceSlot = (_nextProduceSlot + 1) % _numSlots;
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    _stats.updateSeconds += elapsed.count();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Checks (without waiting) whether a slot can be written to again.  A slot whose upload has
+    gone by is idle once its fence has passed, and the fence is cleaned up then.
+Parameters:
+    slot    The slot to check.
+Returns:
+    True if nothing is reading or writing the slot.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool TextureStreamer::IsSlotIdle(Slot &slot)
+{
+    int state = slot.state.load(std::memory_order_acquire);
+    if (state == SLOT_FREE)
+    {
+        return true;
+    }
+    else if (state != SLOT_IN_FLIGHT)
+    {
+        return false;
+    }
+
+    // a timeout of 0 makes this a poll
+    // Note: The flush bit makes sure that the fence is actually on its way to the GPU.
+    // Otherwise a driver that is sitting on a batch of commands could keep this waiting
+    // forever.
+    std::chrono::high_resolution_clock::time_point start =
+        std::chrono::high_resolution_clock::now();
+    GLenum waitResult = glClientWaitSync((GLsync)slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    _stats.fenceWaitSeconds += elapsed.count();
+
+    if ((waitResult != GL_ALREADY_SIGNALED) && (waitResult != GL_CONDITION_SATISFIED))
+    {
+        _stats.slotsStillInUse++;
+        return false;
+    }
+
+    glDeleteSync((GLsync)slot.fence);
+    slot.fence = 0;
+    slot.state.store(SLOT_FREE, std::memory_order_relaxed);
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Hands an idle slot to a thread pool job that runs the producer for the next frame.
+Parameters:
+    slot        The slot.  Must be idle.
+    slotIndex   Where the slot is in the ring.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void TextureStreamer::StartProducing(Slot &slot, unsigned int slotIndex)
+{
+    slot.frameNumber = _nextFrameNumber++;
+    slot.state.store(SLOT_PRODUCING, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(_producingLock);
+        _numProducing++;
+    }
+
+    unsigned char *dest = _mappedBytes + (slotIndex * _slotStride);
+    Slot *slotPtr = &slot;
+    unsigned int frameNumber = slot.frameNumber;
+    ThreadPool::Shared().Enqueue([this, slotPtr, dest, frameNumber]()
+    {
+        _producer(frameNumber, dest);
+
+        // "release" so that the texels are all written before the OpenGL thread sees "ready"
+        slotPtr->state.store(SLOT_READY, std::memory_order_release);
+
+        // Note: Notifying while holding the lock keeps Shutdown() or the destructor from
+        // finishing (and destroying the condition variable) in the middle of this.
+        std::lock_guard<std::mutex> lock(_producingLock);
+        _numProducing--;
+        _producersDone.notify_all();
+    });
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The OpenGL ID of the texture that the images stream into, or 0 before Init(...).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int TextureStreamer::TextureId() const
+{
+    return _textureId;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    How many bytes the producer writes for each image.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+size_t TextureStreamer::BytesPerImage() const
+{
+    return _bytesPerImage;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    The totals since Init(...) or the last ResetStats().
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const TextureStreamerStats &TextureStreamer::Stats() const
+{
+    return _stats;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Zeroes the totals, ex: to measure one stretch of frames.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void TextureStreamer::ResetStats()
+{
+    TextureStreamerStats zeroes = {};
+    _stats = zeroes;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A producer for demos and benchmarks: the tricolor texture, scrolled up one row per frame
+    and packed into the requested format.  The float texels are only generated once per
+    thread; after that, each frame is just a conversion, which is about what decoding video
+    or a streamed asset costs.
+Parameters:
+    width           Texture width.
+    height          Texture height.
+    texelFormat     What to pack the texels into.
+Returns:
+    A producer that can run on several threads at once.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+TextureProducer MakeScrollingTricolorProducer(unsigned int width, unsigned int height,
+    TexelFormat texelFormat)
+{
+    return [width, height, texelFormat](unsigned int frameNumber, void *dest)
+    {
+        struct Source
+        {
+            TexelBuffer texels;
+            unsigned int width;
+            unsigned int height;
+        };
+        static thread_local Source source = { TexelBuffer(), 0, 0 };
+        if ((source.width != width) || (source.height != height) || (source.texels.Data() == 0))
+        {
+            source.texels = GenerateTricolorTexture(width, height);
+            source.width = width;
+            source.height = height;
+        }
+        if (source.texels.Data() == 0)
+        {
+            // out of memory; a black frame is better than a crash on a worker thread
+            memset(dest, 0, (size_t)width * height *
+                GetTexelFormatDescription(texelFormat).bytesPerTexel);
+            return;
+        }
+
+        // rows [shift, height) go first and then rows [0, shift) wrap around after them
+        size_t bytesPerRow = (size_t)width * GetTexelFormatDescription(texelFormat).bytesPerTexel;
+        unsigned int shift = frameNumber % height;
+        ConvertTexels(source.texels.Data() + ((size_t)shift * width),
+            (size_t)(height - shift) * width, texelFormat, dest);
+        ConvertTexels(source.texels.Data(), (size_t)shift * width, texelFormat,
+            (unsigned char *)dest + ((height - shift) * bytesPerRow));
+    };
+}
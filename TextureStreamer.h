@@ -0,0 +1,112 @@
+#pragma once
+
+#include "TexelFormatConverter.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+// Fills one frame's worth of packed texels (width * height * bytesPerTexel bytes) at "dest".
+// Runs on a thread pool worker, so it must not make OpenGL calls.
+typedef std::function<void(unsigned int frameNumber, void *dest)> TextureProducer;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Running totals for a TextureStreamer.  "Frames" here means calls to Update().
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct TextureStreamerStats
+{
+    unsigned long long numFrames;
+    unsigned long long numUploads;
+    unsigned long long bytesUploaded;
+    unsigned long long framesWithoutNewTexels;  // the producers hadn't finished the next one
+    unsigned long long slotsStillInUse;         // the GPU hadn't finished with the next slot
+    double fenceWaitSeconds;                    // time spent in glClientWaitSync(...)
+    double updateSeconds;                       // time spent in Update() altogether
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Streams a new texture image every frame without the OpenGL thread ever waiting on the copy.
+
+    glTexImage2D(...) from client memory has to copy every byte before it returns, since the
+    program is free to change that memory right after.  Instead, this keeps a ring of "slots"
+    in one pixel unpack buffer that is persistently mapped (GL_ARB_buffer_storage, core in
+    4.4), so the producers (thread pool jobs) write texels straight into memory that the
+    driver can read.  Once a slot is full, the OpenGL thread only has to issue a
+    glTexSubImage2D(...) from that slot's offset, which the driver can run on its own time,
+    and drop a fence after it.  A slot is only handed back to a producer once its fence has
+    passed, and Update() only ever polls fences, so nothing waits.
+
+    Note: At most one image is uploaded per Update(), in the order that they were started.
+    If the producers fall behind, the texture keeps its last image for a frame rather than
+    stalling.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class TextureStreamer
+{
+public:
+    TextureStreamer();
+    ~TextureStreamer();
+
+    // these need the OpenGL context to be current
+    bool Init(unsigned int width, unsigned int height, TexelFormat texelFormat,
+        unsigned int numSlots, const TextureProducer &producer);
+    void Shutdown();
+    void Update();
+
+    unsigned int TextureId() const;
+    size_t BytesPerImage() const;
+    const TextureStreamerStats &Stats() const;
+    void ResetStats();
+
+    static const unsigned int MAX_SLOTS = 8;
+
+private:
+    TextureStreamer(const TextureStreamer &);
+    TextureStreamer &operator=(const TextureStreamer &);
+
+    enum SlotState
+    {
+        SLOT_FREE = 0,      // nobody is using it
+        SLOT_PRODUCING,     // a producer job is writing into it
+        SLOT_READY,         // written, waiting for Update() to upload it
+        SLOT_IN_FLIGHT,     // uploaded; the GPU may still be reading it until the fence passes
+    };
+
+    struct Slot
+    {
+        std::atomic<int> state;
+        void *fence;        // a GLsync, but this header doesn't need OpenGL
+        unsigned int frameNumber;
+    };
+
+    void StartProducing(Slot &slot, unsigned int slotIndex);
+    bool IsSlotIdle(Slot &slot);
+
+    unsigned int _textureId;
+    unsigned int _bufferId;
+    unsigned char *_mappedBytes;
+    unsigned int _width;
+    unsigned int _height;
+    TexelFormat _texelFormat;
+    size_t _bytesPerImage;
+    size_t _slotStride;
+    unsigned int _numSlots;
+    Slot _slots[MAX_SLOTS];
+    unsigned int _nextProduceSlot;
+    unsigned int _nextUploadSlot;
+    unsigned int _nextFrameNumber;
+    TextureProducer _producer;
+    TextureStreamerStats _stats;
+
+    // so that Shutdown() can wait for producer jobs that are still writing into the buffer
+    unsigned int _numProducing;
+    std::mutex _producingLock;
+    std::condition_variable _producersDone;
+};
+
+TextureProducer MakeScrollingTricolorProducer(unsigned int width, unsigned int height,
+    TexelFormat texelFormat);
@@ -0,0 +1,142 @@
+#include "glload/include/glload/gl_4_4.h"
+#include "glload/include/glload/gl_load.hpp"
+
+#include "TextureUpload.h"
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Packs one level's texels into the requested format and copies them into storage that was
+    already allocated with glTexStorage2D(...).
+Parameters:
+    level           Which mip level (0 is full size).
+    width           The level's width.
+    height          The level's height.
+    texels          The level's RGBA32F texels.
+    texelFormat     What to pack them into.  Must match the storage's internal format.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void UploadTexelsToLevel(int level, unsigned int width, unsigned int height,
+    const texel *texels, TexelFormat texelFormat)
+{
+    const TexelFormatDescription &packedFormat = GetTexelFormatDescription(texelFormat);
+    PackedTexelBuffer packedTexels;
+    const GLvoid *texelData = texels;
+    if (texelFormat != TEXEL_FORMAT_RGBA32F)
+    {
+        packedTexels = ConvertTexels(texels, (size_t)width * height, texelFormat);
+        texelData = packedTexels.Data();
+    }
+
+    // see CreateTexture() for why this isn't always 4
+    glPixelStorei(GL_UNPACK_ALIGNMENT, (packedFormat.bytesPerTexel >= 4) ? 4 :
+        packedFormat.bytesPerTexel);
+    glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, packedFormat.format,
+        packedFormat.type, texelData);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Allocates immutable storage for the whole mip chain in one go, uploads every level, and
+    switches the texture over to mipmapped minification.
+
+    Note: glTexStorage2D(...) (OpenGL 4.2+) makes all levels at once with a fixed size and
+    format, so the driver never has to guess whether the texture is "complete" or reallocate
+    it when another level shows up, which is what happens with one glTexImage2D(...) per
+    level.
+Parameters:
+    level0          The full-size texels.
+    width           Level 0 width.
+    height          Level 0 height.
+    mipLevels       Levels 1 and on, as made by BuildMipChain(...).  May be empty.
+    texelFormat     What to pack the texels into.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void UploadMipChain(const texel *level0, unsigned int width, unsigned int height,
+    const std::vector<MipLevel> &mipLevels, TexelFormat texelFormat)
+{
+    const TexelFormatDescription &packedFormat = GetTexelFormatDescription(texelFormat);
+    GLsizei numLevels = (GLsizei)mipLevels.size() + 1;
+    glTexStorage2D(GL_TEXTURE_2D, numLevels, packedFormat.internalFormat, width, height);
+
+    UploadTexelsToLevel(0, width, height, level0, texelFormat);
+    for (size_t levelIndex = 0; levelIndex < mipLevels.size(); levelIndex++)
+    {
+        const MipLevel &mipLevel = mipLevels[levelIndex];
+        UploadTexelsToLevel((int)levelIndex + 1, mipLevel.width, mipLevel.height,
+            mipLevel.texels.Data(), texelFormat);
+    }
+
+    // "zoom out" now blends between the two closest levels instead of sampling (and 
+    // thrashing the texture cache over) the full-size image
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, 
+        (numLevels > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Allocates immutable storage in a block-compressed format and uploads already-compressed
+    levels into it.  See UploadMipChain(...) for why it's glTexStorage2D(...).
+
+    Note: The blocks go to the GPU exactly as they are.  The driver can't repack them, so
+    glCompressedTexSubImage2D(...) is little more than a copy, and the texture takes 1/4 (BC3,
+    BC7) or 1/8 (BC1) of the memory and sampling bandwidth of RGBA8.
+Parameters:
+    compressedLevels    Level 0 and then every mip level, as made by CompressMipChain(...).
+    blockFormat         The format that they were compressed into.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void UploadCompressedMipChain(const std::vector<CompressedMipLevel> &compressedLevels,
+    BlockFormat blockFormat)
+{
+    const BlockFormatDescription &description = GetBlockFormatDescription(blockFormat);
+    GLsizei numLevels = (GLsizei)compressedLevels.size();
+    glTexStorage2D(GL_TEXTURE_2D, numLevels, description.internalFormat,
+        compressedLevels[0].width, compressedLevels[0].height);
+
+    for (GLsizei level = 0; level < numLevels; level++)
+    {
+        const CompressedMipLevel &compressed = compressedLevels[level];
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, compressed.width,
+            compressed.height, description.internalFormat, (GLsizei)compressed.blocks.SizeBytes(),
+            compressed.blocks.Data());
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+        (numLevels > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether the driver can take a block format.  BC7 (BPTC) is core in OpenGL 4.2, but BC1 and
+    BC3 (S3TC) are still an extension, although every desktop driver has it.
+Parameters:
+    blockFormat     The format in question.
+Returns:
+    True if glCompressedTexSubImage2D(...) will accept it.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool IsBlockFormatSupported(BlockFormat blockFormat)
+{
+    switch (blockFormat)
+    {
+    case BLOCK_FORMAT_BC1:
+    case BLOCK_FORMAT_BC3:
+        return glext_EXT_texture_compression_s3tc != 0;
+    case BLOCK_FORMAT_BC7:
+        return glload::IsVersionGEQ(4, 2) || (glext_ARB_texture_compression_bptc != 0);
+    default:
+        return false;
+    }
+}
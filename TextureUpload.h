@@ -0,0 +1,19 @@
+#pragma once
+
+#include "TextureGenerator.h"
+#include "TexelFormatConverter.h"
+#include "MipChainBuilder.h"
+#include "BlockCompressor.h"
+
+#include <vector>
+
+// these assume that the OpenGL context is current and the texture is bound to GL_TEXTURE_2D
+void UploadTexelsToLevel(int level, unsigned int width, unsigned int height,
+    const texel *texels, TexelFormat texelFormat);
+void UploadMipChain(const texel *level0, unsigned int width, unsigned int height,
+    const std::vector<MipLevel> &mipLevels, TexelFormat texelFormat);
+void UploadCompressedMipChain(const std::vector<CompressedMipLevel> &compressedLevels,
+    BlockFormat blockFormat);
+
+// this only needs a current context
+bool IsBlockFormatSupported(BlockFormat blockFormat);
@@ -0,0 +1,219 @@
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Spins up the worker threads.  They will immediately go to sleep waiting for jobs.
+Parameters:
+    numWorkers  How many threads to create.  If 0, one thread will be created for every
+                hardware thread except the one that is calling this (it will pitch in during
+                ParallelFor(...)).
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+ThreadPool::ThreadPool(unsigned int numWorkers) :
+    _shuttingDown(false)
+{
+    if (numWorkers == 0)
+    {
+        // Note: hardware_concurrency() is allowed to return 0 if it can't tell.
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        numWorkers = (hardwareThreads > 1) ? (hardwareThreads - 1) : 1;
+    }
+
+    for (unsigned int threadCount = 0; threadCount < numWorkers; threadCount++)
+    {
+        _workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Tells the workers to finish whatever is still in the queue, then waits for them to quit.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_jobsLock);
+        _shuttingDown = true;
+    }
+    _jobsAvailable.notify_all();
+
+    for (size_t threadCount = 0; threadCount < _workers.size(); threadCount++)
+    {
+        _workers[threadCount].join();
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Puts a job on the queue and wakes up one worker to take it.
+Parameters:
+    job     Something to run on a worker thread.  It must not make OpenGL calls.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ThreadPool::Enqueue(const std::function<void()> &job)
+{
+    {
+        std::lock_guard<std::mutex> lock(_jobsLock);
+        _jobs.push(job);
+    }
+    _jobsAvailable.notify_one();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Splits [0, count) into roughly equal chunks, one or more per thread, and runs "func" on all
+    of them.  Blocks until every chunk is finished.
+
+    Note: Chunks are handed out from an atomic counter rather than being pre-assigned to
+    threads, so a thread that finishes early (or a worker that was busy with something else
+    when this was called) doesn't leave the others waiting.
+Parameters:
+    count           How many items of work there are (ex: texture rows).
+    minChunkSize    Don't bother splitting the work smaller than this.  Handing a 4-row band to
+                    a thread costs more than just doing those 4 rows.
+    func            Called as func(begin, end) for each chunk.  Must be safe to run on several
+                    threads at once for different ranges.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ThreadPool::ParallelFor(size_t count, size_t minChunkSize,
+    const std::function<void(size_t begin, size_t end)> &func)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // a few chunks per thread so that uneven chunks even out
+    size_t numThreads = _workers.size() + 1;
+    size_t chunkSize = count / (numThreads * 4);
+    chunkSize = std::max(chunkSize, std::max(minChunkSize, (size_t)1));
+    size_t numChunks = (count + chunkSize - 1) / chunkSize;
+    if (numChunks == 1)
+    {
+        // not worth the handoff
+        func(0, count);
+        return;
+    }
+
+    // Note: The helper jobs may not get picked up until after every chunk is finished (ex:
+    // the workers are busy with something else, or this is itself running on a worker), so
+    // the shared state must outlive this function.  Waiting on "chunks finished" rather than
+    // "helpers finished" also means that this never waits on a helper that hasn't started.
+    struct SharedState
+    {
+        std::atomic<size_t> nextChunk;
+        size_t chunksFinished;
+        std::mutex doneLock;
+        std::condition_variable allDone;
+    };
+    std::shared_ptr<SharedState> state = std::make_shared<SharedState>();
+    state->nextChunk = 0;
+    state->chunksFinished = 0;
+
+    // the function is copied so that a late helper doesn't reference the caller's stack
+    std::shared_ptr<std::function<void(size_t, size_t)>> sharedFunc =
+        std::make_shared<std::function<void(size_t, size_t)>>(func);
+    auto runChunks = [state, sharedFunc, numChunks, chunkSize, count]()
+    {
+        for (size_t chunk = state->nextChunk++; chunk < numChunks; chunk = state->nextChunk++)
+        {
+            size_t begin = chunk * chunkSize;
+            size_t end = std::min(begin + chunkSize, count);
+            (*sharedFunc)(begin, end);
+
+            std::lock_guard<std::mutex> lock(state->doneLock);
+            state->chunksFinished++;
+            if (state->chunksFinished == numChunks)
+            {
+                state->allDone.notify_all();
+            }
+        }
+    };
+
+    size_t numHelpers = std::min(numChunks - 1, (size_t)_workers.size());
+    for (size_t helperCount = 0; helperCount < numHelpers; helperCount++)
+    {
+        Enqueue(runChunks);
+    }
+
+    // pitch in
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(state->doneLock);
+    state->allDone.wait(lock, [&]() { return state->chunksFinished == numChunks; });
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A simple getter.
+Parameters: None
+Returns:
+    How many worker threads were created (does not count the thread that created the pool).
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+unsigned int ThreadPool::NumWorkers() const
+{
+    return (unsigned int)_workers.size();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Rather than every texture/mesh/whatever function spinning up its own threads, they all
+    share this one.  It is created on first use.
+Parameters: None
+Returns:
+    A reference to the program-wide pool.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+ThreadPool &ThreadPool::Shared()
+{
+    static ThreadPool sharedPool;
+    return sharedPool;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    What each worker thread runs until the pool is destroyed: sleep until there is a job, run
+    it, repeat.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ThreadPool::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(_jobsLock);
+            _jobsAvailable.wait(lock, [this]() { return _shuttingDown || !_jobs.empty(); });
+            if (_jobs.empty())
+            {
+                // shutting down and nothing left to do
+                return;
+            }
+
+            job = _jobs.front();
+            _jobs.pop();
+        }
+
+        job();
+    }
+}
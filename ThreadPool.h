@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <functional>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A fixed set of worker threads that pull jobs off of a shared queue.  The threads are
+    created once (creating a thread per job costs more than most of the jobs themselves) and
+    live until the pool is destroyed.
+
+    Enqueue(...) is fire-and-forget.  ParallelFor(...) chops a range of work into chunks,
+    hands them out, and does not return until every chunk is done.  The calling thread works
+    on chunks too instead of just sleeping, so a pool with N workers keeps N + 1 cores busy.
+
+    Note: Do NOT make OpenGL calls from a job.  The context is only current on the thread that
+    made it (the main thread), so jobs are for CPU-side work only.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+class ThreadPool
+{
+public:
+    // 0 means "one worker per hardware thread, minus the calling thread"
+    explicit ThreadPool(unsigned int numWorkers = 0);
+    ~ThreadPool();
+
+    void Enqueue(const std::function<void()> &job);
+
+    // calls func(begin, end) on sub-ranges of [0, count) that are at least minChunkSize long
+    void ParallelFor(size_t count, size_t minChunkSize,
+        const std::function<void(size_t begin, size_t end)> &func);
+
+    unsigned int NumWorkers() const;
+
+    // the pool that the rest of the program shares
+    static ThreadPool &Shared();
+
+private:
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+
+    void WorkerLoop();
+
+    std::vector<std::thread> _workers;
+    std::queue<std::function<void()>> _jobs;
+    std::mutex _jobsLock;
+    std::condition_variable _jobsAvailable;
+    bool _shuttingDown;
+};
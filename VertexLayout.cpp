@@ -0,0 +1,125 @@
+#include "glload/include/glload/gl_4_4.h"
+
+#include "VertexLayout.h"
+#include "ProgramReflection.h"
+
+#include <stdio.h>
+
+// VertexComponentType -> OpenGL's type for glVertexAttribFormat(...)
+static const GLenum GL_COMPONENT_TYPES[] =
+{
+    GL_FLOAT,
+    GL_BYTE,
+    GL_UNSIGNED_BYTE,
+    GL_SHORT,
+    GL_UNSIGNED_SHORT,
+    GL_INT,
+    GL_UNSIGNED_INT,
+    GL_HALF_FLOAT,
+};
+
+// what the shader sees for 1 - 4 components (glVertexAttribFormat(...) always gives it floats)
+static const GLenum GL_SHADER_TYPES[] =
+{
+    GL_FLOAT,
+    GL_FLOAT_VEC2,
+    GL_FLOAT_VEC3,
+    GL_FLOAT_VEC4,
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Describes a vertex struct to the currently bound VAO: every attribute's format, that they
+    all read from the given binding, and how fast that binding advances.  The buffer itself
+    is attached separately with glBindVertexBuffer(bindingIndex, ..., layout.stride), so it
+    can change without describing the vertices again.
+
+    Note: This is the same handful of OpenGL calls per attribute that would be written out by
+    hand.  The only difference is that the numbers come from the struct, which the compiler
+    has already worked out.
+Parameters:
+    layout          From MakeVertexLayout<...>(...).
+    bindingIndex    Which vertex buffer binding the attributes read from.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void SetVertexLayout(const VertexLayout &layout, unsigned int bindingIndex)
+{
+    for (unsigned int attributeCount = 0; attributeCount < layout.numAttributes;
+        attributeCount++)
+    {
+        const VertexAttribute &attribute = layout.attributes[attributeCount];
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribFormat(attribute.location, attribute.componentCount,
+            GL_COMPONENT_TYPES[attribute.componentType], attribute.normalized ? GL_TRUE : GL_FALSE,
+            attribute.offset);
+        glVertexAttribBinding(attribute.location, bindingIndex);
+    }
+    glVertexBindingDivisor(bindingIndex, layout.divisor);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Checks that a linked program takes exactly what the vertex structs give it: every active
+    input has an attribute at its location, and each attribute has as many components as the
+    input it feeds.  OpenGL itself doesn't mind a mismatch (it fills in missing components
+    with 0s and a 1, and feeds an input with no attribute a constant), so without this a
+    "vec3 color" fed 2 texture coordinates just quietly looks wrong.
+
+    Note: This is the half of the check that can't happen at compile time, since the shaders
+    are read and built at runtime.  The structs' own layouts are checked with static_assert(...)
+    (see VertexAttributesFit(...)).
+    Also Note: Attributes with no active input are fine.  The compiler throws away inputs
+    that the shader doesn't use.
+Parameters:
+    reflection  The program's, after Reflect(...).
+    layouts     Every vertex struct that the program is drawn with (ex: the vertices and the
+                per-instance data).
+    numLayouts  How many.
+    programName For the error messages.
+Returns:
+    True if they match.  The mismatches are printed if they don't.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool VertexLayoutsMatchProgram(const ProgramReflection &reflection, const VertexLayout *layouts,
+    unsigned int numLayouts, const char *programName)
+{
+    bool matches = true;
+    const std::vector<ProgramResource> &inputs = reflection.Attributes();
+    for (size_t inputCount = 0; inputCount < inputs.size(); inputCount++)
+    {
+        const ProgramResource &input = inputs[inputCount];
+        const VertexAttribute *attribute = 0;
+        for (unsigned int layoutCount = 0; layoutCount < numLayouts; layoutCount++)
+        {
+            const VertexLayout &layout = layouts[layoutCount];
+            for (unsigned int attributeCount = 0; attributeCount < layout.numAttributes;
+                attributeCount++)
+            {
+                if ((int)layout.attributes[attributeCount].location == input.location)
+                {
+                    attribute = &layout.attributes[attributeCount];
+                }
+            }
+        }
+
+        const char *inputName = InternedName(input.nameId).c_str();
+        if (attribute == 0)
+        {
+            printf("program '%s': input '%s' (location %d) isn't in the vertex layout\n",
+                programName, inputName, input.location);
+            matches = false;
+        }
+        else if (input.type != GL_SHADER_TYPES[attribute->componentCount - 1])
+        {
+            printf("program '%s': input '%s' (location %d) isn't a %u-component float vector "
+                "like the vertex layout gives it\n", programName, inputName, input.location,
+                attribute->componentCount);
+            matches = false;
+        }
+    }
+
+    return matches;
+}
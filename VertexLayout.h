@@ -0,0 +1,183 @@
+#pragma once
+
+#include <stddef.h>     // offsetof(...) and size_t
+
+class ProgramReflection;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The kinds of numbers that a vertex attribute can be made of.  These are turned into
+    OpenGL's GL_FLOAT and friends in VertexLayout.cpp so that this header doesn't need the
+    OpenGL include.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+enum VertexComponentType
+{
+    VERTEX_COMPONENT_FLOAT = 0,
+    VERTEX_COMPONENT_BYTE,
+    VERTEX_COMPONENT_UNSIGNED_BYTE,
+    VERTEX_COMPONENT_SHORT,
+    VERTEX_COMPONENT_UNSIGNED_SHORT,
+    VERTEX_COMPONENT_INT,
+    VERTEX_COMPONENT_UNSIGNED_INT,
+    VERTEX_COMPONENT_HALF_FLOAT,
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    An IEEE half float's bits (see FloatToHalf(...)).  C++ has no half float type, and a plain
+    unsigned short would look like an integer to VERTEX_ATTRIBUTE(...).
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct HalfFloat
+{
+    unsigned short bits;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    One member of a vertex struct and the shader input that it feeds.  Make these with
+    VERTEX_ATTRIBUTE(...) or VERTEX_ATTRIBUTE_NORMALIZED(...) instead of by hand, so that the
+    compiler works out everything but the location from the member itself.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct VertexAttribute
+{
+    unsigned int location;          // the shader's "layout (location = N)"
+    unsigned int componentCount;    // 1 - 4
+    VertexComponentType componentType;
+    bool normalized;                // integers become 0 - 1 (or -1 - 1) floats in the shader
+    unsigned int offset;            // bytes from the start of the vertex
+    unsigned int size;              // bytes
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Everything that glVertexAttribFormat(...), glVertexAttribBinding(...), and
+    glBindVertexBuffer(...) need to know about one vertex struct.  Make these with
+    MakeVertexLayout<...>(...).
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct VertexLayout
+{
+    const VertexAttribute *attributes;
+    unsigned int numAttributes;
+    unsigned int stride;            // the struct's size
+    unsigned int divisor;           // 0 to advance per vertex, 1 per instance
+};
+
+// which VertexComponentType a C++ type is
+// Note: Only these are specialized, so a member of any other type (a double, a pointer, a
+// struct) is a compile error instead of garbage in the shader.
+template<typename T> struct VertexComponentOf;
+template<> struct VertexComponentOf<float>
+{ static const VertexComponentType TYPE = VERTEX_COMPONENT_FLOAT; };
+template<> struct VertexComponentOf<signed char>
+{ static const VertexComponentType TYPE = VERTEX_COMPONENT_BYTE; };
+template<> struct VertexComponentOf<unsigned char>
+{ static const VertexComponentType TYPE = VERTEX_COMPONENT_UNSIGNED_BYTE; };
+template<> struct VertexComponentOf<short>
+{ static const VertexComponentType TYPE = VERTEX_COMPONENT_SHORT; };
+template<> struct VertexComponentOf<unsigned short>
+{ static const VertexComponentType TYPE = VERTEX_COMPONENT_UNSIGNED_SHORT; };
+template<> struct VertexComponentOf<int>
+{ static const VertexComponentType TYPE = VERTEX_COMPONENT_INT; };
+template<> struct VertexComponentOf<unsigned int>
+{ static const VertexComponentType TYPE = VERTEX_COMPONENT_UNSIGNED_INT; };
+template<> struct VertexComponentOf<HalfFloat>
+{ static const VertexComponentType TYPE = VERTEX_COMPONENT_HALF_FLOAT; };
+
+// a member is one component (ex: float scale) or an array of 1 - 4 of them (ex: float pos[3])
+template<typename T> struct VertexMemberOf
+{
+    static const VertexComponentType TYPE = VertexComponentOf<T>::TYPE;
+    static const unsigned int COUNT = 1;
+};
+template<typename T, size_t N> struct VertexMemberOf<T[N]>
+{
+    static_assert((N >= 1) && (N <= 4), "a vertex attribute has 1 - 4 components");
+    static const VertexComponentType TYPE = VertexComponentOf<T>::TYPE;
+    static const unsigned int COUNT = (unsigned int)N;
+};
+
+// describe a member of a vertex struct, ex: VERTEX_ATTRIBUTE(MeshVertex, pos, 0)
+#define VERTEX_ATTRIBUTE_WITH(vertexType, member, location, normalized)                   \
+    VertexAttribute{ (location), VertexMemberOf<decltype(vertexType::member)>::COUNT,      \
+        VertexMemberOf<decltype(vertexType::member)>::TYPE, (normalized),                  \
+        (unsigned int)offsetof(vertexType, member), (unsigned int)sizeof(vertexType::member) }
+#define VERTEX_ATTRIBUTE(vertexType, member, location)                                    \
+    VERTEX_ATTRIBUTE_WITH(vertexType, member, location, false)
+#define VERTEX_ATTRIBUTE_NORMALIZED(vertexType, member, location)                         \
+    VERTEX_ATTRIBUTE_WITH(vertexType, member, location, true)
+
+// the compile-time checks behind VertexAttributesFit(...)
+// Note: Written as single-expression recursion because VS2015 only does C++11 constexpr.
+constexpr bool VertexAttributeFits(const VertexAttribute &a, unsigned int vertexSize)
+{
+    return (a.componentCount >= 1) && (a.componentCount <= 4) &&
+        (a.offset + a.size <= vertexSize) &&
+        ((a.offset % (a.size / a.componentCount)) == 0) &&
+        !(a.normalized && (a.componentType == VERTEX_COMPONENT_FLOAT));
+}
+constexpr bool VertexAttributesClash(const VertexAttribute &a, const VertexAttribute &b)
+{
+    return (a.location == b.location) ||
+        ((a.offset < b.offset + b.size) && (b.offset < a.offset + a.size));
+}
+constexpr bool VertexAttributeClashesWithAny(const VertexAttribute &a,
+    const VertexAttribute *others, size_t numOthers)
+{
+    return (numOthers > 0) && (VertexAttributesClash(a, others[0]) ||
+        VertexAttributeClashesWithAny(a, others + 1, numOthers - 1));
+}
+constexpr bool VertexAttributesAllFit(const VertexAttribute *attributes, size_t numAttributes,
+    unsigned int vertexSize)
+{
+    return (numAttributes == 0) || (VertexAttributeFits(attributes[0], vertexSize) &&
+        !VertexAttributeClashesWithAny(attributes[0], attributes + 1, numAttributes - 1) &&
+        VertexAttributesAllFit(attributes + 1, numAttributes - 1, vertexSize));
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Whether a vertex struct's attributes make sense: each one is inside the struct, aligned
+    to its own component size, and not normalized if it's floats, and no two of them overlap
+    or have the same location.  Meant for static_assert(...), so that a bad layout doesn't
+    compile.
+Parameters:
+    attributes  The struct's attributes, made with VERTEX_ATTRIBUTE(...).
+Returns:
+    True if they make sense.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+template<typename Vertex, size_t N>
+constexpr bool VertexAttributesFit(const VertexAttribute (&attributes)[N])
+{
+    return VertexAttributesAllFit(attributes, N, (unsigned int)sizeof(Vertex));
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Puts a vertex struct's attributes together with its stride.  Everything is known at
+    compile time, so the result can be constexpr and costs nothing to make.
+Parameters:
+    attributes  The struct's attributes, made with VERTEX_ATTRIBUTE(...).  They have to
+                outlive the layout (so make them static constexpr).
+    divisor     0 for vertices, 1 for per-instance data.
+Returns:
+    The layout.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+template<typename Vertex, size_t N>
+constexpr VertexLayout MakeVertexLayout(const VertexAttribute (&attributes)[N],
+    unsigned int divisor)
+{
+    return VertexLayout{ attributes, (unsigned int)N, (unsigned int)sizeof(Vertex), divisor };
+}
+
+// these need the OpenGL context to be current
+void SetVertexLayout(const VertexLayout &layout, unsigned int bindingIndex);
+bool VertexLayoutsMatchProgram(const ProgramReflection &reflection, const VertexLayout *layouts,
+    unsigned int numLayouts, const char *programName);
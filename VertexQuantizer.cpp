@@ -0,0 +1,365 @@
+#include "VertexQuantizer.h"
+#include "TexelFormatConverter.h"   // FloatToHalf(...)
+#include "ThreadPool.h"
+#include "SimdSupport.h"
+
+#include <string.h>     // memcpy(...) and strcmp(...)
+#include <math.h>       // lrintf(...) and sqrtf(...)
+
+static const VertexFormatDescription FORMAT_DESCRIPTIONS[VERTEX_FORMAT_COUNT] =
+{
+    { "float", sizeof(MeshVertex), MESH_VERTEX_LAYOUT },
+    { "snorm16-unorm16", sizeof(PackedMeshVertex),
+        MakeVertexLayout<PackedMeshVertex>(PACKED_MESH_VERTEX_ATTRIBUTES, 0) },
+    { "snorm16-half", sizeof(PackedHalfMeshVertex),
+        MakeVertexLayout<PackedHalfMeshVertex>(PACKED_HALF_MESH_VERTEX_ATTRIBUTES, 0) },
+};
+
+// the SIMD version writes either one the same way
+static_assert(sizeof(PackedMeshVertex) == sizeof(PackedHalfMeshVertex),
+    "the packed vertices should only differ in what their texture coordinates mean");
+
+// the largest normalized 16-bit integers (-32768 is -1 too, but OpenGL 4.2+ never makes it)
+static const float SNORM16_MAX = 32767.0f;
+static const float UNORM16_MAX = 65535.0f;
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Looks up the size and layout of one of the formats.
+Parameters:
+    format  One of the VertexFormat values (not VERTEX_FORMAT_COUNT).
+Returns:
+    A reference to a description that lives for the whole program.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const VertexFormatDescription &GetVertexFormatDescription(VertexFormat format)
+{
+    return FORMAT_DESCRIPTIONS[format];
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Turns a command line string like "snorm16-half" into the matching VertexFormat.
+Parameters:
+    name    The format's name as it appears in FORMAT_DESCRIPTIONS.
+    format  Gets the matching format if there is one.  Untouched otherwise.
+Returns:
+    True if the name matched one of the formats, otherwise false.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool ParseVertexFormat(const char *name, VertexFormat *format)
+{
+    for (int formatIndex = 0; formatIndex < VERTEX_FORMAT_COUNT; formatIndex++)
+    {
+        if (strcmp(name, FORMAT_DESCRIPTIONS[formatIndex].name) == 0)
+        {
+            *format = (VertexFormat)formatIndex;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    For reporting which version of the quantization got compiled in for a given format.
+Parameters:
+    format  One of the VertexFormat values.
+Returns:
+    A string literal that names the instruction set.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+const char *VertexQuantizationInstructionSet(VertexFormat format)
+{
+    if (format == VERTEX_FORMAT_FLOAT)
+    {
+        return "memcpy";
+    }
+
+#if defined(SIMD_F16C)
+    if (format == VERTEX_FORMAT_SNORM16_HALF)
+    {
+        return "SSE2+F16C";
+    }
+#endif
+
+#if defined(SIMD_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Finds the box around a mesh's positions and fits its biggest side into -1 - 1.  The
+    smaller sides get the same scale (see PositionQuantization), so they use less of the
+    16-bit range, but a mesh about 1 unit across still gets steps of about 1/65536 units.
+Parameters:
+    vertices    The mesh's vertices.
+    numVertices How many.
+Returns:
+    The scale and bias to store the positions with.  A scale of 1 and bias of 0 if there are
+    no vertices.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+PositionQuantization FitPositionQuantization(const MeshVertex *vertices, size_t numVertices)
+{
+    PositionQuantization quantization = { 1.0f, { 0.0f, 0.0f, 0.0f } };
+    if (numVertices == 0)
+    {
+        return quantization;
+    }
+
+    float boxMin[3] = { vertices[0].pos[0], vertices[0].pos[1], vertices[0].pos[2] };
+    float boxMax[3] = { vertices[0].pos[0], vertices[0].pos[1], vertices[0].pos[2] };
+    for (size_t vertexCount = 1; vertexCount < numVertices; vertexCount++)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float value = vertices[vertexCount].pos[axis];
+            boxMin[axis] = (value < boxMin[axis]) ? value : boxMin[axis];
+            boxMax[axis] = (value > boxMax[axis]) ? value : boxMax[axis];
+        }
+    }
+
+    float halfSize = 0.0f;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        quantization.bias[axis] = (boxMin[axis] + boxMax[axis]) * 0.5f;
+        float axisHalfSize = (boxMax[axis] - boxMin[axis]) * 0.5f;
+        halfSize = (axisHalfSize > halfSize) ? axisHalfSize : halfSize;
+    }
+
+    // a single point (or only the same one, over and over) can have any scale
+    quantization.scale = (halfSize > 0.0f) ? halfSize : 1.0f;
+    return quantization;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How far the farthest vertex is from the middle of the packed positions, in packed units.
+    That's the radius of a sphere around everything that a draw's instance can scale and move
+    like the mesh itself (see MultiDrawRenderer::Draw(...)), which is what culling needs.
+Parameters:
+    vertices        The mesh's vertices, before packing.
+    numVertices     How many.
+    quantization    How they're packed.  A scale of 1 and bias of 0 gives the plain radius
+                    around the mesh's origin.
+Returns:
+    The radius.  0 if there are no vertices.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+float BoundingRadius(const MeshVertex *vertices, size_t numVertices,
+    const PositionQuantization &quantization)
+{
+    float radius = 0.0f;
+    const float *bias = quantization.bias;
+    for (size_t vertexCount = 0; vertexCount < numVertices; vertexCount++)
+    {
+        const float *pos = vertices[vertexCount].pos;
+        float fromBias[3] = { pos[0] - bias[0], pos[1] - bias[1], pos[2] - bias[2] };
+        float distance = sqrtf((fromBias[0] * fromBias[0]) + (fromBias[1] * fromBias[1]) +
+            (fromBias[2] * fromBias[2]));
+        radius = (distance > radius) ? distance : radius;
+    }
+
+    return radius / quantization.scale;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Clamps to [minValue, maxValue] and rounds to the nearest integer (ties to even).
+
+    Note: The comparisons are the same as minps/maxps, which return the second operand when
+    either one is NaN, so NaN becomes maxValue.
+Parameters:
+    value       Already scaled to the integer range.
+    minValue    The smallest integer.
+    maxValue    The largest integer.
+Returns:
+    The integer.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+static inline int RoundClamped(float value, float minValue, float maxValue)
+{
+    value = (value < maxValue) ? value : maxValue;
+    value = (value > minValue) ? value : minValue;
+
+    // lrintf(...) rounds in the current rounding mode (nearest-even unless someone changed
+    // it), which is the same thing that cvtps2dq does
+    return (int)lrintf(value);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Packs vertices one component at a time.  This is the reference that the SIMD version has
+    to match bit for bit.
+Parameters:
+    vertices        The mesh's vertices.
+    numVertices     How many.
+    format          What to pack them into.
+    quantization    From FitPositionQuantization(...) (or made up, as long as every position
+                    fits).  Ignored for VERTEX_FORMAT_FLOAT.
+    dest            Where to write.  Must hold numVertices * bytesPerVertex bytes.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void QuantizeVerticesScalar(const MeshVertex *vertices, size_t numVertices, VertexFormat format,
+    const PositionQuantization &quantization, void *dest)
+{
+    if (format == VERTEX_FORMAT_FLOAT)
+    {
+        memcpy(dest, vertices, numVertices * sizeof(MeshVertex));
+        return;
+    }
+
+    // Note: Multiplying by this instead of dividing by the scale is what the SIMD version
+    // does, so this does it too or the rounding could come out different.
+    float toSnorm = SNORM16_MAX / quantization.scale;
+    for (size_t vertexCount = 0; vertexCount < numVertices; vertexCount++)
+    {
+        const MeshVertex &vertex = vertices[vertexCount];
+        short pos[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float scaled = (vertex.pos[axis] - quantization.bias[axis]) * toSnorm;
+            pos[axis] = (short)RoundClamped(scaled, -SNORM16_MAX, SNORM16_MAX);
+        }
+
+        if (format == VERTEX_FORMAT_SNORM16_UNORM16)
+        {
+            PackedMeshVertex &packed = ((PackedMeshVertex *)dest)[vertexCount];
+            memcpy(packed.pos, pos, sizeof(pos));
+            packed.padding = 0;
+            packed.uv[0] = (unsigned short)RoundClamped(
+                ((vertex.uv[0] < 1.0f) ? vertex.uv[0] : 1.0f) * UNORM16_MAX, 0.0f, UNORM16_MAX);
+            packed.uv[1] = (unsigned short)RoundClamped(
+                ((vertex.uv[1] < 1.0f) ? vertex.uv[1] : 1.0f) * UNORM16_MAX, 0.0f, UNORM16_MAX);
+        }
+        else
+        {
+            PackedHalfMeshVertex &packed = ((PackedHalfMeshVertex *)dest)[vertexCount];
+            memcpy(packed.pos, pos, sizeof(pos));
+            packed.padding = 0;
+            packed.uv[0].bits = FloatToHalf(vertex.uv[0]);
+            packed.uv[1].bits = FloatToHalf(vertex.uv[1]);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Packs vertices a whole vertex at a time with SSE2 (and F16C for half floats, if the
+    compiler is allowed to use it).  Each vertex is one load of the position (plus the first
+    texture coordinate, which is masked off), one of the texture coordinates, a handful of
+    math, and a 12-byte store, instead of 5 of everything.  Falls back on
+    QuantizeVerticesScalar(...) where there's no SIMD.
+Parameters:
+    Same as QuantizeVerticesScalar(...).
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void QuantizeVerticesSimd(const MeshVertex *vertices, size_t numVertices, VertexFormat format,
+    const PositionQuantization &quantization, void *dest)
+{
+    size_t vertexCount = 0;
+    unsigned char *destBytes = (unsigned char *)dest;
+
+#if defined(SIMD_SSE2)
+    if (format != VERTEX_FORMAT_FLOAT)
+    {
+        float toSnorm = SNORM16_MAX / quantization.scale;
+        const __m128 bias = _mm_setr_ps(quantization.bias[0], quantization.bias[1],
+            quantization.bias[2], 0.0f);
+        const __m128 scale = _mm_set1_ps(toSnorm);
+        const __m128 snormMax = _mm_set1_ps(SNORM16_MAX);
+        const __m128 snormMin = _mm_set1_ps(-SNORM16_MAX);
+        const __m128 positionMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 unormMax = _mm_set1_ps(UNORM16_MAX);
+
+        // SSE2 only packs to signed 16 bits, so unsigned ones are moved down by 32768 first and
+        // back up (by flipping the top bit) after
+        const __m128i unormOffset = _mm_set1_epi32(32768);
+        const __m128i unormFlip = _mm_set1_epi16((short)0x8000);
+
+        for (; vertexCount < numVertices; vertexCount++)
+        {
+            const MeshVertex &vertex = vertices[vertexCount];
+
+            // x, y, z, and (masked off to 0) the first texture coordinate
+            __m128 position = _mm_and_ps(_mm_loadu_ps(vertex.pos), positionMask);
+            position = _mm_mul_ps(_mm_sub_ps(position, bias), scale);
+            position = _mm_max_ps(_mm_min_ps(position, snormMax), snormMin);
+            __m128i positionShorts = _mm_packs_epi32(_mm_cvtps_epi32(position),
+                _mm_setzero_si128());
+
+            __m128 uv = _mm_castsi128_ps(_mm_loadl_epi64((const __m128i *)vertex.uv));
+            __m128i uvShorts;
+            if (format == VERTEX_FORMAT_SNORM16_UNORM16)
+            {
+                // the same clamp as the scalar version (1 first, then scale, then 0 - max)
+                uv = _mm_mul_ps(_mm_min_ps(uv, one), unormMax);
+                uv = _mm_max_ps(_mm_min_ps(uv, unormMax), zero);
+                __m128i uvInts = _mm_sub_epi32(_mm_cvtps_epi32(uv), unormOffset);
+                uvShorts = _mm_xor_si128(_mm_packs_epi32(uvInts, uvInts), unormFlip);
+            }
+            else
+            {
+#if defined(SIMD_F16C)
+                uvShorts = _mm_cvtps_ph(uv, _MM_FROUND_TO_NEAREST_INT);
+#else
+                unsigned int halfs = FloatToHalf(vertex.uv[0]) |
+                    ((unsigned int)FloatToHalf(vertex.uv[1]) << 16);
+                uvShorts = _mm_cvtsi32_si128((int)halfs);
+#endif
+            }
+
+            // x, y, z, padding (0) and then u, v
+            unsigned char *packed = destBytes + (vertexCount * sizeof(PackedMeshVertex));
+            _mm_storel_epi64((__m128i *)packed, positionShorts);
+            int uvBits = _mm_cvtsi128_si32(uvShorts);
+            memcpy(packed + 8, &uvBits, sizeof(uvBits));
+        }
+    }
+#endif
+
+    // leftovers (or everything, if there was no SIMD version for this format)
+    const VertexFormatDescription &description = FORMAT_DESCRIPTIONS[format];
+    QuantizeVerticesScalar(vertices + vertexCount, numVertices - vertexCount, format,
+        quantization, destBytes + (vertexCount * description.bytesPerVertex));
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Packs a mesh's vertices into the given format on the shared thread pool.  Most meshes are
+    much smaller than one piece of work, so this usually just runs on the calling thread.
+Parameters:
+    Same as QuantizeVerticesScalar(...).
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void QuantizeVertices(const MeshVertex *vertices, size_t numVertices, VertexFormat format,
+    const PositionQuantization &quantization, void *dest)
+{
+    unsigned int bytesPerVertex = FORMAT_DESCRIPTIONS[format].bytesPerVertex;
+    unsigned char *destBytes = (unsigned char *)dest;
+    ThreadPool::Shared().ParallelFor(numVertices, 16 * 1024,
+        [vertices, format, &quantization, destBytes, bytesPerVertex](size_t begin, size_t end)
+    {
+        QuantizeVerticesSimd(vertices + begin, end - begin, format, quantization,
+            destBytes + (begin * bytesPerVertex));
+    });
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Mesh.h"
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The layouts that a mesh's vertices can be packed into before they go in the vertex arena.
+    MeshVertex is 5 floats (20 bytes), which is more precision than a mesh about 1 unit
+    across needs, and every one of those bytes is read by the GPU every time the vertex is
+    drawn.
+
+    The packed formats store positions as normalized 16-bit integers (-1 - 1) that are scaled
+    and offset back to the mesh's real size (see PositionQuantization), and texture
+    coordinates as either normalized 16-bit integers (0 - 1 only) or half floats (for ones
+    that go outside of 0 - 1 to repeat the texture).  Either way the shader still sees
+    "vec3 pos" and "vec2 texCoord", so the shaders don't change.
+
+    Note: There's no format with octahedral normals because the meshes don't have normals.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+enum VertexFormat
+{
+    VERTEX_FORMAT_FLOAT = 0,        // 20 bytes, a MeshVertex, no conversion
+    VERTEX_FORMAT_SNORM16_UNORM16,  // 12 bytes, a PackedMeshVertex
+    VERTEX_FORMAT_SNORM16_HALF,     // 12 bytes, a PackedHalfMeshVertex
+    VERTEX_FORMAT_COUNT,
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    A MeshVertex with 16-bit normalized integers for everything.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct PackedMeshVertex
+{
+    short pos[3];           // -32767 - 32767 is -1 - 1 (see PositionQuantization)
+    short padding;          // keeps the vertex (and so the stride) a multiple of 4 bytes
+    unsigned short uv[2];   // 0 - 65535 is 0 - 1
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Same, but with half float texture coordinates.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct PackedHalfMeshVertex
+{
+    short pos[3];
+    short padding;
+    HalfFloat uv[2];
+};
+
+// the same locations as MESH_VERTEX_ATTRIBUTES (see Mesh.h)
+static constexpr VertexAttribute PACKED_MESH_VERTEX_ATTRIBUTES[] =
+{
+    VERTEX_ATTRIBUTE_NORMALIZED(PackedMeshVertex, pos, 0),
+    VERTEX_ATTRIBUTE_NORMALIZED(PackedMeshVertex, uv, 1),
+};
+static_assert(VertexAttributesFit<PackedMeshVertex>(PACKED_MESH_VERTEX_ATTRIBUTES),
+    "PackedMeshVertex's attributes don't fit it");
+static constexpr VertexAttribute PACKED_HALF_MESH_VERTEX_ATTRIBUTES[] =
+{
+    VERTEX_ATTRIBUTE_NORMALIZED(PackedHalfMeshVertex, pos, 0),
+    VERTEX_ATTRIBUTE(PackedHalfMeshVertex, uv, 1),
+};
+static_assert(VertexAttributesFit<PackedHalfMeshVertex>(PACKED_HALF_MESH_VERTEX_ATTRIBUTES),
+    "PackedHalfMeshVertex's attributes don't fit it");
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Everything about a vertex format that the arena and the VAO need to know.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct VertexFormatDescription
+{
+    const char *name;
+    unsigned int bytesPerVertex;
+    VertexLayout layout;
+};
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    How a mesh's positions were fit into -1 - 1: the real position is (stored * scale) + bias.
+    The scale is the same on every axis so that it can be folded into a draw's uniform scale
+    (see MultiDrawRenderer::Draw(...)) and the shaders don't need to know.
+Creator:
+-----------------------------------------------------------------------------------------------*/
+struct PositionQuantization
+{
+    float scale;
+    float bias[3];
+};
+
+const VertexFormatDescription &GetVertexFormatDescription(VertexFormat format);
+bool ParseVertexFormat(const char *name, VertexFormat *format);
+const char *VertexQuantizationInstructionSet(VertexFormat format);
+
+PositionQuantization FitPositionQuantization(const MeshVertex *vertices, size_t numVertices);
+float BoundingRadius(const MeshVertex *vertices, size_t numVertices,
+    const PositionQuantization &quantization);
+void QuantizeVertices(const MeshVertex *vertices, size_t numVertices, VertexFormat format,
+    const PositionQuantization &quantization, void *dest);
+void QuantizeVerticesSimd(const MeshVertex *vertices, size_t numVertices, VertexFormat format,
+    const PositionQuantization &quantization, void *dest);
+void QuantizeVerticesScalar(const MeshVertex *vertices, size_t numVertices, VertexFormat format,
+    const PositionQuantization &quantization, void *dest);
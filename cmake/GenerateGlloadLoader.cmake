@@ -0,0 +1,71 @@
+# The glload in the tree is only its headers and a Windows .lib, so this writes the loader
+# that the headers declare (every _funcptr_gl... pointer, every glext_... flag, and the
+# glload::LoadFunctions() family that main.cpp calls) from the headers themselves.  The
+# functions are looked up with eglGetProcAddress(...), which works for both the window's GLX
+# context and HeadlessContext's EGL one with Mesa and the NVIDIA driver.
+#
+# Usage: generate_glload_loader(<glload include dir> <output .cpp>)
+function(generate_glload_loader glloadDir outputFile)
+    file(READ "${glloadDir}/gl_4_4.h" mainHeader)
+    string(REGEX MATCHALL "#include \"[_a-z0-9]+\\.h\"" includeLines "${mainHeader}")
+
+    set(definitions "")
+    set(loads "")
+    set(extensionChecks "")
+    set(seenFunctions "")
+    foreach(includeLine ${includeLines})
+        string(REGEX REPLACE "#include \"([_a-z0-9]+\\.h)\"" "\\1" headerName "${includeLine}")
+        set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS
+            "${glloadDir}/${headerName}")
+        file(STRINGS "${glloadDir}/${headerName}" declarations
+            REGEX "^extern (PFN[A-Z0-9_]+ _funcptr_[A-Za-z0-9_]+|int glext_[A-Za-z0-9_]+);")
+        foreach(declaration ${declarations})
+            if(declaration MATCHES "^extern (PFN[A-Z0-9_]+) _funcptr_([A-Za-z0-9_]+);")
+                set(pointerType "${CMAKE_MATCH_1}")
+                set(functionName "${CMAKE_MATCH_2}")
+
+                # the removed (compatibility) headers repeat some of the core ones
+                list(FIND seenFunctions "${functionName}" seenIndex)
+                if(seenIndex EQUAL -1)
+                    list(APPEND seenFunctions "${functionName}")
+                    string(APPEND definitions "${pointerType} _funcptr_${functionName} = 0;\n")
+                    string(APPEND loads "    _funcptr_${functionName} = "
+                        "(${pointerType})eglGetProcAddress(\"${functionName}\");\n")
+                endif()
+            elseif(declaration MATCHES "^extern int glext_([A-Za-z0-9_]+);")
+                string(APPEND definitions "int glext_${CMAKE_MATCH_1} = 0;\n")
+                string(APPEND extensionChecks "        if (strcmp(name, \"GL_${CMAKE_MATCH_1}\") "
+                    "== 0) { glext_${CMAKE_MATCH_1} = 1; }\n")
+            endif()
+        endforeach()
+    endforeach()
+
+    set(source "// generated by cmake/GenerateGlloadLoader.cmake; don't edit\n")
+    string(APPEND source "#include \"${glloadDir}/gl_4_4.h\"\n")
+    string(APPEND source "#include \"${glloadDir}/gl_load.hpp\"\n")
+    string(APPEND source "#include <EGL/egl.h>\n#include <string.h>\n\n")
+    string(APPEND source "${definitions}\n")
+    string(APPEND source "static int gMajorVersion = 0;\nstatic int gMinorVersion = 0;\n\n")
+    string(APPEND source "namespace glload\n{\n")
+    string(APPEND source "LoadTest LoadFunctions()\n{\n${loads}\n")
+    string(APPEND source "    glGetIntegerv(GL_MAJOR_VERSION, &gMajorVersion);\n")
+    string(APPEND source "    glGetIntegerv(GL_MINOR_VERSION, &gMinorVersion);\n")
+    string(APPEND source "    GLint numExtensions = 0;\n")
+    string(APPEND source "    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);\n")
+    string(APPEND source "    for (GLint extensionCount = 0; extensionCount < numExtensions; "
+        "extensionCount++)\n    {\n")
+    string(APPEND source "        const char *name = "
+        "(const char *)glGetStringi(GL_EXTENSIONS, extensionCount);\n")
+    string(APPEND source "${extensionChecks}    }\n\n")
+    string(APPEND source "    return LoadTest(gMajorVersion > 0, 0);\n}\n\n")
+    string(APPEND source "int GetMajorVersion() { return gMajorVersion; }\n")
+    string(APPEND source "int GetMinorVersion() { return gMinorVersion; }\n")
+    string(APPEND source "int IsVersionGEQ(int testMajorVersion, int testMinorVersion)\n{\n")
+    string(APPEND source "    return (gMajorVersion > testMajorVersion) ||\n")
+    string(APPEND source "        ((gMajorVersion == testMajorVersion) && "
+        "(gMinorVersion >= testMinorVersion));\n}\n}\n")
+
+    # only rewrite it when it changes so that it isn't rebuilt on every configure
+    file(WRITE "${outputFile}.tmp" "${source}")
+    configure_file("${outputFile}.tmp" "${outputFile}" COPYONLY)
+endfunction()
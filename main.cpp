@@ -38,13 +38,99 @@
 // for printf(...)
 #include <stdio.h>
 
+// for parsing command line options
+#include <string.h>
+#include <stdlib.h>
+
+// for timing headless frames
+#include <chrono>
+
+// for the settings in the benchmark report
+#include <map>
+
+#include "TextureGenerator.h"
+#include "TexelFormatConverter.h"
+#include "MipChainBuilder.h"
+#include "TextureUpload.h"
+#include "BlockCompressor.h"
+#include "DdsFile.h"
+#include "TextureStreamer.h"
+#include "HeadlessContext.h"
+#include "OffscreenFramebuffer.h"
+#include "FrameBenchmark.h"
+#include "GlStateCache.h"
+#include "GpuProfiler.h"
+#include "ProgramBuilder.h"
+#include "ProgramReflection.h"
+#include "SpriteBatcher.h"
+#include "DynamicVertexBuffer.h"
+#include "GpuBufferArena.h"
+#include "VertexQuantizer.h"
+#include "MeshPacking.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshFile.h"
+#include "MultiDrawRenderer.h"
+#include "GpuCuller.h"
+#include "RenderQueue.h"
+#include "FileWatcher.h"
+#include "Benchmark.h"
+
 #define DEBUG
 
 // these should really be encapsulated off in some structure somewhere, but for the sake of this
 // barebones demo, keep them here
-GLint gUniformTextureLocation;
+GLuint gProgramId = 0;
+ProgramReflection gProgramReflection;
+const unsigned int TEX_NAME_ID = InternName("tex");     // the fragment shader's sampler
 GLuint gVaoId;
+GpuBufferArena gVertexArena;        // every mesh's vertices, including the triangle's
+GpuBufferArena gIndexArenas[INDEX_WIDTH_COUNT];     // and indices, an arena per IndexWidth
+unsigned int gTriangleVertices = GpuBufferArena::NO_HANDLE;
+unsigned int gTriangleIndices = GpuBufferArena::NO_HANDLE;
+IndexWidth gTriangleIndexWidth = INDEX_WIDTH_32;    // which arena the triangle's indices are in
+VertexFormat gVertexFormat = VERTEX_FORMAT_FLOAT;     // what the arena's vertices are packed into
 GLuint gTextureId;
+unsigned int gTextureWidth = 64;
+unsigned int gTextureHeight = 64;
+TexelFormat gTexelFormat = TEXEL_FORMAT_RGBA8;
+bool gBuildMipmaps = true;
+BlockFormat gBlockFormat = BLOCK_FORMAT_NONE;
+const char *gDdsFilePath = 0;
+bool gStreamTexture = false;
+TextureStreamer gTextureStreamer;
+bool gHeadless = false;
+unsigned int gHeadlessFrames = 1;
+const char *gScreenshotPath = 0;
+HeadlessContext gHeadlessContext;
+OffscreenFramebuffer gOffscreenFramebuffer;
+unsigned int gBenchFrames = 0;
+const char *gBenchReportPath = "bench_report.json";
+FrameBenchmark gFrameBenchmark;
+GpuProfiler gGpuProfiler;
+const char *gProgramCacheDirectory = "shader_cache";
+ProgramBuilder gProgramBuilder;
+bool gHotReloadShaders = false;
+FileWatcher gShaderWatcher;
+unsigned int gNumFramesDrawn = 0;
+unsigned int gNumSprites = 0;
+SpriteBatcher gSpriteBatcher;
+DynamicVertexBuffer gDynamicVertexBuffer;
+std::vector<SpriteInstance> gSprites;
+unsigned int gNumMeshes = 0;
+bool gOptimizeMeshes = false;
+const char *gMeshFilePath = 0;
+unsigned int gMaxMeshletVertices = MAX_VERTICES_16_BIT_INDICES;
+bool gMeshLods = false;
+float gLodPixelError = 1.0f;
+MultiDrawRenderer gMultiDrawRenderer;
+std::vector<unsigned int> gMeshIndices;     // what each of the instances draws
+std::vector<MeshInstance> gMeshInstances;
+bool gGpuCull = false;
+float gCullViewSize = 1.0f;
+GpuCuller gGpuCuller;
+bool gShutDown = false;               // set by ShutdownRendering()
+RenderQueue gRenderQueue;            // the frame's ordinary draws, sorted by state
 
 /*-----------------------------------------------------------------------------------------------
 Description:
@@ -100,13 +186,20 @@ void APIENTRY DebugFunc(GLenum source, GLenum type, GLuint id, GLenum severity,
 Description:
     Encapsulates the creation of a texture.  It tries to cover all the basics and be as self-
     contained as possible, only returning a texture ID when it is finished.
-Parameters: None
+Parameters:
+    texelsPerRow    How many texels wide.
+    maxTexelRows    How many texels tall.
+    texelFormat     What to pack the texels into before uploading them.
+    buildMipmaps    If true, every mip level is made and uploaded, otherwise just level 0.
+    blockFormat     If not BLOCK_FORMAT_NONE, the texels are block compressed on the CPU and 
+                    uploaded that way instead of as texelFormat.
 Returns:    
-    The OpenGL ID of the texture that was created.
+    The OpenGL ID of the texture that was created, or 0 if the texel data couldn't be made.
 Exception:  Safe
 Creator:    John Cox (2-24-2016)
 -----------------------------------------------------------------------------------------------*/
-GLuint CreateTexture()
+GLuint CreateTexture(unsigned int texelsPerRow, unsigned int maxTexelRows, 
+    TexelFormat texelFormat, bool buildMipmaps, BlockFormat blockFormat)
 {
     // create a 2D texture buffer
     GLuint textureId;
@@ -155,15 +248,7 @@ GLuint CreateTexture()
     // their texture data (ex: GL_RGBA32F is RGBA (RGB + alpha channel) with 32bits per channel,
     // which might come in handy if the programmer was concerned that a user's "float" might not
     // be 32bits), but for this demo, I will keep things relatively simple.
-    struct texel
-    {
-        // do NOT define any methods or else the texel construction loop will have to change
-        //texel() {}
-        GLfloat r;
-        GLfloat g;
-        GLfloat b;
-        GLfloat a;  // alpha
-    };
+    // Note: The "texel" structure is in TextureGenerator.h.
 
     // glTexImage2D(...) will take a pointer to the data, but not a pointer to pointer, so 2D
     // arrays are not an option and the 2D texture data must be crammed into a 1D array
@@ -172,52 +257,100 @@ GLuint CreateTexture()
     // elements progress left-to-right through the remaining texels in the lowest row of the 
     // texture image, and then in successively higher rows of the texture image. The final 
     // element corresponds to the upper right corner of the texture image."
-    const unsigned int MAX_TEXEL_ROWS = 64;
-    const unsigned int TEXELS_PER_ROW = 64;
-    texel crudeTextureArr[MAX_TEXEL_ROWS * TEXELS_PER_ROW];
-    for (size_t rowCounter = 0; rowCounter < MAX_TEXEL_ROWS; rowCounter++)
+    // Also Note: This used to be a stack array filled one texel at a time, which was fine at 
+    // 64x64 but overflows the stack (and takes forever) at 16k x 16k.  The generator fills 
+    // bands of rows on the thread pool with SIMD stores into an aligned heap buffer, and the 
+    // buffer frees itself when this function returns (after glTexImage2D(...) is done with it).
+    // For the sake of this demo, the bottom third will be red, the middle third green, and the 
+    // top third blue.
+    TexelBuffer crudeTextureArr = GenerateTricolorTexture(texelsPerRow, maxTexelRows);
+    if (crudeTextureArr.Data() == 0)
     {
-        for (size_t colCounter = 0; colCounter < TEXELS_PER_ROW; colCounter++)
-        {
-            // for the sake of this demo, the bottom third will be red, the middle third green, 
-            // and the top third blue.
+        printf("could not allocate a %ux%u texture\n", texelsPerRow, maxTexelRows);
+        glDeleteTextures(1, &textureId);
+        return 0;
+    }
 
-            // this array-style assignment is only possible when the struct has no methods 
-            // Note: Even a constructor that takes nothing and does nothing will prevent this.
-            texel t = { 0.0f, 0.0f, 0.0f, 0.0f };
-            if (rowCounter < (MAX_TEXEL_ROWS / 3))
-            {
-                // bottom third, so red
-                t = { 1.0f, 0.0f, 0.0f, 1.0f };
-            }
-            else if (rowCounter < ((2 * MAX_TEXEL_ROWS) / 3))
-            {
-                // middle third, so green
-                t = { 0.0f, 1.0f, 0.0f, 1.0f };
-            }
-            else
-            {
-                // top third, so blue
-                t = { 0.0f, 0.0f, 1.0f, 1.0f };
-            }
+    if ((blockFormat != BLOCK_FORMAT_NONE) && !IsBlockFormatSupported(blockFormat))
+    {
+        printf("this driver can't take %s textures, so uploading it uncompressed\n", 
+            GetBlockFormatDescription(blockFormat).name);
+        blockFormat = BLOCK_FORMAT_NONE;
+    }
 
-            // jam the data into the array
-            crudeTextureArr[(rowCounter * TEXELS_PER_ROW) + colCounter] = t;
+    if (blockFormat != BLOCK_FORMAT_NONE)
+    {
+        // block compression (see BlockCompressor.cpp) keeps the texture compressed in video 
+        // memory too, not just on the way there
+        // Note: Every level is compressed separately, so the mip chain is built from the full 
+        // float texels first rather than from the compressed (lossy) level 0.
+        std::vector<MipLevel> mipLevels;
+        if (buildMipmaps)
+        {
+            mipLevels = BuildMipChain(crudeTextureArr.Data(), texelsPerRow, maxTexelRows);
+        }
+        std::vector<CompressedMipLevel> compressedLevels = CompressMipChain(
+            crudeTextureArr.Data(), texelsPerRow, maxTexelRows, mipLevels, blockFormat);
+        if (compressedLevels.empty())
+        {
+            printf("could not allocate the compressed texture\n");
+            glDeleteTextures(1, &textureId);
+            return 0;
         }
+        UploadCompressedMipChain(compressedLevels, blockFormat);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return textureId;
+    }
+
+    if (buildMipmaps)
+    {
+        // only level 0 means that minified draws sample the whole full-size image, so build 
+        // the rest of the mip chain on the CPU (see MipChainBuilder.cpp for how the levels 
+        // get built in parallel) and upload every level at once
+        // Note: This also switches the "min filter" to a mipmapped one.
+        std::vector<MipLevel> mipLevels = BuildMipChain(crudeTextureArr.Data(), texelsPerRow, 
+            maxTexelRows);
+        UploadMipChain(crudeTextureArr.Data(), texelsPerRow, maxTexelRows, mipLevels, 
+            texelFormat);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return textureId;
     }
 
-    // ??when to use this??
-    //glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    // otherwise it's only level 0, so pack the floats down into something smaller before they go across the bus
+    // Note: 16 bytes per texel is far more than a color texture needs.  RGBA8 is a quarter of 
+    // that and RGB565 an eighth.  The conversion uses SIMD on the thread pool and comes out 
+    // bit-for-bit the same as the plain C++ version (see --bench-texconv).
+    const TexelFormatDescription &packedFormat = GetTexelFormatDescription(texelFormat);
+    PackedTexelBuffer packedTexels;
+    const GLvoid *texelData = crudeTextureArr.Data();
+    if (texelFormat != TEXEL_FORMAT_RGBA32F)
+    {
+        packedTexels = ConvertTexels(crudeTextureArr.Data(), crudeTextureArr.Count(), texelFormat);
+        texelData = packedTexels.Data();
+    }
+
+    // Note: This tells OpenGL how many bytes each row of texels starts on.  The default is 4, 
+    // which is fine for anything with 4+ bytes per texel, but a 2-byte-per-texel row with an 
+    // odd width isn't a multiple of 4 bytes long, so OpenGL would skip 2 bytes at the end of 
+    // every row and the texture would come out sheared.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, (packedFormat.bytesPerTexel >= 4) ? 4 : 
+        packedFormat.bytesPerTexel);
 
     // finally, upload the texture to the GPU
+    // Note: The internal format is a "sized" one (ex: GL_RGBA8 rather than GL_RGBA) so that 
+    // the driver stores exactly what was asked for instead of picking on its own.
     GLint level = 0;                    // some kind of "detail" thing (leave at 0)
-    GLenum type = GL_FLOAT;             // type is float
-    GLenum format = GL_RGBA;            // texel data provided as 4-float sets
-    GLint internalFormat = GL_RGBA;     // store the texel as 4-float sets
-    GLsizei width = TEXELS_PER_ROW;
-    GLsizei height = MAX_TEXEL_ROWS;
+    GLenum type = packedFormat.type;    // what the bits look like (ex: GL_UNSIGNED_BYTE)
+    GLenum format = packedFormat.format;    // which channels are provided (ex: GL_RGBA)
+    GLint internalFormat = packedFormat.internalFormat;    // how to store it (ex: GL_RGBA8)
+    GLsizei width = texelsPerRow;
+    GLsizei height = maxTexelRows;
     GLint border = 0;                   // documentation says 0 (must be legacy)
-    glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, border, format, type, crudeTextureArr);
+    glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, border, format, type, 
+        texelData);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
     // clean up bindings
     glBindTexture(GL_TEXTURE_2D, 0);
@@ -226,14 +359,107 @@ GLuint CreateTexture()
     return textureId;
 }
 
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Makes a texture out of a .dds file that was compressed ahead of time with "--write-dds".
+    The blocks go straight from the file to the GPU without being touched.
+Parameters:
+    filePath    The .dds file.
+Returns:
+    The OpenGL ID of the texture, or 0 if the file couldn't be loaded or the driver can't take 
+    its format.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+GLuint CreateTextureFromDds(const char *filePath)
+{
+    BlockFormat blockFormat = BLOCK_FORMAT_NONE;
+    std::vector<CompressedMipLevel> compressedLevels;
+    if (!ReadDdsFile(filePath, &blockFormat, &compressedLevels))
+    {
+        return 0;
+    }
+    if (!IsBlockFormatSupported(blockFormat))
+    {
+        printf("this driver can't take %s textures\n", 
+            GetBlockFormatDescription(blockFormat).name);
+        return 0;
+    }
+
+    GLuint textureId;
+    glGenTextures(1, &textureId);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textureId);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    UploadCompressedMipChain(compressedLevels, blockFormat);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return textureId;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    The offline half of block compression: makes the same texture that CreateTexture(...) 
+    would, compresses it and its mip chain, and saves the result so that later runs can load 
+    it with "--load-dds" instead of compressing it again.  No OpenGL needed.
+Parameters:
+    filePath        Where to save the .dds file.
+    texelsPerRow    How many texels wide.
+    maxTexelRows    How many texels tall.
+    buildMipmaps    If true, every mip level is saved, otherwise just level 0.
+    blockFormat     Which block format to compress into.  Must not be BLOCK_FORMAT_NONE.
+Returns:
+    True if the file was written.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool CompressTextureToFile(const char *filePath, unsigned int texelsPerRow, 
+    unsigned int maxTexelRows, bool buildMipmaps, BlockFormat blockFormat)
+{
+    TexelBuffer texels = GenerateTricolorTexture(texelsPerRow, maxTexelRows);
+    if (texels.Data() == 0)
+    {
+        printf("could not allocate a %ux%u texture\n", texelsPerRow, maxTexelRows);
+        return false;
+    }
+
+    std::vector<MipLevel> mipLevels;
+    if (buildMipmaps)
+    {
+        mipLevels = BuildMipChain(texels.Data(), texelsPerRow, maxTexelRows);
+    }
+    std::vector<CompressedMipLevel> compressedLevels = CompressMipChain(texels.Data(), 
+        texelsPerRow, maxTexelRows, mipLevels, blockFormat);
+    if (!WriteDdsFile(filePath, blockFormat, compressedLevels))
+    {
+        return false;
+    }
+
+    printf("wrote %ux%u %s (%u levels) to '%s'\n", texelsPerRow, maxTexelRows, 
+        GetBlockFormatDescription(blockFormat).name, (unsigned int)compressedLevels.size(), 
+        filePath);
+    return true;
+}
+
 /*-----------------------------------------------------------------------------------------------
 Description:
     Encapsulates the creation of vertices, including the texture coordinates of each vertex.  It 
     tries to cover all the basics and be as self-contained as possible, only returning a VAO ID 
     when it is finished.
+
+    The vertices and indices go in the shared arenas (see GpuBufferArena.h) instead of a 
+    buffer object each, and gTriangleVertices and gTriangleIndices say where.  The VAO only 
+    describes the layout, so it would work for any other mesh in the arenas too (with a 
+    different base vertex and first index).
+
+    The vertices are packed into gVertexFormat (see VertexQuantizer.h) like every other mesh 
+    in the arena.  The triangle is already in normalized device coordinates, which is what 
+    the packed positions' -1 - 1 means, so they aren't scaled or offset.
 Parameters: None
 Returns:
-    The OpenGL ID of the VAO that was created.
+    The OpenGL ID of the VAO that was created, or 0 if the arenas had no room.
 Exception:  Safe
 Creator:
     John Cox (2-13-2016)
@@ -241,90 +467,73 @@ Creator:
 GLuint CreateGeometry()
 {
     // center the triangle on the texture, whose texture coordinates are[0, 1]
-    // Note: This doesn't strictly need to be static because the gl*Data(...) functions (called 
-    // later in this same function) will send it off to the GPU, and then it won't be needed in 
-    // system memory.
-    GLfloat localVerts[] =
+    // Note: This doesn't strictly need to be static because the arena's upload (later in this 
+    // same function) will send it off to the GPU, and then it won't be needed in system 
+    // memory.
+    // Also Note: Each vertex is a MeshVertex (see Mesh.h), so the compiler works out the 
+    // layout instead of counting floats by hand.
+    MeshVertex localVerts[] =
     {
-        -0.5f, -0.5f, -1.0f,        // (pos) left bottom corner
-        +0.0f, +0.0f,               // texel at bottom left of texture
-
-        +0.5f, -0.5f, -1.0f,        // (pos) right bottom corner
-        +1.0f, 0.0f,                // texel at bottom right of texture
-
-        +0.0f, +0.5f, -1.0f,        // (pos) center top
-        +0.5f, +1.0f,               // texel at top center of texture
+        { { -0.5f, -0.5f, -1.0f }, { 0.0f, 0.0f } },    // left bottom corner, texel at bottom 
+                                                        // left of texture
+        { { +0.5f, -0.5f, -1.0f }, { 1.0f, 0.0f } },    // right bottom corner, bottom right
+        { { +0.0f, +0.5f, -1.0f }, { 0.5f, 1.0f } },    // center top, top center
     };
 
-    // create a vertex array and bind it to the context (it is expected that glload's "init" 
-    // function has already been called, which sets up the OpenGL context)
-    GLuint vertexArrayObjectId = 0;
-    glGenVertexArrays(1, &vertexArrayObjectId);
-    glBindVertexArray(vertexArrayObjectId);
-
-    // create vertex data
-    // Note: If you need to later call glDeleteBuffers(...) to clean up the data, keep 
-    // the vertex buffer ID around.  This barebones code will rely on program end for
-    // cleanup, and the bound VAO will handle future binding/unbinding, so the ID will 
-    // be created just long enough to use it.
-    GLuint vertBufId = 0;
-    glGenBuffers(1, &vertBufId);
-    glBindBuffer(GL_ARRAY_BUFFER, vertBufId);  // ??check for bad number first??
-
-    // send data to GPU
-    // Note: If data already exists and you know exactly which byte in the array to stick the 
-    // new data, use glBufferSubData(...)
-    glBufferData(GL_ARRAY_BUFFER, sizeof(localVerts), localVerts, GL_STATIC_DRAW);
-
-    // set vertex array data to describe the byte pattern
-    // Note: The byte pattern in that single float array is arranged such that it can be split 
-    // into three distinct patterns.  Vertex Attribute Arrays let the patterns be specified.
-    // Starting at float 0, the pattern repeats every 9 floats (36 bytes) until end of the 
-    // buffer.  OpenGL already knows the data size from glBufferData(...).
-    unsigned int vertexArrayIndex = 0;
-    unsigned int bufferStartByteOffset = 0;
-    const unsigned int NUM_THINGS = 3;          // 3 floats per vertex array index
-    const unsigned int BYTES_PER_THING = 12;    // 3 floats at 4 bytes per
-    const unsigned int BYTES_PER_VERT = 20;     // attribute pattern repeats every 5 floats
-
-    // position attribute (3 floats (12 bytes) per)
-    // Note: 3 floats (12 bytes) per attribute,
-    glEnableVertexAttribArray(vertexArrayIndex);
-    glVertexAttribPointer(vertexArrayIndex, 3, GL_FLOAT, GL_FALSE, BYTES_PER_VERT, 
-        (void *)bufferStartByteOffset);
-    bufferStartByteOffset += 12;   // 12 bytes after attribute start
-
-    // texture coord (2 floats (8 bytes) per)
-    // Note: Don't forget (as I did) to increment to the next attribute or the attribute in the 
-    // vertex shader will be a zero vector (that is, won't get set).
-    vertexArrayIndex++; 
-    glEnableVertexAttribArray(vertexArrayIndex);
-    glVertexAttribPointer(vertexArrayIndex, 2, GL_FLOAT, GL_FALSE, BYTES_PER_VERT, 
-        (void *)bufferStartByteOffset);
-
     // index data
     // Note: In order to draw, OpenGL needs point data.  Triangles always need three points 
     // specified, so rather than sending in repeat vertices, index data allows the user to 
     // repeat index data instead (always in sets of 3), which is computationally less demanding 
-    // than sending the entire vertex to the GPU multiple times.  The vertices were previously 
-    // described by the vertex attribute arrays and associated pointers, saying that each vertex 
-    // was composed of three things with their own byte patterns.
-    GLushort localIndices[]
+    // than sending the entire vertex to the GPU multiple times.  The indices are relative to 
+    // the triangle's own first vertex, and the draw's base vertex says where that is.
+    GLuint localIndices[]
     {
         0, 1, 2,
     };
 
-    // like "vertex buffer ID", keep this around if you need to alter the data or clean it up 
-    // properly before program end
-    GLuint elemArrBufId = 0;
-    glGenBuffers(1, &elemArrBufId);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elemArrBufId);  // ??check for bad number first??
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(localIndices), localIndices, GL_STATIC_DRAW);
+    // pack the vertices like the arena's (a straight copy for floats)
+    const VertexFormatDescription &description = GetVertexFormatDescription(gVertexFormat);
+    PositionQuantization noQuantization = { 1.0f, { 0.0f, 0.0f, 0.0f } };
+    std::vector<unsigned char> packedVerts(3 * description.bytesPerVertex);
+    QuantizeVertices(localVerts, 3, gVertexFormat, noQuantization, packedVerts.data());
+
+    // and the indices into as few bytes as 3 vertices need (1 each; see MeshPacking.h)
+    // Note: These used to be one type no matter what (GLushort, and then GLuint).  Now the 
+    // type comes from the vertex count, the same as for the meshes.
+    gTriangleIndexWidth = ChooseIndexWidth(3);
+    GpuBufferArena &indexArena = gIndexArenas[gTriangleIndexWidth];
+    unsigned char packedIndices[3 * sizeof(GLuint)];
+    NarrowIndices(localIndices, 3, gTriangleIndexWidth, packedIndices);
+
+    // find room in the arenas and send the data to the GPU
+    // Note: This used to be a glGenBuffers(...) each for the vertices and indices, which were 
+    // never deleted.  Now they're given back with Free(...) (or all at once when the arenas 
+    // are shut down).
+    gTriangleVertices = gVertexArena.Allocate(3);
+    gTriangleIndices = indexArena.Allocate(3);
+    if (!gVertexArena.Upload(gTriangleVertices, packedVerts.data()) || 
+        !indexArena.Upload(gTriangleIndices, packedIndices))
+    {
+        printf("no room in the arenas for the triangle\n");
+        return 0;
+    }
 
-    // clean up bindings
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    // create a vertex array and describe the byte pattern of the vertices
+    // Note: The strides and offsets come from the vertex struct itself (see MESH_VERTEX_LAYOUT 
+    // in Mesh.h and the packed ones in VertexQuantizer.h) instead of being counted out here, 
+    // where they used to be able to drift from the struct.  The attribute formats are separate 
+    // from the buffer that they read (OpenGL 4.3's glVertexAttribFormat(...) and 
+    // glBindVertexBuffer(...)), and the buffer is attached at draw time (see display()), since 
+    // the arena's buffer changes if it ever has to grow.
+    // Also Note: Don't forget (as I did) to set up every attribute or the attribute in the 
+    // vertex shader will be a zero vector (that is, won't get set).  OnProgramReady(...) 
+    // checks for that now.
+    GLuint vertexArrayObjectId = 0;
+    glGenVertexArrays(1, &vertexArrayObjectId);
+    GlStateCache &stateCache = GlStateCache::Shared();
+    stateCache.BindVertexArray(vertexArrayObjectId);
+    SetVertexLayout(description.layout, 0);
+    stateCache.BindVertexArray(0);
 
     // all good, so return the VAO ID
     return vertexArrayObjectId;
@@ -332,243 +541,833 @@ GLuint CreateGeometry()
 
 /*-----------------------------------------------------------------------------------------------
 Description:
-    Encapsulates the creation of an OpenGL GPU program, including the compilation and linking of 
-    shaders.  It tries to cover all the basics and the error reporting and is as self-contained 
-    as possible, only returning a program ID when it is finished.
-Parameters: None
+    Reads a whole text file into a string.
+Parameters:
+    filePath    The file.
+    contents    Gets the file's contents.
 Returns:
-    The OpenGL ID of the GPU program.
+    False if the file couldn't be opened.
 Exception:  Safe
-Creator:    John Cox (2-13-2016)
+Creator:
 -----------------------------------------------------------------------------------------------*/
-GLuint CreateProgram()
+bool ReadTextFile(const char *filePath, std::string *contents)
 {
-    // hard-coded ignoring possible errors like a boss
-
-    // load up the vertex shader and compile it
     // Note: After retrieving the file's contents, dump the stringstream's contents into a 
     // single std::string.  Do this because, in order to provide the data for shader 
     // compilation, pointers are needed.  The std::string that the stringstream::str() function 
     // returns is a copy of the data, not a reference or pointer to it, so it will go bad as 
     // soon as the std::string object disappears.  To deal with it, copy the data into a 
-    // temporary string.
-    std::ifstream shaderFile("shader.vert");
-    std::stringstream shaderData;
-    shaderData << shaderFile.rdbuf();
-    shaderFile.close();
-    std::string tempFileContents = shaderData.str();
-    GLuint vertShaderId = glCreateShader(GL_VERTEX_SHADER);
-    const GLchar *vertBytes[] = { tempFileContents.c_str() };
-    const GLint vertStrLengths[] = { (int)tempFileContents.length() };
-    glShaderSource(vertShaderId, 1, vertBytes, vertStrLengths);
-    glCompileShader(vertShaderId);
-    // alternately (if you are willing to include and link in glutil, boost, and glm), call 
-    // glutil::CompileShader(GL_VERTEX_SHADER, shaderData.str());
-
-    GLint isCompiled = 0;
-    glGetShaderiv(vertShaderId, GL_COMPILE_STATUS, &isCompiled);
-    if (isCompiled == GL_FALSE)
-    {
-        GLchar errLog[128];
-        GLsizei *logLen = 0;
-        glGetShaderInfoLog(vertShaderId, 128, logLen, errLog);
-        printf("vertex shader failed: '%s'\n", errLog);
-        glDeleteShader(vertShaderId);
-        return 0;
-    }
-
-    // load up the fragment shader and compiler it
-    shaderFile.open("shader.frag");
-    shaderData.str(std::string());      // because stringstream::clear() only clears error flags
-    shaderData.clear();                 // clear any error flags that may have popped up
-    shaderData << shaderFile.rdbuf();
-    shaderFile.close();
-    tempFileContents = shaderData.str();
-    GLuint fragShaderId = glCreateShader(GL_FRAGMENT_SHADER);
-    const GLchar *fragBytes[] = { tempFileContents.c_str() };
-    const GLint fragStrLengths[] = { (int)tempFileContents.length() };
-    glShaderSource(fragShaderId, 1, fragBytes, fragStrLengths);
-    glCompileShader(fragShaderId);
-
-    glGetShaderiv(fragShaderId, GL_COMPILE_STATUS, &isCompiled);
-    if (isCompiled == GL_FALSE)
-    {
-        GLchar errLog[128];
-        GLsizei *logLen = 0;
-        glGetShaderInfoLog(fragShaderId, 128, logLen, errLog);
-        printf("fragment shader failed: '%s'\n", errLog);
-        glDeleteShader(vertShaderId);
-        glDeleteShader(fragShaderId);
-        return 0;
+    // string that outlives the compile.
+    std::ifstream file(filePath);
+    if (!file.is_open())
+    {
+        printf("could not open '%s'\n", filePath);
+        return false;
     }
+    std::stringstream fileData;
+    fileData << file.rdbuf();
+    *contents = fileData.str();
+    return true;
+}
 
-    GLuint programId = glCreateProgram();
-    glAttachShader(programId, vertShaderId);
-    glAttachShader(programId, fragShaderId);
-    glLinkProgram(programId);
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Gets the GPU program once ProgramBuilder has built it (see CreateProgram()).  Switches to 
+    it and looks up its uniforms.
 
-    // the program contains binary, linked versions of the shaders, so clean up the compile 
-    // objects
-    // Note: Shader objects need to be un-linked before they can be deleted.  This is ok because
-    // the program safely contains the shaders in binary form.
-    glDetachShader(programId, vertShaderId);
-    glDetachShader(programId, fragShaderId);
-    glDeleteShader(vertShaderId);
-    glDeleteShader(fragShaderId);
+    Note: A program whose inputs don't match the triangle's vertices (a MeshVertex) is thrown 
+    away like one that didn't build, and the old one (if any) is kept.
+Parameters:
+    programId   The linked program, or 0 if it failed to build.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void OnProgramReady(GLuint programId)
+{
+    if (programId == 0)
+    {
+        // the builder already said why
+        return;
+    }
 
-    // check if the program was built ok
-    GLint isLinked = 0;
-    glGetProgramiv(programId, GL_LINK_STATUS, &isLinked);
-    if (isLinked == GL_FALSE)
+    // find everything the program takes once, now, instead of by string every time
+    ProgramReflection reflection;
+    reflection.Reflect(programId);
+    if (!VertexLayoutsMatchProgram(reflection, &GetVertexFormatDescription(gVertexFormat).layout, 
+        1, "main"))
     {
-        printf("program didn't compile\n");
+        // it said why
         glDeleteProgram(programId);
-        return 0;
+        return;
     }
 
-    // done here
-    return programId;
+    GlStateCache &stateCache = GlStateCache::Shared();
+    if (gProgramId != 0)
+    {
+        glDeleteProgram(gProgramId);
+        stateCache.ForgetProgram(gProgramId);
+    }
+    gProgramId = programId;
+    stateCache.UseProgram(programId);
+    gProgramReflection = reflection;
+    if (gProgramReflection.UniformLocation(TEX_NAME_ID) == -1)
+    {
+        fprintf(stderr, "Could not bind uniform %s\n", "tex");
+        //??throw a fit or continue??
+    }
 }
 
 /*-----------------------------------------------------------------------------------------------
 Description:
-    This is the rendering function.  It tells OpenGL to clear out some color and depth buffers,
-    to set up the data to draw, to draw than stuff, and to report any errors that it came across.
-    This is not a user-called function.
+    Reads a vertex shader and a fragment shader for ProgramBuilder.
+Parameters:
+    vertFilePath    The vertex shader's file.
+    fragFilePath    The fragment shader's file.
+    shaders         Gets the two shaders.
+Returns:
+    False if either file couldn't be read.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool ReadShaderSources(const char *vertFilePath, const char *fragFilePath, 
+    std::vector<ShaderSource> *shaders)
+{
+    shaders->resize(2);
+    (*shaders)[0].shaderType = GL_VERTEX_SHADER;
+    (*shaders)[0].name = vertFilePath;
+    (*shaders)[1].shaderType = GL_FRAGMENT_SHADER;
+    (*shaders)[1].name = fragFilePath;
+    for (size_t shaderCount = 0; shaderCount < shaders->size(); shaderCount++)
+    {
+        if (!ReadTextFile((*shaders)[shaderCount].name.c_str(), &(*shaders)[shaderCount].source))
+        {
+            return false;
+        }
+    }
+    return true;
+}
 
-    This function is registered with glutDisplayFunc(...) during glut's initialization.
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Starts building the OpenGL GPU program, including the compilation and linking of shaders, 
+    and returns without waiting for it.
+
+    The shaders go to a ProgramBuilder, which compiles and links them on the driver's threads 
+    (where the driver can) while init(...) gets on with the geometry and the texture, and 
+    which uses the cached binary from a previous run if there is one (see 
+    ProgramBinaryCache.h).  OnProgramReady(...) gets the result.  Until then gProgramId is 0 
+    and display() doesn't draw.
 Parameters: None
-Returns:    None
+Returns:
+    False if the shader files couldn't be read.
 Exception:  Safe
 Creator:    John Cox (2-13-2016)
 -----------------------------------------------------------------------------------------------*/
-void display()
+bool CreateProgram()
 {
-    // clear existing data
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glClearDepth(1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    std::vector<ShaderSource> shaders;
+    if (!ReadShaderSources("shader.vert", "shader.frag", &shaders))
+    {
+        return false;
+    }
 
-    // set up the data to draw
-    glUniform1i(gUniformTextureLocation, 0);
-    glBindVertexArray(gVaoId);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gTextureId);
+    gProgramBuilder.Submit("main", shaders, OnProgramReady);
+    return true;
+}
 
-    // do the thing
-    glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, 0);
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Gets the sprite program once ProgramBuilder has built it (see CreateSprites(...)) and hands 
+    it to the sprite batcher, which owns it from then on.
+Parameters:
+    programId   The linked program, or 0 if it failed to build.
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void OnSpriteProgramReady(GLuint programId)
+{
+    if (programId != 0)
+    {
+        gSpriteBatcher.SetProgram(programId);
+    }
+}
 
-    // clean up bindings
-    // Note: This is just good practice, but for this barebones demo, the bindings can be left 
-    // as they were and re-bound on each new call to this rendering function.
-    // Also Note: I also do this because I got bit by leaving it bound when I was working on 
-    // implementing FreeType into my main program.
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Sets up the sprite batcher (see SpriteBatcher.h), starts building its program, and lays out 
+    the sprites that display() draws every frame: a grid of them, each showing its own piece 
+    of the texture, so that together they make the whole image.
+Parameters:
+    numSprites  About how many sprites (rounded to fill a square grid).  0 only sets up the 
+                batcher (for "--bench-sprites N").
+Returns:
+    False if the batcher couldn't be made or its shader files couldn't be read.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool CreateSprites(unsigned int numSprites)
+{
+    std::vector<ShaderSource> shaders;
+    if (!gSpriteBatcher.Init() || !ReadShaderSources("sprite.vert", "sprite.frag", &shaders))
+    {
+        return false;
+    }
+    gProgramBuilder.Submit("sprite", shaders, OnSpriteProgramReady);
+    if (numSprites == 0)
+    {
+        return true;
+    }
 
-    // tell the GPU to swap out the displayed buffer with the one that was just rendered
-    glutSwapBuffers();
+    unsigned int numPerRow = 0;
+    while (numPerRow * numPerRow < numSprites)
+    {
+        numPerRow++;
+    }
+    gSprites.clear();
+    for (unsigned int row = 0; row < numPerRow; row++)
+    {
+        for (unsigned int column = 0; column < numPerRow; column++)
+        {
+            // Note: Slightly smaller than their cells so that the grid shows.
+            float cellSize = 1.0f / numPerRow;
+            SpriteInstance sprite;
+            sprite.position[0] = -1.0f + (2.0f * (column + 0.5f) * cellSize);
+            sprite.position[1] = -1.0f + (2.0f * (row + 0.5f) * cellSize);
+            sprite.scale[0] = 0.9f * cellSize;
+            sprite.scale[1] = 0.9f * cellSize;
+            sprite.uvRect[0] = column * cellSize;
+            sprite.uvRect[1] = row * cellSize;
+            sprite.uvRect[2] = (column + 1) * cellSize;
+            sprite.uvRect[3] = (row + 1) * cellSize;
+            memset(sprite.tint, 255, sizeof(sprite.tint));
+            gSprites.push_back(sprite);
+        }
+    }
 
-    // tell glut to call this display() function again on the next iteration of the main loop
-    // Note: https://www.opengl.org/discussion_boards/showthread.php/168717-I-dont-understand-what-glutPostRedisplay()-does
-    // Also Note: This display() function will also be registered to run if the window is moved
-    // or if the viewport is resized.  If glutPostRedisplay() is not called, then as long as the
-    // window stays put and doesn't resize, display() won't be called again (tested with 
-    // debugging).
-    // Also Also Note: It doesn't matter where this is called in this function.  It sets a flag
-    // for glut's main loop and doesn't actually call the registered display function, but I 
-    // got into the habbit of calling it at the end.
-    glutPostRedisplay();
+    return true;
 }
 
 /*-----------------------------------------------------------------------------------------------
 Description:
-    Tell's OpenGL to resize the viewport based on the arguments provided.  This is an
-    opportunity to call glViewport or glScissor to keep up with the change in size.
-
-    This is not a user-called function.  It is registered with glutReshapeFunc(...) during
-    glut's initialization.
+    Gets the mesh program once ProgramBuilder has built it (see CreateMeshes(...)) and hands it 
+    to the multi-draw renderer, which owns it from then on.
 Parameters:
-    w   The width of the window in pixels.
-    h   The height of the window in pixels.
+    programId   The linked program, or 0 if it failed to build.
 Returns:    None
 Exception:  Safe
-Creator:    John Cox (2-13-2016)
+Creator:
 -----------------------------------------------------------------------------------------------*/
-void reshape(int w, int h)
+void OnMeshProgramReady(GLuint programId)
 {
-    glViewport(0, 0, w, h);
+    if (programId != 0)
+    {
+        gMultiDrawRenderer.SetProgram(programId);
+    }
 }
 
 /*-----------------------------------------------------------------------------------------------
 Description:
-    Executes when the user presses a key on the keyboard.
-
-    This is not a user-called function.  It is registered with glutKeyboardFunc(...) during
-    glut's initialization.
-
-    Note: Although the x and y arguments are for the mouse's current position, this function does
-    not respond to mouse presses.
+    Gets the culling program once ProgramBuilder has built it (see CreateGpuCuller()) and 
+    hands it to the culler, which owns it from then on.
 Parameters:
-    key     The ASCII code of the key that was pressed (ex: ESC key is 27)
-    x       The horizontal viewport coordinates of the mouse's current position.
-    y       The vertical window coordinates of the mouse's current position
+    programId   The linked program, or 0 if it failed to build.
 Returns:    None
 Exception:  Safe
-Creator:    John Cox (2-13-2016)
+Creator:
 -----------------------------------------------------------------------------------------------*/
-void keyboard(unsigned char key, int x, int y)
+void OnCullProgramReady(GLuint programId)
 {
-    switch (key)
-    {
-    case 27:
+    if (programId != 0)
     {
-        // ESC key
-        glutLeaveMainLoop();
-        return;
-    }
-    default:
-        break;
+        gGpuCuller.SetProgram(programId);
     }
 }
 
 /*-----------------------------------------------------------------------------------------------
 Description:
-    I don't know what this does, but I've kept it around since early times, and this was the
-    comment given with it:
-
-    "Called before FreeGLUT is initialized. It should return the FreeGLUT display mode flags
-    that you want to use. The initial value are the standard ones used by the framework. You can
-    modify it or just return you own set.  This function can also set the width/height of the
-    window. The initial value of these variables is the default, but you can change it."
-Parameters:
-    displayMode     ??
-    width           ??
-    height          ??
+    Sets up the GPU culler (see GpuCuller.h), starts building its compute program, and gives 
+    it a view of the middle gCullViewSize of the screen (the whole screen if it's 1), so that 
+    what it culls shows.
+Parameters: None
 Returns:
-    ??what??
+    False if the culler couldn't be made or cull.comp couldn't be read.
 Exception:  Safe
-Creator:    John Cox (2-13-2016)
+Creator:
 -----------------------------------------------------------------------------------------------*/
-unsigned int defaults(unsigned int displayMode, int &width, int &height)
-{ 
-    return displayMode; 
+bool CreateGpuCuller()
+{
+    std::vector<ShaderSource> shaders(1);
+    shaders[0].shaderType = GL_COMPUTE_SHADER;
+    shaders[0].name = "cull.comp";
+    if (!gGpuCuller.Init() || !ReadTextFile(shaders[0].name.c_str(), &shaders[0].source))
+    {
+        return false;
+    }
+    gProgramBuilder.Submit("cull", shaders, OnCullProgramReady);
+
+    // a box, -size - +size on X and Y, and all of Z
+    float size = gCullViewSize;
+    float viewPlanes[] =
+    {
+        +1.0f, 0.0f, 0.0f, size,
+        -1.0f, 0.0f, 0.0f, size,
+        0.0f, +1.0f, 0.0f, size,
+        0.0f, -1.0f, 0.0f, size,
+        0.0f, 0.0f, +1.0f, 1.0f,
+        0.0f, 0.0f, -1.0f, 1.0f,
+    };
+    gGpuCuller.SetViewPlanes(viewPlanes, 6);
+    return true;
 }
 
 /*-----------------------------------------------------------------------------------------------
 Description:
-    Governs window creation, the initial OpenGL configuration (face culling, depth mask, even
-    though this is a 2D demo and that stuff won't be of concern), the creation of geometry, and
-    the creation of a texture.
+    Sets up the multi-draw renderer (see MultiDrawRenderer.h), starts building its program, and 
+    gives it numMeshes different meshes (see MakeAssortedMesh(...)) to draw every frame, each 
+    in a cell of a grid and tinted a little differently so that they can be told apart.  With 
+    "--optimize-meshes", each one goes through OptimizeMesh(...) first, and with "--mesh-lods", 
+    each one gets a chain of levels of detail (see MeshSimplifier.h) that the renderer picks 
+    from by how big the mesh is on the screen.
 Parameters:
-    argc    (From main(...)) The number of char * items in argv.  For glut's initialization.
-    argv    (From main(...)) A collection of argument strings.  For glut's initialization.
+    numMeshes   About how many meshes (rounded to fill a square grid).  0 only sets up the 
+                renderer (for "--bench-multidraw N").
 Returns:
-    False if something went wrong during initialization, otherwise true;
+    False if the renderer couldn't be made or its shader files couldn't be read.
 Exception:  Safe
-Creator:    John Cox (3-7-2016)
+Creator:
 -----------------------------------------------------------------------------------------------*/
-bool init(int argc, char *argv[])
+bool CreateMeshes(unsigned int numMeshes)
+{
+    std::vector<ShaderSource> shaders;
+    if (!gMultiDrawRenderer.Init(gVertexArena, gIndexArenas, gVertexFormat) || 
+        !ReadShaderSources("mesh.vert", "mesh.frag", &shaders))
+    {
+        return false;
+    }
+    gMultiDrawRenderer.SetMaxMeshletVertices(gMaxMeshletVertices);
+    gProgramBuilder.Submit("mesh", shaders, OnMeshProgramReady);
+    gMeshIndices.clear();
+    gMeshInstances.clear();
+
+    // "--load-mesh FILE" goes in the middle, scaled so that all of it is on the screen
+    // Note: The file is only needed until its vertices and indices are in the arenas.
+    if (gMeshFilePath != 0)
+    {
+        MeshFile meshFile;
+        if (!meshFile.Open(gMeshFilePath))
+        {
+            return false;
+        }
+        unsigned int meshIndex = gMultiDrawRenderer.AddMesh(meshFile.Mesh());
+        if (meshIndex == MultiDrawRenderer::NO_MESH)
+        {
+            printf("could not add the mesh from '%s'\n", gMeshFilePath);
+            return false;
+        }
+        MeshInstance instance;
+        memset(&instance, 0, sizeof(instance));
+        instance.scale = 0.9f / gMultiDrawRenderer.MeshRadius(meshIndex);
+        memset(instance.tint, 255, sizeof(instance.tint));
+        gMeshIndices.push_back(meshIndex);
+        gMeshInstances.push_back(instance);
+    }
+
+    if (numMeshes == 0)
+    {
+        return true;
+    }
+
+    unsigned int numPerRow = 0;
+    while (numPerRow * numPerRow < numMeshes)
+    {
+        numPerRow++;
+    }
+    std::vector<MeshData> meshes(numPerRow * numPerRow);
+    for (unsigned int meshCount = 0; meshCount < meshes.size(); meshCount++)
+    {
+        meshes[meshCount] = MakeAssortedMesh(meshCount);
+        if (gOptimizeMeshes)
+        {
+            OptimizeMesh(&meshes[meshCount]);
+        }
+    }
+
+    // Note: The meshes are simplified on all of the cores at once, which is why they're all 
+    // made first.
+    std::vector<std::vector<MeshLod>> lodChains;
+    if (gMeshLods)
+    {
+        std::chrono::high_resolution_clock::time_point start = 
+            std::chrono::high_resolution_clock::now();
+        BuildLodChains(meshes, MAX_LODS, &lodChains);
+        std::chrono::duration<double> elapsed = 
+            std::chrono::high_resolution_clock::now() - start;
+        size_t numLods = 0;
+        for (size_t meshCount = 0; meshCount < lodChains.size(); meshCount++)
+        {
+            numLods += lodChains[meshCount].size();
+        }
+        printf("LODs: %u meshes, %u levels of detail in all, built in %.3f ms\n", 
+            (unsigned int)meshes.size(), (unsigned int)numLods, elapsed.count() * 1000.0);
+    }
+
+    for (unsigned int row = 0; row < numPerRow; row++)
+    {
+        for (unsigned int column = 0; column < numPerRow; column++)
+        {
+            // Note: The meshes are 1 unit across and the cells are 2 / numPerRow, so this 
+            // leaves a bit of a gap between them.
+            float cellSize = 2.0f / numPerRow;
+            unsigned int meshNumber = (row * numPerRow) + column;
+            unsigned int meshIndex = gMeshLods ? 
+                gMultiDrawRenderer.AddMeshLods(lodChains[meshNumber]) : 
+                gMultiDrawRenderer.AddMesh(meshes[meshNumber]);
+            if (meshIndex == MultiDrawRenderer::NO_MESH)
+            {
+                return false;
+            }
+            MeshInstance instance;
+            instance.position[0] = -1.0f + ((column + 0.5f) * cellSize);
+            instance.position[1] = -1.0f + ((row + 0.5f) * cellSize);
+            instance.position[2] = 0.0f;
+            instance.scale = 0.8f * cellSize;
+            instance.tint[0] = (GLubyte)(128 + ((column * 127) / numPerRow));
+            instance.tint[1] = (GLubyte)(128 + ((row * 127) / numPerRow));
+            instance.tint[2] = (GLubyte)(128 + ((meshNumber % 3) * 63));
+            instance.tint[3] = 255;
+            gMeshIndices.push_back(meshIndex);
+            gMeshInstances.push_back(instance);
+        }
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Prints how many of the OpenGL state calls that went through the state cache (see 
+    GlStateCache.h) were skipped because they wouldn't have changed anything.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void PrintStateCacheStats()
+{
+    const GlStateCacheStats &stats = GlStateCache::Shared().Stats();
+    if (stats.numFrames == 0)
+    {
+        return;
+    }
+
+    printf("state cache: %u of %u calls elided last frame, %.1f of %.1f per frame on average "
+        "over %llu frames\n", stats.lastFrameElided, stats.lastFrameCalls, 
+        (double)stats.numElided / stats.numFrames, (double)stats.numCalls / stats.numFrames, 
+        stats.numFrames);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Deletes everything that init(...) made that needs the OpenGL context, while it is still 
+    current.  Headless runs call this at the end of RunHeadless(...), and windowed runs call 
+    it from glut's close callback and right before leaving glut's main loop, since freeglut 
+    destroys the context on its way out of glutMainLoop() and nothing after that can clean up.
+
+    The texture streamer goes first, since its producer jobs on the thread pool write into its 
+    mapped buffer until Shutdown() has waited for them, and the mapping goes away with the 
+    context.  The triangle's program, texture (unless it's the streamer's, which went with 
+    it), and VAO go last, along with the headless run's framebuffer.
+
+    Note: Safe to call more than once (ESC leaves the main loop, and then freeglut's 
+    destroying the window calls the close callback).
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void ShutdownRendering()
+{
+    if (gShutDown)
+    {
+        return;
+    }
+    gShutDown = true;
+
+    bool streamedTexture = (gTextureId != 0) && (gTextureId == gTextureStreamer.TextureId());
+    gTextureStreamer.Shutdown();
+    gGpuProfiler.Shutdown();
+    gSpriteBatcher.Shutdown();
+    gMultiDrawRenderer.Shutdown();
+    gGpuCuller.Shutdown();
+    gVertexArena.Free(gTriangleVertices);
+    gIndexArenas[gTriangleIndexWidth].Free(gTriangleIndices);
+    gTriangleVertices = GpuBufferArena::NO_HANDLE;
+    gTriangleIndices = GpuBufferArena::NO_HANDLE;
+    gVertexArena.Shutdown();
+    for (int widthIndex = 0; widthIndex < INDEX_WIDTH_COUNT; widthIndex++)
+    {
+        gIndexArenas[widthIndex].Shutdown();
+    }
+    gDynamicVertexBuffer.Shutdown();
+    gShaderWatcher.Stop();
+
+    GlStateCache &stateCache = GlStateCache::Shared();
+    if (gProgramId != 0)
+    {
+        glDeleteProgram(gProgramId);
+        stateCache.ForgetProgram(gProgramId);
+        gProgramId = 0;
+    }
+    if ((gTextureId != 0) && !streamedTexture)
+    {
+        glDeleteTextures(1, &gTextureId);
+        stateCache.ForgetTexture(gTextureId);
+    }
+    gTextureId = 0;
+    if (gVaoId != 0)
+    {
+        glDeleteVertexArrays(1, &gVaoId);
+        stateCache.ForgetVertexArray(gVaoId);
+        gVaoId = 0;
+    }
+    gOffscreenFramebuffer.Destroy();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Called by display() once "--bench N" has timed all of its frames.  Prints the summary, 
+    writes the JSON report along with the settings that the frames were drawn with, and ends 
+    glut's main loop (if there is one) so that the program quits.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+void FinishFrameBenchmark()
+{
+    gFrameBenchmark.Finish();
+    gFrameBenchmark.PrintSummary();
+
+    std::map<std::string, std::string> settings;
+    settings["mode"] = gHeadless ? "headless" : "windowed";
+    settings["texture_size"] = std::to_string(gTextureWidth) + "x" + 
+        std::to_string(gTextureHeight);
+    settings["texel_format"] = GetTexelFormatDescription(gTexelFormat).name;
+    settings["block_format"] = GetBlockFormatDescription(gBlockFormat).name;
+    settings["mipmaps"] = gBuildMipmaps ? "true" : "false";
+    settings["stream_texture"] = gStreamTexture ? "true" : "false";
+    settings["dds_file"] = (gDdsFilePath != 0) ? gDdsFilePath : "";
+    if (gFrameBenchmark.WriteJsonReport(gBenchReportPath, settings))
+    {
+        printf("bench: wrote '%s'\n", gBenchReportPath);
+    }
+    PrintStateCacheStats();
+
+    if (!gHeadless)
+    {
+        ShutdownRendering();
+        glutLeaveMainLoop();
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    This is the rendering function.  It tells OpenGL to clear out some color and depth buffers,
+    to set up the data to draw, to draw than stuff, and to report any errors that it came across.
+    This is not a user-called function.
+
+    This function is registered with glutDisplayFunc(...) during glut's initialization.
+Parameters: None
+Returns:    None
+Exception:  Safe
+Creator:    John Cox (2-13-2016)
+-----------------------------------------------------------------------------------------------*/
+void display()
+{
+    // glut can still ask for a frame after ESC has cleaned up (the same pass through its loop 
+    // that left it), and there's nothing to draw with by then
+    if (gShutDown)
+    {
+        return;
+    }
+
+    // Note: These do nothing unless "--bench N" started the benchmark.
+    gFrameBenchmark.BeginFrame();
+
+    // Note: The profiler does nothing unless "--gpu-profile" started it.
+    gGpuProfiler.BeginFrame();
+    gNumFramesDrawn++;
+
+    // state changes go through this so that the ones that wouldn't change anything are skipped
+    // (see GlStateCache.h)
+    GlStateCache &stateCache = GlStateCache::Shared();
+    stateCache.BeginFrame();
+
+    // move on to this frame's part of the dynamic geometry ring
+    // Note: This does nothing unless something (the sprites or the meshes) set it up.
+    gDynamicVertexBuffer.BeginFrame();
+
+    // if a shader file was saved, rebuild the program
+    // Note: This is just a check of a flag unless a file has changed (see FileWatcher.h).  The 
+    // old program keeps drawing until the new one links, and if it doesn't link, the old one 
+    // stays.
+    if (gShaderWatcher.HasChanges())
+    {
+        std::vector<std::string> changedFiles = gShaderWatcher.TakeChanges();
+        for (size_t fileCount = 0; fileCount < changedFiles.size(); fileCount++)
+        {
+            printf("'%s' changed; rebuilding the program\n", changedFiles[fileCount].c_str());
+        }
+        CreateProgram();
+    }
+
+    // pick up the program if it has finished building (see CreateProgram())
+    // Note: This is between frames, so a new program is swapped in (by OnProgramReady(...)) 
+    // before anything is drawn with the old one.
+    gProgramBuilder.Poll();
+
+    // clear existing data
+    gGpuProfiler.BeginScope("clear");
+    stateCache.ClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    stateCache.ClearDepth(1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    gGpuProfiler.EndScope();
+
+    // if the texture is streaming, queue up this frame's new texels (if they're ready yet)
+    // Note: This does nothing if the streamer was never started.
+    gGpuProfiler.BeginScope("stream");
+    gTextureStreamer.Update();
+    gGpuProfiler.EndScope();
+    const TextureStreamerStats &streamStats = gTextureStreamer.Stats();
+    if (streamStats.numFrames == 600)
+    {
+        printf("streaming: %.1f KB/frame, %.3f ms/frame fence polling, %.3f ms/frame total, "
+            "%llu frames without new texels\n",
+            (double)streamStats.bytesUploaded / streamStats.numFrames / 1024.0,
+            streamStats.fenceWaitSeconds * 1000.0 / streamStats.numFrames,
+            streamStats.updateSeconds * 1000.0 / streamStats.numFrames,
+            streamStats.framesWithoutNewTexels);
+        gTextureStreamer.ResetStats();
+    }
+
+    if (gGpuProfiler.IsEnabled() && (gNumFramesDrawn % 600 == 0))
+    {
+        gGpuProfiler.PrintStats();
+    }
+
+    // do the thing
+    // Note: The ordinary draws (just the triangle, for now) go through the render queue, which 
+    // sorts them by layer, program, texture, VAO, and depth and then draws them with as few 
+    // state changes as that order takes (see RenderQueue.h).  There's nothing to draw with 
+    // until the program has been built.
+    gGpuProfiler.BeginScope("draw");
+    gRenderQueue.Begin(true);
+    if (gProgramId != 0)
+    {
+        // the sampler uniform belongs to the program, so it's set once here instead of per 
+        // draw, and the queue binds the texture to unit 0
+        stateCache.UseProgram(gProgramId);
+        stateCache.Uniform1i(gProgramReflection.UniformLocation(TEX_NAME_ID), 0);
+
+        // the triangle is somewhere in the arenas, so say which buffers and where
+        // Note: The buffers change if an arena ever grows, so they're given every frame 
+        // instead of once in CreateGeometry().
+        // Also Note: The index type is whatever CreateGeometry() picked for it.
+        GpuBufferArena &indexArena = gIndexArenas[gTriangleIndexWidth];
+        RenderQueueDraw triangle;
+        triangle.programId = gProgramId;
+        triangle.vaoId = gVaoId;
+        triangle.textureId = gTextureId;
+        triangle.vertexBufferId = gVertexArena.BufferId();
+        triangle.vertexStride = gVertexArena.ElementSize();
+        triangle.indexBufferId = indexArena.BufferId();
+        triangle.indexType = IndexType(gTriangleIndexWidth);
+        triangle.indexCount = 3;
+        triangle.firstIndexBytes = 
+            indexArena.Offset(gTriangleIndices) * indexArena.ElementSize();
+        triangle.baseVertex = (int)gVertexArena.Offset(gTriangleVertices);
+        gRenderQueue.Add(0, 0.0f, triangle);
+    }
+    gRenderQueue.Submit();
+
+    // "--sprites N": all of them in one instanced draw call (see SpriteBatcher.h)
+    // Note: Like the main program, there's nothing to draw them with until it's built.
+    if (gSpriteBatcher.IsReady() && !gSprites.empty())
+    {
+        gSpriteBatcher.Begin(true);
+        for (size_t spriteCount = 0; spriteCount < gSprites.size(); spriteCount++)
+        {
+            gSpriteBatcher.Add(gTextureId, gSprites[spriteCount]);
+        }
+        gSpriteBatcher.Flush();
+    }
+
+    // "--meshes N": all of them, each a different mesh, in one glMultiDrawElementsIndirect(...) 
+    // (see MultiDrawRenderer.h), and with "--gpu-cull", only the ones that the GPU finds are 
+    // in view (see GpuCuller.h)
+    if (gMultiDrawRenderer.IsReady() && !gMeshInstances.empty())
+    {
+        gMultiDrawRenderer.Begin();
+        for (size_t meshCount = 0; meshCount < gMeshInstances.size(); meshCount++)
+        {
+            gMultiDrawRenderer.Draw(gMeshIndices[meshCount], gMeshInstances[meshCount]);
+        }
+        if (gGpuCuller.IsReady())
+        {
+            gMultiDrawRenderer.SubmitCulled(gTextureId, gGpuCuller);
+        }
+        else
+        {
+            gMultiDrawRenderer.Submit(gTextureId);
+        }
+    }
+
+    // everything that reads this frame's dynamic geometry has been drawn
+    gDynamicVertexBuffer.EndFrame();
+
+    // Note: The bindings used to be cleaned up (set back to 0) here as good practice after I 
+    // got bit by leaving one bound when I was working on implementing FreeType into my main 
+    // program, but that was 2 calls to unbind and 2 more to re-bind every frame for nothing.  
+    // Now that the state cache knows what is bound, leaving them is safe for anything that 
+    // goes through the cache too.
+    gGpuProfiler.EndScope();
+
+    // tell the GPU to swap out the displayed buffer with the one that was just rendered
+    // Note: Without a window, there's nothing to swap, but flush anyway like a swap would so 
+    // that the driver starts on this frame now instead of whenever its queue fills up.
+    gGpuProfiler.BeginScope("swap");
+    if (gHeadless)
+    {
+        glFlush();
+    }
+    else
+    {
+        glutSwapBuffers();
+    }
+    gGpuProfiler.EndScope();
+
+    gFrameBenchmark.EndFrame();
+    if (gFrameBenchmark.IsDone())
+    {
+        FinishFrameBenchmark();
+        return;
+    }
+
+    // there's no glut main loop to ask for another frame when headless (see RunHeadless(...))
+    if (gHeadless)
+    {
+        return;
+    }
+
+    // tell glut to call this display() function again on the next iteration of the main loop
+    // Note: https://www.opengl.org/discussion_boards/showthread.php/168717-I-dont-understand-what-glutPostRedisplay()-does
+    // Also Note: This display() function will also be registered to run if the window is moved
+    // or if the viewport is resized.  If glutPostRedisplay() is not called, then as long as the
+    // window stays put and doesn't resize, display() won't be called again (tested with 
+    // debugging).
+    // Also Also Note: It doesn't matter where this is called in this function.  It sets a flag
+    // for glut's main loop and doesn't actually call the registered display function, but I 
+    // got into the habbit of calling it at the end.
+    glutPostRedisplay();
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Tell's OpenGL to resize the viewport based on the arguments provided.  This is an
+    opportunity to call glViewport or glScissor to keep up with the change in size.
+
+    This is not a user-called function.  It is registered with glutReshapeFunc(...) during
+    glut's initialization.
+Parameters:
+    w   The width of the window in pixels.
+    h   The height of the window in pixels.
+Returns:    None
+Exception:  Safe
+Creator:    John Cox (2-13-2016)
+-----------------------------------------------------------------------------------------------*/
+void reshape(int w, int h)
+{
+    GlStateCache::Shared().Viewport(0, 0, w, h);
+
+    // the meshes' levels of detail depend on how many pixels they cover
+    gMultiDrawRenderer.SetLodSelection((float)h, gLodPixelError);
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Executes when the user presses a key on the keyboard.
+
+    This is not a user-called function.  It is registered with glutKeyboardFunc(...) during
+    glut's initialization.
+
+    Note: Although the x and y arguments are for the mouse's current position, this function does
+    not respond to mouse presses.
+Parameters:
+    key     The ASCII code of the key that was pressed (ex: ESC key is 27)
+    x       The horizontal viewport coordinates of the mouse's current position.
+    y       The vertical window coordinates of the mouse's current position
+Returns:    None
+Exception:  Safe
+Creator:    John Cox (2-13-2016)
+-----------------------------------------------------------------------------------------------*/
+void keyboard(unsigned char key, int x, int y)
+{
+    switch (key)
+    {
+    case 27:
+    {
+        // ESC key
+        // Note: Clean up while the context is still around (see ShutdownRendering()).
+        ShutdownRendering();
+        glutLeaveMainLoop();
+        return;
+    }
+    default:
+        break;
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    I don't know what this does, but I've kept it around since early times, and this was the
+    comment given with it:
+
+    "Called before FreeGLUT is initialized. It should return the FreeGLUT display mode flags
+    that you want to use. The initial value are the standard ones used by the framework. You can
+    modify it or just return you own set.  This function can also set the width/height of the
+    window. The initial value of these variables is the default, but you can change it."
+Parameters:
+    displayMode     ??
+    width           ??
+    height          ??
+Returns:
+    ??what??
+Exception:  Safe
+Creator:    John Cox (2-13-2016)
+-----------------------------------------------------------------------------------------------*/
+unsigned int defaults(unsigned int displayMode, int &width, int &height)
+{ 
+    return displayMode; 
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Initializes glut and makes the window (and with it, the OpenGL context).  This used to be 
+    the start of init(...), but headless mode (see RunHeadless(...)) makes its context without 
+    glut, so it got its own function.
+Parameters:
+    argc            (From main(...)) For glut's initialization.
+    argv            (From main(...)) For glut's initialization.
+    glMajorVersion  The OpenGL version that the context should have.
+    glMinorVersion  ^
+Returns:
+    glut's window handle.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+int CreateGlutWindow(int argc, char *argv[], int glMajorVersion, int glMinorVersion)
 {
     glutInit(&argc, argv);
 
@@ -586,19 +1385,57 @@ bool init(int argc, char *argv[])
     int window = glutCreateWindow(argv[0]);
     glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_CONTINUE_EXECUTION);
 
+    glutInitContextVersion(glMajorVersion, glMinorVersion);
+    glutInitContextProfile(GLUT_CORE_PROFILE);
+#ifdef DEBUG
+    glutInitContextFlags(GLUT_DEBUG);   // if enabled, 
+#endif
+
+    return window;
+}
+
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Governs window (or headless context) creation, the initial OpenGL configuration (face 
+    culling, depth mask, even though this is a 2D demo and that stuff won't be of concern), the 
+    creation of geometry, and the creation of a texture.
+Parameters:
+    argc    (From main(...)) The number of char * items in argv.  For glut's initialization.
+    argv    (From main(...)) A collection of argument strings.  For glut's initialization.
+Returns:
+    False if something went wrong during initialization, otherwise true;
+Exception:  Safe
+Creator:    John Cox (3-7-2016)
+-----------------------------------------------------------------------------------------------*/
+bool init(int argc, char *argv[])
+{
     // OpenGL 4.3 was where internal debugging was enabled, freeing the user from having to call
     // glGetError() and analyzing it after every single OpenGL call, complete with surrounding it
     // with #ifdef DEBUG ... #endif blocks
     // Note: https://blog.nobel-joergensen.com/2013/02/17/debugging-opengl-part-2-using-gldebugmessagecallback/
     int glMajorVersion = 4;
     int glMinorVersion = 4;
-    glutInitContextVersion(glMajorVersion, glMinorVersion);
-    glutInitContextProfile(GLUT_CORE_PROFILE);
+    int window = 0;
+    if (gHeadless)
+    {
+        // no window, so no glut; EGL makes the context instead (see HeadlessContext.cpp) and 
+        // everything after that is the same
 #ifdef DEBUG
-    glutInitContextFlags(GLUT_DEBUG);   // if enabled, 
+        bool debugContext = true;
+#else
+        bool debugContext = false;
 #endif
+        if (!gHeadlessContext.Create(glMajorVersion, glMinorVersion, debugContext))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        window = CreateGlutWindow(argc, argv, glMajorVersion, glMinorVersion);
+    }
 
-                                        // glload must load AFTER glut loads the context
+    // glload must load AFTER glut (or EGL) makes the context
     glload::LoadTest glLoadGood = glload::LoadFunctions();
     if (!glLoadGood)    // apparently it has an overload for "bool type"
     {
@@ -610,7 +1447,10 @@ bool init(int argc, char *argv[])
         // the "is version" check is an "is at least version" check
         printf("Your OpenGL version is %i, %i. You must have at least OpenGL %i.%i to run this tutorial.\n",
             glload::GetMajorVersion(), glload::GetMinorVersion(), glMajorVersion, glMinorVersion);
-        glutDestroyWindow(window);
+        if (!gHeadless)
+        {
+            glutDestroyWindow(window);
+        }
         return 0;
     }
     else if (glext_ARB_debug_output)
@@ -618,39 +1458,237 @@ bool init(int argc, char *argv[])
         // condition will be true if GLUT_DEBUG is a context flag
         glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB);
         glDebugMessageCallbackARB(DebugFunc, (void*)15);
+
+        // the GPU profiler's scopes are also debug groups (see GpuProfiler.h), and without this
+        // every push and pop would be printed
+        glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, 0, 
+            GL_FALSE);
+        glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, 0, 
+            GL_FALSE);
     }
 
     // these OpenGL initializations are for 3D stuff, where depth matters and multiple shapes can
     // be "on top" of each other relative to the most distant thing rendered, and this barebones 
     // code is only for 2D stuff, but initialize them anyway as good practice (??bad idea? only 
     // use these once 3D becomes a thing??)
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
-    glDepthFunc(GL_LEQUAL);
+    GlStateCache &stateCache = GlStateCache::Shared();
+    stateCache.SetEnabled(GL_CULL_FACE, true);
+    stateCache.CullFace(GL_BACK);
+    stateCache.FrontFace(GL_CCW);
+    stateCache.SetEnabled(GL_DEPTH_TEST, true);
+    stateCache.DepthMask(true);
+    stateCache.DepthFunc(GL_LEQUAL);
     glDepthRange(0.0f, 1.0f);
 
-    GLuint programId = CreateProgram();
-    glUseProgram(programId);
-    gUniformTextureLocation = glGetUniformLocation(programId, "tex");
-    if (gUniformTextureLocation == -1)
+    // the program builds while the geometry and texture are made
+    gProgramBuilder.Init(gProgramCacheDirectory);
+    if (!CreateProgram())
     {
-        fprintf(stderr, "Could not bind uniform %s\n", "tex");
-        //??throw a fit or continue??
+        return false;
+    }
+    if (gHotReloadShaders)
+    {
+        // the same files that CreateProgram() reads
+        std::vector<std::string> shaderFiles = { "shader.vert", "shader.frag" };
+        gShaderWatcher.Start(shaderFiles);
+    }
+
+    // every mesh's vertices and indices go in these (see GpuBufferArena.h), and they grow if 
+    // they have to
+    if (!gVertexArena.Init(GetVertexFormatDescription(gVertexFormat).bytesPerVertex, 64 * 1024))
+    {
+        return false;
+    }
+    for (int widthIndex = 0; widthIndex < INDEX_WIDTH_COUNT; widthIndex++)
+    {
+        if (!gIndexArenas[widthIndex].Init(BytesPerIndex((IndexWidth)widthIndex), 256 * 1024))
+        {
+            return false;
+        }
+    }
+
+    if ((gNumSprites > 0) && !CreateSprites(gNumSprites))
+    {
+        return false;
+    }
+    if (((gNumMeshes > 0) || (gMeshFilePath != 0)) && !CreateMeshes(gNumMeshes))
+    {
+        return false;
+    }
+    if (gGpuCull && !CreateGpuCuller())
+    {
+        return false;
+    }
+
+    // the sprites' instances and the meshes' draw commands are rewritten every frame, so they 
+    // go in the persistently mapped ring (see DynamicVertexBuffer.h), with a bit of room to 
+    // spare for other dynamic geometry and alignment
+    // Note: If the driver can't do that, the batcher orphans its own buffer instead, but the 
+    // meshes aren't drawn.
+    size_t dynamicBytesPerFrame = (gSprites.size() * sizeof(SpriteInstance)) + 
+        (gMeshInstances.size() * MultiDrawRenderer::BYTES_PER_DRAW);
+    if ((dynamicBytesPerFrame > 0) && 
+        gDynamicVertexBuffer.Init(dynamicBytesPerFrame + (64 * 1024), 3))
+    {
+        gSpriteBatcher.SetDynamicBuffer(&gDynamicVertexBuffer);
+        gMultiDrawRenderer.SetDynamicBuffer(&gDynamicVertexBuffer);
     }
 
     // create the vertices for the geometry (and the texture coordinates that go with each 
     // vertex) and the texture that will be used to color it
     // Note: The VAO and texture will be bound at render time (see display()).
     gVaoId = CreateGeometry();
-    gTextureId = CreateTexture();
+    if (gVaoId == 0)
+    {
+        return false;
+    }
+    if (gDdsFilePath != 0)
+    {
+        gTextureId = CreateTextureFromDds(gDdsFilePath);
+    }
+    else if (gStreamTexture && gTextureStreamer.Init(gTextureWidth, gTextureHeight, gTexelFormat, 
+        3, MakeScrollingTricolorProducer(gTextureWidth, gTextureHeight, gTexelFormat)))
+    {
+        // a new image every frame (see display()) instead of a one-time upload
+        gTextureId = gTextureStreamer.TextureId();
+    }
+    else
+    {
+        gTextureId = CreateTexture(gTextureWidth, gTextureHeight, gTexelFormat, gBuildMipmaps, 
+            gBlockFormat);
+    }
+
+    if (gHeadless)
+    {
+        // there is no default framebuffer without a window, so draw into one of our own that is 
+        // the same size that the window would have been
+        if (!gOffscreenFramebuffer.Create(500, 500))
+        {
+            return false;
+        }
+        gOffscreenFramebuffer.Bind();
+
+        // Note: Without a window, glut never calls reshape(...), so it's called here for the 
+        // framebuffer's size.
+        reshape(gOffscreenFramebuffer.Width(), gOffscreenFramebuffer.Height());
+    }
+
+    // making the geometry and textures (and the framebuffer) binds things directly, so the 
+    // cache can't trust what it knows anymore
+    stateCache.Invalidate();
 
     // all went well
     return true;
 }
 
+/*-----------------------------------------------------------------------------------------------
+Description:
+    Stands in for glutMainLoop() in headless mode.  Calls display() the requested number of 
+    times, reports how long that took, optionally saves the last frame, and cleans up.
+Parameters:
+    numFrames       How many times to call display().
+    screenshotPath  If not null, the last frame is saved here as a .ppm image.
+Returns:
+    True if everything (including the screenshot) worked.
+Exception:  Safe
+Creator:
+-----------------------------------------------------------------------------------------------*/
+bool RunHeadless(unsigned int numFrames, const char *screenshotPath)
+{
+    // a window's first frames can go by while the program is still building, but a headless 
+    // run is usually for a screenshot or a benchmark, so make sure that every frame counts
+    gProgramBuilder.WaitForAll();
+
+    // Note: glFinish() so that the time is for drawing the frames and not just for queuing up 
+    // the commands.
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned int frameCount = 0; frameCount < numFrames; frameCount++)
+    {
+        display();
+    }
+    glFinish();
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    printf("headless: %u frames (%ux%u) in %.3f ms (%.1f frames/s) on %s\n", numFrames, 
+        gOffscreenFramebuffer.Width(), gOffscreenFramebuffer.Height(), elapsed.count() * 1000.0, 
+        (elapsed.count() > 0.0) ? numFrames / elapsed.count() : 0.0, 
+        (const char *)glGetString(GL_RENDERER));
+
+    if (gGpuProfiler.IsEnabled())
+    {
+        // everything has finished after glFinish(), so this picks up the last frames' results
+        gGpuProfiler.BeginFrame();
+        gGpuProfiler.PrintStats();
+        gGpuProfiler.Shutdown();
+    }
+
+    bool good = true;
+    if (screenshotPath != 0)
+    {
+        good = gOffscreenFramebuffer.WritePpmFile(screenshotPath);
+        if (good)
+        {
+            printf("headless: saved the last frame to '%s'\n", screenshotPath);
+        }
+    }
+
+    // the frame counts are closed out by the next BeginFrame(), and there isn't one
+    GlStateCache::Shared().BeginFrame();
+    PrintStateCacheStats();
+    if (gDynamicVertexBuffer.IsReady())
+    {
+        const DynamicVertexBufferStats &dynamicStats = gDynamicVertexBuffer.Stats();
+        printf("dynamic geometry: %.1f KB/frame (peak %.1f KB of %.1f KB), %llu stalls, "
+            "%llu failed allocations\n", 
+            (double)dynamicStats.bytesAllocated / dynamicStats.numFrames / 1024.0, 
+            dynamicStats.peakFrameBytes / 1024.0, gDynamicVertexBuffer.BytesPerFrame() / 1024.0, 
+            dynamicStats.numStalls, dynamicStats.failedAllocations);
+    }
+    if (gRenderQueue.Stats().numDraws > 0)
+    {
+        const RenderQueueStats &queueStats = gRenderQueue.Stats();
+        printf("render queue: %u draws, %u program, %u texture, and %u VAO changes (%u avoided "
+            "by sorting), %.3f ms CPU\n", queueStats.numDraws, queueStats.numProgramChanges, 
+            queueStats.numTextureChanges, queueStats.numVaoChanges, 
+            queueStats.numChangesAvoided, queueStats.cpuSeconds * 1000.0);
+    }
+    if (gMultiDrawRenderer.Stats().numDraws > 0)
+    {
+        const MultiDrawStats &multiDrawStats = gMultiDrawRenderer.Stats();
+        printf("multi-draw: %u draws (%u triangles, %u at full detail) in %u draw call(s), "
+            "%.3f ms CPU\n", multiDrawStats.numDraws, multiDrawStats.numTriangles, 
+            multiDrawStats.numFullDetailTriangles, multiDrawStats.numDrawCalls, 
+            multiDrawStats.cpuSeconds * 1000.0);
+    }
+    if (gGpuCuller.IsReady())
+    {
+        // Note: This reads the count back, which the frames themselves never do.
+        printf("GPU culling: %u of %u draws in view (%s)\n", gGpuCuller.VisibleCount(), 
+            gMultiDrawRenderer.Stats().numDraws, gGpuCuller.HasDrawCount() ? 
+            "drawn with the GPU's count" : "drawn with 0-instance commands past the count");
+    }
+
+    if (gVertexArena.IsReady())
+    {
+        // Note: The indices are in bytes, since they're in 3 arenas of different widths.
+        GpuBufferArenaStats vertexStats = gVertexArena.Stats();
+        unsigned int numIndexBytes = 0;
+        unsigned int numRepacks = vertexStats.numRepacks;
+        for (int widthIndex = 0; widthIndex < INDEX_WIDTH_COUNT; widthIndex++)
+        {
+            GpuBufferArenaStats indexStats = gIndexArenas[widthIndex].Stats();
+            numIndexBytes += indexStats.used * BytesPerIndex((IndexWidth)widthIndex);
+            numRepacks += indexStats.numRepacks;
+        }
+        printf("arenas: %u of %u vertices and %u bytes of indices in use by %u mesh(es), "
+            "%u repack(s)\n", vertexStats.used, vertexStats.capacity, numIndexBytes, 
+            vertexStats.numAllocations, numRepacks);
+    }
+
+    ShutdownRendering();
+    gHeadlessContext.Destroy();
+    return good;
+}
+
 /*-----------------------------------------------------------------------------------------------
 Description:
     Program start and end.
@@ -703,16 +1741,426 @@ int main(int argc, char *argv[])
 //    }
 //
 //    init();
+
+    // options that aren't glut's
+    // Note: "--texture-size N" makes an NxN texture and "--texel-format NAME" picks what it is 
+    // packed into (rgba32f, rgba16f, rgba8, r11g11b10f, or rgb565).  "--no-mipmaps" uploads 
+    // only level 0.  "--block-format NAME" compresses it (bc1, bc3, or bc7) instead, 
+    // "--write-dds FILE" saves that to a file and quits, and "--load-dds FILE" uses such a file 
+    // instead of making the texture.  "--stream-texture" uploads a new (scrolled) image every 
+    // frame through a ring of mapped buffers.  The "--bench-*" options time something and then 
+    // quit.  Most of them do it without ever making a window, but the ones that need OpenGL 
+    // wait until after init(...).  "--headless" makes the context without a window (see 
+    // HeadlessContext.h), draws "--frames N" frames (default 1) into an offscreen framebuffer, 
+    // saves the last one to "--screenshot FILE.ppm" if asked, and quits.  "--bench N" times N 
+    // frames (after a few warmup frames), windowed or headless, prints frame time percentiles, 
+    // writes them to "--bench-report FILE.json" (default bench_report.json), and quits.  
+    // "--program-cache DIR" keeps linked shader programs in DIR (default shader_cache) so that 
+    // later runs can skip compiling them, and "--no-program-cache" doesn't.  
+    // "--hot-reload" rebuilds the program whenever shader.vert or shader.frag is saved.  
+    // "--gpu-profile" times the clear, stream, draw, and swap parts of each frame on the GPU 
+    // and prints them every 600 frames.  "--sprites N" also draws about N sprites in a grid 
+    // with one instanced draw call, and "--bench-sprites N" times N sprites drawn that way 
+    // against one draw call per sprite.  "--meshes N" draws about N different meshes in a grid 
+    // with one multi-draw indirect call, and "--bench-multidraw N" times up to N meshes drawn 
+    // that way against one draw call per mesh.  "--gpu-cull" has a compute shader pick which 
+    // of the meshes are in view (the middle "--cull-view S" of the screen, default 1, all of 
+    // it) and write their draw commands, and "--bench-gpu-cull N" times that against culling 
+    // N meshes on the CPU.  "--bench-arena N" times putting N meshes in buffer objects of their 
+    // own against suballocating them from one big buffer, and how that holds up to churn.  
+    // "--vertex-format NAME" packs every mesh's vertices into float (the default), 
+    // snorm16-unorm16, or snorm16-half (see VertexQuantizer.h), and "--bench-vertex-formats N" 
+    // compares how big, how fast to pack, how accurate, and how fast to draw N meshes are in 
+    // each of them.  "--optimize-meshes" reorders every mesh's triangles and vertices for the 
+    // GPU's vertex cache, overdraw, and vertex fetching before it's added (see MeshOptimizer.h), 
+    // and "--bench-mesh-optimizer" prints how much that saves on a simulated cache.  
+    // "--convert-obj FILE.obj FILE.mesh" turns an OBJ file into a mesh file (see MeshFile.h) 
+    // with whatever "--vertex-format" came before it and quits, "--load-mesh FILE.mesh" draws 
+    // one in the middle of the screen, and "--bench-mesh-load N" times loading about N 
+    // vertices from each kind of file.  "--meshlet-vertices N" cuts meshes of more than N 
+    // vertices into meshlets of up to N (default 65536, so that nothing needs 32-bit indices; 
+    // 0 never cuts them), and "--bench-meshlets N" compares the index bytes, draw time, and 
+    // culling of an N-vertex mesh drawn whole and cut into meshlets of a few sizes.  
+    // "--mesh-lods" simplifies each of the "--meshes" into levels of detail (see 
+    // MeshSimplifier.h), and each draw uses the coarsest one that's no more than 
+    // "--lod-pixel-error E" pixels off (default 1) at its size on the screen.  
+    // "--bench-simplify N" times simplifying about N triangles' worth of meshes into levels of 
+    // detail on one thread and on all of them.  "--bench-render-queue N" times N draws with 
+    // assorted programs, textures, and VAOs through the render queue (see RenderQueue.h) in 
+    // the order that they were added against sorted by state, and counts the state changes.
+    bool benchMipmaps = false;
+    bool benchStreaming = false;
+    bool gpuProfile = false;
+    unsigned int benchSprites = 0;
+    unsigned int benchMeshes = 0;
+    unsigned int benchCulledMeshes = 0;
+    unsigned int benchArenaMeshes = 0;
+    unsigned int benchVertexFormatMeshes = 0;
+    unsigned int benchMeshLoadVertices = 0;
+    unsigned int benchMeshletVertices = 0;
+    unsigned int benchQueueDraws = 0;
+    for (int argCount = 1; argCount < argc; argCount++)
+    {
+        if ((strcmp(argv[argCount], "--texture-size") == 0) && (argCount + 1 < argc))
+        {
+            gTextureWidth = (unsigned int)atoi(argv[++argCount]);
+            gTextureHeight = gTextureWidth;
+        }
+        else if ((strcmp(argv[argCount], "--texel-format") == 0) && (argCount + 1 < argc))
+        {
+            if (!ParseTexelFormat(argv[++argCount], &gTexelFormat))
+            {
+                printf("unknown texel format '%s'\n", argv[argCount]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[argCount], "--bench-texgen") == 0)
+        {
+            BenchmarkTextureGeneration(gTextureWidth, gTextureHeight);
+            return 0;
+        }
+        else if (strcmp(argv[argCount], "--bench-mesh-optimizer") == 0)
+        {
+            BenchmarkMeshOptimizer();
+            return 0;
+        }
+        else if (strcmp(argv[argCount], "--optimize-meshes") == 0)
+        {
+            gOptimizeMeshes = true;
+        }
+        else if ((strcmp(argv[argCount], "--convert-obj") == 0) && (argCount + 2 < argc))
+        {
+            argCount += 2;
+            return ConvertObjFile(argv[argCount - 1], argv[argCount], gVertexFormat) ? 0 : 1;
+        }
+        else if ((strcmp(argv[argCount], "--load-mesh") == 0) && (argCount + 1 < argc))
+        {
+            gMeshFilePath = argv[++argCount];
+        }
+        else if ((strcmp(argv[argCount], "--bench-mesh-load") == 0) && (argCount + 1 < argc))
+        {
+            // needs a context too
+            benchMeshLoadVertices = (unsigned int)atoi(argv[++argCount]);
+        }
+        else if ((strcmp(argv[argCount], "--meshlet-vertices") == 0) && (argCount + 1 < argc))
+        {
+            gMaxMeshletVertices = (unsigned int)atoi(argv[++argCount]);
+        }
+        else if (strcmp(argv[argCount], "--mesh-lods") == 0)
+        {
+            gMeshLods = true;
+        }
+        else if ((strcmp(argv[argCount], "--lod-pixel-error") == 0) && (argCount + 1 < argc))
+        {
+            gLodPixelError = (float)atof(argv[++argCount]);
+        }
+        else if ((strcmp(argv[argCount], "--bench-simplify") == 0) && (argCount + 1 < argc))
+        {
+            BenchmarkMeshSimplification((unsigned int)atoi(argv[++argCount]));
+            return 0;
+        }
+        else if ((strcmp(argv[argCount], "--bench-meshlets") == 0) && (argCount + 1 < argc))
+        {
+            // needs a context too
+            benchMeshletVertices = (unsigned int)atoi(argv[++argCount]);
+        }
+        else if ((strcmp(argv[argCount], "--bench-render-queue") == 0) && 
+            (argCount + 1 < argc))
+        {
+            // needs a context too
+            benchQueueDraws = (unsigned int)atoi(argv[++argCount]);
+        }
+        else if (strcmp(argv[argCount], "--no-mipmaps") == 0)
+        {
+            gBuildMipmaps = false;
+        }
+        else if (strcmp(argv[argCount], "--bench-mipmaps") == 0)
+        {
+            // needs a context, so this one waits until after init(...)
+            benchMipmaps = true;
+        }
+        else if (strcmp(argv[argCount], "--bench-texconv") == 0)
+        {
+            BenchmarkTexelConversion(gTextureWidth, gTextureHeight);
+            return 0;
+        }
+        else if ((strcmp(argv[argCount], "--block-format") == 0) && (argCount + 1 < argc))
+        {
+            if (!ParseBlockFormat(argv[++argCount], &gBlockFormat))
+            {
+                printf("unknown block format '%s'\n", argv[argCount]);
+                return 1;
+            }
+        }
+        else if ((strcmp(argv[argCount], "--write-dds") == 0) && (argCount + 1 < argc))
+        {
+            BlockFormat fileFormat = (gBlockFormat != BLOCK_FORMAT_NONE) ? gBlockFormat : 
+                BLOCK_FORMAT_BC7;
+            return CompressTextureToFile(argv[++argCount], gTextureWidth, gTextureHeight, 
+                gBuildMipmaps, fileFormat) ? 0 : 1;
+        }
+        else if ((strcmp(argv[argCount], "--load-dds") == 0) && (argCount + 1 < argc))
+        {
+            gDdsFilePath = argv[++argCount];
+        }
+        else if (strcmp(argv[argCount], "--stream-texture") == 0)
+        {
+            gStreamTexture = true;
+        }
+        else if (strcmp(argv[argCount], "--bench-streaming") == 0)
+        {
+            // needs a context too
+            benchStreaming = true;
+        }
+        else if (strcmp(argv[argCount], "--bench-bc") == 0)
+        {
+            BenchmarkBlockCompression(gTextureWidth, gTextureHeight);
+            return 0;
+        }
+        else if (strcmp(argv[argCount], "--headless") == 0)
+        {
+            gHeadless = true;
+        }
+        else if ((strcmp(argv[argCount], "--frames") == 0) && (argCount + 1 < argc))
+        {
+            gHeadlessFrames = (unsigned int)atoi(argv[++argCount]);
+        }
+        else if ((strcmp(argv[argCount], "--screenshot") == 0) && (argCount + 1 < argc))
+        {
+            gScreenshotPath = argv[++argCount];
+        }
+        else if ((strcmp(argv[argCount], "--bench") == 0) && (argCount + 1 < argc))
+        {
+            gBenchFrames = (unsigned int)atoi(argv[++argCount]);
+        }
+        else if ((strcmp(argv[argCount], "--bench-report") == 0) && (argCount + 1 < argc))
+        {
+            gBenchReportPath = argv[++argCount];
+        }
+        else if ((strcmp(argv[argCount], "--program-cache") == 0) && (argCount + 1 < argc))
+        {
+            gProgramCacheDirectory = argv[++argCount];
+        }
+        else if (strcmp(argv[argCount], "--no-program-cache") == 0)
+        {
+            gProgramCacheDirectory = 0;
+        }
+        else if (strcmp(argv[argCount], "--hot-reload") == 0)
+        {
+            gHotReloadShaders = true;
+        }
+        else if (strcmp(argv[argCount], "--gpu-profile") == 0)
+        {
+            // needs a context too
+            gpuProfile = true;
+        }
+        else if ((strcmp(argv[argCount], "--sprites") == 0) && (argCount + 1 < argc))
+        {
+            gNumSprites = (unsigned int)atoi(argv[++argCount]);
+        }
+        else if ((strcmp(argv[argCount], "--bench-sprites") == 0) && (argCount + 1 < argc))
+        {
+            // needs a context too
+            benchSprites = (unsigned int)atoi(argv[++argCount]);
+        }
+        else if ((strcmp(argv[argCount], "--meshes") == 0) && (argCount + 1 < argc))
+        {
+            gNumMeshes = (unsigned int)atoi(argv[++argCount]);
+        }
+        else if ((strcmp(argv[argCount], "--bench-multidraw") == 0) && (argCount + 1 < argc))
+        {
+            // needs a context too
+            benchMeshes = (unsigned int)atoi(argv[++argCount]);
+        }
+        else if (strcmp(argv[argCount], "--gpu-cull") == 0)
+        {
+            gGpuCull = true;
+        }
+        else if ((strcmp(argv[argCount], "--cull-view") == 0) && (argCount + 1 < argc))
+        {
+            gCullViewSize = (float)atof(argv[++argCount]);
+        }
+        else if ((strcmp(argv[argCount], "--bench-gpu-cull") == 0) && (argCount + 1 < argc))
+        {
+            // needs a context too
+            benchCulledMeshes = (unsigned int)atoi(argv[++argCount]);
+        }
+        else if ((strcmp(argv[argCount], "--bench-arena") == 0) && (argCount + 1 < argc))
+        {
+            // needs a context too
+            benchArenaMeshes = (unsigned int)atoi(argv[++argCount]);
+        }
+        else if ((strcmp(argv[argCount], "--vertex-format") == 0) && (argCount + 1 < argc))
+        {
+            if (!ParseVertexFormat(argv[++argCount], &gVertexFormat))
+            {
+                printf("unknown vertex format '%s'\n", argv[argCount]);
+                return 1;
+            }
+        }
+        else if ((strcmp(argv[argCount], "--bench-vertex-formats") == 0) && 
+            (argCount + 1 < argc))
+        {
+            // needs a context too
+            benchVertexFormatMeshes = (unsigned int)atoi(argv[++argCount]);
+        }
+    }
+
     if (!init(argc, argv))
     {
         // bad initialization; it will take care of it's own error reporting
         return 1;
     }
 
+    // a benchmark that was asked for runs instead of the frames, and then everything goes the 
+    // same way out (1 if it couldn't be set up)
+    int benchExitCode = -1;
+    if (benchMipmaps)
+    {
+        BenchmarkMipmapGeneration(gTextureWidth, gTextureHeight, gTexelFormat);
+        benchExitCode = 0;
+    }
+    else if (benchStreaming)
+    {
+        BenchmarkTextureStreaming(gTextureWidth, gTextureHeight, gTexelFormat);
+        benchExitCode = 0;
+    }
+    else if (benchSprites > 0)
+    {
+        // the batcher's program has to be built before anything can be timed
+        benchExitCode = 1;
+        if (CreateSprites(0))
+        {
+            gProgramBuilder.WaitForAll();
+            BenchmarkSpriteBatching(benchSprites, gSpriteBatcher);
+            benchExitCode = 0;
+        }
+    }
+    else if (benchMeshes > 0)
+    {
+        // same for the renderer's program
+        benchExitCode = 1;
+        if (CreateMeshes(0))
+        {
+            gProgramBuilder.WaitForAll();
+            BenchmarkMultiDraw(benchMeshes, gMultiDrawRenderer);
+            benchExitCode = 0;
+        }
+    }
+    else if (benchCulledMeshes > 0)
+    {
+        benchExitCode = 1;
+        if (CreateMeshes(0) && CreateGpuCuller())
+        {
+            gProgramBuilder.WaitForAll();
+            BenchmarkGpuCulling(benchCulledMeshes, gMultiDrawRenderer, gGpuCuller);
+            benchExitCode = 0;
+        }
+    }
+    else if (benchMeshletVertices > 0)
+    {
+        benchExitCode = 1;
+        if (CreateMeshes(0) && CreateGpuCuller())
+        {
+            gProgramBuilder.WaitForAll();
+            BenchmarkMeshlets(benchMeshletVertices, gMultiDrawRenderer, gGpuCuller);
+            benchExitCode = 0;
+        }
+    }
+    else if (benchQueueDraws > 0)
+    {
+        // a few programs to switch between, all built from the main program's shaders
+        // Note: The benchmark deletes them when it's done.
+        const unsigned int NUM_QUEUE_PROGRAMS = 4;
+        std::vector<ShaderSource> shaders;
+        benchExitCode = 1;
+        if (ReadShaderSources("shader.vert", "shader.frag", &shaders))
+        {
+            std::vector<GLuint> queueProgramIds;
+            for (unsigned int programCount = 0; programCount < NUM_QUEUE_PROGRAMS; 
+                programCount++)
+            {
+                gProgramBuilder.Submit("render queue", shaders, 
+                    [&queueProgramIds](GLuint programId)
+                {
+                    if (programId != 0)
+                    {
+                        queueProgramIds.push_back(programId);
+                    }
+                });
+            }
+            gProgramBuilder.WaitForAll();
+            BenchmarkRenderQueue(benchQueueDraws, queueProgramIds);
+            benchExitCode = 0;
+        }
+    }
+    else if (benchArenaMeshes > 0)
+    {
+        BenchmarkBufferArena(benchArenaMeshes);
+        benchExitCode = 0;
+    }
+    else if (benchMeshLoadVertices > 0)
+    {
+        BenchmarkMeshLoading(benchMeshLoadVertices, gVertexFormat);
+        benchExitCode = 0;
+    }
+    else if (benchVertexFormatMeshes > 0)
+    {
+        // the renderer and its vertex arena are made over for each format
+        // Note: The arena's triangle goes with it, but nothing is drawn after this.
+        printf("vertex formats: %u meshes, renderer '%s'\n", benchVertexFormatMeshes, 
+            (const char *)glGetString(GL_RENDERER));
+        benchExitCode = 0;
+        for (int formatIndex = 0; (benchExitCode == 0) && (formatIndex < VERTEX_FORMAT_COUNT); 
+            formatIndex++)
+        {
+            gVertexFormat = (VertexFormat)formatIndex;
+            gMultiDrawRenderer.Shutdown();
+            gVertexArena.Shutdown();
+            if (!gVertexArena.Init(GetVertexFormatDescription(gVertexFormat).bytesPerVertex, 
+                64 * 1024) || !CreateMeshes(0))
+            {
+                benchExitCode = 1;
+            }
+            else
+            {
+                gProgramBuilder.WaitForAll();
+                BenchmarkVertexFormat(benchVertexFormatMeshes, gMultiDrawRenderer);
+            }
+        }
+    }
+    if (benchExitCode >= 0)
+    {
+        // Note: Without "--headless" there is no headless context, and the window's goes with 
+        // the process.
+        ShutdownRendering();
+        gHeadlessContext.Destroy();
+        return benchExitCode;
+    }
+
+    if (gpuProfile)
+    {
+        gGpuProfiler.Init();
+    }
+    if (gBenchFrames > 0)
+    {
+        // display() takes it from here and quits when it's done
+        const unsigned int NUM_WARMUP_FRAMES = 10;
+        gFrameBenchmark.Start(gBenchFrames, NUM_WARMUP_FRAMES);
+        gHeadlessFrames = NUM_WARMUP_FRAMES + gBenchFrames;
+    }
+    if (gHeadless)
+    {
+        return RunHeadless(gHeadlessFrames, gScreenshotPath) ? 0 : 1;
+    }
 
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
     glutKeyboardFunc(keyboard);
+
+    // closing the window ends the main loop too (see CreateGlutWindow(...)), and this is 
+    // called while the window's context is still current
+    glutCloseFunc(ShutdownRendering);
     glutMainLoop();
 
     return 0;
@@ -0,0 +1,22 @@
+#version 440
+
+// a MeshVertex (see Mesh.h)
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec2 texCoord;
+
+// one of each per draw (a MeshInstance, picked by the draw's base instance)
+layout (location = 2) in vec3 instancePosition;
+layout (location = 3) in float instanceScale;
+layout (location = 4) in vec4 instanceTint;
+
+// must have the same names as their corresponding "in" items in the frag shader
+smooth out vec2 texPos;
+flat out vec4 tint;
+
+void main()
+{
+    texPos = texCoord;
+    tint = instanceTint;
+	gl_Position = vec4(instancePosition + (pos * instanceScale), 1.0f);
+}
+
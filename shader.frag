@@ -14,13 +14,14 @@ out vec4 finalFragColor;
 void main()
 {
     // retrieve the texture values from the sampler (??you sure??)
-    // Note: Texture2D(...) can be explicitly called, or the shader compilation can figure
-    // out from the sampler type and the texture position type that this is a 2D texture.
+    // Note: texture(...) figures out from the sampler type and the texture position type that 
+    // this is a 2D texture.  The old texture2D(...) isn't in the core profile, and strict 
+    // drivers (Mesa, which headless mode runs on) won't compile it.
     // Also Note: Cannot use an integer for the sampler.  Even though the sampler is understood
     // as sampler 0, 1, 2, 3, etc., it is not an integer.  Attempting to make it one will cause
     // the shader to fail compilation.
-    vec3 colorFromTexture = texture2D(tex, texPos).rgb;
-    float alphaFromTexture = texture2D(tex, texPos).a;
+    vec3 colorFromTexture = texture(tex, texPos).rgb;
+    float alphaFromTexture = texture(tex, texPos).a;
 
     // set "vert out color" multiplier to 0.0f to let color data come from texture, or 
     // 1.0f to let it come from the color that was indexed with the vertex
@@ -1,7 +1,8 @@
 #version 440
 
+// a MeshVertex (see Mesh.h)
 layout (location = 0) in vec3 pos;
-layout (location = 1) in vec3 color;    
+layout (location = 1) in vec2 texCoord;
 
 // must have the same name as its corresponding "in" item in the frag shader
 smooth out vec3 vertOutColor;
@@ -9,8 +10,9 @@ smooth out vec2 texPos;
 
 void main()
 {
-    vertOutColor = color;
-    texPos = pos.xy;
+    // there's no per-vertex color anymore (location 1 was a "vec3 color" that was being fed
+    // the 2 texture coordinates), so the frag shader's color multiplier has nothing to mix in
+    vertOutColor = vec3(0.0f);
+    texPos = texCoord;
 	gl_Position = vec4(pos, 1.0f);
 }
-
@@ -0,0 +1,14 @@
+#version 440
+
+// must have the same names as their corresponding "out" items in the vert shader
+smooth in vec2 texPos;
+flat in vec4 tint;
+uniform sampler2D tex;
+
+out vec4 finalFragColor;
+
+void main()
+{
+    finalFragColor = texture(tex, texPos) * tint;
+}
+
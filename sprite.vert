@@ -0,0 +1,23 @@
+#version 440
+
+// the unit quad (see SpriteBatcher.h)
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec2 texCoord;
+
+// one of each per sprite (a SpriteInstance)
+layout (location = 2) in vec2 instancePosition;
+layout (location = 3) in vec2 instanceScale;
+layout (location = 4) in vec4 instanceUvRect;
+layout (location = 5) in vec4 instanceTint;
+
+// must have the same names as their corresponding "in" items in the frag shader
+smooth out vec2 texPos;
+flat out vec4 tint;
+
+void main()
+{
+    texPos = mix(instanceUvRect.xy, instanceUvRect.zw, texCoord);
+    tint = instanceTint;
+	gl_Position = vec4(instancePosition + (pos.xy * instanceScale), pos.z, 1.0f);
+}
+